@@ -297,6 +297,7 @@ extern "C" {
 
 typedef int (*_cups_sccb_t)(int print_fd, int device_fd, int snmp_fd,
 			    http_addr_t *addr, int use_bc);
+typedef int (*_cups_persist_cb_t)(int argc, char *argv[]);
 
 
 /*
@@ -317,12 +318,21 @@ extern int		backendGetMakeModel(const char *device_id,
 extern int		backendNetworkSideCB(int print_fd, int device_fd,
 			                     int snmp_fd, http_addr_t *addr,
 					     int use_bc);
+extern int		backendPersistJob(int argc, char *argv[],
+			                  const char *device_uri,
+					  const char *prefix, int idle,
+					  const int *canceled,
+					  _cups_persist_cb_t job_cb,
+					  void (*done_cb)(void));
 extern ssize_t		backendRunLoop(int print_fd, int device_fd, int snmp_fd,
 			               http_addr_t *addr, int use_bc,
 			               int update_state, _cups_sccb_t side_cb);
 extern int		backendSNMPSupplies(int snmp_fd, http_addr_t *addr,
 			                    int *page_count,
 					    int *printer_state);
+extern char		*backendURIFile(const char *uri, const char *prefix,
+			                const char *ext, char *filename,
+					size_t filesize);
 extern int		backendWaitLoop(int snmp_fd, http_addr_t *addr,
 			                int use_bc, _cups_sccb_t side_cb);
 
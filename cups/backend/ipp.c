@@ -24,6 +24,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
 #if defined(HAVE_GSSAPI) && defined(HAVE_XPC)
 #  include <xpc/xpc.h>
 #  define kPMPrintUIToolAgent	"com.apple.printuitool.agent"
@@ -50,6 +52,14 @@ extern void	xpc_connection_set_target_uid(xpc_connection_t connection,
 #define _CUPS_JSR_JOB_RELEASE_WAIT		0x20
 
 
+/*
+ * Shared printer monitoring...
+ */
+
+#define _CUPS_MONITOR_LEASE	3600	/* Subscription lease in seconds */
+#define _CUPS_MONITOR_REFRESH	60	/* Seconds between forced updates */
+
+
 /*
  * Types...
  */
@@ -69,6 +79,8 @@ typedef struct _cups_monitor_s		/**** Monitoring data ****/
   http_encryption_t	encryption;	/* Use encryption? */
   ipp_jstate_t		job_state;	/* Current job state */
   ipp_pstate_t		printer_state;	/* Current printer state */
+  volatile int		stop,		/* Stop monitoring? */
+			running;	/* Is the monitor running? */
 } _cups_monitor_t;
 
 
@@ -125,6 +137,10 @@ static const char * const pattrs[] =	/* Printer attributes we want */
   "printer-state-message",
   "printer-state-reasons"
 };
+static http_t		*persist_http = NULL;
+					/* Connection kept between jobs */
+static int		persist_server = 0;
+					/* Sending jobs for other backends? */
 static const char * const remote_job_states[] =
 {					/* Remote job state keywords */
   "+cups-remote-pending",
@@ -156,7 +172,22 @@ static void		cancel_job(http_t *http, const char *uri, int id,
 static ipp_pstate_t	check_printer_state(http_t *http, const char *uri,
 		                            const char *resource,
 					    const char *user, int version);
+static int		monitor_events(http_t *http, _cups_monitor_t *monitor,
+			               int sub_id, int *sequence,
+				       int *interval);
+static int		monitor_find_job(_cups_monitor_t *monitor, ipp_t *ipp,
+			                 ipp_attribute_t **reasons);
+static ipp_t		*monitor_load(_cups_monitor_t *monitor);
+static int		monitor_lock(_cups_monitor_t *monitor, int *fd);
+static ipp_t		*monitor_poll(http_t *http, _cups_monitor_t *monitor);
 static void		*monitor_printer(_cups_monitor_t *monitor);
+static void		monitor_save(_cups_monitor_t *monitor, ipp_t *state);
+static void		monitor_sleep(_cups_monitor_t *monitor, int seconds);
+static void		monitor_stop(_cups_monitor_t *monitor);
+static int		monitor_subscribe(http_t *http,
+			                  _cups_monitor_t *monitor);
+static int		monitor_timeout_cb(http_t *http,
+			                   _cups_monitor_t *monitor);
 static ipp_t		*new_request(ipp_op_t op, int version, const char *uri,
 			             const char *user, const char *title,
 				     int num_options, cups_option_t *options,
@@ -169,6 +200,8 @@ static ipp_t		*new_request(ipp_op_t op, int version, const char *uri,
 static const char	*password_cb(const char *prompt, http_t *http,
 			             const char *method, const char *resource,
 			             int *user_data);
+static void		persist_close(void);
+static int		persist_main(int argc, char *argv[]);
 static const char	*quote_string(const char *s, char *q, size_t qsize);
 static void		report_attr(ipp_attribute_t *attr);
 static void		report_printer_state(ipp_t *ipp);
@@ -176,6 +209,7 @@ static void		report_printer_state(ipp_t *ipp);
 static int		run_as_user(char *argv[], uid_t uid,
 			            const char *device_uri, int fd);
 #endif /* HAVE_GSSAPI && HAVE_XPC */
+static int		send_job(int argc, char *argv[]);
 static void		sigterm_handler(int sig);
 static int		timeout_cb(http_t *http, void *user_data);
 static void		update_reasons(ipp_attribute_t *attr, const char *s);
@@ -192,11 +226,85 @@ static void		update_reasons(ipp_attribute_t *attr, const char *s);
 int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line args */
      char *argv[])			/* I - Command-line arguments */
+{
+#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
+  struct sigaction action;		/* Actions for POSIX signals */
+#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
+
+
+ /*
+  * Make sure status messages are not buffered...
+  */
+
+  setbuf(stderr, NULL);
+
+ /*
+  * Ignore SIGPIPE and catch SIGTERM signals...
+  */
+
+#ifdef HAVE_SIGSET
+  sigset(SIGPIPE, SIG_IGN);
+  sigset(SIGTERM, sigterm_handler);
+#elif defined(HAVE_SIGACTION)
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &action, NULL);
+
+  sigemptyset(&action.sa_mask);
+  sigaddset(&action.sa_mask, SIGTERM);
+  action.sa_handler = sigterm_handler;
+  sigaction(SIGTERM, &action, NULL);
+#else
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGTERM, sigterm_handler);
+#endif /* HAVE_SIGSET */
+
+ /*
+  * Check command-line...
+  */
+
+  if (argc == 1)
+  {
+    char *s;
+
+    if ((s = strrchr(argv[0], '/')) != NULL)
+      s ++;
+    else
+      s = argv[0];
+
+    printf("network %s \"Unknown\" \"%s (%s)\"\n",
+           s, _cupsLangString(cupsLangDefault(),
+	                      _("Internet Printing Protocol")), s);
+    return (CUPS_BACKEND_OK);
+  }
+  else if (argc < 6)
+  {
+    _cupsLangPrintf(stderr,
+                    _("Usage: %s job-id user title copies options [file]"),
+		    argv[0]);
+    return (CUPS_BACKEND_STOP);
+  }
+
+  return (send_job(argc, argv));
+}
+
+
+/*
+ * 'send_job()' - Send a job to the printer or server.
+ *
+ * A persistent backend process calls this for every job it sends, so
+ * everything allocated here is freed before returning.
+ */
+
+static int				/* O - Exit status */
+send_job(int  argc,			/* I - Number of command-line args */
+         char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
+  int		status;			/* Exit status */
   int		send_options;		/* Send job options? */
-  int		num_options;		/* Number of printer options */
-  cups_option_t	*options;		/* Printer options */
+  int		num_options = 0;	/* Number of printer options */
+  cups_option_t	*options = NULL;	/* Printer options */
   const char	*device_uri;		/* Device URI */
   char		scheme[255],		/* Scheme in URI */
 		hostname[1024],		/* Hostname */
@@ -207,9 +315,9 @@ main(int  argc,				/* I - Number of command-line args */
 		*value,			/* Value of option */
 		sep;			/* Separator character */
   int		password_tries = 0;	/* Password tries */
-  http_addrlist_t *addrlist;		/* Address of printer */
+  http_addrlist_t *addrlist = NULL;	/* Address of printer */
   int		snmp_enabled = 1;	/* Is SNMP enabled? */
-  int		snmp_fd,		/* SNMP socket */
+  int		snmp_fd = -1,		/* SNMP socket */
 		start_count,		/* Page count via SNMP at start */
 		page_count,		/* Page count via SNMP */
 		have_supplies;		/* Printer supports supply levels? */
@@ -222,11 +330,11 @@ main(int  argc,				/* I - Number of command-line args */
   char		uri[HTTP_MAX_URI];	/* Updated URI without user/pass */
   char		print_job_name[1024];	/* Update job-name for Print-Job */
   http_status_t	http_status;		/* Status of HTTP request */
-  ipp_status_t	ipp_status;		/* Status of IPP request */
-  http_t	*http;			/* HTTP connection */
+  ipp_status_t	ipp_status = IPP_OK;	/* Status of IPP request */
+  http_t	*http = NULL;		/* HTTP connection */
   ipp_t		*request,		/* IPP request */
 		*response,		/* IPP response */
-		*supported;		/* get-printer-attributes response */
+		*supported = NULL;	/* get-printer-attributes response */
   time_t	start_time;		/* Time of first connect */
   int		contimeout;		/* Connection timeout */
   int		delay,			/* Delay for retries */
@@ -235,6 +343,7 @@ main(int  argc,				/* I - Number of command-line args */
   int		waitjob,		/* Wait for job complete? */
 		waitjob_tries = 0,	/* Number of times we've waited */
 		waitprinter;		/* Wait for printer ready? */
+  int		persist;		/* Seconds to keep connection */
   _cups_monitor_t monitor;		/* Monitoring data */
   ipp_attribute_t *job_id_attr;		/* job-id attribute */
   int		job_id;			/* job-id value */
@@ -265,9 +374,6 @@ main(int  argc,				/* I - Number of command-line args */
   int		fd;			/* File descriptor */
   off_t		bytes = 0;		/* Bytes copied */
   char		buffer[16384];		/* Copy buffer */
-#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
-  struct sigaction action;		/* Actions for POSIX signals */
-#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
   int		version;		/* IPP version */
   ppd_file_t	*ppd = NULL;		/* PPD file */
   _ppd_cache_t	*pc = NULL;		/* PPD cache and mapping data */
@@ -275,57 +381,10 @@ main(int  argc,				/* I - Number of command-line args */
 
 
  /*
-  * Make sure status messages are not buffered...
-  */
-
-  setbuf(stderr, NULL);
-
- /*
-  * Ignore SIGPIPE and catch SIGTERM signals...
-  */
-
-#ifdef HAVE_SIGSET
-  sigset(SIGPIPE, SIG_IGN);
-  sigset(SIGTERM, sigterm_handler);
-#elif defined(HAVE_SIGACTION)
-  memset(&action, 0, sizeof(action));
-  action.sa_handler = SIG_IGN;
-  sigaction(SIGPIPE, &action, NULL);
-
-  sigemptyset(&action.sa_mask);
-  sigaddset(&action.sa_mask, SIGTERM);
-  action.sa_handler = sigterm_handler;
-  sigaction(SIGTERM, &action, NULL);
-#else
-  signal(SIGPIPE, SIG_IGN);
-  signal(SIGTERM, sigterm_handler);
-#endif /* HAVE_SIGSET */
-
- /*
-  * Check command-line...
+  * Nothing has been started or allocated yet...
   */
 
-  if (argc == 1)
-  {
-    char *s;
-
-    if ((s = strrchr(argv[0], '/')) != NULL)
-      s ++;
-    else
-      s = argv[0];
-
-    printf("network %s \"Unknown\" \"%s (%s)\"\n",
-           s, _cupsLangString(cupsLangDefault(),
-	                      _("Internet Printing Protocol")), s);
-    return (CUPS_BACKEND_OK);
-  }
-  else if (argc < 6)
-  {
-    _cupsLangPrintf(stderr,
-                    _("Usage: %s job-id user title copies options [file]"),
-		    argv[0]);
-    return (CUPS_BACKEND_STOP);
-  }
+  memset(&monitor, 0, sizeof(monitor));
 
  /*
   * Get the device URI...
@@ -364,7 +423,7 @@ main(int  argc,				/* I - Number of command-line args */
         return (run_as_user(argv, uid, device_uri, 0));
       else
       {
-        int status = 0;			/* Exit status */
+        status = CUPS_BACKEND_OK;
 
         for (i = 6; i < argc && !status && !job_canceled; i ++)
 	{
@@ -431,6 +490,7 @@ main(int  argc,				/* I - Number of command-line args */
   waitjob     = 1;
   waitprinter = 1;
   contimeout  = 7 * 24 * 60 * 60;
+  persist     = 0;
 
   if ((optptr = strchr(resource, '?')) != NULL)
   {
@@ -574,6 +634,15 @@ main(int  argc,				/* I - Number of command-line args */
 	if (atoi(value) > 0)
 	  contimeout = atoi(value);
       }
+      else if (!_cups_strcasecmp(name, "persist"))
+      {
+       /*
+        * Send jobs using a backend process that keeps its connection open
+	* for up to N idle seconds...
+	*/
+
+        persist = atoi(value);
+      }
       else
       {
        /*
@@ -587,6 +656,20 @@ main(int  argc,				/* I - Number of command-line args */
     }
   }
 
+ /*
+  * Hand the job to the persistent backend process for this printer, if
+  * requested...
+  */
+
+  if (persist > 0 && !persist_server && !getenv("AUTH_UID") &&
+      (i = backendPersistJob(argc, argv, device_uri, "ipp-persist", persist,
+                             &job_canceled, persist_main,
+			     persist_close)) >= 0)
+  {
+    status = i;
+    goto done;
+  }
+
  /*
   * If we have 7 arguments, print the file named on the command-line.
   * Otherwise, copy stdin to a temporary file and print the temporary
@@ -671,15 +754,43 @@ main(int  argc,				/* I - Number of command-line args */
     if (getenv("CLASS") != NULL)
     {
       update_reasons(NULL, "-connecting-to-device");
-      return (CUPS_BACKEND_STOP);
+      status = CUPS_BACKEND_STOP;
+      goto done;
     }
 
     if (job_canceled)
-      return (CUPS_BACKEND_OK);
+    {
+      status = CUPS_BACKEND_OK;
+      goto done;
+    }
+  }
+
+  if (persist_http && httpWait(persist_http, 0))
+  {
+   /*
+    * The printer closed the connection we kept from the last job...
+    */
+
+    httpClose(persist_http);
+    persist_http = NULL;
+  }
+
+  if (persist_http)
+  {
+    fputs("DEBUG: Using the connection from the previous job.\n", stderr);
+
+    http = persist_http;
+    httpSetAuthString(http, NULL, NULL);
+  }
+  else
+  {
+    http = httpConnect2(hostname, port, addrlist, AF_UNSPEC, cupsEncryption(),
+                        1, 0, NULL);
+
+    if (persist_server)
+      persist_http = http;
   }
 
-  http = httpConnect2(hostname, port, addrlist, AF_UNSPEC, cupsEncryption(), 1,
-                      0, NULL);
   httpSetTimeout(http, 30.0, timeout_cb, NULL);
 
   if (httpIsEncrypted(http))
@@ -702,7 +813,9 @@ main(int  argc,				/* I - Number of command-line args */
       if (trusts[trust])
       {
         update_reasons(NULL, trusts[trust]);
-        return (CUPS_BACKEND_STOP);
+        httpFreeCredentials(creds);
+        status = CUPS_BACKEND_STOP;
+        goto done;
       }
 
       if (httpLoadCredentials(NULL, &lcreds, hostname))
@@ -741,10 +854,12 @@ main(int  argc,				/* I - Number of command-line args */
 
   if (num_files == 0)
   {
-    if (!backendWaitLoop(snmp_fd, &(addrlist->addr), 0, backendNetworkSideCB))
-      return (CUPS_BACKEND_OK);
-    else if ((bytes = read(0, buffer, sizeof(buffer))) <= 0)
-      return (CUPS_BACKEND_OK);
+    if (!backendWaitLoop(snmp_fd, &(addrlist->addr), 0, backendNetworkSideCB) ||
+        (bytes = read(0, buffer, sizeof(buffer))) <= 0)
+    {
+      status = CUPS_BACKEND_OK;
+      goto done;
+    }
   }
 
  /*
@@ -758,7 +873,7 @@ main(int  argc,				/* I - Number of command-line args */
     fprintf(stderr, "DEBUG: Connecting to %s:%d\n", hostname, port);
     _cupsLangPrintFilter(stderr, "INFO", _("Connecting to printer."));
 
-    if (httpReconnect(http))
+    if ((http != persist_http || http->fd < 0) && httpReconnect(http))
     {
       int error = errno;		/* Connection error */
 
@@ -789,7 +904,8 @@ main(int  argc,				/* I - Number of command-line args */
 
 	update_reasons(NULL, "-connecting-to-device");
 
-        return (CUPS_BACKEND_FAILED);
+        status = CUPS_BACKEND_FAILED;
+        goto done;
       }
 
       fprintf(stderr, "DEBUG: Connection error: %s\n", strerror(errno));
@@ -802,7 +918,8 @@ main(int  argc,				/* I - Number of command-line args */
 	  _cupsLangPrintFilter(stderr, "ERROR",
 	                       _("The printer is not responding."));
 	  update_reasons(NULL, "-connecting-to-device");
-	  return (CUPS_BACKEND_FAILED);
+	  status = CUPS_BACKEND_FAILED;
+	  goto done;
 	}
 
 	switch (error)
@@ -846,9 +963,15 @@ main(int  argc,				/* I - Number of command-line args */
   while (http->fd < 0);
 
   if (job_canceled)
-    return (CUPS_BACKEND_OK);
+  {
+    status = CUPS_BACKEND_OK;
+    goto done;
+  }
   else if (!http)
-    return (CUPS_BACKEND_FAILED);
+  {
+    status = CUPS_BACKEND_FAILED;
+    goto done;
+  }
 
   update_reasons(NULL, "-connecting-to-device");
   _cupsLangPrintFilter(stderr, "INFO", _("Connected to printer."));
@@ -938,7 +1061,8 @@ main(int  argc,				/* I - Number of command-line args */
 	{
 	  _cupsLangPrintFilter(stderr, "ERROR",
 	                       _("The printer is not responding."));
-	  return (CUPS_BACKEND_FAILED);
+	  status = CUPS_BACKEND_FAILED;
+	  goto done;
 	}
 
 	_cupsLangPrintFilter(stderr, "INFO", _("The printer is in use."));
@@ -981,9 +1105,8 @@ main(int  argc,				/* I - Number of command-line args */
 			     _("The printer configuration is incorrect or the "
 			       "printer no longer exists."));
 
-	ippDelete(supported);
-
-	return (CUPS_BACKEND_STOP);
+	status = CUPS_BACKEND_STOP;
+	goto done;
       }
       else if (ipp_status == IPP_FORBIDDEN ||
                ipp_status == IPP_AUTHENTICATION_CANCELED)
@@ -997,7 +1120,8 @@ main(int  argc,				/* I - Number of command-line args */
           auth_info_required = "username,password";
 
 	fprintf(stderr, "ATTR: auth-info-required=%s\n", auth_info_required);
-	return (CUPS_BACKEND_AUTH_REQUIRED);
+	status = CUPS_BACKEND_AUTH_REQUIRED;
+	goto done;
       }
       else if (ipp_status != IPP_NOT_AUTHORIZED)
       {
@@ -1223,7 +1347,10 @@ main(int  argc,				/* I - Number of command-line args */
   while (!job_canceled && ipp_status > IPP_OK_CONFLICT);
 
   if (job_canceled)
-    return (CUPS_BACKEND_OK);
+  {
+    status = CUPS_BACKEND_OK;
+    goto done;
+  }
 
  /*
   * See if the printer is accepting jobs and is not stopped; if either
@@ -1254,16 +1381,14 @@ main(int  argc,				/* I - Number of command-line args */
                            _("Unable to contact printer, queuing on next "
 		             "printer in class."));
 
-      ippDelete(supported);
-      httpClose(http);
-
      /*
       * Sleep 5 seconds to keep the job from requeuing too rapidly...
       */
 
       sleep(5);
 
-      return (CUPS_BACKEND_FAILED);
+      status = CUPS_BACKEND_FAILED;
+      goto done;
     }
   }
 
@@ -1343,7 +1468,8 @@ main(int  argc,				/* I - Number of command-line args */
     if ((fd = cupsTempFd(tmpfilename, sizeof(tmpfilename))) < 0)
     {
       perror("DEBUG: Unable to create temporary file");
-      return (CUPS_BACKEND_FAILED);
+      status = CUPS_BACKEND_FAILED;
+      goto done;
     }
 
     _cupsLangPrintFilter(stderr, "INFO", _("Copying print data."));
@@ -1351,12 +1477,18 @@ main(int  argc,				/* I - Number of command-line args */
     if ((compatsize = write(fd, buffer, (size_t)bytes)) < 0)
     {
       perror("DEBUG: Unable to write temporary file");
-      return (CUPS_BACKEND_FAILED);
+      close(fd);
+      status = CUPS_BACKEND_FAILED;
+      goto done;
     }
 
     if ((bytes = backendRunLoop(-1, fd, snmp_fd, &(addrlist->addr), 0, 0,
 		                backendNetworkSideCB)) < 0)
-      return (CUPS_BACKEND_FAILED);
+    {
+      close(fd);
+      status = CUPS_BACKEND_FAILED;
+      goto done;
+    }
 
     compatsize += bytes;
 
@@ -1400,6 +1532,8 @@ main(int  argc,				/* I - Number of command-line args */
   monitor.encryption    = cupsEncryption();
   monitor.job_state     = IPP_JOB_PENDING;
   monitor.printer_state = IPP_PRINTER_IDLE;
+  monitor.stop          = 0;
+  monitor.running       = 1;
 
   if (create_job)
   {
@@ -1412,7 +1546,8 @@ main(int  argc,				/* I - Number of command-line args */
     monitor.job_name = print_job_name;
   }
 
-  _cupsThreadCreate((_cups_thread_func_t)monitor_printer, &monitor);
+  if (!_cupsThreadCreate((_cups_thread_func_t)monitor_printer, &monitor))
+    monitor.running = 0;
 
  /*
   * Validate access to the printer...
@@ -1541,7 +1676,9 @@ main(int  argc,				/* I - Number of command-line args */
 	  if ((fd = open(files[0], O_RDONLY)) < 0)
 	  {
 	    _cupsLangPrintError("ERROR", _("Unable to open print file"));
-	    return (CUPS_BACKEND_FAILED);
+	    ippDelete(request);
+	    status = CUPS_BACKEND_FAILED;
+	    goto done;
 	  }
 	}
 	else
@@ -1749,7 +1886,9 @@ main(int  argc,				/* I - Number of command-line args */
 	    if ((fd = open(files[i], O_RDONLY)) < 0)
 	    {
 	      _cupsLangPrintError("ERROR", _("Unable to open print file"));
-	      return (CUPS_BACKEND_FAILED);
+	      ippDelete(request);
+	      status = CUPS_BACKEND_FAILED;
+	      goto done;
 	    }
 	  }
 	}
@@ -1954,7 +2093,9 @@ main(int  argc,				/* I - Number of command-line args */
       * Do the request...
       */
 
-      httpReconnect(http);
+      if (http != persist_http)
+        httpReconnect(http);
+
       response   = cupsDoRequest(http, request, resource);
       ipp_status = cupsLastError();
 
@@ -2106,30 +2247,11 @@ main(int  argc,				/* I - Number of command-line args */
 #endif /* HAVE_GSSAPI */
 
  /*
-  * Free memory...
+  * Return the queue status...
   */
 
   cleanup:
 
-  cupsFreeOptions(num_options, options);
-  _ppdCacheDestroy(pc);
-  ppdClose(ppd);
-
-  httpClose(http);
-
-  ippDelete(supported);
-
- /*
-  * Remove the temporary file(s) if necessary...
-  */
-
-  if (tmpfilename[0])
-    unlink(tmpfilename);
-
- /*
-  * Return the queue status...
-  */
-
   if (ipp_status == IPP_NOT_AUTHORIZED || ipp_status == IPP_FORBIDDEN ||
       ipp_status == IPP_AUTHENTICATION_CANCELED ||
       ipp_status <= IPP_OK_CONFLICT)
@@ -2146,16 +2268,16 @@ main(int  argc,				/* I - Number of command-line args */
 
   if (ipp_status == IPP_NOT_AUTHORIZED || ipp_status == IPP_FORBIDDEN ||
       ipp_status == IPP_AUTHENTICATION_CANCELED)
-    return (CUPS_BACKEND_AUTH_REQUIRED);
+    status = CUPS_BACKEND_AUTH_REQUIRED;
   else if (ipp_status == IPP_STATUS_ERROR_CUPS_ACCOUNT_LIMIT_REACHED ||
 	   ipp_status == IPP_STATUS_ERROR_CUPS_ACCOUNT_INFO_NEEDED ||
 	   ipp_status == IPP_STATUS_ERROR_CUPS_ACCOUNT_CLOSED ||
 	   ipp_status == IPP_STATUS_ERROR_CUPS_ACCOUNT_AUTHORIZATION_FAILED)
-    return (CUPS_BACKEND_HOLD);
+    status = CUPS_BACKEND_HOLD;
   else if (ipp_status == IPP_INTERNAL_ERROR)
-    return (CUPS_BACKEND_STOP);
+    status = CUPS_BACKEND_STOP;
   else if (ipp_status == IPP_CONFLICT)
-    return (CUPS_BACKEND_FAILED);
+    status = CUPS_BACKEND_FAILED;
   else if (ipp_status == IPP_REQUEST_VALUE ||
 	   ipp_status == IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES ||
            ipp_status == IPP_DOCUMENT_FORMAT || job_canceled < 0)
@@ -2171,12 +2293,58 @@ main(int  argc,				/* I - Number of command-line args */
     else
       _cupsLangPrintFilter(stderr, "ERROR", _("Print job canceled at printer."));
 
-    return (CUPS_BACKEND_CANCEL);
+    status = CUPS_BACKEND_CANCEL;
   }
   else if (ipp_status > IPP_OK_CONFLICT && ipp_status != IPP_ERROR_JOB_CANCELED)
-    return (CUPS_BACKEND_RETRY_CURRENT);
+    status = CUPS_BACKEND_RETRY_CURRENT;
   else
-    return (CUPS_BACKEND_OK);
+    status = CUPS_BACKEND_OK;
+
+ /*
+  * Free memory...
+  */
+
+  done:
+
+  monitor_stop(&monitor);
+
+  cupsFreeOptions(num_options, options);
+  _ppdCacheDestroy(pc);
+  ppdClose(ppd);
+
+  if (http != persist_http)
+    httpClose(http);
+  else if (job_canceled || ipp_status > IPP_OK_CONFLICT ||
+           status != CUPS_BACKEND_OK)
+  {
+   /*
+    * Don't reuse a connection that might be in the middle of a request...
+    */
+
+    httpClose(http);
+    persist_http = NULL;
+  }
+
+  ippDelete(supported);
+  httpAddrFreeList(addrlist);
+
+  if (snmp_fd >= 0)
+    _cupsSNMPClose(snmp_fd);
+
+  cupsArrayDelete(state_reasons);
+  state_reasons = NULL;
+
+ /*
+  * Remove the temporary file(s) if necessary...
+  */
+
+  if (tmpfilename[0])
+  {
+    unlink(tmpfilename);
+    tmpfilename[0] = '\0';
+  }
+
+  return (status);
 }
 
 
@@ -2276,80 +2444,509 @@ check_printer_state(
 
 
 /*
- * 'monitor_printer()' - Monitor the printer state.
+ * 'monitor_events()' - Wait for events from the printer's subscription.
  */
 
-static void *				/* O - Thread exit code */
-monitor_printer(
-    _cups_monitor_t *monitor)		/* I - Monitoring data */
+static int				/* O - Number of events or -1 on error */
+monitor_events(
+    http_t          *http,		/* I  - Connection to printer */
+    _cups_monitor_t *monitor,		/* I  - Monitoring data */
+    int             sub_id,		/* I  - Subscription ID */
+    int             *sequence,		/* IO - Last sequence number */
+    int             *interval)		/* O  - Seconds before next check */
 {
-  http_t	*http;			/* Connection to printer */
   ipp_t		*request,		/* IPP request */
 		*response;		/* IPP response */
   ipp_attribute_t *attr;		/* Attribute in response */
-  int		delay,			/* Current delay */
-		prev_delay;		/* Previous delay */
-  ipp_op_t	job_op;			/* Operation to use */
-  int		job_id;			/* Job ID */
-  const char	*job_name;		/* Job name */
-  ipp_jstate_t	job_state;		/* Job state */
-  const char	*job_user;		/* Job originating user name */
-  int		password_tries = 0;	/* Password tries */
+  int		events = 0;		/* Number of events */
 
 
  /*
-  * Make a copy of the printer connection...
+  * Send a Get-Notifications request, asking the printer to hold the
+  * response until something happens...
   */
 
-  http = httpConnect2(monitor->hostname, monitor->port, NULL, AF_UNSPEC,
-                      monitor->encryption, 1, 0, NULL);
-  httpSetTimeout(http, 30.0, timeout_cb, NULL);
-  if (username[0])
-    cupsSetUser(username);
+  request = ippNewRequest(IPP_GET_NOTIFICATIONS);
+  ippSetVersion(request, monitor->version / 10, monitor->version % 10);
 
-  cupsSetPasswordCB2((cups_password_cb2_t)password_cb, &password_tries);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+	       NULL, monitor->uri);
 
- /*
-  * Loop until the job is canceled, aborted, or completed.
-  */
+  if (monitor->user && monitor->user[0])
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+		 "requesting-user-name", NULL, monitor->user);
+
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                "notify-subscription-ids", sub_id);
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                "notify-sequence-numbers", *sequence + 1);
+  ippAddBoolean(request, IPP_TAG_OPERATION, "notify-wait", 1);
+
+  response = cupsDoRequest(http, request, monitor->resource);
+
+  fprintf(stderr, "DEBUG: (monitor) Get-Notifications: %s (%s)\n",
+	  ippErrorString(cupsLastError()), cupsLastErrorString());
+
+  if (cupsLastError() > IPP_OK_CONFLICT)
+  {
+    ippDelete(response);
+    return (-1);
+  }
+
+ /*
+  * Count the events and remember the last sequence number...
+  */
+
+  *interval = 0;
+
+  for (attr = response ? response->attrs : NULL; attr; attr = attr->next)
+  {
+    if (attr->group_tag == IPP_TAG_OPERATION && attr->name &&
+        !strcmp(attr->name, "notify-get-interval") &&
+        attr->value_tag == IPP_TAG_INTEGER)
+      *interval = attr->values[0].integer;
+    else if (attr->group_tag == IPP_TAG_EVENT_NOTIFICATION && attr->name &&
+             !strcmp(attr->name, "notify-sequence-number") &&
+             attr->value_tag == IPP_TAG_INTEGER)
+    {
+      events ++;
+
+      if (attr->values[0].integer > *sequence)
+        *sequence = attr->values[0].integer;
+    }
+  }
+
+  ippDelete(response);
+
+  fprintf(stderr, "DEBUG: (monitor) %d events, notify-get-interval=%d\n",
+          events, *interval);
+
+  return (events);
+}
+
+
+/*
+ * 'monitor_find_job()' - Find the job we are monitoring in a list of jobs.
+ */
+
+static int				/* O - 1 if found, 0 otherwise */
+monitor_find_job(
+    _cups_monitor_t *monitor,		/* I - Monitoring data */
+    ipp_t           *ipp,		/* I - Jobs */
+    ipp_attribute_t **reasons)		/* O - job-state-reasons, if any */
+{
+  ipp_attribute_t *attr,		/* Current attribute */
+		*job_reasons;		/* job-state-reasons for job */
+  int		job_id;			/* Job ID */
+  const char	*job_name;		/* Job name */
+  ipp_jstate_t	job_state;		/* Job state */
+  const char	*job_user;		/* Job originating user name */
+
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+  {
+    job_id      = 0;
+    job_name    = NULL;
+    job_state   = IPP_JOB_PENDING;
+    job_user    = NULL;
+    job_reasons = NULL;
+
+    while (attr && attr->group_tag != IPP_TAG_JOB)
+      attr = attr->next;
+
+    if (!attr)
+      break;
+
+    while (attr && attr->group_tag == IPP_TAG_JOB)
+    {
+      if (!strcmp(attr->name, "job-id") &&
+	  attr->value_tag == IPP_TAG_INTEGER)
+	job_id = attr->values[0].integer;
+      else if (!strcmp(attr->name, "job-name") &&
+	       (attr->value_tag == IPP_TAG_NAME ||
+		attr->value_tag == IPP_TAG_NAMELANG))
+	job_name = attr->values[0].string.text;
+      else if (!strcmp(attr->name, "job-state") &&
+	       attr->value_tag == IPP_TAG_ENUM)
+	job_state = (ipp_jstate_t)attr->values[0].integer;
+      else if (!strcmp(attr->name, "job-originating-user-name") &&
+	       (attr->value_tag == IPP_TAG_NAME ||
+		attr->value_tag == IPP_TAG_NAMELANG))
+	job_user = attr->values[0].string.text;
+      else if (!strcmp(attr->name, "job-state-reasons") &&
+	       attr->value_tag == IPP_TAG_KEYWORD)
+	job_reasons = attr;
+
+      attr = attr->next;
+    }
+
+    if (job_id > 0 &&
+        (job_id == monitor->job_id ||
+         (monitor->job_id <= 0 && job_name &&
+          !strcmp(job_name, monitor->job_name) && job_user && monitor->user &&
+          !strcmp(job_user, monitor->user))))
+    {
+      monitor->job_id    = job_id;
+      monitor->job_state = job_state;
+      *reasons           = job_reasons;
+
+      return (1);
+    }
+
+    if (!attr)
+      break;
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'monitor_load()' - Load the printer and job status saved by the process
+ *                    that is monitoring the printer.
+ */
+
+static ipp_t *				/* O - Status or NULL */
+monitor_load(_cups_monitor_t *monitor)	/* I - Monitoring data */
+{
+  char		filename[1024];		/* State filename */
+  int		fd;			/* State file descriptor */
+  struct stat	fileinfo;		/* State file information */
+  cups_file_t	*fp;			/* State file */
+  ipp_t		*state;			/* Printer and job status */
+  ipp_attribute_t *attr;		/* printer-uri attribute */
+
+
+ /*
+  * Ignore missing state files, files we didn't write, and anything older
+  * than the monitoring process's refresh interval...
+  */
+
+  if (!backendURIFile(monitor->uri, "ipp-monitor", "state", filename,
+                      sizeof(filename)) ||
+      (fd = open(filename, O_RDONLY | O_NOFOLLOW)) < 0)
+    return (NULL);
+
+  if (fstat(fd, &fileinfo) || !S_ISREG(fileinfo.st_mode) ||
+      fileinfo.st_uid != getuid() ||
+      (time(NULL) - fileinfo.st_mtime) > _CUPS_MONITOR_REFRESH ||
+      (fp = cupsFileOpenFd(fd, "r")) == NULL)
+  {
+    close(fd);
+    return (NULL);
+  }
+
+  state = ippNew();
+
+  if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, state) != IPP_DATA ||
+      (attr = ippFindAttribute(state, "printer-uri", IPP_TAG_URI)) == NULL ||
+      strcmp(attr->values[0].string.text, monitor->uri))
+  {
+    ippDelete(state);
+    state = NULL;
+  }
+
+  cupsFileClose(fp);
+
+  return (state);
+}
+
+
+/*
+ * 'monitor_lock()' - Try to become the process that monitors the printer.
+ */
+
+static int				/* O  - 1 if monitoring, 0 otherwise */
+monitor_lock(_cups_monitor_t *monitor,	/* I  - Monitoring data */
+             int             *fd)	/* IO - Lock file descriptor */
+{
+  char		filename[1024];		/* Lock filename */
+  struct stat	fileinfo;		/* Lock file information */
+  struct flock	lock;			/* Lock */
+
+
+  if (*fd < 0)
+  {
+    if (!backendURIFile(monitor->uri, "ipp-monitor", "lock", filename,
+                        sizeof(filename)) ||
+        (*fd = open(filename, O_RDWR | O_CREAT | O_NOFOLLOW, 0600)) < 0)
+    {
+     /*
+      * Can't share the monitoring with other jobs, so do it ourselves...
+      */
+
+      return (1);
+    }
+
+    if (fstat(*fd, &fileinfo) || !S_ISREG(fileinfo.st_mode) ||
+        fileinfo.st_uid != getuid())
+    {
+     /*
+      * Don't trust a lock file that somebody else owns...
+      */
+
+      close(*fd);
+      *fd = -1;
+
+      return (1);
+    }
+
+    fcntl(*fd, F_SETFD, fcntl(*fd, F_GETFD) | FD_CLOEXEC);
+  }
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  return (!fcntl(*fd, F_SETLK, &lock));
+}
+
+
+/*
+ * 'monitor_poll()' - Get the current printer and job status.
+ */
+
+static ipp_t *				/* O - Status or NULL */
+monitor_poll(http_t          *http,	/* I - Connection to printer */
+             _cups_monitor_t *monitor)	/* I - Monitoring data */
+{
+  ipp_t		*request,		/* IPP request */
+		*printer,		/* Get-Printer-Attributes response */
+		*jobs,			/* Get-Jobs response */
+		*state;			/* Printer and job status */
+  ipp_attribute_t *attr;		/* Current attribute */
+  int		separator;		/* Need a separator? */
+
+
+ /*
+  * Get the printer attributes...
+  */
+
+  request = ippNewRequest(IPP_GET_PRINTER_ATTRIBUTES);
+  ippSetVersion(request, monitor->version / 10, monitor->version % 10);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+	       NULL, monitor->uri);
+
+  if (monitor->user && monitor->user[0])
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+		 "requesting-user-name", NULL, monitor->user);
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+		"requested-attributes",
+		(int)(sizeof(pattrs) / sizeof(pattrs[0])), NULL, pattrs);
+
+  printer = cupsDoRequest(http, request, monitor->resource);
+
+  fprintf(stderr, "DEBUG: (monitor) Get-Printer-Attributes: %s (%s)\n",
+	  ippErrorString(cupsLastError()), cupsLastErrorString());
+
+  if (!printer)
+    return (NULL);
+
+ /*
+  * Then the active jobs on the printer...
+  */
+
+  request = ippNewRequest(IPP_GET_JOBS);
+  ippSetVersion(request, monitor->version / 10, monitor->version % 10);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+	       NULL, monitor->uri);
+
+  if (monitor->user && monitor->user[0])
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+		 "requesting-user-name", NULL, monitor->user);
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+		"requested-attributes",
+		(int)(sizeof(jattrs) / sizeof(jattrs[0])), NULL, jattrs);
+
+  jobs = cupsDoRequest(http, request, monitor->resource);
+
+  fprintf(stderr, "DEBUG: (monitor) Get-Jobs: %s (%s)\n",
+	  ippErrorString(cupsLastError()), cupsLastErrorString());
+
+ /*
+  * Combine them into a single message tagged with the printer URI...
+  */
+
+  state = ippNew();
+
+  ippAddString(state, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL,
+               monitor->uri);
+
+  for (attr = printer->attrs; attr; attr = attr->next)
+    if (attr->group_tag == IPP_TAG_PRINTER && attr->name)
+      ippCopyAttribute(state, attr, 0);
+
+  for (attr = jobs ? jobs->attrs : NULL, separator = 1; attr;
+       attr = attr->next)
+  {
+    if (attr->group_tag != IPP_TAG_JOB || !attr->name)
+    {
+      separator = 1;
+      continue;
+    }
+
+    if (separator)
+    {
+      ippAddSeparator(state);
+      separator = 0;
+    }
+
+    ippCopyAttribute(state, attr, 0);
+  }
+
+  ippDelete(printer);
+  ippDelete(jobs);
+
+  return (state);
+}
+
+
+/*
+ * 'monitor_printer()' - Monitor the printer state.
+ *
+ * Only one backend process monitors each printer URI at a time, saving the
+ * printer and job status in a file that the other processes read.
+ */
+
+static void *				/* O - Thread exit code */
+monitor_printer(
+    _cups_monitor_t *monitor)		/* I - Monitoring data */
+{
+  http_t	*http;			/* Connection to printer */
+  ipp_t		*request,		/* IPP request */
+		*response,		/* IPP response */
+		*state = NULL;		/* Printer and job status */
+  ipp_attribute_t *attr,		/* Attribute in response */
+		*reasons;		/* job-state-reasons for job */
+  int		delay,			/* Current delay */
+		prev_delay;		/* Previous delay */
+  int		lock_fd = -1,		/* Monitoring lock file */
+		monitoring,		/* Are we monitoring the printer? */
+		sub_id = 0,		/* Subscription ID or -1 if none */
+		sequence = 0,		/* Last notify-sequence-number */
+		interval = 0,		/* notify-get-interval value */
+		events = 0;		/* Number of events */
+  time_t	state_time = 0;		/* Time of last status update */
+  int		password_tries = 0;	/* Password tries */
+
+
+ /*
+  * Make a copy of the printer connection...
+  */
+
+  http = httpConnect2(monitor->hostname, monitor->port, NULL, AF_UNSPEC,
+                      monitor->encryption, 1, 0, NULL);
+  httpSetTimeout(http, 1.0, (http_timeout_cb_t)monitor_timeout_cb, monitor);
+  if (username[0])
+    cupsSetUser(username);
+
+  cupsSetPasswordCB2((cups_password_cb2_t)password_cb, &password_tries);
+
+ /*
+  * Loop until the job is canceled, aborted, or completed.
+  */
 
   delay = _cupsNextDelay(0, &prev_delay);
 
   monitor->job_reasons = 0;
 
-  while (monitor->job_state < IPP_JOB_CANCELED && !job_canceled)
+  while (monitor->job_state < IPP_JOB_CANCELED && !job_canceled &&
+         !monitor->stop)
   {
-   /*
-    * Reconnect to the printer...
-    */
+    reasons  = NULL;
+    response = NULL;
+    events   = 0;
 
-    if (!httpReconnect(http))
+    if ((monitoring = monitor_lock(monitor, &lock_fd)) != 0)
     {
      /*
-      * Connected, so check on the printer state...
+      * We are monitoring the printer for everyone - reconnect, wait for
+      * events if the printer supports subscriptions, and then update the
+      * printer and job status...
       */
 
-      monitor->printer_state = check_printer_state(http, monitor->uri,
-                                                   monitor->resource,
-						   monitor->user,
-						   monitor->version);
-      if (cupsLastError() <= IPP_OK_CONFLICT)
-        password_tries = 0;
+      if (!httpReconnect(http))
+      {
+        if (!sub_id)
+        {
+          sub_id = monitor_subscribe(http, monitor);
+          events = 1;
+        }
+        else if (sub_id > 0 &&
+                 (events = monitor_events(http, monitor, sub_id, &sequence,
+                                          &interval)) < 0)
+	{
+	  sub_id = -1;
+	  events = 1;
+	}
+	else if (sub_id < 0)
+	  events = 1;
 
+        if (events || !state ||
+            (time(NULL) - state_time) >= _CUPS_MONITOR_REFRESH)
+        {
+          if ((response = monitor_poll(http, monitor)) != NULL)
+          {
+            ippDelete(state);
+            state      = response;
+            response   = NULL;
+            state_time = time(NULL);
+          }
+        }
+
+	if (cupsLastError() <= IPP_OK_CONFLICT)
+	  password_tries = 0;
+
+        if (state)
+          monitor_save(monitor, state);
+
+       /*
+        * Disconnect from the printer if we are polling - we'll reconnect on
+        * the next poll...
+        */
+
+        if (sub_id < 0)
+	  _httpDisconnect(http);
+      }
+    }
+    else
+    {
      /*
-      * Check the status of the job itself...
+      * Another job is monitoring the printer, use its status...
       */
 
-      job_op  = (monitor->job_id > 0 && monitor->get_job_attrs) ?
-                    IPP_GET_JOB_ATTRIBUTES : IPP_GET_JOBS;
-      request = ippNewRequest(job_op);
+      ippDelete(state);
+      state = monitor_load(monitor);
+    }
+
+    if (state)
+    {
+      report_printer_state(state);
+
+      if ((attr = ippFindAttribute(state, "printer-state",
+				   IPP_TAG_ENUM)) != NULL)
+	monitor->printer_state = (ipp_pstate_t)attr->values[0].integer;
+    }
+
+   /*
+    * Check the status of the job itself, asking the printer directly if it
+    * isn't in the list of active jobs...
+    */
+
+    if ((!state || !monitor_find_job(monitor, state, &reasons)) &&
+        monitor->job_id > 0 && monitor->get_job_attrs && !httpReconnect(http))
+    {
+      request = ippNewRequest(IPP_GET_JOB_ATTRIBUTES);
       ippSetVersion(request, monitor->version / 10, monitor->version % 10);
 
       ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
 		   NULL, monitor->uri);
-      if (job_op == IPP_GET_JOB_ATTRIBUTES)
-	ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id",
-		      monitor->job_id);
+      ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id",
+		    monitor->job_id);
 
       if (monitor->user && monitor->user[0])
 	ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
@@ -2365,164 +2962,309 @@ monitor_printer(
 
       response = cupsDoRequest(http, request, monitor->resource);
 
-      fprintf(stderr, "DEBUG: (monitor) %s: %s (%s)\n", ippOpString(job_op),
+      fprintf(stderr, "DEBUG: (monitor) Get-Job-Attributes: %s (%s)\n",
 	      ippErrorString(cupsLastError()), cupsLastErrorString());
 
       if (cupsLastError() <= IPP_OK_CONFLICT)
         password_tries = 0;
 
-      if (job_op == IPP_GET_JOB_ATTRIBUTES)
-      {
-	if ((attr = ippFindAttribute(response, "job-state",
-				     IPP_TAG_ENUM)) != NULL)
-	  monitor->job_state = (ipp_jstate_t)attr->values[0].integer;
-	else
-	  monitor->job_state = IPP_JOB_COMPLETED;
-      }
-      else if (response)
-      {
-        for (attr = response->attrs; attr; attr = attr->next)
-        {
-          job_id    = 0;
-          job_name  = NULL;
-          job_state = IPP_JOB_PENDING;
-          job_user  = NULL;
-
-          while (attr && attr->group_tag != IPP_TAG_JOB)
-            attr = attr->next;
+      if ((attr = ippFindAttribute(response, "job-state",
+				   IPP_TAG_ENUM)) != NULL)
+	monitor->job_state = (ipp_jstate_t)attr->values[0].integer;
+      else
+	monitor->job_state = IPP_JOB_COMPLETED;
 
-          if (!attr)
-            break;
+      reasons = ippFindAttribute(response, "job-state-reasons",
+                                 IPP_TAG_KEYWORD);
 
-          while (attr && attr->group_tag == IPP_TAG_JOB)
-          {
-            if (!strcmp(attr->name, "job-id") &&
-                attr->value_tag == IPP_TAG_INTEGER)
-              job_id = attr->values[0].integer;
-            else if (!strcmp(attr->name, "job-name") &&
-		     (attr->value_tag == IPP_TAG_NAME ||
-		      attr->value_tag == IPP_TAG_NAMELANG))
-              job_name = attr->values[0].string.text;
-            else if (!strcmp(attr->name, "job-state") &&
-		     attr->value_tag == IPP_TAG_ENUM)
-              job_state = (ipp_jstate_t)attr->values[0].integer;
-            else if (!strcmp(attr->name, "job-originating-user-name") &&
-		     (attr->value_tag == IPP_TAG_NAME ||
-		      attr->value_tag == IPP_TAG_NAMELANG))
-              job_user = attr->values[0].string.text;
-
-            attr = attr->next;
-          }
+      if (sub_id <= 0)
+        _httpDisconnect(http);
+    }
 
-          if (job_id > 0 && job_name && !strcmp(job_name, monitor->job_name) &&
-              job_user && monitor->user && !strcmp(job_user, monitor->user))
-          {
-            monitor->job_id    = job_id;
-            monitor->job_state = job_state;
-            break;
-          }
+    if (reasons)
+    {
+      int	i, new_reasons = 0;	/* Looping var, new reasons */
 
-          if (!attr)
-            break;
-        }
+      for (i = 0; i < reasons->num_values; i ++)
+      {
+	if (!strcmp(reasons->values[i].string.text,
+		    "account-authorization-failed"))
+	  new_reasons |= _CUPS_JSR_ACCOUNT_AUTHORIZATION_FAILED;
+	else if (!strcmp(reasons->values[i].string.text, "account-closed"))
+	  new_reasons |= _CUPS_JSR_ACCOUNT_CLOSED;
+	else if (!strcmp(reasons->values[i].string.text,
+	                 "account-info-needed"))
+	  new_reasons |= _CUPS_JSR_ACCOUNT_INFO_NEEDED;
+	else if (!strcmp(reasons->values[i].string.text,
+			 "account-limit-reached"))
+	  new_reasons |= _CUPS_JSR_ACCOUNT_LIMIT_REACHED;
+	else if (!strcmp(reasons->values[i].string.text, "job-password-wait"))
+	  new_reasons |= _CUPS_JSR_JOB_PASSWORD_WAIT;
+	else if (!strcmp(reasons->values[i].string.text, "job-release-wait"))
+	  new_reasons |= _CUPS_JSR_JOB_RELEASE_WAIT;
       }
 
-      if ((attr = ippFindAttribute(response, "job-state-reasons",
-                                   IPP_TAG_KEYWORD)) != NULL)
+      if (new_reasons != monitor->job_reasons)
       {
-        int	i, new_reasons = 0;	/* Looping var, new reasons */
-
-        for (i = 0; i < attr->num_values; i ++)
-        {
-          if (!strcmp(attr->values[i].string.text,
-                      "account-authorization-failed"))
-            new_reasons |= _CUPS_JSR_ACCOUNT_AUTHORIZATION_FAILED;
-          else if (!strcmp(attr->values[i].string.text, "account-closed"))
-            new_reasons |= _CUPS_JSR_ACCOUNT_CLOSED;
-          else if (!strcmp(attr->values[i].string.text, "account-info-needed"))
-            new_reasons |= _CUPS_JSR_ACCOUNT_INFO_NEEDED;
-          else if (!strcmp(attr->values[i].string.text,
-                           "account-limit-reached"))
-            new_reasons |= _CUPS_JSR_ACCOUNT_LIMIT_REACHED;
-          else if (!strcmp(attr->values[i].string.text, "job-password-wait"))
-            new_reasons |= _CUPS_JSR_JOB_PASSWORD_WAIT;
-          else if (!strcmp(attr->values[i].string.text, "job-release-wait"))
-            new_reasons |= _CUPS_JSR_JOB_RELEASE_WAIT;
-        }
-
-        if (new_reasons != monitor->job_reasons)
-        {
-	  if (new_reasons & _CUPS_JSR_ACCOUNT_AUTHORIZATION_FAILED)
-	    fputs("JOBSTATE: account-authorization-failed\n", stderr);
-	  else if (new_reasons & _CUPS_JSR_ACCOUNT_CLOSED)
-	    fputs("JOBSTATE: account-closed\n", stderr);
-	  else if (new_reasons & _CUPS_JSR_ACCOUNT_INFO_NEEDED)
-	    fputs("JOBSTATE: account-info-needed\n", stderr);
-	  else if (new_reasons & _CUPS_JSR_ACCOUNT_LIMIT_REACHED)
-	    fputs("JOBSTATE: account-limit-reached\n", stderr);
-	  else if (new_reasons & _CUPS_JSR_JOB_PASSWORD_WAIT)
-	    fputs("JOBSTATE: job-password-wait\n", stderr);
-	  else if (new_reasons & _CUPS_JSR_JOB_RELEASE_WAIT)
-	    fputs("JOBSTATE: job-release-wait\n", stderr);
-	  else
-	    fputs("JOBSTATE: job-printing\n", stderr);
+	if (new_reasons & _CUPS_JSR_ACCOUNT_AUTHORIZATION_FAILED)
+	  fputs("JOBSTATE: account-authorization-failed\n", stderr);
+	else if (new_reasons & _CUPS_JSR_ACCOUNT_CLOSED)
+	  fputs("JOBSTATE: account-closed\n", stderr);
+	else if (new_reasons & _CUPS_JSR_ACCOUNT_INFO_NEEDED)
+	  fputs("JOBSTATE: account-info-needed\n", stderr);
+	else if (new_reasons & _CUPS_JSR_ACCOUNT_LIMIT_REACHED)
+	  fputs("JOBSTATE: account-limit-reached\n", stderr);
+	else if (new_reasons & _CUPS_JSR_JOB_PASSWORD_WAIT)
+	  fputs("JOBSTATE: job-password-wait\n", stderr);
+	else if (new_reasons & _CUPS_JSR_JOB_RELEASE_WAIT)
+	  fputs("JOBSTATE: job-release-wait\n", stderr);
+	else
+	  fputs("JOBSTATE: job-printing\n", stderr);
 
-	  monitor->job_reasons = new_reasons;
-        }
+	monitor->job_reasons = new_reasons;
       }
+    }
 
-      ippDelete(response);
-
-      fprintf(stderr, "DEBUG: (monitor) job-state=%s\n",
-              ippEnumString("job-state", monitor->job_state));
+    ippDelete(response);
 
-      if (!job_canceled &&
-          (monitor->job_state == IPP_JOB_CANCELED ||
-	   monitor->job_state == IPP_JOB_ABORTED))
-	job_canceled = -1;
+    fprintf(stderr, "DEBUG: (monitor) job-state=%s\n",
+	    ippEnumString("job-state", monitor->job_state));
 
-     /*
-      * Disconnect from the printer - we'll reconnect on the next poll...
-      */
+    if (!job_canceled &&
+	(monitor->job_state == IPP_JOB_CANCELED ||
+	 monitor->job_state == IPP_JOB_ABORTED))
+      job_canceled = -1;
 
-      _httpDisconnect(http);
-    }
+    if (monitor->job_state >= IPP_JOB_CANCELED || job_canceled ||
+        monitor->stop)
+      break;
 
    /*
-    * Sleep for N seconds...
+    * Sleep for N seconds, or check for more events right away when the
+    * printer sent us some...
     */
 
-    sleep((unsigned)delay);
+    if (monitoring && sub_id > 0)
+    {
+      if (!events)
+        monitor_sleep(monitor, interval > 0 && interval < delay ? interval :
+                                                                  delay);
+    }
+    else
+      monitor_sleep(monitor, delay);
 
     delay = _cupsNextDelay(delay, &prev_delay);
   }
 
  /*
-  * Cancel the job if necessary...
+  * Cancel the job and subscription if necessary...
   */
 
-  if (job_canceled > 0 && monitor->job_id > 0)
+  if ((job_canceled > 0 && monitor->job_id > 0) || sub_id > 0)
   {
     if (!httpReconnect(http))
     {
-      cancel_job(http, monitor->uri, monitor->job_id, monitor->resource,
-                 monitor->user, monitor->version);
+      if (job_canceled > 0 && monitor->job_id > 0)
+      {
+	cancel_job(http, monitor->uri, monitor->job_id, monitor->resource,
+		   monitor->user, monitor->version);
+
+	if (cupsLastError() > IPP_OK_CONFLICT)
+	  _cupsLangPrintFilter(stderr, "ERROR",
+	                       _("Unable to cancel print job."));
+      }
+
+      if (sub_id > 0)
+      {
+        request = ippNewRequest(IPP_CANCEL_SUBSCRIPTION);
+	ippSetVersion(request, monitor->version / 10, monitor->version % 10);
+
+	ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+		     NULL, monitor->uri);
+	ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+		      "notify-subscription-id", sub_id);
+
+	if (monitor->user && monitor->user[0])
+	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+		       "requesting-user-name", NULL, monitor->user);
 
-      if (cupsLastError() > IPP_OK_CONFLICT)
-	_cupsLangPrintFilter(stderr, "ERROR", _("Unable to cancel print job."));
+	ippDelete(cupsDoRequest(http, request, monitor->resource));
+      }
     }
   }
 
  /*
-  * Cleanup and return...
+  * Cleanup and return, letting another job take over monitoring...
   */
 
+  ippDelete(state);
+
+  if (lock_fd >= 0)
+    close(lock_fd);
+
   httpClose(http);
 
+  monitor->running = 0;
+
   return (NULL);
 }
 
 
+/*
+ * 'monitor_save()' - Save the printer and job status for other jobs.
+ */
+
+static void
+monitor_save(_cups_monitor_t *monitor,	/* I - Monitoring data */
+             ipp_t           *state)	/* I - Printer and job status */
+{
+  char		filename[1024],		/* State filename */
+		tempext[32],		/* Temporary extension */
+		tempfile[1024];		/* Temporary filename */
+  int		fd;			/* Temporary file descriptor */
+  cups_file_t	*fp;			/* State file */
+
+
+ /*
+  * Write to a temporary file and rename it so that readers always see a
+  * complete file...
+  */
+
+  snprintf(tempext, sizeof(tempext), "state.%d", (int)getpid());
+
+  if (!backendURIFile(monitor->uri, "ipp-monitor", "state", filename,
+                      sizeof(filename)) ||
+      !backendURIFile(monitor->uri, "ipp-monitor", tempext, tempfile,
+                      sizeof(tempfile)))
+    return;
+
+  unlink(tempfile);
+
+  if ((fd = open(tempfile, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW,
+                 0600)) < 0)
+    return;
+
+  if ((fp = cupsFileOpenFd(fd, "w")) == NULL)
+  {
+    close(fd);
+    unlink(tempfile);
+    return;
+  }
+
+  ippSetState(state, IPP_STATE_IDLE);
+
+  if (ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL, state) != IPP_DATA)
+  {
+    cupsFileClose(fp);
+    unlink(tempfile);
+    return;
+  }
+
+  if (cupsFileClose(fp) || rename(tempfile, filename))
+    unlink(tempfile);
+}
+
+
+/*
+ * 'monitor_sleep()' - Sleep until it is time to check the printer again.
+ */
+
+static void
+monitor_sleep(_cups_monitor_t *monitor,	/* I - Monitoring data */
+              int             seconds)	/* I - Seconds to sleep */
+{
+  while (seconds > 0 && !monitor->stop && !job_canceled)
+  {
+    sleep(1);
+    seconds --;
+  }
+}
+
+
+/*
+ * 'monitor_stop()' - Stop monitoring the printer and wait for the monitor
+ *                    thread to finish.
+ */
+
+static void
+monitor_stop(_cups_monitor_t *monitor)	/* I - Monitoring data */
+{
+  monitor->stop = 1;
+
+  while (monitor->running)
+    usleep(100000);
+}
+
+
+/*
+ * 'monitor_subscribe()' - Subscribe to printer and job events.
+ */
+
+static int				/* O - Subscription ID or -1 if none */
+monitor_subscribe(
+    http_t          *http,		/* I - Connection to printer */
+    _cups_monitor_t *monitor)		/* I - Monitoring data */
+{
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  ipp_attribute_t *attr;		/* notify-subscription-id */
+  int		sub_id = -1;		/* Subscription ID */
+  static const char * const events[] =	/* Events we want */
+  {
+    "job-state-changed",
+    "printer-state-changed"
+  };
+
+
+  request = ippNewRequest(IPP_CREATE_PRINTER_SUBSCRIPTION);
+  ippSetVersion(request, monitor->version / 10, monitor->version % 10);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+	       NULL, monitor->uri);
+
+  if (monitor->user && monitor->user[0])
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+		 "requesting-user-name", NULL, monitor->user);
+
+  ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD,
+               "notify-pull-method", NULL, "ippget");
+  ippAddStrings(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD,
+                "notify-events", (int)(sizeof(events) / sizeof(events[0])),
+                NULL, events);
+  ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
+                "notify-lease-duration", _CUPS_MONITOR_LEASE);
+
+  response = cupsDoRequest(http, request, monitor->resource);
+
+  fprintf(stderr, "DEBUG: (monitor) Create-Printer-Subscription: %s (%s)\n",
+	  ippErrorString(cupsLastError()), cupsLastErrorString());
+
+  if (cupsLastError() <= IPP_OK_CONFLICT &&
+      (attr = ippFindAttribute(response, "notify-subscription-id",
+                               IPP_TAG_INTEGER)) != NULL)
+    sub_id = attr->values[0].integer;
+
+  ippDelete(response);
+
+  return (sub_id);
+}
+
+
+/*
+ * 'monitor_timeout_cb()' - Handle HTTP timeouts for the monitor thread.
+ */
+
+static int				/* O - 1 to continue, 0 to cancel */
+monitor_timeout_cb(
+    http_t          *http,		/* I - Connection to printer (unused) */
+    _cups_monitor_t *monitor)		/* I - Monitoring data */
+{
+  (void)http;
+
+  return (!job_canceled && !monitor->stop);
+}
+
+
 /*
  * 'new_request()' - Create a new print creation or validation request.
  */
@@ -3081,6 +3823,50 @@ password_cb(const char *prompt,		/* I - Prompt (not used) */
 }
 
 
+/*
+ * 'persist_close()' - Close the connection kept between jobs.
+ */
+
+static void
+persist_close(void)
+{
+  if (persist_http)
+  {
+    httpClose(persist_http);
+    persist_http = NULL;
+  }
+}
+
+
+/*
+ * 'persist_main()' - Send a job for another backend process using the
+ *                    connection kept from the last job.
+ */
+
+static int				/* O - Exit status */
+persist_main(int  argc,			/* I - Number of command-line args */
+             char *argv[])		/* I - Command-line arguments */
+{
+ /*
+  * Reset the state from the last job...
+  */
+
+  persist_server  = 1;
+  job_canceled    = 0;
+  uri_credentials = 0;
+  username[0]     = '\0';
+  password        = NULL;
+
+  cupsFreeOptions(num_attr_cache, attr_cache);
+  num_attr_cache = 0;
+  attr_cache     = NULL;
+
+  cupsSetUser(NULL);
+
+  return (send_job(argc, argv));
+}
+
+
 /*
  * 'quote_string()' - Quote a string value.
  */
@@ -3755,6 +4541,7 @@ update_reasons(ipp_attribute_t *attr,	/* I - printer-state-reasons or NULL */
     fprintf(stderr, "%s\n", rem);
 }
 
+
 /*
  * End of "$Id: ipp.c 12078 2014-07-31 11:45:57Z msweet $".
  */
@@ -1055,23 +1055,38 @@ lpd_queue(const char      *hostname,	/* I - Host to connect to */
 	      CUPS_LLCAST filestats.st_size);
 
       tbytes = 0;
-      for (copy = 0; copy < manual_copies; copy ++)
+
+      if (!print_fd)
       {
-	lseek(print_fd, 0, SEEK_SET);
+       /*
+        * Stream the print data from stdin; backendRunLoop() moves it to the
+	* socket with splice() when it can...
+	*/
 
-	while ((nbytes = read(print_fd, buffer, sizeof(buffer))) > 0)
+        if ((tbytes = backendRunLoop(-1, fd, snmp_fd, &(addr->addr), 0, 0,
+	                             NULL)) < 0)
+	  tbytes = 0;
+      }
+      else
+      {
+	for (copy = 0; copy < manual_copies; copy ++)
 	{
-	  _cupsLangPrintFilter(stderr, "INFO",
-			       _("Spooling job, %.0f%% complete."),
-			       100.0 * tbytes / filestats.st_size);
+	  lseek(print_fd, 0, SEEK_SET);
 
-	  if (lpd_write(fd, buffer, (size_t)nbytes) < nbytes)
+	  while ((nbytes = read(print_fd, buffer, sizeof(buffer))) > 0)
 	  {
-	    perror("DEBUG: Unable to send print file to printer");
-            break;
+	    _cupsLangPrintFilter(stderr, "INFO",
+				 _("Spooling job, %.0f%% complete."),
+				 100.0 * tbytes / filestats.st_size);
+
+	    if (lpd_write(fd, buffer, (size_t)nbytes) < nbytes)
+	    {
+	      perror("DEBUG: Unable to send print file to printer");
+	      break;
+	    }
+	    else
+	      tbytes += nbytes;
 	  }
-	  else
-            tbytes += nbytes;
 	}
       }
 
@@ -0,0 +1,663 @@
+/*
+ * "$Id$"
+ *
+ * Persistent backend process support for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * "LICENSE" which should have been included with this file.  If this
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers.
+ */
+
+#include "backend-private.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+
+
+/*
+ * Local functions...
+ */
+
+static int	persist_check_peer(int fd);
+static void	persist_serve(int listen_fd, const char *device_uri,
+		              const char *sockname, int idle,
+			      _cups_persist_cb_t job_cb, void (*done_cb)(void))
+		              __attribute__((noreturn));
+static int	persist_start(const char *device_uri, const char *prefix,
+		              const char *sockname, int idle,
+			      _cups_persist_cb_t job_cb, void (*done_cb)(void));
+
+
+/*
+ * 'backendPersistJob()' - Send a job using the persistent backend process for
+ *                         the device URI, starting one as needed.
+ *
+ * The persistent process calls "job_cb" with the command-line, environment,
+ * and file descriptors of each job in turn, and calls "done_cb" (if not NULL)
+ * before exiting after "idle" seconds without a job or when the scheduler
+ * removes its socket.  -1 is returned if the job should be sent by the calling
+ * process instead, including jobs with AUTH_* credentials since those are
+ * never passed to another process.  The device URI is not passed either; the
+ * persistent process uses the one it was started with.
+ */
+
+int					/* O - Exit status or -1 to send job here */
+backendPersistJob(
+    int                argc,		/* I - Number of command-line args */
+    char               *argv[],		/* I - Command-line arguments */
+    const char         *device_uri,	/* I - Device URI */
+    const char         *prefix,		/* I - Socket filename prefix */
+    int                idle,		/* I - Idle timeout in seconds */
+    const int          *canceled,	/* I - Set when the job is canceled */
+    _cups_persist_cb_t job_cb,		/* I - Job callback */
+    void               (*done_cb)(void))/* I - Exit callback or NULL */
+{
+  int			i, j,		/* Looping vars */
+			fd,		/* Connection to persistent process */
+			tries,		/* Number of connection attempts */
+			envc,		/* Number of environment variables */
+			header[3],	/* argc, envc, and size of strings */
+			fds[5],		/* File descriptors for job */
+			nullfd = -1,	/* /dev/null */
+			status = -1,	/* Exit status */
+			forwarded = 0;	/* Did we forward a cancel? */
+  pid_t			pid = 0;	/* Persistent process ID */
+  ssize_t		bytes;		/* Bytes read */
+  size_t		length;		/* Length of strings */
+  char			sockname[1024],	/* Socket filename */
+			*strings,	/* argv and environment strings */
+			*ptr;		/* Pointer into strings */
+  struct sockaddr_un	addr;		/* Socket address */
+  struct msghdr		msg;		/* Message with file descriptors */
+  struct iovec		iov;		/* Message data */
+  union
+  {
+    struct cmsghdr	hdr;		/* Control message header */
+    char		buffer[CMSG_SPACE(sizeof(fds))];
+					/* Control message buffer */
+  }			control;	/* Control message */
+  struct pollfd		pfd;		/* Status polling */
+  extern char		**environ;	/* Environment variables */
+
+
+ /*
+  * Don't hand authentication credentials to another process...
+  */
+
+  for (i = 0; environ[i]; i ++)
+    if (!strncmp(environ[i], "AUTH_", 5))
+    {
+      fputs("DEBUG: Not using persistent backend for authenticated job.\n",
+            stderr);
+      return (-1);
+    }
+
+ /*
+  * Connect to the persistent process for this device URI...
+  */
+
+  if (!backendURIFile(device_uri, prefix, "sock", sockname, sizeof(sockname)) ||
+      strlen(sockname) >= sizeof(addr.sun_path))
+    return (-1);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_LOCAL;
+  strlcpy(addr.sun_path, sockname, sizeof(addr.sun_path));
+
+  for (tries = 0; tries < 50 && !*canceled; tries ++)
+  {
+    if ((fd = socket(AF_LOCAL, SOCK_STREAM, 0)) < 0)
+      return (-1);
+
+    if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+      break;
+
+    close(fd);
+    fd = -1;
+
+    if (!tries && persist_start(device_uri, prefix, sockname, idle, job_cb,
+                                done_cb))
+      return (-1);
+
+    usleep(100000);
+  }
+
+  if (fd < 0)
+    return (-1);
+
+  if (!persist_check_peer(fd))
+  {
+    fputs("DEBUG: Persistent backend is not running as our user.\n", stderr);
+    close(fd);
+    return (-1);
+  }
+
+ /*
+  * Wait for the persistent process to finish any other job and send us its
+  * process ID...
+  */
+
+  pfd.fd     = fd;
+  pfd.events = POLLIN;
+
+  while (!*canceled && poll(&pfd, 1, 1000) <= 0);
+
+  if (*canceled)
+  {
+    close(fd);
+    return (CUPS_BACKEND_OK);
+  }
+
+  if (read(fd, &pid, sizeof(pid)) != sizeof(pid))
+  {
+    close(fd);
+    return (-1);
+  }
+
+  fprintf(stderr, "DEBUG: Sending job using persistent backend (PID %d).\n",
+          (int)pid);
+
+ /*
+  * Send the command-line, environment (less the device URI), and file
+  * descriptors...
+  */
+
+  for (i = 0, envc = 0, length = 0; environ[i]; i ++)
+    if (strncmp(environ[i], "DEVICE_URI=", 11))
+    {
+      length += strlen(environ[i]) + 1;
+      envc ++;
+    }
+
+  for (i = 0; i < argc; i ++)
+    length += strlen(argv[i]) + 1;
+
+  if ((strings = malloc(length)) == NULL)
+  {
+    close(fd);
+    return (-1);
+  }
+
+  for (i = 0, ptr = strings; i < argc; i ++)
+  {
+    strcpy(ptr, argv[i]);
+    ptr += strlen(ptr) + 1;
+  }
+
+  for (i = 0, j = 0; environ[i] && j < envc; i ++)
+    if (strncmp(environ[i], "DEVICE_URI=", 11))
+    {
+      strcpy(ptr, environ[i]);
+      ptr += strlen(ptr) + 1;
+      j ++;
+    }
+
+  for (i = 0; i < 5; i ++)
+  {
+    if (fcntl(i, F_GETFD) >= 0)
+      fds[i] = i;
+    else
+    {
+      if (nullfd < 0)
+        nullfd = open("/dev/null", O_RDWR);
+
+      fds[i] = nullfd;
+    }
+  }
+
+  header[0] = argc;
+  header[1] = envc;
+  header[2] = (int)length;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+
+  iov.iov_base       = header;
+  iov.iov_len        = sizeof(header);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  control.hdr.cmsg_level = SOL_SOCKET;
+  control.hdr.cmsg_type  = SCM_RIGHTS;
+  control.hdr.cmsg_len   = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(&control.hdr), fds, sizeof(fds));
+
+  if (sendmsg(fd, &msg, 0) != sizeof(header) ||
+      write(fd, strings, length) != (ssize_t)length)
+  {
+    free(strings);
+    close(fd);
+
+    if (nullfd >= 0)
+      close(nullfd);
+
+    _cupsLangPrintFilter(stderr, "ERROR",
+                         _("Unable to send job to persistent backend."));
+    return (CUPS_BACKEND_FAILED);
+  }
+
+  free(strings);
+
+  if (nullfd >= 0)
+    close(nullfd);
+
+ /*
+  * Wait for the exit status, passing along any cancel...
+  */
+
+  for (;;)
+  {
+    if (*canceled && !forwarded && pid > 0)
+    {
+      kill(pid, SIGTERM);
+      forwarded = 1;
+    }
+
+    if (poll(&pfd, 1, 1000) <= 0)
+      continue;
+
+    if ((bytes = read(fd, &status, sizeof(status))) < 0 &&
+        (errno == EINTR || errno == EAGAIN))
+      continue;
+
+    if (bytes != sizeof(status))
+    {
+      _cupsLangPrintFilter(stderr, "ERROR",
+			   _("Persistent backend stopped unexpectedly."));
+      status = CUPS_BACKEND_FAILED;
+    }
+
+    break;
+  }
+
+  close(fd);
+
+  return (status);
+}
+
+
+/*
+ * 'backendURIFile()' - Get the name of a file shared by the backends for a URI.
+ *
+ * The files live in a directory under TMPDIR that only the current user can
+ * access, so other users can't create, replace, or read them.  NULL is
+ * returned when TMPDIR is not set, since a shared directory like /tmp can't
+ * be trusted.
+ */
+
+char *					/* O - Filename or NULL on error */
+backendURIFile(const char *uri,		/* I - Printer or device URI */
+               const char *prefix,	/* I - Filename prefix */
+               const char *ext,		/* I - Extension */
+               char       *filename,	/* I - Filename buffer */
+               size_t     filesize)	/* I - Size of filename buffer */
+{
+  const char	*tmpdir;		/* TMPDIR environment variable */
+  char		dirname[1024];		/* Private directory */
+  struct stat	dirinfo;		/* Directory information */
+  unsigned	hash;			/* Hash of URI */
+
+
+  if ((tmpdir = getenv("TMPDIR")) == NULL)
+    return (NULL);
+
+  snprintf(dirname, sizeof(dirname), "%s/cups-backend-%d", tmpdir,
+           (int)getuid());
+
+  if (mkdir(dirname, 0700) && errno != EEXIST)
+  {
+    fprintf(stderr, "DEBUG: Unable to create \"%s\": %s\n", dirname,
+            strerror(errno));
+    return (NULL);
+  }
+
+  if (lstat(dirname, &dirinfo) || !S_ISDIR(dirinfo.st_mode) ||
+      dirinfo.st_uid != getuid() || (dirinfo.st_mode & 077))
+  {
+    fprintf(stderr, "DEBUG: Not using \"%s\" since it is not a private "
+                    "directory.\n", dirname);
+    return (NULL);
+  }
+
+  for (hash = 5381; *uri; uri ++)
+    hash = hash * 33 + (unsigned)*uri;
+
+  snprintf(filename, filesize, "%s/%s-%08x.%s", dirname, prefix, hash, ext);
+
+  return (filename);
+}
+
+
+/*
+ * 'persist_check_peer()' - Make sure the other end of a connection is running
+ *                          as the same user.
+ */
+
+static int				/* O - 1 if same user, 0 otherwise */
+persist_check_peer(int fd)		/* I - Connected socket */
+{
+#if defined(SO_PEERCRED) && !defined(__OpenBSD__)
+  struct ucred	peercred;		/* Peer credentials */
+  socklen_t	peersize;		/* Size of peer credentials */
+
+
+  peersize = sizeof(peercred);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peercred, &peersize))
+    return (0);
+
+  return (peercred.uid == getuid());
+
+#else
+  uid_t		uid;			/* Peer user ID */
+  gid_t		gid;			/* Peer group ID */
+
+
+  if (getpeereid(fd, &uid, &gid))
+    return (0);
+
+  return (uid == getuid());
+#endif /* SO_PEERCRED && !__OpenBSD__ */
+}
+
+
+/*
+ * 'persist_serve()' - Send jobs for other backend processes using the same
+ *                     connection to the printer.
+ */
+
+static void
+persist_serve(
+    int                listen_fd,	/* I - Listening socket */
+    const char         *device_uri,	/* I - Device URI */
+    const char         *sockname,	/* I - Socket filename */
+    int                idle,		/* I - Idle timeout in seconds */
+    _cups_persist_cb_t job_cb,		/* I - Job callback */
+    void               (*done_cb)(void))/* I - Exit callback or NULL */
+{
+  int			i,		/* Looping var */
+			fd,		/* Connection from backend */
+			nullfd,		/* /dev/null */
+			header[3],	/* argc, envc, and size of strings */
+			fds[5],		/* File descriptors for job */
+			status;		/* Exit status */
+  pid_t			pid = getpid();	/* Our process ID */
+  ssize_t		bytes;		/* Bytes read */
+  size_t		total;		/* Total bytes read */
+  char			*strings,	/* argv and environment strings */
+			*ptr,		/* Pointer into strings */
+			**args,		/* Command-line and environment */
+			uri_env[1024];	/* DEVICE_URI environment variable */
+  struct msghdr		msg;		/* Message with file descriptors */
+  struct iovec		iov;		/* Message data */
+  struct cmsghdr	*cmsg;		/* Control message */
+  union
+  {
+    struct cmsghdr	hdr;		/* Control message header */
+    char		buffer[CMSG_SPACE(sizeof(fds))];
+					/* Control message buffer */
+  }			control;	/* Control message */
+  struct pollfd		pfd;		/* Listening socket polling */
+  extern char		**environ;	/* Environment variables */
+
+
+  nullfd = open("/dev/null", O_RDWR);
+
+  snprintf(uri_env, sizeof(uri_env), "DEVICE_URI=%s", device_uri);
+
+  pfd.fd     = listen_fd;
+  pfd.events = POLLIN;
+
+ /*
+  * Serve jobs until we are idle or the scheduler removes our socket...
+  */
+
+  while (!access(sockname, F_OK) && poll(&pfd, 1, idle * 1000) > 0)
+  {
+    if ((fd = accept(listen_fd, NULL, NULL)) < 0)
+      continue;
+
+    if (!persist_check_peer(fd))
+    {
+      close(fd);
+      continue;
+    }
+
+   /*
+    * Tell the backend who we are, then get the job from it...
+    */
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+
+    iov.iov_base       = header;
+    iov.iov_len        = sizeof(header);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    if (write(fd, &pid, sizeof(pid)) != sizeof(pid) ||
+        recvmsg(fd, &msg, 0) != sizeof(header) ||
+	(cmsg = CMSG_FIRSTHDR(&msg)) == NULL ||
+	cmsg->cmsg_type != SCM_RIGHTS ||
+	cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+    {
+      close(fd);
+      continue;
+    }
+
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    if (header[0] < 6 || header[1] < 0 || header[2] <= 0 ||
+        (strings = malloc((size_t)header[2] + 1)) == NULL)
+    {
+      for (i = 0; i < 5; i ++)
+        close(fds[i]);
+
+      close(fd);
+      continue;
+    }
+
+    for (total = 0; total < (size_t)header[2]; total += (size_t)bytes)
+      if ((bytes = read(fd, strings + total, (size_t)header[2] - total)) <= 0)
+        break;
+
+    strings[header[2]] = '\0';
+
+    args = calloc((size_t)(header[0] + header[1] + 3), sizeof(char *));
+
+    if (total < (size_t)header[2] || !args)
+    {
+      for (i = 0; i < 5; i ++)
+        close(fds[i]);
+
+      free(strings);
+      free(args);
+      close(fd);
+      continue;
+    }
+
+   /*
+    * Split the strings into the command-line and environment...
+    */
+
+    for (i = 0, ptr = strings; i < (header[0] + header[1]); i ++)
+    {
+      if (i < header[0])
+        args[i] = ptr;
+      else
+        args[i + 1] = ptr;
+
+      if (ptr < (strings + header[2]))
+        ptr += strlen(ptr) + 1;
+    }
+
+    args[header[0] + header[1] + 1] = uri_env;
+
+    environ = args + header[0] + 1;
+
+   /*
+    * Use the backend's print data, back-channel, side-channel, and status
+    * pipes...
+    */
+
+    for (i = 0; i < 5; i ++)
+    {
+      dup2(fds[i], i);
+      close(fds[i]);
+    }
+
+   /*
+    * Send the job and return the exit status...
+    */
+
+    status = (*job_cb)(header[0], args);
+
+    if (write(fd, &status, sizeof(status)) != sizeof(status))
+      fputs("DEBUG: Unable to send exit status to backend.\n", stderr);
+
+    close(fd);
+
+    for (i = 0; i < 5; i ++)
+      dup2(nullfd, i);
+
+    environ = NULL;
+
+    free(args);
+    free(strings);
+  }
+
+ /*
+  * Idle, so close the printer connection and exit...
+  */
+
+  unlink(sockname);
+
+  if (done_cb)
+    (*done_cb)();
+
+  exit(0);
+}
+
+
+/*
+ * 'persist_start()' - Start a persistent backend process.
+ *
+ * The process holds a lock on a "pid" file containing its process ID so that
+ * the scheduler can find and stop it, and listens on a socket that only the
+ * current user can connect to.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+persist_start(
+    const char         *device_uri,	/* I - Device URI */
+    const char         *prefix,		/* I - Lock filename prefix */
+    const char         *sockname,	/* I - Socket filename */
+    int                idle,		/* I - Idle timeout in seconds */
+    _cups_persist_cb_t job_cb,		/* I - Job callback */
+    void               (*done_cb)(void))/* I - Exit callback or NULL */
+{
+  pid_t			pid;		/* Child process ID */
+  int			i,		/* Looping var */
+			lock_fd,	/* Lock file */
+			listen_fd,	/* Listening socket */
+			nullfd;		/* /dev/null */
+  char			lockname[1024],	/* Lock filename */
+			pidstr[32];	/* Process ID string */
+  struct flock		lock;		/* Lock */
+  struct sockaddr_un	addr;		/* Socket address */
+
+
+  if ((pid = fork()) < 0)
+    return (-1);
+  else if (pid > 0)
+  {
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+
+    return (0);
+  }
+
+ /*
+  * Detach from the job so the scheduler doesn't wait for us...
+  */
+
+  setsid();
+
+  if (fork())
+    _exit(0);
+
+  if ((nullfd = open("/dev/null", O_RDWR)) >= 0)
+  {
+    for (i = 0; i < 5; i ++)
+      dup2(nullfd, i);
+
+    close(nullfd);
+  }
+
+ /*
+  * Only one persistent process per device URI...
+  */
+
+  if (!backendURIFile(device_uri, prefix, "pid", lockname,
+                      sizeof(lockname)) ||
+      (lock_fd = open(lockname, O_RDWR | O_CREAT | O_NOFOLLOW, 0600)) < 0)
+    _exit(1);
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  if (fcntl(lock_fd, F_SETLK, &lock))
+    _exit(0);
+
+  snprintf(pidstr, sizeof(pidstr), "%d\n", (int)getpid());
+
+  if (ftruncate(lock_fd, 0) ||
+      write(lock_fd, pidstr, strlen(pidstr)) != (ssize_t)strlen(pidstr))
+    _exit(1);
+
+ /*
+  * Listen for jobs...
+  */
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_LOCAL;
+  strlcpy(addr.sun_path, sockname, sizeof(addr.sun_path));
+
+  unlink(sockname);
+  umask(077);
+
+  if ((listen_fd = socket(AF_LOCAL, SOCK_STREAM, 0)) < 0 ||
+      bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+      listen(listen_fd, 128))
+    _exit(1);
+
+  fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+  fcntl(lock_fd, F_SETFD, FD_CLOEXEC);
+
+  persist_serve(listen_fd, device_uri, sockname, idle, job_cb, done_cb);
+
+  return (0);
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -21,7 +21,27 @@
 
 #include "backend-private.h"
 #include <limits.h>
+#include <poll.h>
 #include <sys/select.h>
+#ifdef HAVE_SPLICE
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif /* HAVE_SPLICE */
+
+
+/*
+ * Local constants...
+ */
+
+#define BACKEND_BUFFER_MIN	8192	/* Initial size of print data reads */
+#define BACKEND_BUFFER_MAX	262144	/* Maximum size of print data reads */
+
+
+/*
+ * Local functions...
+ */
+
+static int	backend_can_splice(int print_fd, int device_fd);
 
 
 /*
@@ -129,6 +149,12 @@ backendDrainOutput(int print_fd,	/* I - Print file descriptor */
 
 /*
  * 'backendRunLoop()' - Read and write print and back-channel data.
+ *
+ * Print data is read in chunks that grow from 8k to 256k while the input
+ * keeps filling the buffer.  When the print data comes from a pipe and goes
+ * to a socket or file it is moved with splice() instead, so it never gets
+ * copied into the backend; the data waits in the pipe until the device is
+ * ready, just like the buffered data does.
  */
 
 ssize_t					/* O - Total bytes on success, -1 on error */
@@ -141,19 +167,19 @@ backendRunLoop(
     int          update_state,		/* I - Update printer-state-reasons? */
     _cups_sccb_t side_cb)		/* I - Side-channel callback */
 {
-  int		nfds;			/* Maximum file descriptor value + 1 */
-  fd_set	input,			/* Input set for reading */
-		output;			/* Output set for writing */
+  struct pollfd	pfds[3];		/* Print, device, and side-channel */
   ssize_t	print_bytes,		/* Print bytes read */
 		bc_bytes,		/* Backchannel bytes read */
 		total_bytes,		/* Total bytes written */
 		bytes;			/* Bytes written */
   int		paperout;		/* "Paper out" status */
   int		offline;		/* "Off-line" status */
-  char		print_buffer[8192],	/* Print data buffer */
+  int		use_splice,		/* Move print data with splice()? */
+		splice_ready;		/* Print data waiting in the pipe? */
+  size_t	print_size;		/* Size of next read */
+  char		*print_buffer,		/* Print data buffer */
 		*print_ptr,		/* Pointer into print data buffer */
 		bc_buffer[1024];	/* Back-channel data buffer */
-  struct timeval timeout;		/* Timeout for select() */
   time_t	curtime,		/* Current time */
 		snmp_update = 0;
 #if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
@@ -196,41 +222,48 @@ backendRunLoop(
     print_fd = 0;
   }
 
- /*
-  * Figure out the maximum file descriptor value to use with select()...
-  */
+  if ((print_buffer = malloc(BACKEND_BUFFER_MAX)) == NULL)
+  {
+    _cupsLangPrintError("ERROR", _("Unable to allocate memory"));
+    return (-1);
+  }
 
-  nfds = (print_fd > device_fd ? print_fd : device_fd) + 1;
+  print_size = BACKEND_BUFFER_MIN;
+  use_splice = backend_can_splice(print_fd, device_fd);
+
+  if (use_splice)
+    fputs("DEBUG: Using splice() for print data.\n", stderr);
 
  /*
   * Now loop until we are out of data from print_fd...
   */
 
   for (print_bytes = 0, print_ptr = print_buffer, offline = -1,
-           paperout = -1, total_bytes = 0;;)
+           paperout = -1, total_bytes = 0, splice_ready = 0;;)
   {
    /*
-    * Use select() to determine whether we have data to copy around...
+    * Use poll() to determine whether we have data to copy around...
     */
 
-    FD_ZERO(&input);
-    if (!print_bytes)
-      FD_SET(print_fd, &input);
+    pfds[0].fd      = (print_bytes || splice_ready) ? -1 : print_fd;
+    pfds[0].events  = POLLIN;
+    pfds[0].revents = 0;
+
+    pfds[1].fd      = device_fd;
+    pfds[1].events  = 0;
+    pfds[1].revents = 0;
     if (use_bc)
-      FD_SET(device_fd, &input);
-    if (!print_bytes && side_cb)
-      FD_SET(CUPS_SC_FD, &input);
+      pfds[1].events |= POLLIN;
+    if (print_bytes || splice_ready || (!use_bc && !side_cb))
+      pfds[1].events |= POLLOUT;
 
-    FD_ZERO(&output);
-    if (print_bytes || (!use_bc && !side_cb))
-      FD_SET(device_fd, &output);
+    pfds[2].fd      = (!print_bytes && side_cb) ? CUPS_SC_FD : -1;
+    pfds[2].events  = POLLIN;
+    pfds[2].revents = 0;
 
     if (use_bc || side_cb)
     {
-      timeout.tv_sec  = 5;
-      timeout.tv_usec = 0;
-
-      if (select(nfds, &input, &output, NULL, &timeout) < 0)
+      if (poll(pfds, 3, 5000) < 0)
       {
        /*
 	* Pause printing to clear any pending errors...
@@ -247,6 +280,7 @@ backendRunLoop(
 	{
 	  fputs("DEBUG: Received an interrupt before any bytes were "
 	        "written, aborting.\n", stderr);
+	  free(print_buffer);
           return (0);
 	}
 
@@ -254,15 +288,24 @@ backendRunLoop(
 	continue;
       }
     }
+    else
+    {
+     /*
+      * Nothing else to watch, so just do blocking reads and writes...
+      */
+
+      pfds[0].revents = pfds[0].fd >= 0 ? POLLIN : 0;
+      pfds[1].revents = pfds[1].events;
+    }
 
    /*
     * Check if we have a side-channel request ready...
     */
 
-    if (side_cb && FD_ISSET(CUPS_SC_FD, &input))
+    if (pfds[2].revents)
     {
      /*
-      * Do the side-channel request, then start back over in the select
+      * Do the side-channel request, then start back over in the poll
       * loop since it may have read from print_fd...
       */
 
@@ -275,7 +318,7 @@ backendRunLoop(
     * Check if we have back-channel data ready...
     */
 
-    if (FD_ISSET(device_fd, &input))
+    if (pfds[1].revents & (POLLIN | POLLHUP | POLLERR))
     {
       if ((bc_bytes = read(device_fd, bc_buffer, sizeof(bc_buffer))) > 0)
       {
@@ -298,10 +341,17 @@ backendRunLoop(
     * Check if we have print data ready...
     */
 
-    if (FD_ISSET(print_fd, &input))
+    if (use_splice && (pfds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+    {
+     /*
+      * Leave the print data in the pipe until the device is ready...
+      */
+
+      splice_ready = 1;
+    }
+    else if (pfds[0].revents & (POLLIN | POLLHUP | POLLERR))
     {
-      if ((print_bytes = read(print_fd, print_buffer,
-                              sizeof(print_buffer))) < 0)
+      if ((print_bytes = read(print_fd, print_buffer, print_size)) < 0)
       {
        /*
         * Read error - bail if we don't see EAGAIN or EINTR...
@@ -312,6 +362,7 @@ backendRunLoop(
 	  fprintf(stderr, "DEBUG: Read failed: %s\n", strerror(errno));
 	  _cupsLangPrintFilter(stderr, "ERROR",
 	                       _("Unable to read print data."));
+	  free(print_buffer);
 	  return (-1);
 	}
 
@@ -330,6 +381,13 @@ backendRunLoop(
 
       fprintf(stderr, "DEBUG: Read %d bytes of print data...\n",
               (int)print_bytes);
+
+     /*
+      * Read more at a time while the input keeps up...
+      */
+
+      if ((size_t)print_bytes == print_size && print_size < BACKEND_BUFFER_MAX)
+        print_size *= 2;
     }
 
    /*
@@ -337,9 +395,43 @@ backendRunLoop(
     * send...
     */
 
-    if (print_bytes && FD_ISSET(device_fd, &output))
+    if ((print_bytes || splice_ready) && (pfds[1].revents & POLLOUT))
     {
-      if ((bytes = write(device_fd, print_ptr, (size_t)print_bytes)) < 0)
+#ifdef HAVE_SPLICE
+      if (splice_ready)
+      {
+       /*
+        * Move the print data straight from the pipe to the device...
+	*/
+
+	if ((bytes = splice(print_fd, NULL, device_fd, NULL, print_size,
+			    SPLICE_F_MOVE | SPLICE_F_MORE)) == 0)
+	{
+	 /*
+	  * End of file, break out of the loop...
+	  */
+
+	  break;
+	}
+	else if (bytes < 0 && (errno == EINVAL || errno == ENOSYS))
+	{
+	 /*
+	  * The kernel can't splice these descriptors after all, copy
+	  * instead...
+	  */
+
+	  fprintf(stderr, "DEBUG: Unable to splice print data: %s\n",
+		  strerror(errno));
+	  use_splice   = 0;
+	  splice_ready = 0;
+	  continue;
+	}
+      }
+      else
+#endif /* HAVE_SPLICE */
+      bytes = write(device_fd, print_ptr, (size_t)print_bytes);
+
+      if (bytes < 0)
       {
        /*
         * Write error - bail if we don't see an error we can retry...
@@ -367,6 +459,7 @@ backendRunLoop(
 	else if (errno != EAGAIN && errno != EINTR && errno != ENOTTY)
 	{
 	  _cupsLangPrintError("ERROR", _("Unable to write print data"));
+	  free(print_buffer);
 	  return (-1);
 	}
       }
@@ -388,9 +481,25 @@ backendRunLoop(
 
         fprintf(stderr, "DEBUG: Wrote %d bytes of print data...\n", (int)bytes);
 
-        print_bytes -= bytes;
-	print_ptr   += bytes;
 	total_bytes += bytes;
+
+        if (splice_ready)
+	{
+	 /*
+	  * Wait for more print data, moving more at a time while the input
+	  * keeps up...
+	  */
+
+	  splice_ready = 0;
+
+	  if ((size_t)bytes == print_size && print_size < BACKEND_BUFFER_MAX)
+	    print_size *= 2;
+	}
+	else
+	{
+	  print_bytes -= bytes;
+	  print_ptr   += bytes;
+	}
       }
     }
 
@@ -407,6 +516,8 @@ backendRunLoop(
     }
   }
 
+  free(print_buffer);
+
  /*
   * Return with success...
   */
@@ -527,6 +638,37 @@ backendWaitLoop(
 }
 
 
+/*
+ * 'backend_can_splice()' - Determine whether print data can be spliced.
+ *
+ * splice() needs a pipe on one side; we only use it for sockets and files on
+ * the other, since character devices report their status through write().
+ */
+
+static int				/* O - 1 if splice() can be used */
+backend_can_splice(int print_fd,	/* I - Print file descriptor */
+                   int device_fd)	/* I - Device file descriptor */
+{
+#ifdef HAVE_SPLICE
+  struct stat	print_info,		/* Print file information */
+		device_info;		/* Device file information */
+
+
+  if (fstat(print_fd, &print_info) || fstat(device_fd, &device_info))
+    return (0);
+
+  return (S_ISFIFO(print_info.st_mode) &&
+          (S_ISSOCK(device_info.st_mode) || S_ISREG(device_info.st_mode)));
+
+#else
+  (void)print_fd;
+  (void)device_fd;
+
+  return (0);
+#endif /* HAVE_SPLICE */
+}
+
+
 /*
  * End of "$Id: runloop.c 11560 2014-02-06 20:10:19Z msweet $".
  */
@@ -20,6 +20,8 @@
 
 #include "backend-private.h"
 #include <cups/array.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 
 
 /*
@@ -28,6 +30,10 @@
 
 #define CUPS_MAX_SUPPLIES	32	/* Maximum number of supplies for a printer */
 #define CUPS_SUPPLY_TIMEOUT	2.0	/* Timeout for SNMP lookups */
+#define CUPS_SUPPLY_REPETITIONS	16	/* OIDs in each GetBulkRequest response */
+#define CUPS_SUPPLY_FRESH	10	/* Age of shared levels used as-is */
+#define CUPS_SUPPLY_STALE	300	/* Max age of shared levels used while
+					 * refreshing them */
 
 #define CUPS_DEVELOPER_LOW	0x0001
 #define CUPS_DEVELOPER_EMPTY	0x0002
@@ -61,6 +67,14 @@ typedef struct				/**** Printer supply data ****/
 	level;				/* Current level value */
 } backend_supplies_t;
 
+typedef struct				/**** Shared device status ****/
+{
+  time_t	updated;		/* Time of last update */
+  int		page_count,		/* prtMarkerLifeCount value */
+		status,			/* hrPrinterStatus value */
+		state;			/* hrPrinterDetectedErrorState bits */
+} backend_levels_t;
+
 typedef struct				/**** Printer state table ****/
 {
   int		bit;			/* State bit */
@@ -76,6 +90,7 @@ static http_addr_t	current_addr;	/* Current address */
 static int		current_state = -1;
 					/* Current device state bits */
 static int		charset = -1;	/* Character set for supply names */
+static int		bulk = -1;	/* Supports SNMPv2c GetBulkRequest? */
 static unsigned		quirks = CUPS_SNMP_NONE;
 					/* Quirks we have to work around */
 static int		num_supplies = 0;
@@ -84,6 +99,9 @@ static backend_supplies_t supplies[CUPS_MAX_SUPPLIES];
 					/* Supply information */
 static int		supply_state = -1;
 					/* Supply state info */
+static backend_levels_t	levels;		/* Current device status */
+static time_t		refresh_time = 0;
+					/* Time of last background refresh */
 
 static const int	hrDeviceDescr[] =
 			{ CUPS_OID_hrDeviceDescr, 1, -1 };
@@ -202,8 +220,17 @@ static const backend_state_t supply_states[] =
  * Local functions...
  */
 
+static int	backend_get_value(int snmp_fd, const int *oid,
+		                  cups_asn1_t type, cups_snmp_t *packet);
 static void	backend_init_supplies(int snmp_fd, http_addr_t *addr);
+static void	backend_levels_file(char *filename, size_t filesize,
+		                    const char *ext);
+static int	backend_poll_levels(int snmp_fd);
+static int	backend_read_levels(void);
+static void	backend_refresh_levels(void);
+static void	backend_walk(int snmp_fd, const int *prefix);
 static void	backend_walk_cb(cups_snmp_t *packet, void *data);
+static void	backend_write_levels(void);
 static void	utf16_to_utf8(cups_utf8_t *dst, const unsigned char *src,
 			      size_t srcsize, size_t dstsize, int le);
 
@@ -221,10 +248,6 @@ backendSNMPSupplies(
 {
   if (!httpAddrEqual(addr, &current_addr))
     backend_init_supplies(snmp_fd, addr);
-  else if (num_supplies > 0)
-    _cupsSNMPWalk(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
-		  _cupsSNMPDefaultCommunity(), prtMarkerSuppliesLevel,
-		  CUPS_SUPPLY_TIMEOUT, backend_walk_cb, NULL);
 
   if (page_count)
     *page_count = -1;
@@ -243,6 +266,45 @@ backendSNMPSupplies(
 					/* marker-levels value string */
 		*ptr;			/* Pointer into value string */
     cups_snmp_t	packet;			/* SNMP response packet */
+    int		age;			/* Age of shared levels */
+
+   /*
+    * Use the levels shared by the other jobs for this device when they are
+    * recent, otherwise query the device.  Levels that are a little old are
+    * used while a background process refreshes them.  The page count and
+    * printer state are used for accounting, so they are always queried...
+    */
+
+    if ((age = backend_read_levels()) < 0 || age >= CUPS_SUPPLY_STALE)
+    {
+      if (backend_poll_levels(snmp_fd))
+        return (-1);
+
+      backend_write_levels();
+    }
+    else
+    {
+      if (age >= CUPS_SUPPLY_FRESH)
+        backend_refresh_levels();
+
+      if (printer_state)
+      {
+        if (backend_get_value(snmp_fd, hrPrinterStatus, CUPS_ASN1_INTEGER,
+	                      &packet))
+	  return (-1);
+
+        levels.status = packet.object_value.integer;
+      }
+
+      if (page_count)
+      {
+        if (backend_get_value(snmp_fd, prtMarkerLifeCount, CUPS_ASN1_COUNTER,
+	                      &packet))
+	  return (-1);
+
+        levels.page_count = packet.object_value.counter;
+      }
+    }
 
    /*
     * Generate the marker-levels value string...
@@ -350,25 +412,10 @@ backendSNMPSupplies(
     supply_state = new_supply_state;
 
    /*
-    * Get the current printer status bits...
+    * Report the current printer status bits...
     */
 
-    if (!_cupsSNMPWrite(snmp_fd, addr, CUPS_SNMP_VERSION_1,
-                       _cupsSNMPDefaultCommunity(), CUPS_ASN1_GET_REQUEST, 1,
-                       hrPrinterDetectedErrorState))
-      return (-1);
-
-    if (!_cupsSNMPRead(snmp_fd, &packet, CUPS_SUPPLY_TIMEOUT) ||
-        packet.object_type != CUPS_ASN1_OCTET_STRING)
-      return (-1);
-
-    if (packet.object_value.string.num_bytes == 2)
-      new_state = (packet.object_value.string.bytes[0] << 8) |
-		  packet.object_value.string.bytes[1];
-    else if (packet.object_value.string.num_bytes == 1)
-      new_state = (packet.object_value.string.bytes[0] << 8);
-    else
-      new_state = 0;
+    new_state = levels.state;
 
     if (current_state < 0)
       change_state = 0xffff;
@@ -391,39 +438,23 @@ backendSNMPSupplies(
     current_state = new_state;
 
    /*
-    * Get the current printer state...
+    * Return the current printer state and page count...
     */
 
     if (printer_state)
     {
-      if (!_cupsSNMPWrite(snmp_fd, addr, CUPS_SNMP_VERSION_1,
-			 _cupsSNMPDefaultCommunity(), CUPS_ASN1_GET_REQUEST, 1,
-			 hrPrinterStatus))
-	return (-1);
+      if (levels.status < 0)
+        return (-1);
 
-      if (!_cupsSNMPRead(snmp_fd, &packet, CUPS_SUPPLY_TIMEOUT) ||
-	  packet.object_type != CUPS_ASN1_INTEGER)
-	return (-1);
-
-      *printer_state = packet.object_value.integer;
+      *printer_state = levels.status;
     }
 
-   /*
-    * Get the current page count...
-    */
-
     if (page_count)
     {
-      if (!_cupsSNMPWrite(snmp_fd, addr, CUPS_SNMP_VERSION_1,
-			 _cupsSNMPDefaultCommunity(), CUPS_ASN1_GET_REQUEST, 1,
-			 prtMarkerLifeCount))
-	return (-1);
-
-      if (!_cupsSNMPRead(snmp_fd, &packet, CUPS_SUPPLY_TIMEOUT) ||
-	  packet.object_type != CUPS_ASN1_COUNTER)
-	return (-1);
+      if (levels.page_count < 0)
+        return (-1);
 
-      *page_count = packet.object_value.counter;
+      *page_count = levels.page_count;
     }
 
     return (0);
@@ -433,6 +464,30 @@ backendSNMPSupplies(
 }
 
 
+/*
+ * 'backend_get_value()' - Get a single value from the device.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+backend_get_value(
+    int         snmp_fd,		/* I - SNMP socket */
+    const int   *oid,			/* I - OID to get */
+    cups_asn1_t type,			/* I - Expected value type */
+    cups_snmp_t *packet)		/* O - SNMP response packet */
+{
+  if (!_cupsSNMPWrite(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
+		     _cupsSNMPDefaultCommunity(), CUPS_ASN1_GET_REQUEST, 1,
+		     oid))
+    return (-1);
+
+  if (!_cupsSNMPRead(snmp_fd, packet, CUPS_SUPPLY_TIMEOUT) ||
+      packet->object_type != type)
+    return (-1);
+
+  return (0);
+}
+
+
 /*
  * 'backend_init_supplies()' - Initialize the supplies list.
  */
@@ -504,8 +559,11 @@ backend_init_supplies(
   current_state = -1;
   num_supplies  = -1;
   charset       = -1;
+  bulk          = -1;
+  refresh_time  = 0;
 
   memset(supplies, 0, sizeof(supplies));
+  memset(&levels, 0, sizeof(levels));
 
  /*
   * See if we should be getting supply levels via SNMP...
@@ -565,14 +623,14 @@ backend_init_supplies(
    /*
     * Yes, read the cache file:
     *
-    *     3 num_supplies charset
+    *     4 num_supplies charset bulk
     *     device description
     *     supply structures...
     */
 
     if (cupsFileGets(cachefile, value, sizeof(value)))
     {
-      if (sscanf(value, "3 %d%d", &num_supplies, &charset) == 2 &&
+      if (sscanf(value, "4 %d%d%d", &num_supplies, &charset, &bulk) == 3 &&
           num_supplies <= CUPS_MAX_SUPPLIES &&
           cupsFileGets(cachefile, value, sizeof(value)))
       {
@@ -583,12 +641,14 @@ backend_init_supplies(
 	{
 	  num_supplies = -1;
 	  charset      = -1;
+	  bulk         = -1;
 	}
       }
       else
       {
         num_supplies = -1;
 	charset      = -1;
+	bulk         = -1;
       }
     }
 
@@ -654,9 +714,17 @@ backend_init_supplies(
     * Walk the printer configuration information...
     */
 
-    _cupsSNMPWalk(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
-		  _cupsSNMPDefaultCommunity(), prtMarkerSuppliesEntry,
-		  CUPS_SUPPLY_TIMEOUT, backend_walk_cb, NULL);
+    backend_walk(snmp_fd, prtMarkerSuppliesEntry);
+
+   /*
+    * Get the colors...
+    */
+
+    for (i = 0; i < num_supplies; i ++)
+      strlcpy(supplies[i].color, "none", sizeof(supplies[i].color));
+
+    if (num_supplies > 0)
+      backend_walk(snmp_fd, prtMarkerColorantValue);
   }
 
  /*
@@ -668,7 +736,7 @@ backend_init_supplies(
 
   if ((cachefile = cupsFileOpen(cachefilename, "w")) != NULL)
   {
-    cupsFilePrintf(cachefile, "3 %d %d\n", num_supplies, charset);
+    cupsFilePrintf(cachefile, "4 %d %d %d\n", num_supplies, charset, bulk);
     cupsFilePrintf(cachefile, "%s\n", description);
 
     if (num_supplies > 0)
@@ -681,17 +749,6 @@ backend_init_supplies(
   if (num_supplies <= 0)
     return;
 
- /*
-  * Get the colors...
-  */
-
-  for (i = 0; i < num_supplies; i ++)
-    strlcpy(supplies[i].color, "none", sizeof(supplies[i].color));
-
-  _cupsSNMPWalk(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
-                _cupsSNMPDefaultCommunity(), prtMarkerColorantValue,
-	        CUPS_SUPPLY_TIMEOUT, backend_walk_cb, NULL);
-
  /*
   * Output the marker-colors attribute...
   */
@@ -758,6 +815,275 @@ backend_init_supplies(
 }
 
 
+/*
+ * 'backend_levels_file()' - Get the name of a shared levels file.
+ */
+
+static void
+backend_levels_file(char       *filename,/* I - Filename buffer */
+                    size_t     filesize,/* I - Size of filename buffer */
+		    const char *ext)	/* I - Filename extension */
+{
+  const char	*cachedir;		/* CUPS_CACHEDIR value */
+  char		addrstr[256];		/* Address string */
+
+
+  if ((cachedir = getenv("CUPS_CACHEDIR")) == NULL)
+    cachedir = CUPS_CACHEDIR;
+
+  httpAddrString(&current_addr, addrstr, sizeof(addrstr));
+
+  snprintf(filename, filesize, "%s/%s.%s", cachedir, addrstr, ext);
+}
+
+
+/*
+ * 'backend_poll_levels()' - Query the device for the current supply levels
+ *                           and status.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+backend_poll_levels(int snmp_fd)	/* I - SNMP socket */
+{
+  int		i;			/* Looping var */
+  const int	*oids[3];		/* Status OIDs */
+
+
+ /*
+  * Get the supply levels...
+  */
+
+  backend_walk(snmp_fd, prtMarkerSuppliesLevel);
+
+ /*
+  * Get the current printer status bits, printer state, and page count,
+  * using a single request when the printer supports SNMPv2c...
+  */
+
+  oids[0] = hrPrinterDetectedErrorState;
+  oids[1] = hrPrinterStatus;
+  oids[2] = prtMarkerLifeCount;
+
+  levels.state      = -1;
+  levels.status     = -1;
+  levels.page_count = -1;
+
+  if (bulk > 0)
+    _cupsSNMPGet(snmp_fd, &current_addr, CUPS_SNMP_VERSION_2C,
+                 _cupsSNMPDefaultCommunity(), 3, oids, CUPS_SUPPLY_TIMEOUT,
+		 backend_walk_cb, NULL);
+  else
+  {
+    for (i = 0; i < 3; i ++)
+      if (_cupsSNMPGet(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
+                       _cupsSNMPDefaultCommunity(), 1, oids + i,
+		       CUPS_SUPPLY_TIMEOUT, backend_walk_cb, NULL) < 0 && !i)
+        break;
+  }
+
+  if (levels.state < 0)
+    return (-1);
+
+  levels.updated = time(NULL);
+
+  return (0);
+}
+
+
+/*
+ * 'backend_read_levels()' - Read the levels shared by other jobs.
+ */
+
+static int				/* O - Age in seconds or -1 if none */
+backend_read_levels(void)
+{
+  int			i,		/* Looping var */
+			count,		/* Number of levels */
+			pos;		/* Position in line */
+  long			updated;	/* Time of update */
+  cups_file_t		*fp;		/* Levels file */
+  char			filename[1024],	/* Levels filename */
+			line[2048],	/* Line from file */
+			*ptr,		/* Pointer into line */
+			*end;		/* End of value */
+  backend_levels_t	temp;		/* Device status from file */
+  int			temp_levels[CUPS_MAX_SUPPLIES];
+					/* Supply levels from file */
+  time_t		curtime;	/* Current time */
+
+
+ /*
+  * The levels file contains a single line:
+  *
+  *     1 updated page-count status state num-levels level ... level
+  */
+
+  backend_levels_file(filename, sizeof(filename), "levels");
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (-1);
+
+  ptr = cupsFileGets(fp, line, sizeof(line));
+
+  cupsFileClose(fp);
+
+  if (!ptr || sscanf(line, "1 %ld%d%d%d%d%n", &updated, &temp.page_count,
+                     &temp.status, &temp.state, &count, &pos) != 5 ||
+      count != num_supplies)
+    return (-1);
+
+  for (i = 0, ptr = line + pos; i < count; i ++, ptr = end)
+  {
+    temp_levels[i] = (int)strtol(ptr, &end, 10);
+
+    if (end == ptr)
+      return (-1);
+  }
+
+  curtime = time(NULL);
+
+  if (updated > curtime)
+    return (-1);
+
+ /*
+  * Use the levels from the file...
+  */
+
+  temp.updated = (time_t)updated;
+  levels       = temp;
+
+  for (i = 0; i < count; i ++)
+    supplies[i].level = temp_levels[i];
+
+  fprintf(stderr, "DEBUG2: Using supply levels from %d seconds ago.\n",
+          (int)(curtime - levels.updated));
+
+  return ((int)(curtime - levels.updated));
+}
+
+
+/*
+ * 'backend_refresh_levels()' - Refresh the shared levels in the background.
+ */
+
+static void
+backend_refresh_levels(void)
+{
+  pid_t		pid;			/* Child process ID */
+  int		fd,			/* Looping var/lock file */
+		snmp_fd,		/* SNMP socket */
+		age;			/* Age of shared levels */
+  char		lockname[1024];		/* Lock filename */
+  struct flock	lock;			/* Lock */
+  time_t	curtime;		/* Current time */
+
+
+ /*
+  * Don't start another refresh until the last one has had a chance to
+  * finish...
+  */
+
+  if ((curtime = time(NULL)) < (refresh_time + CUPS_SUPPLY_FRESH))
+    return;
+
+  refresh_time = curtime;
+
+  fputs("DEBUG: Refreshing supply levels in the background.\n", stderr);
+
+  if ((pid = fork()) < 0)
+    return;
+  else if (pid > 0)
+  {
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+
+    return;
+  }
+
+ /*
+  * Detach from the job so the scheduler doesn't wait for us, and close the
+  * job's files and the connection to the printer...
+  */
+
+  setsid();
+
+  if (fork())
+    _exit(0);
+
+  for (fd = 0; fd < 1024; fd ++)
+    close(fd);
+
+  if ((fd = open("/dev/null", O_RDWR)) == 0)
+  {
+    dup2(fd, 1);
+    dup2(fd, 2);
+  }
+
+ /*
+  * Only one process refreshes the levels for each device...
+  */
+
+  backend_levels_file(lockname, sizeof(lockname), "lock");
+
+  if ((fd = open(lockname, O_RDWR | O_CREAT, 0600)) < 0)
+    _exit(1);
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  if (fcntl(fd, F_SETLK, &lock))
+    _exit(0);
+
+  if ((age = backend_read_levels()) >= 0 && age < CUPS_SUPPLY_FRESH)
+    _exit(0);
+
+ /*
+  * Query the device using our own socket...
+  */
+
+  if ((snmp_fd = _cupsSNMPOpen(current_addr.addr.sa_family)) < 0)
+    _exit(1);
+
+  if (!backend_poll_levels(snmp_fd))
+    backend_write_levels();
+
+  _cupsSNMPClose(snmp_fd);
+
+  _exit(0);
+}
+
+
+/*
+ * 'backend_walk()' - Walk a supply table, using GetBulkRequest when the
+ *                    printer supports it.
+ */
+
+static void
+backend_walk(int       snmp_fd,		/* I - SNMP socket */
+             const int *prefix)		/* I - OID prefix */
+{
+  if (bulk)
+  {
+    if (_cupsSNMPBulkWalk(snmp_fd, &current_addr, _cupsSNMPDefaultCommunity(),
+                          prefix, CUPS_SUPPLY_REPETITIONS,
+			  CUPS_SUPPLY_TIMEOUT, backend_walk_cb, NULL) >= 0)
+    {
+      bulk = 1;
+      return;
+    }
+
+    fputs("DEBUG: Printer does not support SNMPv2c GetBulkRequest.\n",
+          stderr);
+
+    bulk = 0;
+  }
+
+  _cupsSNMPWalk(snmp_fd, &current_addr, CUPS_SNMP_VERSION_1,
+		_cupsSNMPDefaultCommunity(), prefix, CUPS_SUPPLY_TIMEOUT,
+		backend_walk_cb, NULL);
+}
+
+
 /*
  * 'backend_walk_cb()' - Interpret the supply value responses.
  */
@@ -799,7 +1125,40 @@ backend_walk_cb(cups_snmp_t *packet,	/* I - SNMP packet */
 
   (void)data;
 
-  if (_cupsSNMPIsOIDPrefixed(packet, prtMarkerColorantValue) &&
+  if (_cupsSNMPIsOID(packet, hrPrinterDetectedErrorState) &&
+      packet->object_type == CUPS_ASN1_OCTET_STRING)
+  {
+   /*
+    * Get printer status bits...
+    */
+
+    if (packet->object_value.string.num_bytes == 2)
+      levels.state = (packet->object_value.string.bytes[0] << 8) |
+		     packet->object_value.string.bytes[1];
+    else if (packet->object_value.string.num_bytes == 1)
+      levels.state = (packet->object_value.string.bytes[0] << 8);
+    else
+      levels.state = 0;
+  }
+  else if (_cupsSNMPIsOID(packet, hrPrinterStatus) &&
+           packet->object_type == CUPS_ASN1_INTEGER)
+  {
+   /*
+    * Get printer state...
+    */
+
+    levels.status = packet->object_value.integer;
+  }
+  else if (_cupsSNMPIsOID(packet, prtMarkerLifeCount) &&
+           packet->object_type == CUPS_ASN1_COUNTER)
+  {
+   /*
+    * Get page count...
+    */
+
+    levels.page_count = packet->object_value.counter;
+  }
+  else if (_cupsSNMPIsOIDPrefixed(packet, prtMarkerColorantValue) &&
       packet->object_type == CUPS_ASN1_OCTET_STRING)
   {
    /*
@@ -1034,6 +1393,42 @@ backend_walk_cb(cups_snmp_t *packet,	/* I - SNMP packet */
 }
 
 
+/*
+ * 'backend_write_levels()' - Share the current levels with other jobs.
+ */
+
+static void
+backend_write_levels(void)
+{
+  int		i;			/* Looping var */
+  cups_file_t	*fp;			/* Levels file */
+  char		filename[1024],		/* Levels filename */
+		tempfile[1024],		/* Temporary filename */
+		tempext[64];		/* Temporary filename extension */
+
+
+  snprintf(tempext, sizeof(tempext), "levels.%d", (int)getpid());
+
+  backend_levels_file(filename, sizeof(filename), "levels");
+  backend_levels_file(tempfile, sizeof(tempfile), tempext);
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+    return;
+
+  cupsFilePrintf(fp, "1 %ld %d %d %d %d", (long)levels.updated,
+                 levels.page_count, levels.status, levels.state,
+		 num_supplies);
+
+  for (i = 0; i < num_supplies; i ++)
+    cupsFilePrintf(fp, " %d", supplies[i].level);
+
+  cupsFilePuts(fp, "\n");
+
+  if (cupsFileClose(fp) || rename(tempfile, filename))
+    unlink(tempfile);
+}
+
+
 /*
  * 'utf16_to_utf8()' - Convert UTF-16 text to UTF-8.
  */
@@ -24,6 +24,9 @@
 #include <cups/file.h>
 #include <cups/http-private.h>
 #include <regex.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
 
 
 /*
@@ -31,7 +34,13 @@
  * based approach to get SNMP response packets from potential printers,
  * requesting OIDs from the Host and Port Monitor MIBs, does a URI
  * lookup based on the device description string, and finally a probe of
- * port 9100 (AppSocket) and 515 (LPD).
+ * port 9100 (AppSocket) and 515 (LPD).  Networks in CIDR notation are
+ * swept with unicast queries, and up to MaxProbes devices are probed at
+ * the same time using non-blocking connections.
+ *
+ * When run without an address, the devices found by the last scan are
+ * reported from a cache file and a new scan is run in the background to
+ * update the cache.
  *
  * The current focus is on printers with internal network cards, although
  * the code also works with many external print servers as well.
@@ -41,21 +50,26 @@
  * directives:
  *
  *     Address ip-address
+ *     Address ip-address/prefix-length
  *     Address @LOCAL
  *     Address @IF(name)
+ *     CacheTime N
  *     Community name
  *     DebugLevel N
  *     DeviceURI "regex pattern" uri
  *     HostNameLookups on
  *     HostNameLookups off
+ *     MaxProbes N
  *     MaxRunTime N
  *
  * The default is to use:
  *
  *     Address @LOCAL
+ *     CacheTime 3600
  *     Community public
  *     DebugLevel 0
  *     HostNameLookups off
+ *     MaxProbes 64
  *     MaxRunTime 120
  *
  * This backend is known to work with the following network printers and
@@ -81,6 +95,19 @@
  * (for all of these, they do not support the Host MIB)
  */
 
+/*
+ * Local constants...
+ */
+
+#define SNMP_PROBE_TIMEOUT	1.0	/* Timeout for each port probe */
+#define SNMP_QUIET_TIME		1.0	/* Time without responses before a
+					 * device is listed or probed */
+#define SNMP_SCAN_TIMEOUT	2.0	/* Time without responses before the
+					 * scan is complete */
+#define SNMP_SWEEP_BATCH	64	/* Number of sweep queries to send at
+					 * a time */
+
+
 /*
  * Types...
  */
@@ -111,8 +138,24 @@ typedef struct snmp_cache_s		/**** SNMP scan cache ****/
 		*location,		/* device-location */
 		*make_and_model;	/* device-make-and-model */
   int		sent;			/* Has this device been listed? */
+  double	updated;		/* Time of last response */
 } snmp_cache_t;
 
+typedef struct snmp_probe_s		/**** Port probe ****/
+{
+  snmp_cache_t	*device;		/* Device being probed, NULL if unused */
+  int		fd,			/* Socket or -1 */
+		port;			/* Index into ProbePorts */
+  double	start;			/* Time of connect() */
+} snmp_probe_t;
+
+typedef struct snmp_sweep_s		/**** Unicast network sweep ****/
+{
+  unsigned	next,			/* Next IPv4 address */
+		remaining;		/* Number of addresses left */
+  const char	*community;		/* Community name */
+} snmp_sweep_t;
+
 
 /*
  * Local functions...
@@ -123,7 +166,7 @@ static void		add_cache(http_addr_t *addr, const char *addrname,
 			          const char *uri, const char *id,
 				  const char *make_and_model);
 static device_uri_t	*add_device_uri(char *value);
-static void		alarm_handler(int sig);
+static void		add_sweep(const char *address);
 static int		compare_cache(snmp_cache_t *a, snmp_cache_t *b);
 static void		debug_printf(const char *format, ...);
 static void		fix_make_model(char *make_model,
@@ -135,14 +178,18 @@ static http_addrlist_t	*get_interface_addresses(const char *ifname);
 static void		list_device(snmp_cache_t *cache);
 static const char	*password_cb(const char *prompt);
 static void		probe_device(snmp_cache_t *device);
+static void		probe_found(snmp_cache_t *device, int port);
+static void		probe_next(snmp_probe_t *probe);
+static int		read_cache(void);
 static void		read_snmp_conf(const char *address);
-static void		read_snmp_response(int fd);
+static int		read_snmp_response(int fd);
+static void		refresh_cache(int ipv4, int ipv6);
 static double		run_time(void);
 static void		scan_devices(int ipv4, int ipv6);
-static int		try_connect(http_addr_t *addr, const char *addrname,
-			            int port);
+static int		send_sweeps(int fd);
 static void		update_cache(snmp_cache_t *device, const char *uri,
 			             const char *id, const char *make_model);
+static void		write_cache(void);
 
 
 /*
@@ -150,6 +197,7 @@ static void		update_cache(snmp_cache_t *device, const char *uri,
  */
 
 static cups_array_t	*Addresses = NULL;
+static int		CacheTime = 3600;
 static cups_array_t	*Communities = NULL;
 static cups_array_t	*Devices = NULL;
 static int		DebugLevel = 0;
@@ -164,8 +212,19 @@ static const int	LexmarkDeviceIdOID[] = { 1,3,6,1,4,1,641,2,1,2,1,3,1,-1 };
 static const int	XeroxProductOID[] = { 1,3,6,1,4,1,128,2,1,3,1,2,0,-1 };
 static cups_array_t	*DeviceURIs = NULL;
 static int		HostNameLookups = 0;
+static int		MaxProbes = 64;
 static int		MaxRunTime = 120;
+static const int	ProbePorts[] =
+			{
+#ifdef __APPLE__
+			  5353,		/* Bonjour/mDNS, not reported */
+#endif /* __APPLE__ */
+			  9100,
+			  515
+			};
+static snmp_probe_t	*Probes = NULL;
 static struct timeval	StartTime;
+static cups_array_t	*Sweeps = NULL;
 
 
 /*
@@ -178,9 +237,6 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 {
   int		ipv4,			/* SNMP IPv4 socket */
 		ipv6;			/* SNMP IPv6 socket */
-#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
-  struct sigaction action;		/* Actions for POSIX signals */
-#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
 
 
  /*
@@ -199,23 +255,6 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 
   cupsSetPasswordCB(password_cb);
 
- /*
-  * Catch SIGALRM signals...
-  */
-
-#ifdef HAVE_SIGSET
-  sigset(SIGALRM, alarm_handler);
-#elif defined(HAVE_SIGACTION)
-  memset(&action, 0, sizeof(action));
-
-  sigemptyset(&action.sa_mask);
-  sigaddset(&action.sa_mask, SIGALRM);
-  action.sa_handler = alarm_handler;
-  sigaction(SIGALRM, &action, NULL);
-#else
-  signal(SIGALRM, alarm_handler);
-#endif /* HAVE_SIGSET */
-
  /*
   * Open the SNMP socket...
   */
@@ -241,10 +280,19 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
   Devices = cupsArrayNew((cups_array_func_t)compare_cache, NULL);
 
  /*
-  * Scan for devices...
+  * Report the cached devices and update the cache in the background, or
+  * scan for devices now...
   */
 
-  scan_devices(ipv4, ipv6);
+  if (!argv[1] && CacheTime > 0 && read_cache())
+    refresh_cache(ipv4, ipv6);
+  else
+  {
+    scan_devices(ipv4, ipv6);
+
+    if (!argv[1] && CacheTime > 0)
+      write_cache();
+  }
 
  /*
   * Close, free, and return with no errors...
@@ -258,6 +306,20 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
   free_array(Communities);
   free_cache();
 
+  if (Sweeps)
+  {
+    snmp_sweep_t *sweep;		/* Current sweep */
+
+    for (sweep = (snmp_sweep_t *)cupsArrayFirst(Sweeps);
+         sweep;
+	 sweep = (snmp_sweep_t *)cupsArrayNext(Sweeps))
+      free(sweep);
+
+    cupsArrayDelete(Sweeps);
+  }
+
+  free(Probes);
+
   return (0);
 }
 
@@ -304,6 +366,7 @@ add_cache(http_addr_t *addr,		/* I - Device IP address */
   memcpy(&(temp->address), addr, sizeof(temp->address));
 
   temp->addrname = strdup(addrname);
+  temp->updated  = run_time();
 
   if (uri)
     temp->uri = strdup(uri);
@@ -412,24 +475,68 @@ add_device_uri(char *value)		/* I - Value from snmp.conf */
 
 
 /*
- * 'alarm_handler()' - Handle alarm signals...
+ * 'add_sweep()' - Add a unicast sweep of an IPv4 network.
  */
 
 static void
-alarm_handler(int sig)			/* I - Signal number */
+add_sweep(const char *address)		/* I - Network in CIDR notation */
 {
+  char		network[256],		/* Network address */
+		*bits;			/* Prefix length */
+  struct in_addr netaddr;		/* Network address */
+  int		prefix;			/* Prefix length */
+  unsigned	mask,			/* Network mask */
+		first,			/* First address */
+		count;			/* Number of addresses */
+  char		*community;		/* Current community */
+  snmp_sweep_t	*sweep;			/* New sweep */
+
+
+  strlcpy(network, address, sizeof(network));
+  if ((bits = strchr(network, '/')) != NULL)
+    *bits++ = '\0';
+
+  if (!bits || (prefix = atoi(bits)) < 16 || prefix > 32 ||
+      inet_pton(AF_INET, network, &netaddr) != 1)
+  {
+    fprintf(stderr, "ERROR: Unable to scan \"%s\"!\n", address);
+    return;
+  }
+
  /*
-  * Do nothing...
+  * Skip the network and broadcast addresses except for point-to-point
+  * and single host networks...
   */
 
-  (void)sig;
+  mask  = 0xffffffffU << (32 - prefix);
+  first = ntohl(netaddr.s_addr) & mask;
+  count = ~mask + 1;
 
-#if !defined(HAVE_SIGSET) && !defined(HAVE_SIGACTION)
-  signal(SIGALRM, alarm_handler);
-#endif /* !HAVE_SIGSET && !HAVE_SIGACTION */
+  if (prefix < 31)
+  {
+    first ++;
+    count -= 2;
+  }
 
-  if (DebugLevel)
-    write(2, "DEBUG: ALARM!\n", 14);
+  if (!Sweeps)
+    Sweeps = cupsArrayNew(NULL, NULL);
+
+  for (community = (char *)cupsArrayFirst(Communities);
+       community;
+       community = (char *)cupsArrayNext(Communities))
+  {
+    debug_printf("DEBUG: Sweeping %u addresses in \"%s\" via \"%s\"...\n",
+                 count, address, community);
+
+    if ((sweep = calloc(1, sizeof(snmp_sweep_t))) == NULL)
+      break;
+
+    sweep->next      = first;
+    sweep->remaining = count;
+    sweep->community = community;
+
+    cupsArrayAdd(Sweeps, sweep);
+  }
 }
 
 
@@ -673,6 +780,8 @@ password_cb(const char *prompt)		/* I - Prompt message */
 /*
  * 'probe_device()' - Probe a device to discover whether it is a printer.
  *
+ * The caller must make sure that a probe slot is available.
+ *
  * TODO: Try using the Port Monitor MIB to discover the correct protocol
  *       to use - first need a commercially-available printer that supports
  *       it, though...
@@ -685,22 +794,11 @@ probe_device(snmp_cache_t *device)	/* I - Device */
 		*uriptr,		/* Pointer into URI */
 		*format;		/* Format string for device */
   device_uri_t	*device_uri;		/* Current DeviceURI match */
+  int		i;			/* Looping var */
 
 
   debug_printf("DEBUG: %.3f Probing %s...\n", run_time(), device->addrname);
 
-#ifdef __APPLE__
- /*
-  * If the printer supports Bonjour/mDNS, don't report it from the SNMP backend.
-  */
-
-  if (!try_connect(&(device->address), device->addrname, 5353))
-  {
-    debug_printf("DEBUG: %s supports mDNS, not reporting!\n", device->addrname);
-    return;
-  }
-#endif /* __APPLE__ */
-
  /*
   * Lookup the device in the match table...
   */
@@ -742,17 +840,50 @@ probe_device(snmp_cache_t *device)	/* I - Device */
     }
 
  /*
-  * Then try the standard ports...
+  * Then try the standard ports using a free probe slot...
   */
 
-  if (!try_connect(&(device->address), device->addrname, 9100))
+  for (i = 0; i < MaxProbes; i ++)
+    if (!Probes[i].device)
+    {
+      Probes[i].device = device;
+      Probes[i].fd     = -1;
+      Probes[i].port   = 0;
+
+      probe_next(Probes + i);
+      break;
+    }
+}
+
+
+/*
+ * 'probe_found()' - Report a device that accepted a connection on a port.
+ */
+
+static void
+probe_found(snmp_cache_t *device,	/* I - Device */
+            int          port)		/* I - Port number */
+{
+  char	uri[1024];			/* Full device URI */
+
+
+  if (port == 5353)
+  {
+   /*
+    * If the printer supports Bonjour/mDNS, don't report it from the SNMP
+    * backend.
+    */
+
+    debug_printf("DEBUG: %s supports mDNS, not reporting!\n", device->addrname);
+  }
+  else if (port == 9100)
   {
     debug_printf("DEBUG: %s supports AppSocket!\n", device->addrname);
 
     snprintf(uri, sizeof(uri), "socket://%s", device->addrname);
     update_cache(device, uri, NULL, NULL);
   }
-  else if (!try_connect(&(device->address), device->addrname, 515))
+  else
   {
     debug_printf("DEBUG: %s supports LPD!\n", device->addrname);
 
@@ -762,6 +893,124 @@ probe_device(snmp_cache_t *device)	/* I - Device */
 }
 
 
+/*
+ * 'probe_next()' - Start a non-blocking connection to the next port.
+ *
+ * The probe slot is freed when the device has been found or there are no
+ * more ports to try.
+ */
+
+static void
+probe_next(snmp_probe_t *probe)		/* I - Probe */
+{
+  snmp_cache_t	*device = probe->device;/* Device */
+  int		port;			/* Port number */
+
+
+  for (; probe->port < (int)(sizeof(ProbePorts) / sizeof(ProbePorts[0]));
+       probe->port ++)
+  {
+    port = ProbePorts[probe->port];
+
+    debug_printf("DEBUG: %.3f Trying %s://%s:%d...\n", run_time(),
+		 port == 515 ? "lpd" : "socket", device->addrname, port);
+
+    if ((probe->fd = socket(httpAddrFamily(&(device->address)), SOCK_STREAM,
+                            0)) < 0)
+    {
+      fprintf(stderr, "ERROR: Unable to create socket: %s\n",
+	      strerror(errno));
+      break;
+    }
+
+    fcntl(probe->fd, F_SETFD, FD_CLOEXEC);
+    fcntl(probe->fd, F_SETFL, fcntl(probe->fd, F_GETFL) | O_NONBLOCK);
+
+    _httpAddrSetPort(&(device->address), port);
+
+    if (!connect(probe->fd, (void *)&(device->address),
+                 (socklen_t)httpAddrLength(&(device->address))))
+    {
+      close(probe->fd);
+      probe->fd = -1;
+
+      probe_found(device, port);
+      break;
+    }
+    else if (errno == EINPROGRESS)
+    {
+      probe->start = run_time();
+      return;
+    }
+
+    close(probe->fd);
+    probe->fd = -1;
+  }
+
+  probe->device = NULL;
+}
+
+
+/*
+ * 'read_cache()' - Report the devices in the cache file.
+ */
+
+static int				/* O - 1 if the cache is current, 0 otherwise */
+read_cache(void)
+{
+  const char	*cachedir;		/* CUPS_CACHEDIR env var */
+  char		filename[1024],		/* Cache filename */
+		line[8192],		/* Line from file */
+		*fields[6],		/* Fields on line */
+		*ptr;			/* Pointer into line */
+  int		i;			/* Looping var */
+  struct stat	fileinfo;		/* Cache file information */
+  cups_file_t	*fp;			/* Cache file */
+
+
+  if ((cachedir = getenv("CUPS_CACHEDIR")) == NULL)
+    cachedir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/snmp.cache", cachedir);
+
+  if (stat(filename, &fileinfo) ||
+      (time(NULL) - fileinfo.st_mtime) > CacheTime ||
+      (fp = cupsFileOpen(filename, "r")) == NULL)
+    return (0);
+
+  debug_printf("DEBUG: Reporting devices from \"%s\"...\n", filename);
+
+ /*
+  * Each line contains the tab-separated address name, device URI, make and
+  * model, info, device ID, and location...
+  */
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (line[0] == '#')
+      continue;
+
+    for (i = 0, ptr = line; i < 6 && ptr; i ++)
+    {
+      fields[i] = ptr;
+
+      if ((ptr = strchr(ptr, '\t')) != NULL)
+        *ptr++ = '\0';
+    }
+
+    if (i < 6 || !fields[1][0])
+      continue;
+
+    cupsBackendReport("network", fields[1], fields[2], fields[3], fields[4],
+                      fields[5]);
+  }
+
+  cupsFileClose(fp);
+
+  return (1);
+}
+
+
 /*
  * 'read_snmp_conf()' - Read the snmp.conf file.
  */
@@ -822,6 +1071,8 @@ read_snmp_conf(const char *address)	/* I - Single address to probe */
         if (!address)
           add_array(Addresses, value);
       }
+      else if (!_cups_strcasecmp(line, "CacheTime"))
+        CacheTime = atoi(value);
       else if (!_cups_strcasecmp(line, "Community"))
         add_array(Communities, value);
       else if (!_cups_strcasecmp(line, "DebugLevel"))
@@ -840,6 +1091,8 @@ read_snmp_conf(const char *address)	/* I - Single address to probe */
 	                  !_cups_strcasecmp(value, "yes") ||
 	                  !_cups_strcasecmp(value, "true") ||
 	                  !_cups_strcasecmp(value, "double");
+      else if (!_cups_strcasecmp(line, "MaxProbes"))
+        MaxProbes = atoi(value);
       else if (!_cups_strcasecmp(line, "MaxRunTime"))
         MaxRunTime = atoi(value);
       else
@@ -871,6 +1124,9 @@ read_snmp_conf(const char *address)	/* I - Single address to probe */
     fputs("INFO: Using default SNMP Community public\n", stderr);
     add_array(Communities, "public");
   }
+
+  if (MaxProbes < 1)
+    MaxProbes = 1;
 }
 
 
@@ -878,7 +1134,7 @@ read_snmp_conf(const char *address)	/* I - Single address to probe */
  * 'read_snmp_response()' - Read and parse a SNMP response...
  */
 
-static void
+static int				/* O - 1 if a packet was read, 0 otherwise */
 read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
 {
   char		addrname[256];		/* Source address name */
@@ -895,7 +1151,7 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
   {
     fprintf(stderr, "ERROR: Unable to read data from socket: %s\n",
             strerror(errno));
-    return;
+    return (0);
   }
 
   if (HostNameLookups)
@@ -914,7 +1170,7 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
     fprintf(stderr, "ERROR: Bad SNMP packet from %s: %s\n", addrname,
             packet.error);
 
-    return;
+    return (1);
   }
 
   debug_printf("DEBUG: community=\"%s\"\n", packet.community);
@@ -922,7 +1178,7 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
   debug_printf("DEBUG: error-status=%d\n", packet.error_status);
 
   if (packet.error_status && packet.request_id != DEVICE_TYPE)
-    return;
+    return (1);
 
  /*
   * Find a matching device in the cache...
@@ -931,6 +1187,9 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
   key.addrname = addrname;
   device       = (snmp_cache_t *)cupsArrayFind(Devices, &key);
 
+  if (device)
+    device->updated = run_time();
+
  /*
   * Process the message...
   */
@@ -946,7 +1205,7 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
 	{
 	  debug_printf("DEBUG: Discarding duplicate device type for \"%s\"...\n",
 		       addrname);
-	  return;
+	  return (1);
 	}
 
        /*
@@ -1124,6 +1383,71 @@ read_snmp_response(int fd)		/* I - SNMP socket file descriptor */
 	}
 	break;
   }
+
+  return (1);
+}
+
+
+/*
+ * 'refresh_cache()' - Update the cache file in the background.
+ */
+
+static void
+refresh_cache(int ipv4,			/* I - SNMP IPv4 socket */
+              int ipv6)			/* I - SNMP IPv6 socket */
+{
+  const char	*cachedir;		/* CUPS_CACHEDIR env var */
+  char		filename[1024];		/* Lock filename */
+  int		fd;			/* Lock/null file */
+  struct flock	lock;			/* Lock information */
+
+
+ /*
+  * Flush the cached devices and let the parent exit right away...
+  */
+
+  fflush(stdout);
+
+  if (fork())
+    return;
+
+ /*
+  * Detach from cups-deviced so that it does not wait for the scan...
+  */
+
+  setsid();
+
+  if ((fd = open("/dev/null", O_RDWR)) >= 0)
+  {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    close(fd);
+  }
+
+ /*
+  * Only run one scan at a time...
+  */
+
+  if ((cachedir = getenv("CUPS_CACHEDIR")) == NULL)
+    cachedir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/snmp.lock", cachedir);
+
+  if ((fd = open(filename, O_WRONLY | O_CREAT, 0600)) < 0)
+    return;
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  if (!fcntl(fd, F_SETLK, &lock))
+  {
+    scan_devices(ipv4, ipv6);
+    write_cache();
+  }
+
+  close(fd);
 }
 
 
@@ -1153,22 +1477,41 @@ scan_devices(int ipv4,			/* I - SNMP IPv4 socket */
              int ipv6)			/* I - SNMP IPv6 socket */
 {
   int			fd,		/* File descriptor for this address */
-			busy;		/* Are we busy processing something? */
+			i,		/* Looping var */
+			nfds,		/* Number of file descriptors */
+			count,		/* Number of packets read */
+			sending,	/* Still sending sweep queries? */
+			probing,	/* Number of active probes */
+			pending,	/* Devices waiting to be listed */
+			status;		/* Connection status */
+  socklen_t		len;		/* Length of status */
   char			*address,	/* Current address */
 			*community;	/* Current community */
-  fd_set		input;		/* Input set for select() */
-  struct timeval	timeout;	/* Timeout for select() */
-  time_t		endtime;	/* End time for scan */
+  struct pollfd		*pfds,		/* File descriptors for poll() */
+			*pfd;		/* Current file descriptor */
+  double		curtime,	/* Current time */
+			lasttime;	/* Time of last response */
   http_addrlist_t	*addrs,		/* List of addresses */
 			*addr;		/* Current address */
   snmp_cache_t		*device;	/* Current device */
+  snmp_probe_t		*probe;		/* Current probe */
   char			temp[1024];	/* Temporary address string */
 
 
   gettimeofday(&StartTime, NULL);
 
+  Probes = calloc((size_t)MaxProbes, sizeof(snmp_probe_t));
+  pfds   = calloc((size_t)MaxProbes + 2, sizeof(struct pollfd));
+
+  if (!Probes || !pfds)
+  {
+    fputs("ERROR: Unable to allocate memory for probes!\n", stderr);
+    free(pfds);
+    return;
+  }
+
  /*
-  * First send all of the broadcast queries...
+  * First send all of the broadcast queries and set up the unicast sweeps...
   */
 
   for (address = (char *)cupsArrayFirst(Addresses);
@@ -1187,6 +1530,11 @@ scan_devices(int ipv4,			/* I - SNMP IPv4 socket */
 
       addrs = get_interface_addresses(ifname);
     }
+    else if (strchr(address, '/'))
+    {
+      add_sweep(address);
+      continue;
+    }
     else
       addrs = httpAddrGetList(address, AF_UNSPEC, NULL);
 
@@ -1224,107 +1572,203 @@ scan_devices(int ipv4,			/* I - SNMP IPv4 socket */
   }
 
  /*
-  * Then read any responses that come in over the next 3 seconds...
+  * Then read responses and probe devices until nothing has happened for a
+  * while...
   */
 
-  endtime = time(NULL) + MaxRunTime;
+  for (i = 0; i < MaxProbes; i ++)
+    Probes[i].fd = -1;
 
-  FD_ZERO(&input);
+  lasttime = run_time();
 
-  while (time(NULL) < endtime)
+  while ((curtime = run_time()) < MaxRunTime)
   {
-    timeout.tv_sec  = 2;
-    timeout.tv_usec = 0;
+   /*
+    * Send the next batch of sweep queries...
+    */
+
+    sending = send_sweeps(ipv4);
+
+   /*
+    * Wait for responses and probe connections...
+    */
 
-    FD_SET(ipv4, &input);
-    if (ipv6 >= 0)
-      FD_SET(ipv6, &input);
+    pfds[0].fd     = ipv4;
+    pfds[0].events = POLLIN;
+    pfds[1].fd     = ipv6;
+    pfds[1].events = POLLIN;
 
-    fd = ipv4 > ipv6 ? ipv4 : ipv6;
-    if (select(fd + 1, &input, NULL, NULL, &timeout) < 0)
+    for (i = 0, nfds = 2, probing = 0, probe = Probes;
+         i < MaxProbes;
+	 i ++, probe ++)
+      if (probe->device)
+      {
+        probing ++;
+
+	if (probe->fd >= 0)
+	{
+	  pfds[nfds].fd     = probe->fd;
+	  pfds[nfds].events = POLLOUT;
+	  nfds ++;
+	}
+      }
+
+    if (poll(pfds, (nfds_t)nfds, sending ? 10 : 250) < 0 && errno != EINTR)
     {
-      fprintf(stderr, "ERROR: %.3f select() for %d/%d failed: %s\n", run_time(),
+      fprintf(stderr, "ERROR: %.3f poll() for %d/%d failed: %s\n", run_time(),
               ipv4, ipv6, strerror(errno));
       break;
     }
 
-    busy = 0;
+    curtime = run_time();
 
-    if (FD_ISSET(ipv4, &input))
-    {
-      read_snmp_response(ipv4);
-      busy = 1;
-    }
+    for (i = 0, pfd = pfds; i < 2; i ++, pfd ++)
+      if (pfd->fd >= 0 && (pfd->revents & POLLIN))
+      {
+       /*
+        * Read all of the packets that are waiting...
+	*/
+
+	for (count = 0; count < 256; count ++)
+	{
+	  if (!read_snmp_response(pfd->fd))
+	    break;
+
+          pfd->revents = 0;
+
+	  if (poll(pfd, 1, 0) < 1 || !(pfd->revents & POLLIN))
+	    break;
+	}
 
-    if (ipv6 >= 0 && FD_ISSET(ipv6, &input))
+	lasttime = curtime;
+      }
+
+   /*
+    * Finish probes that have connected, failed, or timed out...
+    */
+
+    for (i = 0, nfds = 2, probe = Probes; i < MaxProbes; i ++, probe ++)
     {
-      read_snmp_response(ipv6);
-      busy = 1;
+      if (!probe->device || probe->fd < 0)
+        continue;
+
+      pfd = pfds + nfds;
+      nfds ++;
+
+      if (pfd->revents)
+      {
+        len = sizeof(status);
+	if (getsockopt(probe->fd, SOL_SOCKET, SO_ERROR, &status, &len))
+	  status = errno;
+      }
+      else if ((curtime - probe->start) >= SNMP_PROBE_TIMEOUT)
+        status = ETIMEDOUT;
+      else
+        continue;
+
+      close(probe->fd);
+      probe->fd = -1;
+
+      if (!status)
+      {
+        probe_found(probe->device, ProbePorts[probe->port]);
+        probe->device = NULL;
+	probing --;
+      }
+      else
+      {
+        probe->port ++;
+	probe_next(probe);
+
+	if (!probe->device)
+	  probing --;
+      }
     }
 
-    if (!busy)
-    {
-     /*
-      * List devices with complete information...
-      */
+   /*
+    * List or probe devices with complete information that have stopped
+    * responding to our queries...
+    */
 
-      int sent_something = 0;
+    for (device = (snmp_cache_t *)cupsArrayFirst(Devices), pending = 0;
+         device;
+	 device = (snmp_cache_t *)cupsArrayNext(Devices))
+    {
+      if (device->sent || !device->info || !device->make_and_model)
+        continue;
 
-      for (device = (snmp_cache_t *)cupsArrayFirst(Devices);
-           device;
-	   device = (snmp_cache_t *)cupsArrayNext(Devices))
-        if (!device->sent && device->info && device->make_and_model)
-	{
-	  if (device->uri)
-	    list_device(device);
-	  else
-	    probe_device(device);
+      if ((curtime - device->updated) < SNMP_QUIET_TIME)
+      {
+        pending ++;
+	continue;
+      }
 
-	  device->sent = sent_something = 1;
-	}
+      if (device->uri)
+	list_device(device);
+      else if (probing < MaxProbes)
+      {
+	probe_device(device);
+	probing ++;
+      }
+      else
+      {
+        pending ++;
+	continue;
+      }
 
-      if (!sent_something)
-        break;
+      device->sent = 1;
     }
+
+    if (!sending && !probing && !pending &&
+        (curtime - lasttime) >= SNMP_SCAN_TIMEOUT)
+      break;
   }
 
+  for (i = 0, probe = Probes; i < MaxProbes; i ++, probe ++)
+    if (probe->fd >= 0)
+      close(probe->fd);
+
+  free(pfds);
+
   debug_printf("DEBUG: %.3f Scan complete!\n", run_time());
 }
 
 
 /*
- * 'try_connect()' - Try connecting on a port...
+ * 'send_sweeps()' - Send the next batch of unicast sweep queries.
  */
 
-static int				/* O - 0 on success or -1 on error */
-try_connect(http_addr_t *addr,		/* I - Socket address */
-            const char  *addrname,	/* I - Hostname or IP address */
-            int         port)		/* I - Port number */
+static int				/* O - 1 if more queries remain, 0 otherwise */
+send_sweeps(int fd)			/* I - SNMP IPv4 socket */
 {
-  int	fd;				/* Socket */
-  int	status;				/* Connection status */
+  int		count = 0;		/* Number of queries sent */
+  snmp_sweep_t	*sweep;			/* Current sweep */
+  http_addr_t	addr;			/* Address to query */
 
 
-  debug_printf("DEBUG: %.3f Trying %s://%s:%d...\n", run_time(),
-               port == 515 ? "lpd" : "socket", addrname, port);
+  memset(&addr, 0, sizeof(addr));
+  addr.ipv4.sin_family = AF_INET;
 
-  if ((fd = socket(httpAddrFamily(addr), SOCK_STREAM, 0)) < 0)
+  for (sweep = (snmp_sweep_t *)cupsArrayFirst(Sweeps);
+       sweep;
+       sweep = (snmp_sweep_t *)cupsArrayNext(Sweeps))
   {
-    fprintf(stderr, "ERROR: Unable to create socket: %s\n",
-            strerror(errno));
-    return (-1);
-  }
-
-  _httpAddrSetPort(addr, port);
+    for (; sweep->remaining > 0 && count < SNMP_SWEEP_BATCH; count ++)
+    {
+      addr.ipv4.sin_addr.s_addr = htonl(sweep->next);
 
-  alarm(1);
+      _cupsSNMPWrite(fd, &addr, CUPS_SNMP_VERSION_1, sweep->community,
+		     CUPS_ASN1_GET_REQUEST, DEVICE_TYPE, DeviceTypeOID);
 
-  status = connect(fd, (void *)addr, (socklen_t)httpAddrLength(addr));
+      sweep->next ++;
+      sweep->remaining --;
+    }
 
-  close(fd);
-  alarm(0);
+    if (sweep->remaining > 0)
+      return (1);
+  }
 
-  return (status);
+  return (0);
 }
 
 
@@ -1363,6 +1807,79 @@ update_cache(snmp_cache_t *device,	/* I - Device */
 }
 
 
+/*
+ * 'write_cache()' - Write the devices that were found to the cache file.
+ */
+
+static void
+write_cache(void)
+{
+  const char	*cachedir;		/* CUPS_CACHEDIR env var */
+  char		filename[1024],		/* Cache filename */
+		tempfile[1024];		/* Temporary cache filename */
+  int		i;			/* Looping var */
+  const char	*fields[6],		/* Fields to write */
+		*ptr;			/* Pointer into field */
+  cups_file_t	*fp;			/* Cache file */
+  snmp_cache_t	*device;		/* Current device */
+
+
+  if ((cachedir = getenv("CUPS_CACHEDIR")) == NULL)
+    cachedir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/snmp.cache", cachedir);
+  snprintf(tempfile, sizeof(tempfile), "%s/snmp.cache.%d", cachedir,
+           (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+  {
+    debug_printf("DEBUG: Unable to create \"%s\": %s\n", tempfile,
+                 strerror(errno));
+    return;
+  }
+
+  cupsFilePuts(fp, "# SNMP device cache - DO NOT EDIT\n");
+
+  for (device = (snmp_cache_t *)cupsArrayFirst(Devices);
+       device;
+       device = (snmp_cache_t *)cupsArrayNext(Devices))
+  {
+    if (!device->sent || !device->uri)
+      continue;
+
+    fields[0] = device->addrname;
+    fields[1] = device->uri;
+    fields[2] = device->make_and_model;
+    fields[3] = device->info;
+    fields[4] = device->id;
+    fields[5] = device->location;
+
+    for (i = 0; i < 6; i ++)
+    {
+      if (i)
+        cupsFilePutChar(fp, '\t');
+
+     /*
+      * Replace tabs, newlines, and other control characters with spaces...
+      */
+
+      if (fields[i])
+	for (ptr = fields[i]; *ptr; ptr ++)
+	  cupsFilePutChar(fp, (*ptr & 255) < ' ' ? ' ' : *ptr);
+    }
+
+    cupsFilePutChar(fp, '\n');
+  }
+
+  if (cupsFileClose(fp) || rename(tempfile, filename))
+  {
+    debug_printf("DEBUG: Unable to write \"%s\": %s\n", filename,
+                 strerror(errno));
+    unlink(tempfile);
+  }
+}
+
+
 /*
  * End of "$Id: snmp.c 11645 2014-02-27 16:35:53Z msweet $".
  */
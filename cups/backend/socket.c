@@ -34,13 +34,35 @@
 #  include <netinet/in.h>
 #  include <arpa/inet.h>
 #  include <netdb.h>
+#  include <poll.h>
 #endif /* WIN32 */
 
 
+/*
+ * Local globals...
+ */
+
+static int		job_canceled = 0;
+					/* Job canceled? */
+static http_addrlist_t	*persist_addrlist = NULL,
+					/* Addresses kept between jobs */
+			*persist_addr = NULL;
+					/* Address of kept connection */
+static int		persist_fd = -1,/* Connection kept between jobs */
+			persist_server = 0,
+					/* Sending jobs for other backends? */
+			persist_snmp_fd = -1;
+					/* SNMP socket kept between jobs */
+
+
 /*
  * Local functions...
  */
 
+static void	persist_close(void);
+static int	persist_main(int argc, char *argv[]);
+static int	send_job(int argc, char *argv[]);
+static void	sigterm_handler(int sig);
 static ssize_t	wait_bc(int device_fd, int secs);
 
 
@@ -56,36 +78,6 @@ int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
      char *argv[])			/* I - Command-line arguments */
 {
-  const char	*device_uri;		/* Device URI */
-  char		scheme[255],		/* Scheme in URI */
-		hostname[1024],		/* Hostname */
-		username[255],		/* Username info (not used) */
-		resource[1024],		/* Resource info (not used) */
-		*options,		/* Pointer to options */
-		*name,			/* Name of option */
-		*value,			/* Value of option */
-		sep;			/* Option separator */
-  int		print_fd;		/* Print file */
-  int		copies;			/* Number of copies to print */
-  time_t	start_time;		/* Time of first connect */
-  int		contimeout;		/* Connection timeout */
-  int		waiteof;		/* Wait for end-of-file? */
-  int		port;			/* Port number */
-  char		portname[255];		/* Port name */
-  int		delay;			/* Delay for retries... */
-  int		device_fd;		/* AppSocket */
-  int		error;			/* Error code (if any) */
-  http_addrlist_t *addrlist,		/* Address list */
-		*addr;			/* Connected address */
-  char		addrname[256];		/* Address name */
-  int		snmp_enabled = 1;	/* Is SNMP enabled? */
-  int		snmp_fd,		/* SNMP socket */
-		start_count,		/* Page count via SNMP at start */
-		page_count,		/* Page count via SNMP */
-		have_supplies;		/* Printer supports supply levels? */
-  ssize_t	bytes = 0,		/* Initial bytes read */
-		tbytes;			/* Total number of bytes written */
-  char		buffer[1024];		/* Initial print buffer */
 #if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
   struct sigaction action;		/* Actions for POSIX signals */
 #endif /* HAVE_SIGACTION && !HAVE_SIGSET */
@@ -129,6 +121,61 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
     return (CUPS_BACKEND_FAILED);
   }
 
+  return (send_job(argc, argv));
+}
+
+
+/*
+ * 'send_job()' - Send a job to the printer.
+ *
+ * A persistent backend process calls this for every job it sends, so
+ * everything that isn't kept for the next job is freed before returning.
+ */
+
+static int				/* O - Exit status */
+send_job(int  argc,			/* I - Number of command-line arguments (6 or 7) */
+         char *argv[])			/* I - Command-line arguments */
+{
+  const char	*device_uri;		/* Device URI */
+  char		scheme[255],		/* Scheme in URI */
+		hostname[1024],		/* Hostname */
+		username[255],		/* Username info (not used) */
+		resource[1024],		/* Resource info (not used) */
+		*options,		/* Pointer to options */
+		*name,			/* Name of option */
+		*value,			/* Value of option */
+		sep;			/* Option separator */
+  int		print_fd;		/* Print file */
+  int		copies;			/* Number of copies to print */
+  time_t	start_time;		/* Time of first connect */
+  int		contimeout;		/* Connection timeout */
+  int		waiteof;		/* Wait for end-of-file? */
+  int		drain;			/* Seconds to wait for back-channel data */
+  int		persist;		/* Seconds to keep connection */
+  int		status;			/* Exit status */
+  int		port;			/* Port number */
+  char		portname[255];		/* Port name */
+  int		delay;			/* Delay for retries... */
+  int		device_fd = -1;		/* AppSocket */
+  int		error;			/* Error code (if any) */
+  http_addrlist_t *addrlist = NULL,	/* Address list */
+		*newlist,		/* New address list */
+		*addr = NULL;		/* Connected address */
+  struct pollfd	pfd;			/* Kept connection polling */
+  char		addrname[256];		/* Address name */
+  int		snmp_enabled = 1;	/* Is SNMP enabled? */
+  int		snmp_fd = -1,		/* SNMP socket */
+		start_count,		/* Page count via SNMP at start */
+		page_count,		/* Page count via SNMP */
+		have_supplies;		/* Printer supports supply levels? */
+  ssize_t	bytes = 0,		/* Initial bytes read */
+		tbytes;			/* Total number of bytes written */
+  char		buffer[1024];		/* Initial print buffer */
+#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
+  struct sigaction action;		/* Actions for POSIX signals */
+#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
+
+
  /*
   * If we have 7 arguments, print the file named on the command-line.
   * Otherwise, send stdin instead...
@@ -164,7 +211,10 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
     sleep(10);
 
     if (getenv("CLASS") != NULL)
-      return (CUPS_BACKEND_FAILED);
+    {
+      status = CUPS_BACKEND_FAILED;
+      goto done;
+    }
   }
 
   httpSeparateURI(HTTP_URI_CODING_ALL, device_uri, scheme, sizeof(scheme),
@@ -179,6 +229,8 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
   */
 
   waiteof    = 1;
+  drain      = -1;
+  persist    = 0;
   contimeout = 7 * 24 * 60 * 60;
 
   if ((options = strchr(resource, '?')) != NULL)
@@ -257,9 +309,61 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 	if (atoi(value) > 0)
 	  contimeout = atoi(value);
       }
+      else if (!_cups_strcasecmp(name, "drain"))
+      {
+       /*
+        * Set the time to wait for back-channel data at the end of the job...
+	*/
+
+	if (atoi(value) >= 0)
+	  drain = atoi(value);
+      }
+      else if (!_cups_strcasecmp(name, "persist"))
+      {
+       /*
+        * Keep the connection open between jobs...
+	*/
+
+        persist = atoi(value);
+      }
     }
   }
 
+ /*
+  * Hand the job to the persistent backend process for this printer, if
+  * requested...
+  */
+
+  if (persist > 0 && !persist_server)
+  {
+#ifdef HAVE_SIGSET
+    sigset(SIGTERM, sigterm_handler);
+#elif defined(HAVE_SIGACTION)
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sigterm_handler;
+    sigaction(SIGTERM, &action, NULL);
+#else
+    signal(SIGTERM, sigterm_handler);
+#endif /* HAVE_SIGSET */
+
+    if ((status = backendPersistJob(argc, argv, device_uri, "socket-persist",
+                                    persist, &job_canceled, persist_main,
+				    persist_close)) >= 0)
+      goto done;
+
+#ifdef HAVE_SIGSET
+    sigset(SIGTERM, SIG_DFL);
+#elif defined(HAVE_SIGACTION)
+    action.sa_handler = SIG_DFL;
+    sigaction(SIGTERM, &action, NULL);
+#else
+    signal(SIGTERM, SIG_DFL);
+#endif /* HAVE_SIGSET */
+  }
+
+  if (drain < 0)
+    drain = persist_server ? 0 : 90;
+
  /*
   * Then try finding the remote host...
   */
@@ -269,29 +373,43 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
   sprintf(portname, "%d", port);
 
   fputs("STATE: +connecting-to-device\n", stderr);
-  fprintf(stderr, "DEBUG: Looking up \"%s\"...\n", hostname);
 
-  while ((addrlist = httpAddrGetList(hostname, AF_UNSPEC, portname)) == NULL)
+  if ((addrlist = persist_addrlist) == NULL)
   {
-    _cupsLangPrintFilter(stderr, "INFO",
-                         _("Unable to locate printer \"%s\"."), hostname);
-    sleep(10);
+    fprintf(stderr, "DEBUG: Looking up \"%s\"...\n", hostname);
 
-    if (getenv("CLASS") != NULL)
+    while ((addrlist = httpAddrGetList(hostname, AF_UNSPEC, portname)) == NULL)
     {
-      fputs("STATE: -connecting-to-device\n", stderr);
-      return (CUPS_BACKEND_STOP);
+      _cupsLangPrintFilter(stderr, "INFO",
+			   _("Unable to locate printer \"%s\"."), hostname);
+      sleep(10);
+
+      if (getenv("CLASS") != NULL)
+      {
+	fputs("STATE: -connecting-to-device\n", stderr);
+
+	status = CUPS_BACKEND_STOP;
+	goto done;
+      }
     }
+
+    if (persist_server)
+      persist_addrlist = addrlist;
   }
 
  /*
   * See if the printer supports SNMP...
   */
 
-  if (snmp_enabled)
-    snmp_fd = _cupsSNMPOpen(addrlist->addr.addr.sa_family);
-  else
+  if (!snmp_enabled)
     snmp_fd = -1;
+  else if ((snmp_fd = persist_snmp_fd) < 0)
+  {
+    snmp_fd = _cupsSNMPOpen(addrlist->addr.addr.sa_family);
+
+    if (persist_server)
+      persist_snmp_fd = snmp_fd;
+  }
 
   if (snmp_fd >= 0)
     have_supplies = !backendSNMPSupplies(snmp_fd, &(addrlist->addr),
@@ -305,26 +423,68 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 
   if (print_fd == 0)
   {
-    if (!backendWaitLoop(snmp_fd, &(addrlist->addr), 1, backendNetworkSideCB))
-      return (CUPS_BACKEND_OK);
-    else if ((bytes = read(0, buffer, sizeof(buffer))) <= 0)
-      return (CUPS_BACKEND_OK);
+    if (!backendWaitLoop(snmp_fd, &(addrlist->addr), 1, backendNetworkSideCB) ||
+        (bytes = read(0, buffer, sizeof(buffer))) <= 0)
+    {
+      status = CUPS_BACKEND_OK;
+      goto done;
+    }
   }
 
  /*
-  * Connect to the printer...
+  * Use the connection from the last job unless the printer has closed it
+  * or sent something we don't expect...
   */
 
-  fprintf(stderr, "DEBUG: Connecting to %s:%d\n", hostname, port);
-  _cupsLangPrintFilter(stderr, "INFO", _("Connecting to printer."));
+  if (persist_fd >= 0)
+  {
+    pfd.fd     = persist_fd;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, 0))
+    {
+      fputs("DEBUG: Printer closed the kept connection, reconnecting.\n",
+            stderr);
+
+      close(persist_fd);
+      persist_fd = -1;
+    }
+  }
 
-  for (delay = 5;;)
+  if ((device_fd = persist_fd) >= 0)
+  {
+    addr = persist_addr;
+
+    fputs("DEBUG: Using the connection kept from the last job.\n", stderr);
+  }
+  else
+  {
+    fprintf(stderr, "DEBUG: Connecting to %s:%d\n", hostname, port);
+    _cupsLangPrintFilter(stderr, "INFO", _("Connecting to printer."));
+  }
+
+ /*
+  * Connect to the printer...
+  */
+
+  for (delay = 5; device_fd < 0;)
   {
     if ((addr = httpAddrConnect(addrlist, &device_fd)) == NULL)
     {
       error     = errno;
       device_fd = -1;
 
+      if (addrlist == persist_addrlist &&
+          (newlist = httpAddrGetList(hostname, AF_UNSPEC, portname)) != NULL)
+      {
+       /*
+        * Look up the printer again in case its address has changed...
+	*/
+
+        httpAddrFreeList(persist_addrlist);
+	addrlist = persist_addrlist = newlist;
+      }
+
       if (getenv("CLASS") != NULL)
       {
        /*
@@ -344,7 +504,8 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 
 	sleep(5);
 
-        return (CUPS_BACKEND_FAILED);
+        status = CUPS_BACKEND_FAILED;
+        goto done;
       }
 
       fprintf(stderr, "DEBUG: Connection error: %s\n", strerror(error));
@@ -356,7 +517,9 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 	{
 	  _cupsLangPrintFilter(stderr, "ERROR",
 	                       _("The printer is not responding."));
-	  return (CUPS_BACKEND_FAILED);
+
+	  status = CUPS_BACKEND_FAILED;
+	  goto done;
 	}
 
 	switch (error)
@@ -392,8 +555,6 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 	sleep(30);
       }
     }
-    else
-      break;
   }
 
   fputs("STATE: -connecting-to-device\n", stderr);
@@ -431,7 +592,24 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 
   fputs("STATE: +cups-waiting-for-job-completed\n", stderr);
 
-  if (waiteof)
+  if (persist_server)
+  {
+   /*
+    * Read any back-channel data that arrives within the drain time, then
+    * keep the connection for the next job...
+    */
+
+    while (tbytes >= 0 && (bytes = wait_bc(device_fd, drain)) > 0);
+
+    if (tbytes < 0 || bytes == 0)
+      persist_fd = -1;
+    else
+    {
+      persist_fd   = device_fd;
+      persist_addr = addr;
+    }
+  }
+  else if (waiteof)
   {
    /*
     * Shutdown the socket and wait for the other end to finish...
@@ -441,7 +619,7 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
 
     shutdown(device_fd, 1);
 
-    while (wait_bc(device_fd, 90) > 0);
+    while (wait_bc(device_fd, drain) > 0);
   }
 
  /*
@@ -453,13 +631,22 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
       page_count > start_count)
     fprintf(stderr, "PAGE: total %d\n", page_count - start_count);
 
+  status = CUPS_BACKEND_OK;
+
  /*
   * Close the socket connection...
   */
 
-  close(device_fd);
+  done:
 
-  httpAddrFreeList(addrlist);
+  if (device_fd >= 0 && device_fd != persist_fd)
+    close(device_fd);
+
+  if (addrlist != persist_addrlist)
+    httpAddrFreeList(addrlist);
+
+  if (snmp_fd >= 0 && snmp_fd != persist_snmp_fd)
+    _cupsSNMPClose(snmp_fd);
 
  /*
   * Close the input file and return...
@@ -468,7 +655,79 @@ main(int  argc,				/* I - Number of command-line arguments (6 or 7) */
   if (print_fd != 0)
     close(print_fd);
 
-  return (CUPS_BACKEND_OK);
+  return (status);
+}
+
+
+/*
+ * 'persist_close()' - Close the connection kept between jobs.
+ */
+
+static void
+persist_close(void)
+{
+  if (persist_fd >= 0)
+  {
+    close(persist_fd);
+    persist_fd = -1;
+  }
+
+  if (persist_snmp_fd >= 0)
+  {
+    _cupsSNMPClose(persist_snmp_fd);
+    persist_snmp_fd = -1;
+  }
+
+  httpAddrFreeList(persist_addrlist);
+  persist_addrlist = NULL;
+}
+
+
+/*
+ * 'persist_main()' - Send a job for another backend process using the
+ *                    connection kept from the last job.
+ */
+
+static int				/* O - Exit status */
+persist_main(int  argc,			/* I - Number of command-line args */
+             char *argv[])		/* I - Command-line arguments */
+{
+#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
+  struct sigaction action;		/* Actions for POSIX signals */
+#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
+
+
+ /*
+  * Cancel each job the same way as a backend that was started for it...
+  */
+
+#ifdef HAVE_SIGSET
+  sigset(SIGTERM, SIG_DFL);
+#elif defined(HAVE_SIGACTION)
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIG_DFL;
+  sigaction(SIGTERM, &action, NULL);
+#else
+  signal(SIGTERM, SIG_DFL);
+#endif /* HAVE_SIGSET */
+
+  persist_server = 1;
+  job_canceled   = 0;
+
+  return (send_job(argc, argv));
+}
+
+
+/*
+ * 'sigterm_handler()' - Handle 'terminate' signals that stop the backend.
+ */
+
+static void
+sigterm_handler(int sig)		/* I - Signal */
+{
+  (void)sig;	/* remove compiler warnings... */
+
+  job_canceled = 1;
 }
 
 
@@ -198,7 +198,7 @@ esac
 AC_CHECK_FUNCS(sigaction)
 
 dnl Checks for wait functions.
-AC_CHECK_FUNCS(waitpid wait3)
+AC_CHECK_FUNCS(waitpid wait3 wait4)
 
 dnl Check for posix_spawn
 AC_CHECK_FUNCS(posix_spawn)
@@ -16,6 +16,7 @@ dnl
 AC_CHECK_FUNC(poll, AC_DEFINE(HAVE_POLL))
 AC_CHECK_FUNC(epoll_create, AC_DEFINE(HAVE_EPOLL))
 AC_CHECK_FUNC(kqueue, AC_DEFINE(HAVE_KQUEUE))
+AC_CHECK_FUNC(splice, AC_DEFINE(HAVE_SPLICE))
 
 dnl
 dnl End of "$Id: cups-poll.m4 11468 2013-12-18 20:31:42Z msweet $".
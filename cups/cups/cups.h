@@ -266,6 +266,10 @@ typedef struct _cups_dinfo_s cups_dinfo_t;
 					/* Destination capability and status
 					 * information @since CUPS 1.6/OS X 10.8@ */
 
+typedef struct _cups_loop_s cups_loop_t;
+					/* Asynchronous request loop
+					 * @since CUPS 2.1@ */
+
 typedef struct cups_job_s		/**** Job ****/
 {
   int		id;			/* The job ID */
@@ -332,6 +336,12 @@ typedef const char *(*cups_password_cb2_t)(const char *prompt, http_t *http,
 					/* New password callback
 					 * @since CUPS 1.4/OS X 10.6@ */
 
+typedef void (*cups_request_cb_t)(void *user_data, http_t *http,
+				  ipp_status_t status, const char *message,
+				  ipp_t *response);
+					/* Asynchronous request callback
+					 * @since CUPS 2.1@ */
+
 typedef int (*cups_server_cert_cb_t)(http_t *http, void *tls,
 				     cups_array_t *certs, void *user_data);
 					/* Server credentials callback
@@ -621,6 +631,12 @@ extern const char	*cupsLocalizeDestMedia(http_t *http, cups_dest_t *dest, cups_d
 extern int		cupsMakeServerCredentials(const char *path, const char *common_name, int num_alt_names, const char **alt_names, time_t expiration_date) _CUPS_API_2_0;
 extern int		cupsSetServerCredentials(const char *path, const char *common_name, int auto_create) _CUPS_API_2_0;
 
+/* New in CUPS 2.1 */
+extern int		cupsDoRequestAsync(cups_loop_t *loop, http_t *http, ipp_t *request, const char *resource, int msec, cups_request_cb_t cb, void *user_data) _CUPS_API_2_1;
+extern void		cupsLoopDelete(cups_loop_t *loop) _CUPS_API_2_1;
+extern cups_loop_t	*cupsLoopNew(void) _CUPS_API_2_1;
+extern int		cupsLoopRun(cups_loop_t *loop, int msec) _CUPS_API_2_1;
+
 #  ifdef __cplusplus
 }
 #  endif /* __cplusplus */
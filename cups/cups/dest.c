@@ -59,11 +59,28 @@
 #  define kUseLastPrinter	CFSTR("UseLastPrinter")
 #endif /* __APPLE__ */
 
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+#  define _CUPS_DNSSD_IDLE	300	/* Seconds to keep browsing after use */
+#  define _CUPS_DNSSD_WAIT	50	/* Milliseconds between cache checks */
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
 
 /*
  * Types...
  */
 
+typedef struct _cups_dests_cache_s	/* Cached printer list */
+{
+  char			*server,	/* Server hostname */
+			*user;		/* Requesting user */
+  int			port;		/* Server port */
+  cups_ptype_t		type,		/* Printer type bits */
+			mask;		/* Printer type mask */
+  int			change_count;	/* printer-list-change-count value */
+  int			num_dests;	/* Number of destinations */
+  cups_dest_t		*dests;		/* Destinations */
+} _cups_dests_cache_t;
+
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 typedef enum _cups_dnssd_state_e	/* Enumerated device state */
 {
@@ -79,10 +96,20 @@ typedef enum _cups_dnssd_state_e	/* Enumerated device state */
 typedef struct _cups_dnssd_data_s	/* Enumeration data */
 {
 #  ifdef HAVE_DNSSD
-  DNSServiceRef		main_ref;	/* Main service reference */
+  DNSServiceRef		main_ref,	/* Main service reference */
+			ipp_ref,	/* IPP browser */
+			local_ipp_ref;	/* Local IPP browser */
+#    ifdef HAVE_SSL
+  DNSServiceRef		ipps_ref,	/* IPPS browser */
+			local_ipps_ref;	/* Local IPPS browser */
+#    endif /* HAVE_SSL */
 #  else /* HAVE_AVAHI */
   AvahiSimplePoll	*simple_poll;	/* Polling interface */
   AvahiClient		*client;	/* Client information */
+  AvahiServiceBrowser	*ipp_ref;	/* IPP browser */
+#    ifdef HAVE_SSL
+  AvahiServiceBrowser	*ipps_ref;	/* IPPS browser */
+#    endif /* HAVE_SSL */
   int			got_data;	/* Did we get data? */
 #  endif /* HAVE_DNSSD */
   cups_dest_cb_t	cb;		/* Callback */
@@ -112,9 +139,47 @@ typedef struct _cups_dnssd_resolve_s	/* Data for resolving URI */
   int			*cancel;	/* Pointer to "cancel" variable */
   struct timeval	end_time;	/* Ending time */
 } _cups_dnssd_resolve_t;
+
+typedef struct _cups_dnssd_cache_s	/* Cached network destination */
+{
+  cups_dest_t		dest;		/* Destination record */
+  cups_ptype_t		type;		/* Printer type bits */
+  unsigned		generation;	/* Generation of last change */
+  int			removed;	/* Has the destination gone away? */
+} _cups_dnssd_cache_t;
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	cups_dests_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for printer list cache */
+static cups_array_t	*cups_dests_cache = NULL;
+					/* Printer lists from servers */
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static _cups_mutex_t	cups_dnssd_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for background browsing */
+static cups_array_t	*cups_dnssd_cache = NULL;
+					/* Network destinations found so far */
+static unsigned		cups_dnssd_generation = 0;
+					/* Current cache generation */
+static int		cups_dnssd_pid = 0,
+					/* Process that started browsing */
+			cups_dnssd_running = 0,
+					/* Is the browse thread running? */
+			cups_dnssd_users = 0;
+					/* Number of active enumerations */
+static time_t		cups_dnssd_used = 0;
+					/* Time of last enumeration */
+#  ifdef HAVE_PTHREAD_H
+static int		cups_dnssd_atfork = 0;
+					/* Is the fork handler registered? */
+#  endif /* HAVE_PTHREAD_H */
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
 /*
  * Local functions...
  */
@@ -132,6 +197,11 @@ static cups_dest_t	*cups_add_dest(const char *name, const char *instance,
 static int		cups_block_cb(cups_dest_block_t block, unsigned flags,
 			              cups_dest_t *dest);
 #endif /* __BLOCKS__ */
+static void		cups_cache_dests(_cups_dests_cache_t *key,
+			                 int change_count, int num_dests,
+			                 cups_dest_t *dests);
+static int		cups_compare_cache(_cups_dests_cache_t *a,
+			                   _cups_dests_cache_t *b);
 static int		cups_compare_dests(cups_dest_t *a, cups_dest_t *b);
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 #  ifdef HAVE_DNSSD
@@ -157,8 +227,21 @@ static void		cups_dnssd_client_cb(AvahiClient *client,
 					     AvahiClientState state,
 					     void *context);
 #  endif /* HAVE_DNSSD */
+static int		cups_dnssd_browse_poll(_cups_dnssd_data_t *data,
+			                       int msec);
+static int		cups_dnssd_browse_start(_cups_dnssd_data_t *data);
+static void		cups_dnssd_browse_stop(_cups_dnssd_data_t *data);
+static void		*cups_dnssd_browse_thread(void *arg);
+static int		cups_dnssd_cache_cb(void *user_data, unsigned flags,
+			                    cups_dest_t *dest);
+static int		cups_dnssd_compare_cache(_cups_dnssd_cache_t *a,
+			                         _cups_dnssd_cache_t *b);
 static int		cups_dnssd_compare_devices(_cups_dnssd_device_t *a,
 			                           _cups_dnssd_device_t *b);
+#  ifdef HAVE_PTHREAD_H
+static void		cups_dnssd_fork_child(void);
+#  endif /* HAVE_PTHREAD_H */
+static void		cups_dnssd_free_cache(_cups_dnssd_cache_t *entry);
 static void		cups_dnssd_free_device(_cups_dnssd_device_t *device,
 			                       _cups_dnssd_data_t *data);
 static _cups_dnssd_device_t *
@@ -197,6 +280,10 @@ static void		cups_dnssd_query_cb(AvahiRecordBrowser *browser,
 					    AvahiLookupResultFlags flags,
 					    void *context);
 #  endif /* HAVE_DNSSD */
+static int		cups_dnssd_report(cups_array_t *seen, int num_dests,
+					  cups_dest_t *dests, int *cancel,
+					  cups_ptype_t type, cups_ptype_t mask,
+					  cups_dest_cb_t cb, void *user_data);
 static const char	*cups_dnssd_resolve(cups_dest_t *dest, const char *uri,
 					    int msec, int *cancel,
 					    cups_dest_cb_t cb, void *user_data);
@@ -207,6 +294,7 @@ static void		cups_dnssd_unquote(char *dst, const char *src,
 static int		cups_find_dest(const char *name, const char *instance,
 				       int num_dests, cups_dest_t *dests, int prev,
 				       int *rdiff);
+static void		cups_free_cache(_cups_dests_cache_t *cache);
 static char		*cups_get_default(const char *filename, char *namebuf,
 					  size_t namesize, const char **instance);
 static int		cups_get_dests(const char *filename, const char *match_name,
@@ -533,6 +621,9 @@ _cupsAppleSetUseLastPrinter(
  * to by "cancel" is non-zero, or the callback function (or block) returns 0,
  * The caller is responsible for calling httpClose() on the returned object.
  *
+ * Idle connections are kept open after httpClose() and reused by later calls
+ * for the same server, port, encryption, and user.
+ *
  * @since CUPS 1.6/OS X 10.8@
  */
 
@@ -616,6 +707,29 @@ cupsConnectDest(
     return (NULL);
   }
 
+  if (!strcmp(scheme, "ipps") || port == 443)
+    encryption = HTTP_ENCRYPTION_ALWAYS;
+  else
+    encryption = HTTP_ENCRYPTION_IF_REQUESTED;
+
+ /*
+  * Use an idle connection from the pool if we have one...
+  */
+
+  if (!(flags & CUPS_DEST_FLAGS_UNCONNECTED) &&
+      (http = _httpPoolGet(hostname, port, encryption,
+                           _cupsGlobals()->tls_credentials)) != NULL)
+  {
+    DEBUG_printf(("1cupsConnectDest: Reusing pooled connection %p.", http));
+
+    http->pool = 1;
+
+    if (cb)
+      (*cb)(user_data, CUPS_DEST_FLAGS_NONE, dest);
+
+    return (http);
+  }
+
  /*
   * Lookup the address for the server...
   */
@@ -647,17 +761,16 @@ cupsConnectDest(
   }
 
  /*
-  * Create the HTTP object pointing to the server referenced by the URI...
+  * Create the HTTP object pointing to the server referenced by the URI; the
+  * connection is returned to the pool when closed...
   */
 
-  if (!strcmp(scheme, "ipps") || port == 443)
-    encryption = HTTP_ENCRYPTION_ALWAYS;
-  else
-    encryption = HTTP_ENCRYPTION_IF_REQUESTED;
-
   http = httpConnect2(hostname, port, addrlist, AF_UNSPEC, encryption, 1, 0,
                       NULL);
 
+  if (http)
+    http->pool = 1;
+
  /*
   * Connect if requested...
   */
@@ -805,6 +918,13 @@ cupsCopyDest(cups_dest_t *dest,
  * Enumeration happens on the current thread and does not return until all
  * destinations have been enumerated or the callback function returns 0.
  *
+ * Local destinations are reported first.  Network destinations are found by
+ * a background thread that keeps browsing for a few minutes after the last
+ * enumeration, so destinations that are already known are reported right
+ * away and new, changed, or removed destinations are reported as they are
+ * found until the timeout expires.  A timeout of 0 only reports the local
+ * destinations and the network destinations that are already known.
+ *
  * @since CUPS 1.6/OS X 10.8@
  */
 
@@ -828,32 +948,10 @@ cupsEnumDests(
 			*instance,	/* Pointer to instance name */
 			*user_default;	/* User default printer */
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
-  int			count,		/* Number of queries started */
-			remaining;	/* Remainder of timeout */
-  _cups_dnssd_data_t	data;		/* Data for callback */
-  _cups_dnssd_device_t	*device;	/* Current device */
-#  ifdef HAVE_DNSSD
-  int			nfds,		/* Number of files responded */
-			main_fd;	/* File descriptor for lookups */
-  DNSServiceRef		ipp_ref,	/* IPP browser */
-			local_ipp_ref;	/* Local IPP browser */
-#    ifdef HAVE_SSL
-  DNSServiceRef		ipps_ref,	/* IPPS browser */
-			local_ipps_ref;	/* Local IPPS browser */
-#    endif /* HAVE_SSL */
-#    ifdef HAVE_POLL
-  struct pollfd		pfd;		/* Polling data */
-#    else
-  fd_set		input;		/* Input set for select() */
-  struct timeval	timeout;	/* Timeout for select() */
-#    endif /* HAVE_POLL */
-#  else /* HAVE_AVAHI */
-  int			error;		/* Error value */
-  AvahiServiceBrowser	*ipp_ref;	/* IPP browser */
-#    ifdef HAVE_SSL
-  AvahiServiceBrowser	*ipps_ref;	/* IPPS browser */
-#    endif /* HAVE_SSL */
-#  endif /* HAVE_DNSSD */
+  int			remaining,	/* Remainder of timeout */
+			wait,		/* Time to wait for changes */
+			running;	/* Is the browse thread running? */
+  cups_array_t		*seen;		/* Network destinations reported */
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
  /*
@@ -904,225 +1002,103 @@ cupsEnumDests(
                dest))
       break;
 
-  cupsFreeDests(num_dests, dests);
-
-  if (i > 0 || msec == 0)
+  if (i > 0)
+  {
+    cupsFreeDests(num_dests, dests);
     return (1);
+  }
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
  /*
-  * Get Bonjour-shared printers...
+  * Start browsing for Bonjour-shared printers in the background as needed...
   */
 
-  data.type      = type;
-  data.mask      = mask;
-  data.cb        = cb;
-  data.user_data = user_data;
-  data.devices   = cupsArrayNew3((cups_array_func_t)cups_dnssd_compare_devices, NULL, NULL, 0, NULL, (cups_afree_func_t)cups_dnssd_free_device);
-
-#  ifdef HAVE_DNSSD
-  if (DNSServiceCreateConnection(&data.main_ref) != kDNSServiceErr_NoError)
-    return (0);
-
-  main_fd = DNSServiceRefSockFD(data.main_ref);
-
-  ipp_ref = data.main_ref;
-  DNSServiceBrowse(&ipp_ref, kDNSServiceFlagsShareConnection, 0,
-                   "_ipp._tcp", NULL,
-                   (DNSServiceBrowseReply)cups_dnssd_browse_cb, &data);
-
-  local_ipp_ref = data.main_ref;
-  DNSServiceBrowse(&local_ipp_ref, kDNSServiceFlagsShareConnection,
-                   kDNSServiceInterfaceIndexLocalOnly,
-                   "_ipp._tcp", NULL,
-                   (DNSServiceBrowseReply)cups_dnssd_local_cb, &data);
+#  ifdef HAVE_PTHREAD_H
+  _cupsGlobalLock();
 
-#    ifdef HAVE_SSL
-  ipps_ref = data.main_ref;
-  DNSServiceBrowse(&ipps_ref, kDNSServiceFlagsShareConnection, 0,
-                   "_ipps._tcp", NULL,
-                   (DNSServiceBrowseReply)cups_dnssd_browse_cb, &data);
-
-  local_ipps_ref = data.main_ref;
-  DNSServiceBrowse(&local_ipps_ref, kDNSServiceFlagsShareConnection,
-                   kDNSServiceInterfaceIndexLocalOnly,
-                   "_ipps._tcp", NULL,
-                   (DNSServiceBrowseReply)cups_dnssd_local_cb, &data);
-#    endif /* HAVE_SSL */
-
-#  else /* HAVE_AVAHI */
-  if ((data.simple_poll = avahi_simple_poll_new()) == NULL)
-  {
-    DEBUG_puts("cupsEnumDests: Unable to create Avahi simple poll object.");
-    return (1);
-  }
-
-  avahi_simple_poll_set_func(data.simple_poll, cups_dnssd_poll_cb, &data);
-
-  data.client = avahi_client_new(avahi_simple_poll_get(data.simple_poll),
-				 0, cups_dnssd_client_cb, &data,
-				 &error);
-  if (!data.client)
+  if (!cups_dnssd_atfork)
   {
-    DEBUG_puts("cupsEnumDests: Unable to create Avahi client.");
-    avahi_simple_poll_free(data.simple_poll);
-    return (1);
+    pthread_atfork(NULL, NULL, cups_dnssd_fork_child);
+    cups_dnssd_atfork = 1;
   }
 
-  ipp_ref  = avahi_service_browser_new(data.client, AVAHI_IF_UNSPEC,
-				       AVAHI_PROTO_UNSPEC, "_ipp._tcp", NULL,
-				       0, cups_dnssd_browse_cb, &data);
-#    ifdef HAVE_SSL
-  ipps_ref = avahi_service_browser_new(data.client, AVAHI_IF_UNSPEC,
-			               AVAHI_PROTO_UNSPEC, "_ipps._tcp", NULL,
-			               0, cups_dnssd_browse_cb, &data);
-#    endif /* HAVE_SSL */
-#  endif /* HAVE_DNSSD */
+  _cupsGlobalUnlock();
+#  endif /* HAVE_PTHREAD_H */
 
-  if (msec < 0)
-    remaining = INT_MAX;
-  else
-    remaining = msec;
+  _cupsMutexLock(&cups_dnssd_mutex);
 
-  while (remaining > 0 && (!cancel || !*cancel))
+  if (cups_dnssd_pid != getpid())
   {
    /*
-    * Check for input...
+    * Child processes don't inherit the browse thread...
     */
 
-#  ifdef HAVE_DNSSD
-#    ifdef HAVE_POLL
-    pfd.fd     = main_fd;
-    pfd.events = POLLIN;
-
-    nfds = poll(&pfd, 1, remaining > 250 ? 250 : remaining);
-
-#    else
-    FD_ZERO(&input);
-    FD_SET(main_fd, &input);
-
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = remaining > 250 ? 250000 : remaining * 1000;
-
-    nfds = select(main_fd + 1, &input, NULL, NULL, &timeout);
-#    endif /* HAVE_POLL */
-
-    if (nfds > 0)
-      DNSServiceProcessResult(data.main_ref);
-    else if (nfds == 0)
-      remaining -= 250;
-
-#  else /* HAVE_AVAHI */
-    data.got_data = 0;
+    cups_dnssd_pid     = getpid();
+    cups_dnssd_running = 0;
+    cups_dnssd_users   = 0;
+    cups_dnssd_cache   = NULL;
+  }
 
-    if ((error = avahi_simple_poll_iterate(data.simple_poll, 250)) > 0)
-    {
-     /*
-      * We've been told to exit the loop.  Perhaps the connection to
-      * Avahi failed.
-      */
+  if (!cups_dnssd_running && msec != 0)
+  {
+    if (_cupsThreadCreate((_cups_thread_func_t)cups_dnssd_browse_thread,
+                          NULL))
+      cups_dnssd_running = 1;
+    else
+      DEBUG_puts("1cupsEnumDests: Unable to start browse thread.");
+  }
 
-      break;
-    }
+  running = cups_dnssd_running;
 
-    if (!data.got_data)
-      remaining -= 250;
-#  endif /* HAVE_DNSSD */
+  cups_dnssd_users ++;
+  cups_dnssd_used = time(NULL);
 
-    for (device = (_cups_dnssd_device_t *)cupsArrayFirst(data.devices),
-             count = 0;
-         device;
-         device = (_cups_dnssd_device_t *)cupsArrayNext(data.devices))
-    {
-      if (device->ref)
-        count ++;
+  _cupsMutexUnlock(&cups_dnssd_mutex);
 
-      if (!device->ref && device->state == _CUPS_DNSSD_NEW)
-      {
-	DEBUG_printf(("1cupsEnumDests: Querying '%s'.", device->fullName));
+ /*
+  * Report the printers found so far, and then any changes until the
+  * timeout...
+  */
 
-#  ifdef HAVE_DNSSD
-        device->ref = data.main_ref;
+  seen = cupsArrayNew3((cups_array_func_t)cups_dnssd_compare_cache, NULL, NULL,
+                       0, NULL, (cups_afree_func_t)cups_dnssd_free_cache);
 
-	if (DNSServiceQueryRecord(&(device->ref),
-				  kDNSServiceFlagsShareConnection,
-				  0, device->fullName,
-				  kDNSServiceType_TXT,
-				  kDNSServiceClass_IN,
-				  (DNSServiceQueryRecordReply)cups_dnssd_query_cb,
-				  &data) == kDNSServiceErr_NoError)
-	{
-	  count ++;
-	}
-	else
-	{
-	  device->ref   = 0;
-	  device->state = _CUPS_DNSSD_ERROR;
+  if (msec < 0)
+    remaining = INT_MAX;
+  else
+    remaining = msec;
 
-	  DEBUG_puts("1cupsEnumDests: Query failed.");
-	}
+  while (cups_dnssd_report(seen, num_dests, dests, cancel, type, mask, cb,
+                           user_data) &&
+         running && remaining > 0)
+  {
+    wait = remaining > _CUPS_DNSSD_WAIT ? _CUPS_DNSSD_WAIT : remaining;
 
-#  else /* HAVE_AVAHI */
-	if ((device->ref = avahi_record_browser_new(data.client,
-	                                            AVAHI_IF_UNSPEC,
-						    AVAHI_PROTO_UNSPEC,
-						    device->fullName,
-						    AVAHI_DNS_CLASS_IN,
-						    AVAHI_DNS_TYPE_TXT,
-						    0,
-						    cups_dnssd_query_cb,
-						    &data)) != NULL)
-        {
-	  count ++;
-	}
-	else
-	{
-	  device->state = _CUPS_DNSSD_ERROR;
+#  ifdef WIN32
+    Sleep((DWORD)wait);
+#  else
+    usleep((useconds_t)wait * 1000);
+#  endif /* WIN32 */
 
-	  DEBUG_printf(("1cupsEnumDests: Query failed: %s",
-	                avahi_strerror(avahi_client_errno(data.client))));
-	}
-#  endif /* HAVE_DNSSD */
-      }
-      else if (device->ref && device->state == _CUPS_DNSSD_PENDING)
-      {
-        if ((device->type & mask) == type)
-        {
-	  if (!(*cb)(user_data, CUPS_DEST_FLAGS_NONE, &device->dest))
-	  {
-	    remaining = -1;
-	    break;
-	  }
-        }
+    if (remaining < INT_MAX)
+      remaining -= wait;
 
-        device->state = _CUPS_DNSSD_ACTIVE;
-      }
-    }
+    _cupsMutexLock(&cups_dnssd_mutex);
+    running = cups_dnssd_running;
+    _cupsMutexUnlock(&cups_dnssd_mutex);
   }
 
-  cupsArrayDelete(data.devices);
-
-#  ifdef HAVE_DNSSD
-  DNSServiceRefDeallocate(ipp_ref);
-  DNSServiceRefDeallocate(local_ipp_ref);
+  cupsArrayDelete(seen);
 
-#    ifdef HAVE_SSL
-  DNSServiceRefDeallocate(ipp_ref);
-  DNSServiceRefDeallocate(local_ipp_ref);
-#    endif /* HAVE_SSL */
+  _cupsMutexLock(&cups_dnssd_mutex);
 
-  DNSServiceRefDeallocate(data.main_ref);
+  cups_dnssd_users --;
+  cups_dnssd_used = time(NULL);
 
-#  else /* HAVE_AVAHI */
-  avahi_service_browser_free(ipp_ref);
-#    ifdef HAVE_SSL
-  avahi_service_browser_free(ipps_ref);
-#    endif /* HAVE_SSL */
+  _cupsMutexUnlock(&cups_dnssd_mutex);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
 
-  avahi_client_free(data.client);
-  avahi_simple_poll_free(data.simple_poll);
-#  endif /* HAVE_DNSSD */
-#endif /* HAVE_DNSSD || HAVE_DNSSD */
+  cupsFreeDests(num_dests, dests);
 
   return (1);
 }
@@ -1428,7 +1404,8 @@ _cupsGetDests(http_t       *http,	/* I  - Connection to server or
 	      cups_ptype_t type,	/* I  - Printer type bits */
 	      cups_ptype_t mask)	/* I  - Printer type mask */
 {
-  int		num_dests = 0;		/* Number of destinations */
+  int		i,			/* Looping var */
+		num_dests = 0;		/* Number of destinations */
   cups_dest_t	*dest;			/* Current destination */
   ipp_t		*request,		/* IPP Request */
 		*response;		/* IPP Response */
@@ -1443,6 +1420,11 @@ _cupsGetDests(http_t       *http,	/* I  - Connection to server or
   char		optname[1024],		/* Option name */
 		value[2048],		/* Option value */
 		*ptr;			/* Pointer into name/value */
+  char		server[256];		/* Server hostname */
+  _cups_dests_cache_t key,		/* Search key for printer list */
+		*cache;			/* Cached printer list */
+  int		cached = 0,		/* Do we have a cached list? */
+		change_count = 0;	/* printer-list-change-count value */
   static const char * const pattrs[] =	/* Attributes we're interested in */
 		{
 		  "auth-info-required",
@@ -1516,12 +1498,90 @@ _cupsGetDests(http_t       *http,	/* I  - Connection to server or
     ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_ENUM, "printer-type-mask", (int)mask);
   }
 
+  if (op == IPP_OP_CUPS_GET_PRINTERS && !name)
+  {
+   /*
+    * See if we already have the printer list from this server.  If so, send
+    * its printer-list-change-count value so that the server only sends the
+    * printers again when something has changed...
+    */
+
+    if (http == CUPS_HTTP_DEFAULT)
+    {
+      strlcpy(server, cupsServer(), sizeof(server));
+      key.port = ippPort();
+    }
+    else
+    {
+      httpGetHostname(http, server, sizeof(server));
+      key.port = http->hostaddr ? httpAddrPort(http->hostaddr) : 0;
+    }
+
+    key.server = server;
+    key.user   = (char *)cupsUser();
+    key.type   = type;
+    key.mask   = mask;
+
+    _cupsMutexLock(&cups_dests_mutex);
+
+    if ((cache = (_cups_dests_cache_t *)cupsArrayFind(cups_dests_cache,
+                                                      &key)) != NULL)
+    {
+      cached       = 1;
+      change_count = cache->change_count;
+    }
+
+    _cupsMutexUnlock(&cups_dests_mutex);
+
+    if (cached)
+      ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                    "printer-list-change-count", change_count);
+  }
+
  /*
   * Do the request and get back a response...
   */
 
   if ((response = cupsDoRequest(http, request, "/")) != NULL)
   {
+    if (op == IPP_OP_CUPS_GET_PRINTERS && !name &&
+        response->request.status.status_code == IPP_STATUS_OK &&
+        (attr = ippFindAttribute(response, "printer-list-change-count",
+                                 IPP_TAG_INTEGER)) != NULL &&
+	attr->group_tag == IPP_TAG_OPERATION)
+    {
+      if (cached && attr->values[0].integer == change_count &&
+          !ippFindAttribute(response, "printer-name", IPP_TAG_NAME))
+      {
+       /*
+        * Nothing has changed, use the cached list...
+	*/
+
+        DEBUG_printf(("1_cupsGetDests: Using cached printer list for %s:%d.",
+	              server, key.port));
+
+	_cupsMutexLock(&cups_dests_mutex);
+
+	if ((cache = (_cups_dests_cache_t *)cupsArrayFind(cups_dests_cache,
+	                                                  &key)) != NULL)
+	{
+	  for (i = cache->num_dests, dest = cache->dests;
+	       i > 0;
+	       i --, dest ++)
+	    num_dests = cupsCopyDest(dest, num_dests, dests);
+	}
+
+	_cupsMutexUnlock(&cups_dests_mutex);
+
+        ippDelete(response);
+
+	return (num_dests);
+      }
+
+      cached       = -1;		/* Save the new list below */
+      change_count = attr->values[0].integer;
+    }
+
     for (attr = response->attrs; attr != NULL; attr = attr->next)
     {
      /*
@@ -1595,8 +1655,6 @@ _cupsGetDests(http_t       *http,	/* I  - Connection to server or
 	  * See if we can set a default media size...
 	  */
 
-          int	i;			/* Looping var */
-
 	  for (i = 0; i < attr->num_values; i ++)
 	    if (!_cups_strcasecmp(media_default, attr->values[i].string.text))
 	    {
@@ -1661,6 +1719,9 @@ _cupsGetDests(http_t       *http,	/* I  - Connection to server or
     }
 
     ippDelete(response);
+
+    if (cached < 0)
+      cups_cache_dests(&key, change_count, num_dests, *dests);
   }
 
  /*
@@ -2640,22 +2701,110 @@ cups_block_cb(
 
 
 /*
- * 'cups_compare_dests()' - Compare two destinations.
+ * 'cups_cache_dests()' - Save a copy of the printer list from a server.
  */
 
-static int				/* O - Result of comparison */
-cups_compare_dests(cups_dest_t *a,	/* I - First destination */
-                   cups_dest_t *b)	/* I - Second destination */
+static void
+cups_cache_dests(
+    _cups_dests_cache_t *key,		/* I - Server, user, and type */
+    int                 change_count,	/* I - printer-list-change-count */
+    int                 num_dests,	/* I - Number of destinations */
+    cups_dest_t         *dests)		/* I - Destinations */
 {
-  int	diff;				/* Difference */
+  int			i;		/* Looping var */
+  cups_dest_t		*dest;		/* Current destination */
+  _cups_dests_cache_t	*cache;		/* Cached printer list */
 
 
-  if ((diff = _cups_strcasecmp(a->name, b->name)) != 0)
-    return (diff);
-  else if (a->instance && b->instance)
-    return (_cups_strcasecmp(a->instance, b->instance));
+  DEBUG_printf(("4cups_cache_dests(key=%p(%s:%d), change_count=%d, "
+                "num_dests=%d, dests=%p)", key, key->server, key->port,
+		change_count, num_dests, dests));
+
+  _cupsMutexLock(&cups_dests_mutex);
+
+  if (!cups_dests_cache)
+    cups_dests_cache = cupsArrayNew3((cups_array_func_t)cups_compare_cache,
+                                     NULL, NULL, 0, NULL,
+                                     (cups_afree_func_t)cups_free_cache);
+
+  if ((cache = (_cups_dests_cache_t *)cupsArrayFind(cups_dests_cache,
+                                                    key)) == NULL)
+  {
+    if ((cache = calloc(1, sizeof(_cups_dests_cache_t))) == NULL)
+    {
+      _cupsMutexUnlock(&cups_dests_mutex);
+      return;
+    }
+
+    cache->server = _cupsStrAlloc(key->server);
+    cache->user   = _cupsStrAlloc(key->user);
+    cache->port   = key->port;
+    cache->type   = key->type;
+    cache->mask   = key->mask;
+
+    cupsArrayAdd(cups_dests_cache, cache);
+  }
   else
-    return ((a->instance && !b->instance) - (!a->instance && b->instance));
+  {
+    cupsFreeDests(cache->num_dests, cache->dests);
+
+    cache->num_dests = 0;
+    cache->dests     = NULL;
+  }
+
+  cache->change_count = change_count;
+
+  for (i = num_dests, dest = dests; i > 0; i --, dest ++)
+    cache->num_dests = cupsCopyDest(dest, cache->num_dests, &cache->dests);
+
+  _cupsMutexUnlock(&cups_dests_mutex);
+}
+
+
+/*
+ * 'cups_compare_cache()' - Compare two cached printer lists.
+ */
+
+static int				/* O - Result of comparison */
+cups_compare_cache(
+    _cups_dests_cache_t *a,		/* I - First printer list */
+    _cups_dests_cache_t *b)		/* I - Second printer list */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->server, b->server)) != 0)
+    return (result);
+  else if ((result = a->port - b->port) != 0)
+    return (result);
+  else if ((result = strcmp(a->user, b->user)) != 0)
+    return (result);
+  else if (a->type != b->type)
+    return (a->type < b->type ? -1 : 1);
+  else if (a->mask != b->mask)
+    return (a->mask < b->mask ? -1 : 1);
+  else
+    return (0);
+}
+
+
+/*
+ * 'cups_compare_dests()' - Compare two destinations.
+ */
+
+static int				/* O - Result of comparison */
+cups_compare_dests(cups_dest_t *a,	/* I - First destination */
+                   cups_dest_t *b)	/* I - Second destination */
+{
+  int	diff;				/* Difference */
+
+
+  if ((diff = _cups_strcasecmp(a->name, b->name)) != 0)
+    return (diff);
+  else if (a->instance && b->instance)
+    return (_cups_strcasecmp(a->instance, b->instance));
+  else
+    return ((a->instance && !b->instance) - (!a->instance && b->instance));
 }
 
 
@@ -2799,6 +2948,448 @@ cups_dnssd_client_cb(
 #  endif /* HAVE_DNSSD */
 
 
+/*
+ * 'cups_dnssd_browse_poll()' - Process browse and query results.
+ */
+
+static int				/* O - 1 to continue, 0 on error */
+cups_dnssd_browse_poll(
+    _cups_dnssd_data_t *data,		/* I - Enumeration data */
+    int                msec)		/* I - Time to poll in milliseconds */
+{
+  int			remaining;	/* Remainder of timeout */
+  _cups_dnssd_device_t	*device;	/* Current device */
+#  ifdef HAVE_DNSSD
+  int			nfds,		/* Number of files responded */
+			main_fd;	/* File descriptor for lookups */
+#    ifdef HAVE_POLL
+  struct pollfd		pfd;		/* Polling data */
+#    else
+  fd_set		input;		/* Input set for select() */
+  struct timeval	timeout;	/* Timeout for select() */
+#    endif /* HAVE_POLL */
+#  endif /* HAVE_DNSSD */
+
+
+#  ifdef HAVE_DNSSD
+  main_fd = DNSServiceRefSockFD(data->main_ref);
+#  endif /* HAVE_DNSSD */
+
+  for (remaining = msec; remaining > 0;)
+  {
+   /*
+    * Check for input...
+    */
+
+#  ifdef HAVE_DNSSD
+#    ifdef HAVE_POLL
+    pfd.fd     = main_fd;
+    pfd.events = POLLIN;
+
+    nfds = poll(&pfd, 1, remaining > 250 ? 250 : remaining);
+
+#    else
+    FD_ZERO(&input);
+    FD_SET(main_fd, &input);
+
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = remaining > 250 ? 250000 : remaining * 1000;
+
+    nfds = select(main_fd + 1, &input, NULL, NULL, &timeout);
+#    endif /* HAVE_POLL */
+
+    if (nfds > 0)
+    {
+      if (DNSServiceProcessResult(data->main_ref) != kDNSServiceErr_NoError)
+      {
+        DEBUG_puts("5cups_dnssd_browse_poll: Lost connection to mDNSResponder.");
+        return (0);
+      }
+    }
+    else if (nfds == 0)
+      remaining -= 250;
+    else if (errno != EINTR && errno != EAGAIN)
+      return (0);
+
+#  else /* HAVE_AVAHI */
+    data->got_data = 0;
+
+    if (avahi_simple_poll_iterate(data->simple_poll, 250) > 0)
+    {
+     /*
+      * We've been told to exit the loop.  Perhaps the connection to
+      * Avahi failed.
+      */
+
+      return (0);
+    }
+
+    if (!data->got_data)
+      remaining -= 250;
+#  endif /* HAVE_DNSSD */
+
+    for (device = (_cups_dnssd_device_t *)cupsArrayFirst(data->devices);
+         device;
+         device = (_cups_dnssd_device_t *)cupsArrayNext(data->devices))
+    {
+      if (!device->ref && device->state == _CUPS_DNSSD_NEW)
+      {
+	DEBUG_printf(("6cups_dnssd_browse_poll: Querying '%s'.",
+	              device->fullName));
+
+#  ifdef HAVE_DNSSD
+        device->ref = data->main_ref;
+
+	if (DNSServiceQueryRecord(&(device->ref),
+				  kDNSServiceFlagsShareConnection,
+				  0, device->fullName,
+				  kDNSServiceType_TXT,
+				  kDNSServiceClass_IN,
+				  (DNSServiceQueryRecordReply)cups_dnssd_query_cb,
+				  data) != kDNSServiceErr_NoError)
+	{
+	  device->ref   = 0;
+	  device->state = _CUPS_DNSSD_ERROR;
+
+	  DEBUG_puts("6cups_dnssd_browse_poll: Query failed.");
+	}
+
+#  else /* HAVE_AVAHI */
+	if ((device->ref = avahi_record_browser_new(data->client,
+	                                            AVAHI_IF_UNSPEC,
+						    AVAHI_PROTO_UNSPEC,
+						    device->fullName,
+						    AVAHI_DNS_CLASS_IN,
+						    AVAHI_DNS_TYPE_TXT,
+						    0,
+						    cups_dnssd_query_cb,
+						    data)) == NULL)
+	{
+	  device->state = _CUPS_DNSSD_ERROR;
+
+	  DEBUG_printf(("6cups_dnssd_browse_poll: Query failed: %s",
+	                avahi_strerror(avahi_client_errno(data->client))));
+	}
+#  endif /* HAVE_DNSSD */
+      }
+      else if (device->ref && device->state == _CUPS_DNSSD_PENDING)
+      {
+        if ((device->type & data->mask) == data->type &&
+	    !(*data->cb)(data->user_data, CUPS_DEST_FLAGS_NONE, &device->dest))
+	  return (0);
+
+        device->state = _CUPS_DNSSD_ACTIVE;
+      }
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'cups_dnssd_browse_start()' - Start browsing for printers.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_dnssd_browse_start(
+    _cups_dnssd_data_t *data)		/* I - Enumeration data */
+{
+#  ifdef HAVE_AVAHI
+  int	error;				/* Error value */
+#  endif /* HAVE_AVAHI */
+
+
+#  ifdef HAVE_DNSSD
+  if (DNSServiceCreateConnection(&data->main_ref) != kDNSServiceErr_NoError)
+  {
+    DEBUG_puts("5cups_dnssd_browse_start: Unable to create service "
+               "connection.");
+    data->main_ref = 0;
+    return (0);
+  }
+
+  data->ipp_ref = data->main_ref;
+  if (DNSServiceBrowse(&data->ipp_ref, kDNSServiceFlagsShareConnection, 0,
+                       "_ipp._tcp", NULL,
+                       (DNSServiceBrowseReply)cups_dnssd_browse_cb,
+                       data) != kDNSServiceErr_NoError)
+    data->ipp_ref = 0;
+
+  data->local_ipp_ref = data->main_ref;
+  if (DNSServiceBrowse(&data->local_ipp_ref, kDNSServiceFlagsShareConnection,
+                       kDNSServiceInterfaceIndexLocalOnly,
+                       "_ipp._tcp", NULL,
+                       (DNSServiceBrowseReply)cups_dnssd_local_cb,
+                       data) != kDNSServiceErr_NoError)
+    data->local_ipp_ref = 0;
+
+#    ifdef HAVE_SSL
+  data->ipps_ref = data->main_ref;
+  if (DNSServiceBrowse(&data->ipps_ref, kDNSServiceFlagsShareConnection, 0,
+                       "_ipps._tcp", NULL,
+                       (DNSServiceBrowseReply)cups_dnssd_browse_cb,
+                       data) != kDNSServiceErr_NoError)
+    data->ipps_ref = 0;
+
+  data->local_ipps_ref = data->main_ref;
+  if (DNSServiceBrowse(&data->local_ipps_ref, kDNSServiceFlagsShareConnection,
+                       kDNSServiceInterfaceIndexLocalOnly,
+                       "_ipps._tcp", NULL,
+                       (DNSServiceBrowseReply)cups_dnssd_local_cb,
+                       data) != kDNSServiceErr_NoError)
+    data->local_ipps_ref = 0;
+#    endif /* HAVE_SSL */
+
+#  else /* HAVE_AVAHI */
+  if ((data->simple_poll = avahi_simple_poll_new()) == NULL)
+  {
+    DEBUG_puts("5cups_dnssd_browse_start: Unable to create Avahi simple poll "
+               "object.");
+    return (0);
+  }
+
+  avahi_simple_poll_set_func(data->simple_poll, cups_dnssd_poll_cb, data);
+
+  data->client = avahi_client_new(avahi_simple_poll_get(data->simple_poll),
+				  0, cups_dnssd_client_cb, data,
+				  &error);
+  if (!data->client)
+  {
+    DEBUG_puts("5cups_dnssd_browse_start: Unable to create Avahi client.");
+    return (0);
+  }
+
+  data->ipp_ref  = avahi_service_browser_new(data->client, AVAHI_IF_UNSPEC,
+				             AVAHI_PROTO_UNSPEC, "_ipp._tcp",
+				             NULL, 0, cups_dnssd_browse_cb,
+				             data);
+#    ifdef HAVE_SSL
+  data->ipps_ref = avahi_service_browser_new(data->client, AVAHI_IF_UNSPEC,
+			                     AVAHI_PROTO_UNSPEC, "_ipps._tcp",
+			                     NULL, 0, cups_dnssd_browse_cb,
+			                     data);
+#    endif /* HAVE_SSL */
+#  endif /* HAVE_DNSSD */
+
+  return (1);
+}
+
+
+/*
+ * 'cups_dnssd_browse_stop()' - Stop browsing for printers.
+ */
+
+static void
+cups_dnssd_browse_stop(
+    _cups_dnssd_data_t *data)		/* I - Enumeration data */
+{
+  cupsArrayDelete(data->devices);
+  data->devices = NULL;
+
+#  ifdef HAVE_DNSSD
+  if (data->ipp_ref)
+    DNSServiceRefDeallocate(data->ipp_ref);
+  if (data->local_ipp_ref)
+    DNSServiceRefDeallocate(data->local_ipp_ref);
+
+#    ifdef HAVE_SSL
+  if (data->ipps_ref)
+    DNSServiceRefDeallocate(data->ipps_ref);
+  if (data->local_ipps_ref)
+    DNSServiceRefDeallocate(data->local_ipps_ref);
+#    endif /* HAVE_SSL */
+
+  if (data->main_ref)
+    DNSServiceRefDeallocate(data->main_ref);
+
+#  else /* HAVE_AVAHI */
+  if (data->ipp_ref)
+    avahi_service_browser_free(data->ipp_ref);
+#    ifdef HAVE_SSL
+  if (data->ipps_ref)
+    avahi_service_browser_free(data->ipps_ref);
+#    endif /* HAVE_SSL */
+
+  if (data->client)
+    avahi_client_free(data->client);
+  if (data->simple_poll)
+    avahi_simple_poll_free(data->simple_poll);
+#  endif /* HAVE_DNSSD */
+}
+
+
+/*
+ * 'cups_dnssd_browse_thread()' - Browse for printers in the background.
+ *
+ * The printers that are found are kept in a cache that is shared by all
+ * enumerations in the process.  The thread exits when it has not been used
+ * for _CUPS_DNSSD_IDLE seconds.
+ */
+
+static void *				/* O - Exit status (unused) */
+cups_dnssd_browse_thread(void *arg)	/* I - Argument (unused) */
+{
+  _cups_dnssd_data_t	data;		/* Enumeration data */
+  int			status;		/* Browse status */
+
+
+  (void)arg;
+
+  memset(&data, 0, sizeof(data));
+
+  data.cb      = cups_dnssd_cache_cb;
+  data.devices = cupsArrayNew3((cups_array_func_t)cups_dnssd_compare_devices,
+                               NULL, NULL, 0, NULL,
+                               (cups_afree_func_t)cups_dnssd_free_device);
+
+  status = cups_dnssd_browse_start(&data);
+
+  for (;;)
+  {
+    if (status)
+      status = cups_dnssd_browse_poll(&data, 1000);
+
+    _cupsMutexLock(&cups_dnssd_mutex);
+
+    if (!status ||
+        (!cups_dnssd_users &&
+         (time(NULL) - cups_dnssd_used) > _CUPS_DNSSD_IDLE))
+    {
+     /*
+      * Stop browsing and forget the printers we found since we won't see
+      * any changes to them...
+      */
+
+      DEBUG_puts("5cups_dnssd_browse_thread: Stopping.");
+
+      cupsArrayDelete(cups_dnssd_cache);
+      cups_dnssd_cache   = NULL;
+      cups_dnssd_running = 0;
+
+      _cupsMutexUnlock(&cups_dnssd_mutex);
+      break;
+    }
+
+    _cupsMutexUnlock(&cups_dnssd_mutex);
+  }
+
+  cups_dnssd_browse_stop(&data);
+
+  return (NULL);
+}
+
+
+/*
+ * 'cups_dnssd_cache_cb()' - Update the cache of network printers.
+ */
+
+static int				/* O - 1 to continue */
+cups_dnssd_cache_cb(
+    void        *user_data,		/* I - User data (unused) */
+    unsigned    flags,			/* I - Destination flags */
+    cups_dest_t *dest)			/* I - Destination */
+{
+  int			i,		/* Looping var */
+			changed;	/* Has the destination changed? */
+  cups_option_t		*option;	/* Current option */
+  const char		*value;		/* Option value */
+  _cups_dnssd_cache_t	key,		/* Search key */
+			*entry;		/* Cached destination */
+
+
+  (void)user_data;
+
+  _cupsMutexLock(&cups_dnssd_mutex);
+
+  if (!cups_dnssd_cache)
+    cups_dnssd_cache = cupsArrayNew3((cups_array_func_t)cups_dnssd_compare_cache,
+                                     NULL, NULL, 0, NULL,
+                                     (cups_afree_func_t)cups_dnssd_free_cache);
+
+  key.dest.name = dest->name;
+  entry         = (_cups_dnssd_cache_t *)cupsArrayFind(cups_dnssd_cache, &key);
+
+  if (flags & CUPS_DEST_FLAGS_REMOVED)
+  {
+    if (entry && !entry->removed)
+    {
+      entry->removed    = 1;
+      entry->generation = ++ cups_dnssd_generation;
+    }
+  }
+  else
+  {
+    if (!entry && (entry = calloc(1, sizeof(_cups_dnssd_cache_t))) != NULL)
+    {
+      entry->dest.name = _cupsStrAlloc(dest->name);
+      entry->removed   = 1;
+
+      cupsArrayAdd(cups_dnssd_cache, entry);
+    }
+
+   /*
+    * Only count it as a change when the TXT record really changed, so that
+    * repeated answers are not reported again...
+    */
+
+    if (entry)
+    {
+      changed = entry->removed || entry->dest.num_options != dest->num_options;
+
+      for (i = dest->num_options, option = dest->options;
+           i > 0 && !changed;
+	   i --, option ++)
+	if ((value = cupsGetOption(option->name, entry->dest.num_options,
+	                           entry->dest.options)) == NULL ||
+	    strcmp(value, option->value))
+	  changed = 1;
+
+      if (changed)
+      {
+	cupsFreeOptions(entry->dest.num_options, entry->dest.options);
+
+	entry->dest.num_options = 0;
+	entry->dest.options     = NULL;
+
+	for (i = dest->num_options, option = dest->options;
+	     i > 0;
+	     i --, option ++)
+	  entry->dest.num_options = cupsAddOption(option->name, option->value,
+	                                          entry->dest.num_options,
+						  &entry->dest.options);
+
+	if ((value = cupsGetOption("printer-type", entry->dest.num_options,
+	                           entry->dest.options)) != NULL)
+	  entry->type = (cups_ptype_t)strtol(value, NULL, 0);
+	else
+	  entry->type = 0;
+
+	entry->removed    = 0;
+	entry->generation = ++ cups_dnssd_generation;
+      }
+    }
+  }
+
+  _cupsMutexUnlock(&cups_dnssd_mutex);
+
+  return (1);
+}
+
+
+/*
+ * 'cups_dnssd_compare_cache()' - Compare two cached destinations.
+ */
+
+static int				/* O - Result of comparison */
+cups_dnssd_compare_cache(
+    _cups_dnssd_cache_t *a,		/* I - First destination */
+    _cups_dnssd_cache_t *b)		/* I - Second destination */
+{
+  return (strcmp(a->dest.name, b->dest.name));
+}
+
+
 /*
  * 'cups_dnssd_compare_device()' - Compare two devices.
  */
@@ -2812,6 +3403,43 @@ cups_dnssd_compare_devices(
 }
 
 
+#  ifdef HAVE_PTHREAD_H
+/*
+ * 'cups_dnssd_fork_child()' - Reset the browsing state in a child process.
+ *
+ * The mutex may have been held by another thread at the time of the fork,
+ * and that thread does not exist in the child.
+ */
+
+static void
+cups_dnssd_fork_child(void)
+{
+  _cupsMutexInit(&cups_dnssd_mutex);
+
+  cups_dnssd_pid     = getpid();
+  cups_dnssd_running = 0;
+  cups_dnssd_users   = 0;
+  cups_dnssd_cache   = NULL;
+}
+#  endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * 'cups_dnssd_free_cache()' - Free the memory used by a cached destination.
+ */
+
+static void
+cups_dnssd_free_cache(
+    _cups_dnssd_cache_t *entry)		/* I - Cached destination */
+{
+  _cupsStrFree(entry->dest.name);
+
+  cupsFreeOptions(entry->dest.num_options, entry->dest.options);
+
+  free(entry);
+}
+
+
 /*
  * 'cups_dnssd_free_device()' - Free the memory used by a device.
  */
@@ -3397,6 +4025,103 @@ cups_dnssd_query_cb(
 }
 
 
+/*
+ * 'cups_dnssd_report()' - Report new, changed, and removed network printers.
+ */
+
+static int				/* O - 1 to continue, 0 to stop */
+cups_dnssd_report(
+    cups_array_t   *seen,		/* I - Printers reported so far */
+    int            num_dests,		/* I - Number of local destinations */
+    cups_dest_t    *dests,		/* I - Local destinations */
+    int            *cancel,		/* I - Pointer to "cancel" variable */
+    cups_ptype_t   type,		/* I - Printer type bits */
+    cups_ptype_t   mask,		/* I - Mask for printer type bits */
+    cups_dest_cb_t cb,			/* I - Callback function */
+    void           *user_data)		/* I - User data */
+{
+  int			i,		/* Looping var */
+			num_added = 0,	/* Number of new printers */
+			num_removed = 0,/* Number of removed printers */
+			status = 1;	/* Return value */
+  cups_dest_t		*added = NULL,	/* New and changed printers */
+			*removed = NULL,/* Removed printers */
+			*dest;		/* Current printer */
+  _cups_dnssd_cache_t	*entry,		/* Cached printer */
+			*reported;	/* Reported printer */
+
+
+  if (cancel && *cancel)
+    return (0);
+
+ /*
+  * Copy the changes since the last report so that the callback function is
+  * not run with the cache locked...
+  */
+
+  _cupsMutexLock(&cups_dnssd_mutex);
+
+  for (entry = (_cups_dnssd_cache_t *)cupsArrayFirst(cups_dnssd_cache);
+       entry;
+       entry = (_cups_dnssd_cache_t *)cupsArrayNext(cups_dnssd_cache))
+  {
+   /*
+    * Skip printers that don't match or have the same name as a local
+    * destination...
+    */
+
+    if ((entry->type & mask) != type ||
+        cupsGetDest(entry->dest.name, NULL, num_dests, dests))
+      continue;
+
+    if ((reported = (_cups_dnssd_cache_t *)cupsArrayFind(seen, entry)) != NULL &&
+        reported->generation == entry->generation)
+      continue;
+
+    if (!entry->removed)
+      num_added = cupsCopyDest(&entry->dest, num_added, &added);
+    else if (reported && !reported->removed)
+      num_removed = cupsCopyDest(&entry->dest, num_removed, &removed);
+
+    if (!reported &&
+        (reported = calloc(1, sizeof(_cups_dnssd_cache_t))) != NULL)
+    {
+      reported->dest.name = _cupsStrAlloc(entry->dest.name);
+
+      cupsArrayAdd(seen, reported);
+    }
+
+    if (reported)
+    {
+      reported->generation = entry->generation;
+      reported->removed    = entry->removed;
+    }
+  }
+
+  _cupsMutexUnlock(&cups_dnssd_mutex);
+
+ /*
+  * Then pass them to the callback function...
+  */
+
+  for (i = num_removed, dest = removed; i > 0 && status; i --, dest ++)
+    if ((cancel && *cancel) ||
+        !(*cb)(user_data, CUPS_DEST_FLAGS_REMOVED, dest))
+      status = 0;
+
+  for (i = num_added, dest = added; i > 0 && status; i --, dest ++)
+    if ((cancel && *cancel) ||
+        !(*cb)(user_data, i > 1 ? CUPS_DEST_FLAGS_MORE : CUPS_DEST_FLAGS_NONE,
+               dest))
+      status = 0;
+
+  cupsFreeDests(num_removed, removed);
+  cupsFreeDests(num_added, added);
+
+  return (status);
+}
+
+
 /*
  * 'cups_dnssd_resolve()' - Resolve a Bonjour printer URI.
  */
@@ -3632,6 +4357,23 @@ cups_find_dest(const char  *name,	/* I - Destination name */
 }
 
 
+/*
+ * 'cups_free_cache()' - Free the memory used by a cached printer list.
+ */
+
+static void
+cups_free_cache(
+    _cups_dests_cache_t *cache)		/* I - Printer list */
+{
+  _cupsStrFree(cache->server);
+  _cupsStrFree(cache->user);
+
+  cupsFreeDests(cache->num_dests, cache->dests);
+
+  free(cache);
+}
+
+
 /*
  * 'cups_get_default()' - Get the default destination from an lpoptions file.
  */
@@ -90,6 +90,9 @@ typedef enum				/**** _cupsFileCheck file type values ****/
 typedef void (*_cups_fc_func_t)(void *context, _cups_fc_result_t result,
 				const char *message);
 
+typedef ssize_t (*_cups_file_iocb_t)(void *ctx, char *buffer, size_t bytes);
+					/**** _cupsFileOpenIO callback ****/
+
 struct _cups_file_s			/**** CUPS file structure... ****/
 
 {
@@ -112,6 +115,9 @@ struct _cups_file_s			/**** CUPS file structure... ****/
 
   char		*printf_buffer;		/* cupsFilePrintf buffer */
   size_t	printf_size;		/* Size of cupsFilePrintf buffer */
+
+  _cups_file_iocb_t iocb;		/* I/O callback or NULL for fd */
+  void		*ctx;			/* Context for I/O callback */
 };
 
 
@@ -127,6 +133,8 @@ extern _cups_fc_result_t	_cupsFileCheck(const char *filename,
 extern void			_cupsFileCheckFilter(void *context,
 						     _cups_fc_result_t result,
 						     const char *message);
+extern cups_file_t		*_cupsFileOpenIO(_cups_file_iocb_t iocb,
+						 void *ctx, const char *mode);
 
 #  ifdef __cplusplus
 }
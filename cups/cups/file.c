@@ -25,6 +25,7 @@
  */
 
 #include "file-private.h"
+#include "ring-private.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -310,6 +311,47 @@ _cupsFileCheckFilter(
 #endif /* !WIN32 */
 
 
+/*
+ * '_cupsFileOpenIO()' - Open a CUPS file using a callback function.
+ *
+ * The callback is called to read or write data in place of a file
+ * descriptor, and once with a @code NULL@ buffer and a length of 0 when the
+ * file is closed.  The mode is "r" for reading (with transparent gzip
+ * decompression) or "w" for writing.
+ */
+
+cups_file_t *				/* O - CUPS file or @code NULL@ on error */
+_cupsFileOpenIO(_cups_file_iocb_t iocb,	/* I - Read/write callback */
+                void              *ctx,	/* I - Context pointer for callback */
+		const char        *mode)/* I - Open mode */
+{
+  cups_file_t	*fp;			/* New CUPS file */
+
+
+  DEBUG_printf(("_cupsFileOpenIO(iocb=%p, ctx=%p, mode=\"%s\")", iocb, ctx,
+                mode));
+
+  if (!iocb || !mode || (*mode != 'r' && *mode != 'w'))
+    return (NULL);
+
+  if ((fp = calloc(1, sizeof(cups_file_t))) == NULL)
+    return (NULL);
+
+  fp->fd   = -1;
+  fp->iocb = iocb;
+  fp->ctx  = ctx;
+  fp->mode = *mode;
+
+  if (fp->mode == 'w')
+  {
+    fp->ptr = fp->buf;
+    fp->end = fp->buf + sizeof(fp->buf);
+  }
+
+  return (fp);
+}
+
+
 /*
  * 'cupsFileClose()' - Close a CUPS file.
  *
@@ -418,6 +460,13 @@ cupsFileClose(cups_file_t *fp)		/* I - CUPS file */
   mode     = fp->mode;
   is_stdio = fp->is_stdio;
 
+ /*
+  * Callback streams are told about the close with a zero-length request...
+  */
+
+  if (fp->iocb && (*fp->iocb)(fp->ctx, NULL, 0) < 0)
+    status = -1;
+
   if (fp->printf_buffer)
     free(fp->printf_buffer);
 
@@ -432,7 +481,7 @@ cupsFileClose(cups_file_t *fp)		/* I - CUPS file */
     if (httpAddrClose(NULL, fd) < 0)
       status = -1;
   }
-  else if (!is_stdio)
+  else if (!is_stdio && fd >= 0)
   {
     if (close(fd) < 0)
       status = -1;
@@ -1918,6 +1967,7 @@ cups_file_t *				/* O - CUPS file */
 cupsFileStdin(void)
 {
   _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals... */
+  _cups_ring_t	*ring;			/* Ring on stdin */
 
 
  /*
@@ -1927,10 +1977,20 @@ cupsFileStdin(void)
   if (!cg->stdio_files[0])
   {
    /*
-    * Open file descriptor 0...
+    * Open file descriptor 0, reading directly from the shared memory if the
+    * scheduler connected us to the previous filter with a ring...
     */
 
-    if ((cg->stdio_files[0] = cupsFileOpenFd(0, "r")) != NULL)
+    if ((ring = _cupsRingOpen(0, 'r')) != NULL)
+    {
+      if ((cg->stdio_files[0] = _cupsFileOpenIO(_cupsRingRead, ring,
+                                                "r")) == NULL)
+        _cupsRingRead(ring, NULL, 0);
+    }
+    else
+      cg->stdio_files[0] = cupsFileOpenFd(0, "r");
+
+    if (cg->stdio_files[0])
       cg->stdio_files[0]->is_stdio = 1;
   }
 
@@ -1948,6 +2008,7 @@ cups_file_t *				/* O - CUPS file */
 cupsFileStdout(void)
 {
   _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals... */
+  _cups_ring_t	*ring;			/* Ring on stdout */
 
 
  /*
@@ -1963,10 +2024,19 @@ cupsFileStdout(void)
     fflush(stdout);
 
    /*
-    * Open file descriptor 1...
+    * Open file descriptor 1, writing to a ring if there is one...
     */
 
-    if ((cg->stdio_files[1] = cupsFileOpenFd(1, "w")) != NULL)
+    if ((ring = _cupsRingOpen(1, 'w')) != NULL)
+    {
+      if ((cg->stdio_files[1] = _cupsFileOpenIO(_cupsRingWrite, ring,
+                                                "w")) == NULL)
+        _cupsRingWrite(ring, NULL, 0);
+    }
+    else
+      cg->stdio_files[1] = cupsFileOpenFd(1, "w");
+
+    if (cg->stdio_files[1])
       cg->stdio_files[1]->is_stdio = 1;
   }
 
@@ -2380,7 +2450,8 @@ cups_fill(cups_file_t *fp)		/* I - CUPS file */
 	uLong		tcrc;		/* Trailer CRC */
 
 
-	if (read(fp->fd, trailer, sizeof(trailer)) < (ssize_t)sizeof(trailer))
+	if (cups_read(fp, (char *)trailer, sizeof(trailer)) <
+	        (ssize_t)sizeof(trailer))
 	{
 	 /*
           * Can't get it, so mark end-of-file...
@@ -2569,6 +2640,9 @@ cups_read(cups_file_t *fp,		/* I - CUPS file */
 
   for (;;)
   {
+    if (fp->iocb)
+      total = (*fp->iocb)(fp->ctx, buf, bytes);
+    else
 #ifdef WIN32
     if (fp->mode == 's')
       total = (ssize_t)recv(fp->fd, buf, (unsigned)bytes, 0);
@@ -2627,6 +2701,9 @@ cups_write(cups_file_t *fp,		/* I - CUPS file */
   total = 0;
   while (bytes > 0)
   {
+    if (fp->iocb)
+      count = (*fp->iocb)(fp->ctx, (char *)buf, bytes);
+    else
 #ifdef WIN32
     if (fp->mode == 's')
       count = (ssize_t)send(fp->fd, buf, (unsigned)bytes, 0);
@@ -359,9 +359,14 @@ cups_globals_free(_cups_globals_t *cg)	/* I - Pointer to global data */
   cupsArrayDelete(cg->ppd_size_lut);
   cupsArrayDelete(cg->pwg_size_lut);
 
-  httpClose(cg->http);
+  if (cg->http)
+  {
+    cg->http->pool = 0;			/* Thread is exiting, don't pool */
+    httpClose(cg->http);
+  }
 
 #ifdef HAVE_SSL
+  _httpPoolClose(cg->tls_credentials);
   _httpFreeCredentials(cg->tls_credentials);
 #endif /* HAVE_SSL */
 
@@ -0,0 +1,521 @@
+/*
+ * "$Id$"
+ *
+ * HTTP connection pool for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#ifndef MSG_DONTWAIT
+#  define MSG_DONTWAIT 0
+#endif /* !MSG_DONTWAIT */
+
+
+/*
+ * Local constants...
+ */
+
+#define _HTTP_POOL_IDLE		20	/* Seconds before idle connections are closed */
+#define _HTTP_POOL_MAX		32	/* Maximum number of idle connections */
+#define _HTTP_POOL_MAX_HOST	4	/* Maximum idle connections per server */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _http_pool_s		/**** Idle pooled connection ****/
+{
+  char			hostname[256];	/* Hostname */
+  int			port;		/* Port number */
+  http_encryption_t	encryption;	/* Encryption setting */
+  char			user[65];	/* User that owns the connection */
+  http_tls_credentials_t credentials;	/* Client credentials or NULL */
+  time_t		idle;		/* Time connection became idle */
+  http_t		*http;		/* Connection */
+} _http_pool_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	pool_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for connection pool */
+static cups_array_t	*pool = NULL;	/* Idle connections, oldest first */
+#ifdef HAVE_PTHREAD_H
+static int		pool_atfork = 0,/* Fork handler registered? */
+			pool_running = 0;
+					/* Expire thread running? */
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * Local functions...
+ */
+
+static void	http_pool_close(_http_pool_t *p);
+static time_t	http_pool_expire(void);
+#ifdef HAVE_PTHREAD_H
+static void	*http_pool_expire_thread(void *data);
+static void	http_pool_fork_child(void);
+#endif /* HAVE_PTHREAD_H */
+static int	http_pool_is_closed(http_t *http);
+static void	http_pool_reset(http_t *http);
+static int	http_pool_same_host(_http_pool_t *a, _http_pool_t *b);
+
+
+/*
+ * '_httpPoolClose()' - Close idle connections that use the given client
+ *                      credentials.
+ *
+ * Called before the credentials are freed so that a later set of credentials
+ * at the same address never matches a connection made with the old ones.
+ */
+
+void
+_httpPoolClose(
+    http_tls_credentials_t credentials)	/* I - Client credentials */
+{
+  _http_pool_t	*p;			/* Current pool entry */
+
+
+  if (!credentials)
+    return;
+
+  _cupsMutexLock(&pool_mutex);
+
+  for (p = (_http_pool_t *)cupsArrayFirst(pool);
+       p;
+       p = (_http_pool_t *)cupsArrayNext(pool))
+    if (p->credentials == credentials)
+    {
+      cupsArrayRemove(pool, p);
+      http_pool_close(p);
+    }
+
+  _cupsMutexUnlock(&pool_mutex);
+}
+
+
+/*
+ * '_httpPoolGet()' - Get an idle connection from the pool.
+ *
+ * The hostname and port are those passed to @link httpConnect2@.  Only
+ * connections made by the same user with the same client credentials are
+ * returned.  The connection is removed from the pool and is returned to it
+ * when closed with @link httpClose@.
+ */
+
+http_t *				/* O - Connection or @code NULL@ if none */
+_httpPoolGet(
+    const char             *hostname,	/* I - Hostname */
+    int                    port,	/* I - Port number */
+    http_encryption_t      encryption,	/* I - Encryption setting */
+    http_tls_credentials_t credentials)	/* I - Client credentials or @code NULL@ */
+{
+  _http_pool_t	*p,			/* Current pool entry */
+		*match = NULL;		/* Matching pool entry */
+  http_t	*http = NULL;		/* Connection */
+  const char	*user = cupsUser();	/* Current user */
+
+
+  DEBUG_printf(("_httpPoolGet(hostname=\"%s\", port=%d, encryption=%d, "
+                "credentials=%p)", hostname, port, encryption, credentials));
+
+  _cupsMutexLock(&pool_mutex);
+
+ /*
+  * Close any connections that have expired or been closed by the server, then
+  * look for the most recently used matching connection...
+  */
+
+  http_pool_expire();
+
+  for (p = (_http_pool_t *)cupsArrayFirst(pool);
+       p;
+       p = (_http_pool_t *)cupsArrayNext(pool))
+  {
+    if (p->port == port && p->encryption == encryption &&
+        p->credentials == credentials &&
+        !_cups_strcasecmp(p->hostname, hostname) && !strcmp(p->user, user))
+      match = p;
+  }
+
+  if (match)
+  {
+    cupsArrayRemove(pool, match);
+
+    http = match->http;
+    free(match);
+  }
+
+  _cupsMutexUnlock(&pool_mutex);
+
+  DEBUG_printf(("1_httpPoolGet: Returning %p.", http));
+
+  return (http);
+}
+
+
+/*
+ * '_httpPoolPut()' - Return a connection to the pool.
+ *
+ * Returns 1 if the connection was added to the pool and 0 if it should be
+ * closed by the caller.  The timeout, blocking mode, request fields, and
+ * authorization state of the previous owner are reset first.
+ */
+
+int					/* O - 1 if pooled, 0 otherwise */
+_httpPoolPut(http_t *http)		/* I - Connection */
+{
+  _http_pool_t	*p,			/* Current pool entry */
+		*oldest = NULL;		/* Oldest matching entry */
+  int		count = 0;		/* Number of matching entries */
+
+
+  DEBUG_printf(("_httpPoolPut(http=%p)", http));
+
+ /*
+  * Only keep connections that are idle and can be reused...
+  */
+
+  if (http->fd < 0 || !http->hostaddr || http->state != HTTP_STATE_WAITING ||
+      http->error || http->used > 0 || http->wused > 0 ||
+      http->mode != _HTTP_MODE_CLIENT || http->version < HTTP_VERSION_1_1 ||
+      !_cups_strcasecmp(http->fields[HTTP_FIELD_CONNECTION], "close") ||
+      http_pool_is_closed(http))
+    return (0);
+
+  if ((p = calloc(1, sizeof(_http_pool_t))) == NULL)
+    return (0);
+
+  strlcpy(p->hostname, http->hostname, sizeof(p->hostname));
+  strlcpy(p->user, cupsUser(), sizeof(p->user));
+  p->port        = http->port;
+  p->encryption  = http->encryption;
+  p->credentials = _cupsGlobals()->tls_credentials;
+  p->idle        = time(NULL);
+  p->http        = http;
+
+  http_pool_reset(http);
+
+#ifdef HAVE_PTHREAD_H
+  _cupsGlobalLock();
+
+  if (!pool_atfork)
+  {
+    pthread_atfork(NULL, NULL, http_pool_fork_child);
+    pool_atfork = 1;
+  }
+
+  _cupsGlobalUnlock();
+#endif /* HAVE_PTHREAD_H */
+
+  _cupsMutexLock(&pool_mutex);
+
+  if (!pool && (pool = cupsArrayNew(NULL, NULL)) == NULL)
+  {
+    _cupsMutexUnlock(&pool_mutex);
+    free(p);
+    return (0);
+  }
+
+  http_pool_expire();
+
+ /*
+  * Enforce the per-server limit by closing the oldest connection to the same
+  * server...
+  */
+
+  for (oldest = (_http_pool_t *)cupsArrayFirst(pool);
+       oldest;
+       oldest = (_http_pool_t *)cupsArrayNext(pool))
+    if (http_pool_same_host(oldest, p))
+    {
+      if (++ count >= _HTTP_POOL_MAX_HOST)
+        break;
+    }
+
+  if (count >= _HTTP_POOL_MAX_HOST)
+  {
+    for (oldest = (_http_pool_t *)cupsArrayFirst(pool);
+	 oldest;
+	 oldest = (_http_pool_t *)cupsArrayNext(pool))
+      if (http_pool_same_host(oldest, p))
+        break;
+  }
+  else if (cupsArrayCount(pool) >= _HTTP_POOL_MAX)
+    oldest = (_http_pool_t *)cupsArrayFirst(pool);
+
+  if (oldest)
+  {
+    cupsArrayRemove(pool, oldest);
+    http_pool_close(oldest);
+  }
+
+  cupsArrayAdd(pool, p);
+
+#ifdef HAVE_PTHREAD_H
+ /*
+  * Start a thread to close the connection if nobody uses it in time...
+  */
+
+  if (!pool_running)
+  {
+    if (_cupsThreadCreate((_cups_thread_func_t)http_pool_expire_thread, NULL))
+      pool_running = 1;
+    else
+      DEBUG_puts("1_httpPoolPut: Unable to start expire thread.");
+  }
+#endif /* HAVE_PTHREAD_H */
+
+  _cupsMutexUnlock(&pool_mutex);
+
+  return (1);
+}
+
+
+/*
+ * 'http_pool_close()' - Close a pooled connection and free the entry.
+ */
+
+static void
+http_pool_close(_http_pool_t *p)	/* I - Pool entry */
+{
+  DEBUG_printf(("4http_pool_close(p=%p(%s:%d))", p, p->hostname, p->port));
+
+  p->http->pool = 0;
+
+  httpClose(p->http);
+  free(p);
+}
+
+
+/*
+ * 'http_pool_expire()' - Close expired connections and connections that were
+ *                        closed by the server.
+ *
+ * The pool mutex must be held.  Returns the time when the oldest remaining
+ * connection expires or 0 if the pool is empty.
+ */
+
+static time_t				/* O - Next expiration time or 0 */
+http_pool_expire(void)
+{
+  _http_pool_t	*p;			/* Current pool entry */
+  time_t	expire = time(NULL) - _HTTP_POOL_IDLE;
+					/* Oldest usable connection */
+
+
+  for (p = (_http_pool_t *)cupsArrayFirst(pool);
+       p;
+       p = (_http_pool_t *)cupsArrayNext(pool))
+  {
+    if (p->idle < expire || http_pool_is_closed(p->http))
+    {
+      cupsArrayRemove(pool, p);
+      http_pool_close(p);
+    }
+  }
+
+  if ((p = (_http_pool_t *)cupsArrayFirst(pool)) != NULL)
+    return (p->idle + _HTTP_POOL_IDLE);
+  else
+    return (0);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * 'http_pool_expire_thread()' - Close idle connections as they expire.
+ *
+ * The thread exits once the pool is empty and is started again by the next
+ * @code _httpPoolPut@.
+ */
+
+static void *				/* O - Exit status */
+http_pool_expire_thread(void *data)	/* I - Thread data (unused) */
+{
+  time_t	next,			/* Next expiration time */
+		curtime;		/* Current time */
+
+
+  (void)data;
+
+  for (;;)
+  {
+    _cupsMutexLock(&pool_mutex);
+
+    if ((next = http_pool_expire()) == 0)
+    {
+      pool_running = 0;
+      _cupsMutexUnlock(&pool_mutex);
+      break;
+    }
+
+    _cupsMutexUnlock(&pool_mutex);
+
+    if ((curtime = time(NULL)) < next)
+      sleep((unsigned)(next - curtime + 1));
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'http_pool_fork_child()' - Forget the pool in a child process.
+ *
+ * The idle connections belong to the parent, which may still use them, and
+ * the expire thread is not inherited.
+ */
+
+static void
+http_pool_fork_child(void)
+{
+  _cupsMutexInit(&pool_mutex);
+
+  pool         = NULL;
+  pool_running = 0;
+}
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * 'http_pool_is_closed()' - Determine whether the server closed an idle
+ *                           connection.
+ */
+
+static int				/* O - 1 if closed, 0 if still open */
+http_pool_is_closed(http_t *http)	/* I - Connection */
+{
+  char		ch;			/* Connection check byte */
+  ssize_t	n;			/* Number of bytes */
+
+
+#ifdef WIN32
+  if ((n = recv(http->fd, &ch, 1, MSG_PEEK)) == 0 ||
+      (n < 0 && WSAGetLastError() != WSAEWOULDBLOCK))
+#else
+  if ((n = recv(http->fd, &ch, 1, MSG_PEEK | MSG_DONTWAIT)) == 0 ||
+      (n < 0 && errno != EWOULDBLOCK && errno != EAGAIN))
+#endif /* WIN32 */
+    return (1);
+
+ /*
+  * Any unsolicited data also makes the connection unusable...
+  */
+
+  return (n > 0);
+}
+
+
+/*
+ * 'http_pool_reset()' - Reset the per-owner state of a connection.
+ */
+
+static void
+http_pool_reset(http_t *http)		/* I - Connection */
+{
+#ifdef HAVE_GSSAPI
+  OM_uint32	minor_status;		/* Minor status code */
+#endif /* HAVE_GSSAPI */
+#ifdef WIN32
+  DWORD		tv = 0;			/* No timeout */
+#else
+  struct timeval tv;			/* No timeout */
+#endif /* WIN32 */
+
+
+ /*
+  * Timeout and blocking mode...
+  */
+
+  if (http->timeout_value > 0.0)
+  {
+#ifndef WIN32
+    tv.tv_sec  = 0;
+    tv.tv_usec = 0;
+#endif /* !WIN32 */
+
+    setsockopt(http->fd, SOL_SOCKET, SO_RCVTIMEO, CUPS_SOCAST &tv, sizeof(tv));
+    setsockopt(http->fd, SOL_SOCKET, SO_SNDTIMEO, CUPS_SOCAST &tv, sizeof(tv));
+  }
+
+  http->timeout_cb    = NULL;
+  http->timeout_data  = NULL;
+  http->timeout_value = 0.0;
+
+  httpBlocking(http, 1);
+
+ /*
+  * Request fields, cookies, and authorization...
+  */
+
+  httpClearFields(http);
+  httpClearCookie(http);
+  httpSetAuthString(http, NULL, NULL);
+
+  memset(http->nonce, 0, sizeof(http->nonce));
+  memset(http->userpass, 0, sizeof(http->userpass));
+
+  http->nonce_count  = 0;
+  http->digest_tries = 0;
+
+#ifdef HAVE_GSSAPI
+  if (http->gssctx != GSS_C_NO_CONTEXT)
+    gss_delete_sec_context(&minor_status, &http->gssctx, GSS_C_NO_BUFFER);
+#endif /* HAVE_GSSAPI */
+
+#ifdef HAVE_AUTHORIZATION_H
+  if (http->auth_ref)
+  {
+    AuthorizationFree(http->auth_ref, kAuthorizationFlagDefaults);
+    http->auth_ref = NULL;
+  }
+#endif /* HAVE_AUTHORIZATION_H */
+
+ /*
+  * Client credentials that have not been used for TLS yet...
+  */
+
+#ifdef HAVE_SSL
+  if (!http->tls && http->tls_credentials)
+  {
+    _httpFreeCredentials(http->tls_credentials);
+    http->tls_credentials = NULL;
+  }
+#endif /* HAVE_SSL */
+}
+
+
+/*
+ * 'http_pool_same_host()' - Determine whether two entries are for the same
+ *                           server.
+ */
+
+static int				/* O - 1 if same server, 0 otherwise */
+http_pool_same_host(_http_pool_t *a,	/* I - First entry */
+                    _http_pool_t *b)	/* I - Second entry */
+{
+  return (a->port == b->port && !_cups_strcasecmp(a->hostname, b->hostname));
+}
+
+
+/*
+ * End of "$Id$".
+ */
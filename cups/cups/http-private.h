@@ -342,6 +342,10 @@ struct _http_s				/**** HTTP connection structure ****/
   z_stream		stream;		/* (De)compression stream */
   Bytef			*sbuffer;	/* (De)compression buffer */
 #  endif /* HAVE_LIBZ */
+
+  /**** New in CUPS 2.1 ****/
+  int			pool;		/* Return to connection pool on close? */
+  int			port;		/* Port number passed to httpConnect2 */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -411,11 +415,19 @@ extern void		_httpDisconnect(http_t *http);
 extern char		*_httpEncodeURI(char *dst, const char *src,
 			                size_t dstsize);
 extern void		_httpFreeCredentials(http_tls_credentials_t credentials);
+extern void		_httpPoolClose(http_tls_credentials_t credentials);
+extern http_t		*_httpPoolGet(const char *hostname, int port,
+			              http_encryption_t encryption,
+				      http_tls_credentials_t credentials);
+extern int		_httpPoolPut(http_t *http);
 extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context);
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status);
+#  ifdef HAVE_GNUTLS
+extern int		_httpTLSHandshake(http_t *http, int *wantwrite);
+#  endif /* HAVE_GNUTLS */
 extern void		_httpTLSInitialize(void);
 extern size_t		_httpTLSPending(http_t *http);
 extern int		_httpTLSRead(http_t *http, char *buf, int len);
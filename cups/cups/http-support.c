@@ -20,6 +20,7 @@
  */
 
 #include "cups-private.h"
+#include <sys/stat.h>
 #ifdef HAVE_DNSSD
 #  include <dns_sd.h>
 #  ifdef WIN32
@@ -36,6 +37,14 @@
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * Local constants...
+ */
+
+#define _HTTP_RESOLVE_CACHE_MAX	100	/* Maximum number of cached URIs */
+#define _HTTP_RESOLVE_CACHE_TTL	120	/* Seconds to cache resolved URIs */
+
+
 /*
  * Local types...
  */
@@ -114,6 +123,16 @@ static const char	*http_copy_decode(char *dst, const char *src,
 static char		*http_copy_encode(char *dst, const char *src,
 			                  char *dstend, const char *reserved,
 					  const char *term, int encode);
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static int		http_resolve_cache_get(const char *uri, int options,
+			                       char *resolved_uri,
+					       size_t resolved_size);
+static const char	*http_resolve_cache_path(const char *ext,
+			                         char *filename,
+			                         size_t filesize);
+static void		http_resolve_cache_put(const char *uri, int options,
+			                       const char *resolved_uri);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
 #ifdef HAVE_DNSSD
 static void DNSSD_API	http_resolve_cb(DNSServiceRef sdRef,
 					DNSServiceFlags flags,
@@ -1609,6 +1628,8 @@ _httpResolveURI(
   if (strstr(hostname, "._tcp"))
   {
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+    const char		*service_uri = uri;
+					/* DNS-SD URI */
     char		*regtype,	/* Pointer to type in hostname */
 			*domain,	/* Pointer to domain in hostname */
 			*uuid,		/* Pointer to UUID in URI */
@@ -1636,6 +1657,22 @@ _httpResolveURI(
     int			error;		/* Status */
 #  endif /* HAVE_DNSSD */
 
+   /*
+    * Use a recent resolution of the same URI if we have one...
+    */
+
+    if (http_resolve_cache_get(service_uri, options, resolved_uri,
+                               resolved_size))
+    {
+      if (options & _HTTP_RESOLVE_STDERR)
+        fprintf(stderr, "DEBUG: Resolved as \"%s\" (cached)...\n",
+	        resolved_uri);
+
+      DEBUG_printf(("5_httpResolveURI: Returning cached \"%s\"",
+                    resolved_uri));
+      return (resolved_uri);
+    }
+
     if (options & _HTTP_RESOLVE_STDERR)
       fprintf(stderr, "DEBUG: Resolving \"%s\"...\n", hostname);
 
@@ -1923,6 +1960,9 @@ _httpResolveURI(
     }
 #  endif /* HAVE_DNSSD */
 
+    if (uri)
+      http_resolve_cache_put(service_uri, options, uri);
+
     if (options & _HTTP_RESOLVE_STDERR)
     {
       if (uri)
@@ -2115,6 +2155,190 @@ http_copy_encode(char       *dst,	/* O - Destination buffer */
 }
 
 
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+/*
+ * 'http_resolve_cache_get()' - Get a recently resolved URI from the cache.
+ *
+ * mDNS host and SRV records are normally announced with a 120 second TTL, so
+ * that is how long a resolved URI is used before resolving it again.  The
+ * resolved URI contains the host name and not its address, so a printer that
+ * changes addresses is still found.
+ */
+
+static int				/* O - 1 if found, 0 otherwise */
+http_resolve_cache_get(
+    const char *uri,			/* I - DNS-SD URI */
+    int        options,			/* I - Resolve options */
+    char       *resolved_uri,		/* I - Buffer for resolved URI */
+    size_t     resolved_size)		/* I - Size of URI buffer */
+{
+  cups_file_t	*fp;			/* Cache file */
+  char		filename[1024],		/* Cache filename */
+		line[2048],		/* Line from file */
+		key[1024],		/* DNS-SD URI from line */
+		value[1024];		/* Resolved URI from line */
+  long		expires;		/* Expiration time from line */
+  int		loptions,		/* Resolve options from line */
+		found = 0;		/* Found the URI? */
+  time_t	curtime = time(NULL);	/* Current time */
+
+
+  options &= _HTTP_RESOLVE_FQDN | _HTTP_RESOLVE_FAXOUT;
+
+  if (!http_resolve_cache_path("cache", filename, sizeof(filename)) ||
+      (fp = cupsFileOpen(filename, "r")) == NULL)
+    return (0);
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (sscanf(line, "%ld%d%1023s%1023s", &expires, &loptions, key,
+               value) == 4 &&
+        expires > curtime && loptions == options && !strcmp(key, uri))
+    {
+     /*
+      * Use the last match, which is the newest...
+      */
+
+      strlcpy(resolved_uri, value, resolved_size);
+      found = 1;
+    }
+  }
+
+  cupsFileClose(fp);
+
+  DEBUG_printf(("6http_resolve_cache_get(uri=\"%s\", options=%d): %d", uri,
+                options, found));
+
+  return (found);
+}
+
+
+/*
+ * 'http_resolve_cache_path()' - Get the filename for the resolve cache.
+ *
+ * Backends share the cache in the scheduler's cache directory.  Other
+ * programs use one in the user's ~/.cups directory.
+ */
+
+static const char *			/* O - Filename or NULL */
+http_resolve_cache_path(
+    const char *ext,			/* I - Filename extension */
+    char       *filename,		/* I - Filename buffer */
+    size_t     filesize)		/* I - Size of filename buffer */
+{
+  const char	*cachedir,		/* CUPS_CACHEDIR environment variable */
+		*home;			/* HOME environment variable */
+
+
+  if ((cachedir = getenv("CUPS_CACHEDIR")) == NULL && !getuid())
+    cachedir = CUPS_CACHEDIR;
+
+  if (cachedir)
+    snprintf(filename, filesize, "%s/dnssd.%s", cachedir, ext);
+  else if ((home = getenv("HOME")) != NULL)
+  {
+    snprintf(filename, filesize, "%s/.cups", home);
+    if (access(filename, 0) && mkdir(filename, 0700))
+      return (NULL);
+
+    snprintf(filename, filesize, "%s/.cups/dnssd.%s", home, ext);
+  }
+  else
+    return (NULL);
+
+  return (filename);
+}
+
+
+/*
+ * 'http_resolve_cache_put()' - Add a resolved URI to the cache.
+ */
+
+static void
+http_resolve_cache_put(
+    const char *uri,			/* I - DNS-SD URI */
+    int        options,			/* I - Resolve options */
+    const char *resolved_uri)		/* I - Resolved URI */
+{
+  cups_file_t	*fp;			/* Cache file */
+  cups_array_t	*lines;			/* Lines to keep */
+  char		filename[1024],		/* Cache filename */
+		tempext[64],		/* Temporary filename extension */
+		tempfile[1024],		/* Temporary cache filename */
+		line[2048],		/* Line from file */
+		key[1024],		/* DNS-SD URI from line */
+		*ptr;			/* Pointer to line */
+  long		expires;		/* Expiration time from line */
+  int		loptions;		/* Resolve options from line */
+  time_t	curtime = time(NULL);	/* Current time */
+
+
+  options &= _HTTP_RESOLVE_FQDN | _HTTP_RESOLVE_FAXOUT;
+
+  snprintf(tempext, sizeof(tempext), "cache.%d", (int)getpid());
+
+  if (!http_resolve_cache_path("cache", filename, sizeof(filename)) ||
+      !http_resolve_cache_path(tempext, tempfile, sizeof(tempfile)) ||
+      strchr(uri, ' ') || strchr(resolved_uri, ' ') ||
+      (lines = cupsArrayNew(NULL, NULL)) == NULL)
+    return;
+
+ /*
+  * Keep the entries that haven't expired, dropping the oldest ones when the
+  * cache is full...
+  */
+
+  if ((fp = cupsFileOpen(filename, "r")) != NULL)
+  {
+    while (cupsFileGets(fp, line, sizeof(line)))
+    {
+      if (sscanf(line, "%ld%d%1023s", &expires, &loptions, key) != 3 ||
+          expires <= curtime || (loptions == options && !strcmp(key, uri)))
+        continue;
+
+      if (cupsArrayCount(lines) >= (_HTTP_RESOLVE_CACHE_MAX - 1))
+      {
+        ptr = (char *)cupsArrayFirst(lines);
+	cupsArrayRemove(lines, ptr);
+	free(ptr);
+      }
+
+      if ((ptr = strdup(line)) != NULL)
+        cupsArrayAdd(lines, ptr);
+    }
+
+    cupsFileClose(fp);
+  }
+
+ /*
+  * Write the new cache file and replace the old one...
+  */
+
+  if ((fp = cupsFileOpen(tempfile, "w")) != NULL)
+  {
+    for (ptr = (char *)cupsArrayFirst(lines);
+         ptr;
+	 ptr = (char *)cupsArrayNext(lines))
+      cupsFilePrintf(fp, "%s\n", ptr);
+
+    cupsFilePrintf(fp, "%ld %d %s %s\n",
+                   (long)(curtime + _HTTP_RESOLVE_CACHE_TTL), options, uri,
+		   resolved_uri);
+
+    if (cupsFileClose(fp) || rename(tempfile, filename))
+      unlink(tempfile);
+  }
+
+  for (ptr = (char *)cupsArrayFirst(lines);
+       ptr;
+       ptr = (char *)cupsArrayNext(lines))
+    free(ptr);
+
+  cupsArrayDelete(lines);
+}
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
 #ifdef HAVE_DNSSD
 /*
  * 'http_resolve_cb()' - Build a device URI for the given service name.
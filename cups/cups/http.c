@@ -353,6 +353,13 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (!http)
     return;
 
+ /*
+  * Keep pooled connections open for reuse...
+  */
+
+  if (http->pool && _httpPoolPut(http))
+    return;
+
  /*
   * Close any open connection...
   */
@@ -3965,6 +3972,8 @@ http_create(
   if (host)
     strlcpy(http->hostname, host, sizeof(http->hostname));
 
+  http->port = port;
+
   if (port == 443)			/* Always use encryption for https */
     http->encryption = HTTP_ENCRYPTION_ALWAYS;
   else
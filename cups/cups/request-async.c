@@ -0,0 +1,1581 @@
+/*
+ * "$Id$"
+ *
+ * Asynchronous IPP request functions for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define _CUPS_ASYNC_TIMEOUT	30000	/* Default timeout in milliseconds */
+#define _CUPS_ASYNC_MAX_LINE	32768	/* Maximum length of a response line */
+
+
+/*
+ * Local types...
+ */
+
+typedef enum _cups_astate_e		/**** Asynchronous request states ****/
+{
+  _CUPS_ASTATE_QUEUED,			/* Waiting for the connection */
+  _CUPS_ASTATE_CONNECT,			/* Connecting to the server */
+  _CUPS_ASTATE_TLS,			/* Negotiating encryption */
+  _CUPS_ASTATE_SEND,			/* Sending HTTP request */
+  _CUPS_ASTATE_HEADER,			/* Reading HTTP response header */
+  _CUPS_ASTATE_BODY,			/* Reading HTTP response body */
+  _CUPS_ASTATE_DONE			/* Request completed */
+} _cups_astate_t;
+
+typedef struct _cups_areq_s		/**** Asynchronous request ****/
+{
+  _cups_astate_t	state;		/* Current state */
+  http_t		*http;		/* Connection to server */
+  ipp_t			*request;	/* IPP request */
+  char			resource[1024];	/* HTTP resource for POST */
+  int			msec;		/* Timeout in milliseconds */
+  double		deadline;	/* Time when current state times out */
+  http_addrlist_t	*addr;		/* Address being connected */
+  int			fd;		/* Socket being connected */
+  int			events;		/* poll() events for current state */
+  int			reused;		/* Sent on a kept-alive connection? */
+  int			upgrade;	/* TLS upgrade: 0 = none, 1 = waiting for
+					 * 101 response, 2 = waiting for OPTIONS
+					 * response after handshake */
+  char			*wbuffer;	/* Outgoing HTTP request */
+  size_t		wsize,		/* Size of request buffer */
+			wused,		/* Bytes used in request buffer */
+			wpos;		/* Bytes sent so far */
+  char			*rbuffer;	/* Incoming HTTP response data */
+  size_t		rsize,		/* Size of input buffer */
+			rused,		/* Bytes used in input buffer */
+			rpos;		/* Bytes parsed so far */
+  int			eof;		/* Has the server closed the connection? */
+  http_status_t		status;		/* HTTP status of response */
+  int			keep_alive,	/* Keep the connection open? */
+			chunked,	/* Chunked transfer encoding? */
+			trailer;	/* Reading chunked trailer? */
+  off_t			remaining;	/* Bytes remaining in body/chunk or -1 */
+  char			*buffer;	/* Response body */
+  size_t		bufsize,	/* Size of response buffer */
+			bufused,	/* Bytes used in response buffer */
+			bufpos;		/* Read position for ippReadIO */
+  cups_request_cb_t	cb;		/* Completion callback */
+  void			*user_data;	/* User data pointer */
+} _cups_areq_t;
+
+struct _cups_loop_s			/**** Asynchronous request loop ****/
+{
+  cups_array_t		*requests;	/* Requests in submission order */
+};
+
+
+/*
+ * Local functions...
+ */
+
+static void	cups_async_connect(_cups_areq_t *req);
+static void	cups_async_connected(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_disconnect(http_t *http);
+static void	cups_async_done(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_error(cups_loop_t *loop, _cups_areq_t *req,
+		                 int error);
+static void	cups_async_finish(cups_loop_t *loop, _cups_areq_t *req,
+		                  ipp_status_t status, const char *message,
+		                  ipp_t *response);
+static int	cups_async_gets(_cups_areq_t *req, char *line,
+		                size_t linesize);
+static int	cups_async_grow(char **buffer, size_t *bufsize,
+		                size_t bytes);
+static void	cups_async_handshake(cups_loop_t *loop, _cups_areq_t *req);
+static ssize_t	cups_async_io(http_t *http, char *buffer, size_t bytes,
+		              int write_data);
+static int	cups_async_is_busy(cups_loop_t *loop, http_t *http);
+static double	cups_async_now(void);
+static void	cups_async_read(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_read_body(cups_loop_t *loop, _cups_areq_t *req);
+static ssize_t	cups_async_read_cb(_cups_areq_t *req, ipp_uchar_t *buffer,
+		                   size_t bytes);
+static void	cups_async_read_header(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_ready(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_send(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_start(cups_loop_t *loop, _cups_areq_t *req);
+static void	cups_async_write(cups_loop_t *loop, _cups_areq_t *req);
+static ssize_t	cups_async_write_cb(_cups_areq_t *req, ipp_uchar_t *buffer,
+		                    size_t bytes);
+
+
+/*
+ * 'cupsDoRequestAsync()' - Queue an IPP request on an asynchronous loop.
+ *
+ * This function queues the IPP request for the specified connection and
+ * returns immediately.  The request is sent and the response received when
+ * @link cupsLoopRun@ is called, and "cb" is then called with the IPP status,
+ * the status message, and the response (or @code NULL@ on error).  The
+ * callback must free the response with @link ippDelete@.
+ *
+ * The connection must be created with @link httpConnect2@ using a timeout of
+ * 0 so that the loop can perform a non-blocking connect, and only one request
+ * is active on a given connection at a time - additional requests for the
+ * same connection are sent in order as previous requests complete.  The
+ * socket is non-blocking while the loop owns it, so a slow server never
+ * delays requests on other connections.
+ *
+ * The "msec" argument specifies the timeout for connecting to the server
+ * (including any TLS negotiation) and for receiving the response.  The request
+ * is freed with @link ippDelete@.
+ *
+ * @since CUPS 2.1@
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsDoRequestAsync(
+    cups_loop_t       *loop,		/* I - Request loop */
+    http_t            *http,		/* I - Connection to server */
+    ipp_t             *request,		/* I - IPP request */
+    const char        *resource,	/* I - HTTP resource for POST */
+    int               msec,		/* I - Timeout in milliseconds or -1 for default */
+    cups_request_cb_t cb,		/* I - Completion callback */
+    void              *user_data)	/* I - User data pointer */
+{
+  _cups_areq_t	*req;			/* New request */
+
+
+  DEBUG_printf(("cupsDoRequestAsync(loop=%p, http=%p, request=%p(%s), "
+                "resource=\"%s\", msec=%d, cb=%p, user_data=%p)", loop, http,
+                request,
+		request ? ippOpString(request->request.op.operation_id) : "?",
+		resource, msec, cb, user_data));
+
+ /*
+  * Range check input...
+  */
+
+  if (!loop || !http || !request || !resource || !cb)
+  {
+    ippDelete(request);
+
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+
+    return (0);
+  }
+
+  if ((req = calloc(1, sizeof(_cups_areq_t))) == NULL)
+  {
+    ippDelete(request);
+
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+
+    return (0);
+  }
+
+  req->state     = _CUPS_ASTATE_QUEUED;
+  req->http      = http;
+  req->request   = request;
+  req->msec      = msec > 0 ? msec : _CUPS_ASYNC_TIMEOUT;
+  req->fd        = -1;
+  req->cb        = cb;
+  req->user_data = user_data;
+
+  strlcpy(req->resource, resource, sizeof(req->resource));
+
+ /*
+  * Add the request to the loop - it is started by cupsLoopRun so that the
+  * callback is never called from here...
+  */
+
+  cupsArrayAdd(loop->requests, req);
+
+  return (1);
+}
+
+
+/*
+ * 'cupsLoopDelete()' - Delete an asynchronous request loop.
+ *
+ * Any pending requests are canceled and their callbacks are called with
+ * @code IPP_STATUS_ERROR_INTERNAL@.
+ *
+ * @since CUPS 2.1@
+ */
+
+void
+cupsLoopDelete(cups_loop_t *loop)	/* I - Request loop */
+{
+  _cups_areq_t	*req;			/* Current request */
+
+
+  DEBUG_printf(("cupsLoopDelete(loop=%p)", loop));
+
+  if (!loop)
+    return;
+
+  for (req = (_cups_areq_t *)cupsArrayFirst(loop->requests);
+       req;
+       req = (_cups_areq_t *)cupsArrayNext(loop->requests))
+  {
+    if (req->state != _CUPS_ASTATE_DONE)
+    {
+      if (req->fd >= 0)
+        httpAddrClose(NULL, req->fd);
+
+      if (req->state != _CUPS_ASTATE_QUEUED)
+        cups_async_disconnect(req->http);
+
+      cups_async_finish(NULL, req, IPP_STATUS_ERROR_INTERNAL,
+                        strerror(ECANCELED), NULL);
+    }
+
+    free(req);
+  }
+
+  cupsArrayDelete(loop->requests);
+  free(loop);
+}
+
+
+/*
+ * 'cupsLoopNew()' - Create a new asynchronous request loop.
+ *
+ * @since CUPS 2.1@
+ */
+
+cups_loop_t *				/* O - New request loop or @code NULL@ on error */
+cupsLoopNew(void)
+{
+  cups_loop_t	*loop;			/* New loop */
+
+
+  DEBUG_puts("cupsLoopNew()");
+
+  if ((loop = calloc(1, sizeof(cups_loop_t))) == NULL)
+    return (NULL);
+
+  if ((loop->requests = cupsArrayNew(NULL, NULL)) == NULL)
+  {
+    free(loop);
+    return (NULL);
+  }
+
+  return (loop);
+}
+
+
+/*
+ * 'cupsLoopRun()' - Process asynchronous requests.
+ *
+ * This function sends queued requests and processes responses until all
+ * requests have completed or the specified number of milliseconds have
+ * elapsed.  Completion callbacks are called from this function and may queue
+ * additional requests.
+ *
+ * @since CUPS 2.1@
+ */
+
+int					/* O - Number of requests still pending */
+cupsLoopRun(cups_loop_t *loop,		/* I - Request loop */
+            int         msec)		/* I - Maximum time in milliseconds or -1 for no limit */
+{
+  _cups_areq_t	*req,			/* Current request */
+		**reqs = NULL;		/* Requests being polled */
+  struct pollfd	*pfds = NULL;		/* Polled file descriptors */
+  int		alloc_pfds = 0,		/* Allocated polled file descriptors */
+		num_pfds,		/* Number of polled file descriptors */
+		pending,		/* Number of pending requests */
+		i,			/* Looping var */
+		timeout;		/* poll() timeout */
+  double	now,			/* Current time */
+		end,			/* End time */
+		next;			/* Next deadline */
+
+
+  DEBUG_printf(("cupsLoopRun(loop=%p, msec=%d)", loop, msec));
+
+  if (!loop)
+    return (0);
+
+  end = msec >= 0 ? cups_async_now() + msec : 0.0;
+
+  for (;;)
+  {
+   /*
+    * Start queued requests whose connections are not in use.  Indices are
+    * used since starting a request can walk the array...
+    */
+
+    for (i = 0; i < cupsArrayCount(loop->requests); i ++)
+    {
+      req = (_cups_areq_t *)cupsArrayIndex(loop->requests, i);
+
+      if (req->state == _CUPS_ASTATE_QUEUED &&
+          !cups_async_is_busy(loop, req->http))
+        cups_async_start(loop, req);
+    }
+
+   /*
+    * Remove completed requests, expire requests that have timed out, and
+    * build the list of file descriptors to poll...
+    */
+
+    now     = cups_async_now();
+    next    = end;
+    pending = 0;
+
+    for (req = (_cups_areq_t *)cupsArrayFirst(loop->requests);
+         req;
+	 req = (_cups_areq_t *)cupsArrayNext(loop->requests))
+    {
+      if (req->state != _CUPS_ASTATE_DONE && req->state != _CUPS_ASTATE_QUEUED &&
+          now >= req->deadline)
+      {
+        DEBUG_printf(("2cupsLoopRun: Request %p timed out.", req));
+
+	if (req->fd >= 0)
+	{
+	  httpAddrClose(NULL, req->fd);
+	  req->fd = -1;
+	}
+
+        cups_async_disconnect(req->http);
+	cups_async_finish(loop, req, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE,
+	                  strerror(ETIMEDOUT), NULL);
+      }
+
+      if (req->state == _CUPS_ASTATE_DONE)
+      {
+        cupsArrayRemove(loop->requests, req);
+	free(req);
+	continue;
+      }
+
+      pending ++;
+
+      if (req->state != _CUPS_ASTATE_QUEUED &&
+          (next <= 0.0 || req->deadline < next))
+        next = req->deadline;
+    }
+
+    if (!pending || (msec >= 0 && now >= end))
+      break;
+
+    if (pending > alloc_pfds)
+    {
+      struct pollfd	*temp_pfds;	/* New polled file descriptors */
+      _cups_areq_t	**temp_reqs;	/* New polled requests */
+
+      if ((temp_pfds = realloc(pfds, (size_t)pending * sizeof(struct pollfd))) == NULL)
+        break;
+
+      pfds = temp_pfds;
+
+      if ((temp_reqs = realloc(reqs, (size_t)pending * sizeof(_cups_areq_t *))) == NULL)
+        break;
+
+      reqs       = temp_reqs;
+      alloc_pfds = pending;
+    }
+
+    timeout = next > 0.0 ? (int)(next - now) + 1 : -1;
+
+    for (num_pfds = 0, req = (_cups_areq_t *)cupsArrayFirst(loop->requests);
+         req;
+	 req = (_cups_areq_t *)cupsArrayNext(loop->requests))
+    {
+      if (req->state == _CUPS_ASTATE_CONNECT)
+        pfds[num_pfds].fd = req->fd;
+      else if (req->state != _CUPS_ASTATE_QUEUED)
+        pfds[num_pfds].fd = req->http->fd;
+      else
+        continue;
+
+      pfds[num_pfds].events  = (short)req->events;
+      pfds[num_pfds].revents = 0;
+      reqs[num_pfds ++]      = req;
+    }
+
+    DEBUG_printf(("2cupsLoopRun: Polling %d sockets, timeout=%d...", num_pfds,
+                  timeout));
+
+    if (poll(pfds, (nfds_t)num_pfds, timeout) < 0 && errno != EINTR &&
+        errno != EAGAIN)
+      break;
+
+   /*
+    * Process any activity...
+    */
+
+    for (i = 0; i < num_pfds; i ++)
+    {
+      if (!pfds[i].revents)
+        continue;
+
+      req = reqs[i];
+
+      switch (req->state)
+      {
+        case _CUPS_ASTATE_CONNECT :
+	    cups_async_connected(loop, req);
+	    break;
+
+        case _CUPS_ASTATE_TLS :
+	    cups_async_handshake(loop, req);
+	    break;
+
+        case _CUPS_ASTATE_SEND :
+	    cups_async_write(loop, req);
+	    break;
+
+        case _CUPS_ASTATE_HEADER :
+        case _CUPS_ASTATE_BODY :
+	    cups_async_read(loop, req);
+	    break;
+
+        default :
+	    break;
+      }
+    }
+  }
+
+  free(pfds);
+  free(reqs);
+
+  DEBUG_printf(("1cupsLoopRun: Returning %d.", pending));
+
+  return (pending);
+}
+
+
+/*
+ * 'cups_async_connect()' - Start connecting to the next available address.
+ */
+
+static void
+cups_async_connect(_cups_areq_t *req)	/* I - Request */
+{
+  int	val;				/* Socket option value */
+
+
+  for (; req->addr; req->addr = req->addr->next)
+  {
+    if ((req->fd = (int)socket(httpAddrFamily(&(req->addr->addr)), SOCK_STREAM,
+                               0)) < 0)
+      continue;
+
+    val = 1;
+    setsockopt(req->fd, IPPROTO_TCP, TCP_NODELAY, CUPS_SOCAST &val,
+               sizeof(val));
+
+#ifdef SO_NOSIGPIPE
+    val = 1;
+    setsockopt(req->fd, SOL_SOCKET, SO_NOSIGPIPE, CUPS_SOCAST &val,
+               sizeof(val));
+#endif /* SO_NOSIGPIPE */
+
+    fcntl(req->fd, F_SETFD, FD_CLOEXEC);
+    fcntl(req->fd, F_SETFL, fcntl(req->fd, F_GETFL) | O_NONBLOCK);
+
+    if (!connect(req->fd, &(req->addr->addr.addr),
+                 (socklen_t)httpAddrLength(&(req->addr->addr))) ||
+        errno == EINPROGRESS || errno == EWOULDBLOCK)
+    {
+     /*
+      * Wait for the connection to complete (or fail)...
+      */
+
+      req->state  = _CUPS_ASTATE_CONNECT;
+      req->events = POLLOUT;
+      return;
+    }
+
+    req->http->error = errno;
+
+    httpAddrClose(NULL, req->fd);
+    req->fd = -1;
+  }
+
+ /*
+  * Out of addresses...
+  */
+
+  DEBUG_puts("4cups_async_connect: Unable to connect.");
+
+  req->state = _CUPS_ASTATE_DONE;
+}
+
+
+/*
+ * 'cups_async_connected()' - Finish connecting to the server.
+ */
+
+static void
+cups_async_connected(
+    cups_loop_t  *loop,			/* I - Request loop */
+    _cups_areq_t *req)			/* I - Request */
+{
+  http_t	*http = req->http;	/* Connection */
+  int		error = 0;		/* Socket error */
+  socklen_t	len = sizeof(error);	/* Length of error */
+
+
+  if (getsockopt(req->fd, SOL_SOCKET, SO_ERROR, CUPS_SOCAST &error, &len))
+    error = errno;
+
+  if (error)
+  {
+   /*
+    * Try the next address...
+    */
+
+    DEBUG_printf(("4cups_async_connected: connect() failed - %s",
+                  strerror(error)));
+
+    http->error = error;
+
+    httpAddrClose(NULL, req->fd);
+    req->fd   = -1;
+    req->addr = req->addr->next;
+
+    cups_async_connect(req);
+
+    if (req->state == _CUPS_ASTATE_DONE)
+      cups_async_error(loop, req, http->error);
+    return;
+  }
+
+ /*
+  * Reset the connection state just like httpReconnect2(), leaving the socket
+  * in non-blocking mode...
+  */
+
+  http->fd              = req->fd;
+  http->state           = HTTP_STATE_WAITING;
+  http->version         = HTTP_VERSION_1_1;
+  http->keep_alive      = HTTP_KEEPALIVE_OFF;
+  http->data_encoding   = HTTP_ENCODING_FIELDS;
+  http->_data_remaining = 0;
+  http->used            = 0;
+  http->data_remaining  = 0;
+  http->hostaddr        = &(req->addr->addr);
+  http->wused           = 0;
+  http->error           = 0;
+  req->fd               = -1;
+
+  memset(&http->_hostaddr, 0, sizeof(http->_hostaddr));
+
+  cups_async_ready(loop, req);
+}
+
+
+/*
+ * 'cups_async_disconnect()' - Close a connection after an error or timeout.
+ */
+
+static void
+cups_async_disconnect(http_t *http)	/* I - Connection */
+{
+#ifdef HAVE_SSL
+  if (http->tls)
+    _httpTLSStop(http);
+#endif /* HAVE_SSL */
+
+  if (http->fd >= 0)
+  {
+    httpAddrClose(NULL, http->fd);
+    http->fd = -1;
+  }
+
+  http->state = HTTP_STATE_WAITING;
+  http->used  = 0;
+  http->wused = 0;
+}
+
+
+/*
+ * 'cups_async_done()' - Decode a complete response and finish the request.
+ */
+
+static void
+cups_async_done(cups_loop_t  *loop,	/* I - Request loop */
+                _cups_areq_t *req)	/* I - Request */
+{
+  http_t	*http = req->http;	/* Connection */
+  ipp_t		*response;		/* IPP response */
+  ipp_state_t	state;			/* IPP read state */
+  ipp_attribute_t *attr;		/* status-message attribute */
+
+
+  DEBUG_printf(("4cups_async_done: Got %d byte response.",
+                (int)req->bufused));
+
+  response = ippNew();
+
+  while ((state = ippReadIO(req, (ipp_iocb_t)cups_async_read_cb, 1, NULL,
+                            response)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  if (!req->keep_alive || req->eof)
+    cups_async_disconnect(http);
+  else
+  {
+   /*
+    * Give the kept-alive connection back to the caller in blocking mode...
+    */
+
+    fcntl(http->fd, F_SETFL, fcntl(http->fd, F_GETFL) & ~O_NONBLOCK);
+    http->state = HTTP_STATE_WAITING;
+  }
+
+  if (state == IPP_STATE_ERROR)
+  {
+    ippDelete(response);
+    cups_async_finish(loop, req, IPP_STATUS_ERROR_INTERNAL,
+                      _cupsLangString(cupsLangDefault(),
+		                      _("Unable to read IPP response.")), NULL);
+    return;
+  }
+
+  attr = ippFindAttribute(response, "status-message", IPP_TAG_TEXT);
+
+  cups_async_finish(loop, req, ippGetStatusCode(response),
+                    attr ? ippGetString(attr, 0, NULL) :
+		           ippErrorString(ippGetStatusCode(response)),
+		    response);
+}
+
+
+/*
+ * 'cups_async_error()' - Close the connection and fail the request.
+ */
+
+static void
+cups_async_error(cups_loop_t  *loop,	/* I - Request loop */
+                 _cups_areq_t *req,	/* I - Request */
+		 int          error)	/* I - errno value */
+{
+  DEBUG_printf(("4cups_async_error(loop=%p, req=%p, error=%d)", loop, req,
+                error));
+
+  cups_async_disconnect(req->http);
+  cups_async_finish(loop, req, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE,
+                    strerror(error ? error : EIO), NULL);
+}
+
+
+/*
+ * 'cups_async_finish()' - Complete a request and start the next one for the
+ *                         same connection.
+ */
+
+static void
+cups_async_finish(
+    cups_loop_t  *loop,			/* I - Request loop or NULL when deleting */
+    _cups_areq_t *req,			/* I - Request */
+    ipp_status_t status,		/* I - IPP status */
+    const char   *message,		/* I - Status message */
+    ipp_t        *response)		/* I - IPP response or NULL */
+{
+  _cups_areq_t	*next;			/* Next request */
+
+
+  DEBUG_printf(("4cups_async_finish(loop=%p, req=%p, status=%s, "
+                "message=\"%s\", response=%p)", loop, req,
+		ippErrorString(status), message, response));
+
+  req->state = _CUPS_ASTATE_DONE;
+
+  ippDelete(req->request);
+  req->request = NULL;
+
+  free(req->wbuffer);
+  req->wbuffer = NULL;
+
+  free(req->rbuffer);
+  req->rbuffer = NULL;
+
+  free(req->buffer);
+  req->buffer = NULL;
+
+  (*req->cb)(req->user_data, req->http, status, message, response);
+
+ /*
+  * Start the next request for this connection, if any...
+  */
+
+  if (!loop)
+    return;
+
+  for (next = (_cups_areq_t *)cupsArrayFirst(loop->requests);
+       next;
+       next = (_cups_areq_t *)cupsArrayNext(loop->requests))
+    if (next->http == req->http && next->state == _CUPS_ASTATE_QUEUED)
+    {
+      cups_async_start(loop, next);
+      break;
+    }
+
+  cupsArrayFind(loop->requests, req);
+}
+
+
+/*
+ * 'cups_async_gets()' - Get a line from the response data.
+ */
+
+static int				/* O - 1 on success, 0 if more data is needed, -1 on error */
+cups_async_gets(_cups_areq_t *req,	/* I - Request */
+                char         *line,	/* I - Line buffer */
+		size_t       linesize)	/* I - Size of line buffer */
+{
+  char		*start,			/* Start of line */
+		*eol;			/* End of line */
+  size_t	len;			/* Length of line */
+
+
+  start = req->rbuffer + req->rpos;
+
+  if (req->rpos >= req->rused ||
+      (eol = memchr(start, '\n', req->rused - req->rpos)) == NULL)
+    return (req->rused - req->rpos > _CUPS_ASYNC_MAX_LINE ? -1 : 0);
+
+  req->rpos += (size_t)(eol - start) + 1;
+
+  if (eol > start && eol[-1] == '\r')
+    eol --;
+
+  if ((len = (size_t)(eol - start)) >= linesize)
+    len = linesize - 1;
+
+  memcpy(line, start, len);
+  line[len] = '\0';
+
+  return (1);
+}
+
+
+/*
+ * 'cups_async_grow()' - Grow a buffer to hold the specified number of bytes.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_async_grow(char   **buffer,	/* IO - Buffer */
+                size_t *bufsize,	/* IO - Size of buffer */
+		size_t bytes)		/* I  - Bytes needed */
+{
+  char		*temp;			/* New buffer */
+  size_t	tempsize;		/* New size */
+
+
+  for (tempsize = *bufsize ? *bufsize : 8192; tempsize < bytes; tempsize *= 2);
+
+  if ((temp = realloc(*buffer, tempsize)) == NULL)
+    return (0);
+
+  *buffer  = temp;
+  *bufsize = tempsize;
+
+  return (1);
+}
+
+
+/*
+ * 'cups_async_handshake()' - Continue negotiating encryption.
+ */
+
+static void
+cups_async_handshake(
+    cups_loop_t  *loop,			/* I - Request loop */
+    _cups_areq_t *req)			/* I - Request */
+{
+#ifdef HAVE_SSL
+  http_t	*http = req->http;	/* Connection */
+  int		blocking = http->blocking,
+					/* Original blocking mode */
+		result;			/* Result of negotiation */
+#  ifdef HAVE_GNUTLS
+  int		wantwrite = 0;		/* Wait for writing? */
+
+
+  req->state = _CUPS_ASTATE_TLS;
+
+ /*
+  * The socket is non-blocking, so don't let the TLS layer wait for data...
+  */
+
+  http->blocking = 1;
+  result         = _httpTLSHandshake(http, &wantwrite);
+  http->blocking = blocking;
+
+  if (!result)
+  {
+    req->events = wantwrite ? POLLOUT : POLLIN;
+    return;
+  }
+
+#  else
+ /*
+  * Other TLS libraries only offer a blocking handshake, so negotiate now,
+  * bounded by the time remaining for the connect...
+  */
+
+  int		wait_value = http->wait_value;
+					/* Original httpWait value */
+
+
+  req->state = _CUPS_ASTATE_TLS;
+
+  fcntl(http->fd, F_SETFL, fcntl(http->fd, F_GETFL) & ~O_NONBLOCK);
+
+  http->wait_value = (int)(req->deadline - cups_async_now());
+  http->blocking   = 0;
+
+  if (http->wait_value <= 0)
+    http->wait_value = 1;
+
+  result = _httpTLSStart(http) ? -1 : 1;
+
+  http->wait_value = wait_value;
+  http->blocking   = blocking;
+
+  if (http->fd >= 0)
+    fcntl(http->fd, F_SETFL, fcntl(http->fd, F_GETFL) | O_NONBLOCK);
+#  endif /* HAVE_GNUTLS */
+
+  if (result < 0)
+  {
+    DEBUG_puts("4cups_async_handshake: Unable to negotiate encryption.");
+
+    cups_async_error(loop, req, http->error);
+    return;
+  }
+#endif /* HAVE_SSL */
+
+  cups_async_ready(loop, req);
+}
+
+
+/*
+ * 'cups_async_io()' - Read or write data without blocking.
+ */
+
+static ssize_t				/* O - Bytes read/written or -1 on error */
+cups_async_io(http_t *http,		/* I - Connection */
+              char   *buffer,		/* I - Buffer */
+	      size_t bytes,		/* I - Number of bytes */
+	      int    write_data)	/* I - 1 to write, 0 to read */
+{
+#ifdef HAVE_SSL
+  if (http->tls)
+  {
+    int		blocking = http->blocking;
+					/* Original blocking mode */
+    int		result;			/* Bytes read/written */
+
+
+   /*
+    * The socket is non-blocking, so don't let the TLS layer wait for data...
+    */
+
+    http->blocking = 1;
+    errno          = 0;
+
+    if (write_data)
+      result = _httpTLSWrite(http, buffer, (int)bytes);
+    else
+      result = _httpTLSRead(http, buffer, (int)bytes);
+
+    http->blocking = blocking;
+
+    return (result);
+  }
+#endif /* HAVE_SSL */
+
+  if (write_data)
+    return (send(http->fd, buffer, bytes, 0));
+  else
+    return (recv(http->fd, buffer, bytes, 0));
+}
+
+
+/*
+ * 'cups_async_is_busy()' - Determine whether a connection has an active
+ *                          request.
+ *
+ * Queued requests do not make a connection busy.
+ */
+
+static int				/* O - 1 if busy, 0 otherwise */
+cups_async_is_busy(cups_loop_t *loop,	/* I - Request loop */
+                   http_t      *http)	/* I - Connection */
+{
+  _cups_areq_t	*req;			/* Current request */
+
+
+  for (req = (_cups_areq_t *)cupsArrayFirst(loop->requests);
+       req;
+       req = (_cups_areq_t *)cupsArrayNext(loop->requests))
+    if (req->http == http && req->state != _CUPS_ASTATE_DONE &&
+        req->state != _CUPS_ASTATE_QUEUED)
+      return (1);
+
+  return (0);
+}
+
+
+/*
+ * 'cups_async_now()' - Return the current time in milliseconds.
+ */
+
+static double				/* O - Current time in milliseconds */
+cups_async_now(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec * 1000.0 + curtime.tv_usec * 0.001);
+}
+
+
+/*
+ * 'cups_async_read()' - Read the HTTP response from the server.
+ */
+
+static void
+cups_async_read(cups_loop_t  *loop,	/* I - Request loop */
+                _cups_areq_t *req)	/* I - Request */
+{
+  http_t	*http = req->http;	/* Connection */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  for (;;)
+  {
+   /*
+    * Discard data that has already been parsed and make room for more...
+    */
+
+    if (req->rpos > 0)
+    {
+      memmove(req->rbuffer, req->rbuffer + req->rpos, req->rused - req->rpos);
+      req->rused -= req->rpos;
+      req->rpos  = 0;
+    }
+
+    if (req->rused >= req->rsize &&
+        !cups_async_grow(&req->rbuffer, &req->rsize, req->rused + 1))
+    {
+      cups_async_disconnect(http);
+      cups_async_finish(loop, req, IPP_STATUS_ERROR_INTERNAL, strerror(errno),
+                        NULL);
+      return;
+    }
+
+    if ((bytes = cups_async_io(http, req->rbuffer + req->rused,
+                               req->rsize - req->rused, 0)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        cups_async_error(loop, req, errno);
+      return;
+    }
+
+    if (bytes == 0)
+      req->eof = 1;
+    else
+      req->rused += (size_t)bytes;
+
+    if (req->state == _CUPS_ASTATE_HEADER)
+      cups_async_read_header(loop, req);
+
+    if (req->state == _CUPS_ASTATE_BODY)
+      cups_async_read_body(loop, req);
+
+    if (req->state != _CUPS_ASTATE_HEADER && req->state != _CUPS_ASTATE_BODY)
+      return;
+
+    if (req->eof)
+      break;
+  }
+
+ /*
+  * The server closed the connection before the response was complete...
+  */
+
+  if (req->state == _CUPS_ASTATE_BODY && !req->chunked && req->remaining < 0)
+  {
+   /*
+    * No Content-Length, the body ends when the connection is closed...
+    */
+
+    cups_async_done(loop, req);
+  }
+  else if (req->state == _CUPS_ASTATE_HEADER && req->reused &&
+           req->status == HTTP_STATUS_NONE && !req->rused)
+  {
+   /*
+    * The server closed the kept-alive connection before reading the
+    * request, try again on a new connection...
+    */
+
+    DEBUG_puts("4cups_async_read: Kept-alive connection closed, reconnecting.");
+
+    cups_async_disconnect(http);
+    cups_async_start(loop, req);
+  }
+  else
+    cups_async_error(loop, req, EPIPE);
+}
+
+
+/*
+ * 'cups_async_read_body()' - Read the HTTP response body.
+ */
+
+static void
+cups_async_read_body(cups_loop_t  *loop,/* I - Request loop */
+                     _cups_areq_t *req)	/* I - Request */
+{
+  char		line[256];		/* Chunk size line */
+  size_t	bytes;			/* Bytes to copy */
+  int		result;			/* Result of line read */
+
+
+  for (;;)
+  {
+    if (!req->chunked && !req->remaining)
+      break;
+
+    if (req->chunked && req->remaining <= 0)
+    {
+     /*
+      * Read the next chunk size (or the trailer after the last chunk)...
+      */
+
+      if ((result = cups_async_gets(req, line, sizeof(line))) < 0)
+      {
+        cups_async_error(loop, req, EIO);
+	return;
+      }
+      else if (!result)
+        return;
+
+      if (req->trailer)
+      {
+        if (!line[0])
+	  break;
+      }
+      else if (line[0])
+      {
+       /*
+        * Blank lines end the previous chunk's data...
+	*/
+
+        if ((req->remaining = strtoll(line, NULL, 16)) <= 0)
+	  req->trailer = 1;
+      }
+
+      continue;
+    }
+
+    if (req->rpos >= req->rused)
+      return;
+
+    bytes = req->rused - req->rpos;
+    if (req->remaining >= 0 && (off_t)bytes > req->remaining)
+      bytes = (size_t)req->remaining;
+
+    if (req->bufused + bytes > req->bufsize &&
+        !cups_async_grow(&req->buffer, &req->bufsize, req->bufused + bytes))
+    {
+      cups_async_disconnect(req->http);
+      cups_async_finish(loop, req, IPP_STATUS_ERROR_INTERNAL, strerror(errno),
+                        NULL);
+      return;
+    }
+
+    memcpy(req->buffer + req->bufused, req->rbuffer + req->rpos, bytes);
+    req->bufused += bytes;
+    req->rpos    += bytes;
+
+    if (req->remaining >= 0)
+      req->remaining -= (off_t)bytes;
+  }
+
+ /*
+  * Got the whole response, send the IPP request after an upgrade or decode
+  * it...
+  */
+
+  if (req->upgrade)
+  {
+    req->upgrade = 0;
+    cups_async_send(loop, req);
+  }
+  else
+    cups_async_done(loop, req);
+}
+
+
+/*
+ * 'cups_async_read_cb()' - Read IPP data from the response buffer.
+ */
+
+static ssize_t				/* O - Bytes read */
+cups_async_read_cb(_cups_areq_t *req,	/* I - Request */
+                   ipp_uchar_t  *buffer,/* O - Buffer */
+		   size_t       bytes)	/* I - Bytes to read */
+{
+  if (bytes > req->bufused - req->bufpos)
+    bytes = req->bufused - req->bufpos;
+
+  memcpy(buffer, req->buffer + req->bufpos, bytes);
+  req->bufpos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'cups_async_read_header()' - Read the HTTP response header.
+ */
+
+static void
+cups_async_read_header(
+    cups_loop_t  *loop,			/* I - Request loop */
+    _cups_areq_t *req)			/* I - Request */
+{
+  char		line[HTTP_MAX_BUFFER],	/* Header line */
+		*value;			/* Field value */
+  int		result;			/* Result of line read */
+  ipp_status_t	ipp_status;		/* IPP status for HTTP error */
+
+
+  for (;;)
+  {
+    if ((result = cups_async_gets(req, line, sizeof(line))) < 0)
+    {
+      cups_async_error(loop, req, EIO);
+      return;
+    }
+    else if (!result)
+      return;
+
+    if (req->status == HTTP_STATUS_NONE)
+    {
+     /*
+      * Status line...
+      */
+
+      if (strncmp(line, "HTTP/", 5) || (value = strchr(line, ' ')) == NULL ||
+          (req->status = (http_status_t)atoi(value + 1)) <= HTTP_STATUS_NONE)
+      {
+        DEBUG_printf(("4cups_async_read_header: Bad status line \"%s\".",
+	              line));
+        cups_async_error(loop, req, EIO);
+	return;
+      }
+
+      req->keep_alive = strncmp(line, "HTTP/1.0 ", 9) != 0;
+      req->chunked    = 0;
+      req->trailer    = 0;
+      req->remaining  = -1;
+    }
+    else if (line[0])
+    {
+     /*
+      * Header field, only the ones that control the body and connection
+      * matter here...
+      */
+
+      if ((value = strchr(line, ':')) == NULL)
+        continue;
+
+      for (*value++ = '\0'; _cups_isspace(*value); value ++);
+
+      if (!_cups_strcasecmp(line, "Content-Length"))
+        req->remaining = strtoll(value, NULL, 10);
+      else if (!_cups_strcasecmp(line, "Transfer-Encoding"))
+        req->chunked = !_cups_strncasecmp(value, "chunked", 7);
+      else if (!_cups_strcasecmp(line, "Connection"))
+      {
+        if (!_cups_strcasecmp(value, "close"))
+	  req->keep_alive = 0;
+	else if (!_cups_strcasecmp(value, "keep-alive"))
+	  req->keep_alive = 1;
+      }
+    }
+    else if (req->status == HTTP_STATUS_CONTINUE)
+    {
+     /*
+      * Ignore "100 Continue" and wait for the real response...
+      */
+
+      req->status = HTTP_STATUS_NONE;
+    }
+    else
+      break;
+  }
+
+  DEBUG_printf(("4cups_async_read_header: status=%d", req->status));
+
+#ifdef HAVE_SSL
+  if (req->upgrade == 1)
+  {
+   /*
+    * Response to an upgrade request, the response to the OPTIONS request
+    * itself follows once encryption has been negotiated...
+    */
+
+    if (req->status == HTTP_STATUS_SWITCHING_PROTOCOLS)
+    {
+      req->upgrade = 2;
+
+      cups_async_handshake(loop, req);
+      return;
+    }
+
+    cups_async_disconnect(req->http);
+    cups_async_finish(loop, req, IPP_STATUS_ERROR_CUPS_PKI,
+                      _cupsLangString(cupsLangDefault(),
+		                      _("Encryption is not supported.")), NULL);
+    return;
+  }
+#endif /* HAVE_SSL */
+
+  if (req->status == HTTP_STATUS_OK || req->upgrade)
+  {
+    req->state   = _CUPS_ASTATE_BODY;
+    req->bufused = 0;
+    req->bufpos  = 0;
+
+    if (req->chunked)
+      req->remaining = 0;
+    return;
+  }
+
+ /*
+  * HTTP error, map it to an IPP status like _cupsSetHTTPError()...
+  */
+
+  switch (req->status)
+  {
+    case HTTP_STATUS_NOT_FOUND :
+        ipp_status = IPP_STATUS_ERROR_NOT_FOUND;
+	break;
+
+    case HTTP_STATUS_UNAUTHORIZED :
+        ipp_status = IPP_STATUS_ERROR_NOT_AUTHENTICATED;
+	break;
+
+    case HTTP_STATUS_FORBIDDEN :
+        ipp_status = IPP_STATUS_ERROR_FORBIDDEN;
+	break;
+
+    case HTTP_STATUS_BAD_REQUEST :
+        ipp_status = IPP_STATUS_ERROR_BAD_REQUEST;
+	break;
+
+    case HTTP_STATUS_REQUEST_TOO_LARGE :
+        ipp_status = IPP_STATUS_ERROR_REQUEST_VALUE;
+	break;
+
+    case HTTP_STATUS_NOT_IMPLEMENTED :
+        ipp_status = IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED;
+	break;
+
+    case HTTP_STATUS_NOT_SUPPORTED :
+        ipp_status = IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED;
+	break;
+
+    default :
+        ipp_status = IPP_STATUS_ERROR_SERVICE_UNAVAILABLE;
+	break;
+  }
+
+  cups_async_disconnect(req->http);
+  cups_async_finish(loop, req, ipp_status, httpStatus(req->status), NULL);
+}
+
+
+/*
+ * 'cups_async_ready()' - Negotiate encryption as needed and send the request.
+ */
+
+static void
+cups_async_ready(cups_loop_t  *loop,	/* I - Request loop */
+                 _cups_areq_t *req)	/* I - Request */
+{
+#ifdef HAVE_SSL
+  http_t	*http = req->http;	/* Connection */
+
+
+  if (!http->tls && http->encryption == HTTP_ENCRYPTION_ALWAYS)
+  {
+    cups_async_handshake(loop, req);
+    return;
+  }
+
+  if (req->upgrade == 2)
+  {
+   /*
+    * Wait for the response to the OPTIONS request...
+    */
+
+    req->state  = _CUPS_ASTATE_HEADER;
+    req->events = POLLIN;
+    req->rused  = 0;
+    req->rpos   = 0;
+    req->status = HTTP_STATUS_NONE;
+    return;
+  }
+
+  req->upgrade = !http->tls && http->encryption == HTTP_ENCRYPTION_REQUIRED;
+#endif /* HAVE_SSL */
+
+  cups_async_send(loop, req);
+}
+
+
+/*
+ * 'cups_async_send()' - Format the request and start sending it.
+ *
+ * When upgrading to TLS an OPTIONS request is sent first, and the IPP request
+ * follows once encryption has been negotiated.
+ */
+
+static void
+cups_async_send(cups_loop_t  *loop,	/* I - Request loop */
+                _cups_areq_t *req)	/* I - Request */
+{
+  http_t	*http = req->http;	/* Connection */
+  char		resource[1024],		/* Encoded resource */
+		line[2048];		/* Header line */
+  int		bad = 0;		/* Unable to buffer the request? */
+  ipp_state_t	state;			/* IPP write state */
+
+
+  DEBUG_printf(("4cups_async_send(loop=%p, req=%p)", loop, req));
+
+  req->wused  = 0;
+  req->wpos   = 0;
+  req->rused  = 0;
+  req->rpos   = 0;
+  req->eof    = 0;
+  req->status = HTTP_STATUS_NONE;
+
+ /*
+  * httpClearFields() sets the Host: value for the connection...
+  */
+
+  httpClearFields(http);
+
+  if (req->upgrade)
+    strlcpy(line, "OPTIONS * HTTP/1.1\r\n", sizeof(line));
+  else
+  {
+    _httpEncodeURI(resource, req->resource, sizeof(resource));
+    snprintf(line, sizeof(line), "POST %s HTTP/1.1\r\n", resource);
+  }
+
+  bad |= cups_async_write_cb(req, (ipp_uchar_t *)line, strlen(line)) < 0;
+
+  snprintf(line, sizeof(line), "Host: %s:%d\r\nUser-Agent: %s\r\n",
+           httpGetField(http, HTTP_FIELD_HOST), httpAddrPort(http->hostaddr),
+	   http->default_user_agent ? http->default_user_agent :
+	                              cupsUserAgent());
+  bad |= cups_async_write_cb(req, (ipp_uchar_t *)line, strlen(line)) < 0;
+
+  if (req->upgrade)
+    strlcpy(line, "Connection: Upgrade\r\nUpgrade: TLS/1.2,TLS/1.1,TLS/1.0\r\n",
+            sizeof(line));
+  else
+    snprintf(line, sizeof(line),
+             "Content-Type: application/ipp\r\nContent-Length: %d\r\n",
+	     (int)ippLength(req->request));
+
+  bad |= cups_async_write_cb(req, (ipp_uchar_t *)line, strlen(line)) < 0;
+
+  if (http->authstring && http->authstring[0] && !req->upgrade)
+  {
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)"Authorization: ", 15) < 0;
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)http->authstring,
+                               strlen(http->authstring)) < 0;
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)"\r\n", 2) < 0;
+  }
+
+  if (http->cookie)
+  {
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)"Cookie: $Version=0; ",
+                               20) < 0;
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)http->cookie,
+                               strlen(http->cookie)) < 0;
+    bad |= cups_async_write_cb(req, (ipp_uchar_t *)"\r\n", 2) < 0;
+  }
+
+  bad |= cups_async_write_cb(req, (ipp_uchar_t *)"\r\n", 2) < 0;
+
+  if (!req->upgrade && !bad)
+  {
+    req->request->state = IPP_STATE_IDLE;
+
+    while ((state = ippWriteIO(req, (ipp_iocb_t)cups_async_write_cb, 1, NULL,
+                               req->request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+      {
+        bad = 1;
+        break;
+      }
+  }
+
+  if (bad)
+  {
+    cups_async_disconnect(http);
+    cups_async_finish(loop, req, IPP_STATUS_ERROR_INTERNAL, strerror(ENOMEM),
+                      NULL);
+    return;
+  }
+
+ /*
+  * Send as much as the socket will take now, the rest as it drains...
+  */
+
+  req->state  = _CUPS_ASTATE_SEND;
+  req->events = POLLOUT;
+
+  cups_async_write(loop, req);
+}
+
+
+/*
+ * 'cups_async_start()' - Start a request, connecting as needed.
+ */
+
+static void
+cups_async_start(cups_loop_t  *loop,	/* I - Request loop */
+                 _cups_areq_t *req)	/* I - Request */
+{
+  http_t	*http = req->http;	/* Connection */
+
+
+  DEBUG_printf(("4cups_async_start(loop=%p, req=%p)", loop, req));
+
+  req->deadline = cups_async_now() + req->msec;
+  req->reused   = 0;
+  req->upgrade  = 0;
+
+ /*
+  * Reuse a kept-alive connection unless the server has closed it...
+  */
+
+  if (http->fd >= 0)
+  {
+    if (http->state != HTTP_STATE_WAITING || httpCheck(http))
+    {
+      DEBUG_puts("5cups_async_start: Connection is stale, reconnecting.");
+      cups_async_disconnect(http);
+    }
+    else
+    {
+      fcntl(http->fd, F_SETFL, fcntl(http->fd, F_GETFL) | O_NONBLOCK);
+
+      req->reused = 1;
+      cups_async_ready(loop, req);
+      return;
+    }
+  }
+
+  req->addr = http->addrlist;
+
+  cups_async_connect(req);
+
+  if (req->state == _CUPS_ASTATE_DONE)
+    cups_async_finish(loop, req, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE,
+                      strerror(http->error ? http->error : ENETUNREACH), NULL);
+}
+
+
+/*
+ * 'cups_async_write()' - Send buffered request data to the server.
+ */
+
+static void
+cups_async_write(cups_loop_t  *loop,	/* I - Request loop */
+                 _cups_areq_t *req)	/* I - Request */
+{
+  ssize_t	bytes;			/* Bytes written */
+
+
+  while (req->wpos < req->wused)
+  {
+    if ((bytes = cups_async_io(req->http, req->wbuffer + req->wpos,
+                               req->wused - req->wpos, 1)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        cups_async_error(loop, req, errno);
+      return;
+    }
+
+    req->wpos += (size_t)bytes;
+  }
+
+ /*
+  * Wait for the response...
+  */
+
+  req->state    = _CUPS_ASTATE_HEADER;
+  req->events   = POLLIN;
+  req->deadline = cups_async_now() + req->msec;
+}
+
+
+/*
+ * 'cups_async_write_cb()' - Add data to the request buffer.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+cups_async_write_cb(_cups_areq_t *req,	/* I - Request */
+                    ipp_uchar_t  *buffer,
+					/* I - Buffer */
+		    size_t       bytes)	/* I - Bytes to write */
+{
+  if (req->wused + bytes > req->wsize &&
+      !cups_async_grow(&req->wbuffer, &req->wsize, req->wused + bytes))
+    return (-1);
+
+  memcpy(req->wbuffer + req->wused, buffer, bytes);
+  req->wused += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * End of "$Id$".
+ */
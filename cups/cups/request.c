@@ -1012,12 +1012,14 @@ _cupsConnect(void)
     */
 
     if (strcmp(cg->http->hostname, cg->server) ||
-        cg->ipp_port != httpAddrPort(cg->http->hostaddr) ||
+        cg->ipp_port != cg->http->port ||
         (cg->http->encryption != cg->encryption &&
 	 cg->http->encryption == HTTP_ENCRYPTION_NEVER))
     {
      /*
-      * Need to close the current connection because something has changed...
+      * Need to switch connections because something has changed; the
+      * current connection goes back to the pool so that we can use it again
+      * when switching back...
       */
 
       httpClose(cg->http);
@@ -1056,7 +1058,9 @@ _cupsConnect(void)
 
   if (!cg->http)
   {
-    if ((cg->http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC,
+    if ((cg->http = _httpPoolGet(cupsServer(), ippPort(), cupsEncryption(),
+                                 cg->tls_credentials)) == NULL &&
+        (cg->http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC,
 				 cupsEncryption(), 1, 30000, NULL)) == NULL)
     {
       if (errno)
@@ -1065,6 +1069,9 @@ _cupsConnect(void)
         _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE,
 	              _("Unable to connect to host."), 1);
     }
+
+    if (cg->http)
+      cg->http->pool = 1;
   }
 
  /*
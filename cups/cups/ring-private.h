@@ -0,0 +1,64 @@
+/*
+ * "$Id$"
+ *
+ * Private shared memory ring buffer definitions for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+#ifndef _CUPS_RING_PRIVATE_H_
+#  define _CUPS_RING_PRIVATE_H_
+
+/*
+ * Include necessary headers...
+ */
+
+#  include "config.h"
+#  include <sys/types.h>
+
+
+/*
+ * C++ magic...
+ */
+
+#  ifdef __cplusplus
+extern "C" {
+#  endif /* __cplusplus */
+
+
+/*
+ * Types and structures...
+ */
+
+typedef struct _cups_ring_s _cups_ring_t;
+					/**** Shared memory ring buffer ****/
+
+
+/*
+ * Prototypes...
+ */
+
+extern int		_cupsRingCreate(size_t size, int fds[2]);
+extern _cups_ring_t	*_cupsRingOpen(int fd, int mode);
+extern ssize_t		_cupsRingRead(void *ring, char *buffer, size_t bytes);
+extern ssize_t		_cupsRingWrite(void *ring, char *buffer,
+			               size_t bytes);
+
+
+#  ifdef __cplusplus
+}
+#  endif /* __cplusplus */
+
+#endif /* !_CUPS_RING_PRIVATE_H_ */
+
+/*
+ * End of "$Id$".
+ */
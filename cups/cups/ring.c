@@ -0,0 +1,564 @@
+/*
+ * "$Id$"
+ *
+ * Shared memory ring buffer functions for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ *
+ * A ring is a sealed memory file that the scheduler creates in place of a
+ * pipe between two filters.  The same file is passed as stdout of one filter
+ * and stdin of the next; cupsFileStdin, cupsFileStdout, and cupsRasterOpen
+ * recognize it and move data through the shared mapping instead of the
+ * kernel.  Each side is a separate open file description holding a lock on
+ * its own byte of the file, so the other side can tell when every process
+ * using it has gone away, just like a pipe.  Waiting is done with futexes on
+ * the shared header.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include "ring-private.h"
+#include <sys/stat.h>
+#ifdef __linux
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
+#  include <limits.h>
+#  if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS) && \
+      defined(F_OFD_SETLK) && defined(SYS_futex)
+#    define HAVE_CUPS_RING 1
+#  endif /* MFD_ALLOW_SEALING && F_ADD_SEALS && F_OFD_SETLK && SYS_futex */
+#endif /* __linux */
+
+
+#ifdef HAVE_CUPS_RING
+/*
+ * Local constants...
+ */
+
+#  define _CUPS_RING_MAGIC	"CUPSRNG1"
+					/* Magic string at start of header */
+#  define _CUPS_RING_HEADER	4096	/* Size of header */
+#  define _CUPS_RING_MIN	65536	/* Minimum size of data area */
+#  define _CUPS_RING_WAIT	250	/* Milliseconds between liveness checks */
+
+#  define _CUPS_RING_UNUSED	0	/* Side has not opened the ring yet */
+#  define _CUPS_RING_OPEN	1	/* Side has the ring open */
+#  define _CUPS_RING_CLOSED	2	/* Side has closed the ring */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _cups_ring_hdr_s		/**** Shared ring header ****/
+{
+  char		magic[8];		/* _CUPS_RING_MAGIC */
+  size_t	size;			/* Size of data area */
+  int		writer,			/* Writer state */
+		reader;			/* Reader state */
+  size_t	head,			/* Total bytes written */
+		tail;			/* Total bytes read */
+  int		data_seq,		/* Futex: data was added */
+		space_seq,		/* Futex: data was consumed */
+		reader_waiting,		/* Reader is waiting for data? */
+		writer_waiting;		/* Writer is waiting for space? */
+} _cups_ring_hdr_t;
+
+struct _cups_ring_s			/**** Open ring ****/
+{
+  int			fd,		/* Ring file descriptor */
+			mode;		/* 'r' or 'w' */
+  _cups_ring_hdr_t	*hdr;		/* Shared header */
+  char			*data;		/* Shared data area */
+  size_t		length;		/* Length of mapping */
+};
+
+
+/*
+ * Local functions...
+ */
+
+static int	ring_alive(_cups_ring_t *ring);
+static void	ring_close(_cups_ring_t *ring);
+static int	ring_lock(int fd, int mode);
+static int	ring_wait(int *seq, int *waiting, size_t *value,
+		          size_t current);
+static void	ring_wake(int *seq);
+#endif /* HAVE_CUPS_RING */
+
+
+/*
+ * '_cupsRingCreate()' - Create a new ring.
+ *
+ * Like pipe(), "fds[0]" is the reading side and "fds[1]" the writing side.
+ * Both are close-on-exec.  Returns -1 if rings are not supported on this
+ * platform.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_cupsRingCreate(size_t size,		/* I - Size of data area */
+                int    fds[2])		/* O - Reading and writing sides */
+{
+#ifdef HAVE_CUPS_RING
+  int			fd;		/* Ring file descriptor */
+  char			path[256];	/* Path to ring file descriptor */
+  _cups_ring_hdr_t	*hdr;		/* Shared header */
+  long			pagesize;	/* Page size */
+
+
+  DEBUG_printf(("_cupsRingCreate(size=" CUPS_LLFMT ", fds=%p)",
+                CUPS_LLCAST size, fds));
+
+  if (size < _CUPS_RING_MIN)
+    size = _CUPS_RING_MIN;
+
+  if ((pagesize = sysconf(_SC_PAGESIZE)) > 0)
+    size = (size + (size_t)pagesize - 1) / (size_t)pagesize * (size_t)pagesize;
+
+  if ((fd = memfd_create("cups-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+    return (-1);
+
+  if (ftruncate(fd, (off_t)(_CUPS_RING_HEADER + size)))
+  {
+    close(fd);
+    return (-1);
+  }
+
+  if ((hdr = mmap(NULL, _CUPS_RING_HEADER, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0)) == MAP_FAILED)
+  {
+    close(fd);
+    return (-1);
+  }
+
+  memcpy(hdr->magic, _CUPS_RING_MAGIC, sizeof(hdr->magic));
+  hdr->size = size;
+
+  munmap(hdr, _CUPS_RING_HEADER);
+
+ /*
+  * Seal the size so that the ring can be recognized and cannot be truncated
+  * out from under the mapping...
+  */
+
+  if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL))
+  {
+    close(fd);
+    return (-1);
+  }
+
+ /*
+  * Reopen the file to get a second open file description for the reading
+  * side, then lock each side's byte.  The locks belong to the descriptions,
+  * so they stay held until every process with that side open has closed it
+  * or exited...
+  */
+
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+  if ((fds[0] = open(path, O_RDWR | O_CLOEXEC)) < 0)
+  {
+    close(fd);
+    return (-1);
+  }
+
+  fds[1] = fd;
+
+  if (ring_lock(fds[0], 'r') || ring_lock(fds[1], 'w'))
+  {
+    close(fds[0]);
+    close(fds[1]);
+    return (-1);
+  }
+
+  return (0);
+
+#else
+  (void)size;
+  (void)fds;
+
+  errno = ENOSYS;
+  return (-1);
+#endif /* HAVE_CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingOpen()' - Open one side of a ring.
+ *
+ * Returns @code NULL@ if the file descriptor is not a ring.
+ */
+
+_cups_ring_t *				/* O - Ring or @code NULL@ */
+_cupsRingOpen(int fd,			/* I - File descriptor */
+              int mode)			/* I - 'r' to read, 'w' to write */
+{
+#ifdef HAVE_CUPS_RING
+  struct stat		fileinfo;	/* File information */
+  int			seals;		/* File seals */
+  _cups_ring_hdr_t	*hdr;		/* Shared header */
+  _cups_ring_t		*ring;		/* Ring */
+
+
+  if (fstat(fd, &fileinfo) || !S_ISREG(fileinfo.st_mode) ||
+      fileinfo.st_size <= _CUPS_RING_HEADER)
+    return (NULL);
+
+  if ((seals = fcntl(fd, F_GET_SEALS)) < 0 ||
+      (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW))
+    return (NULL);
+
+  if ((hdr = mmap(NULL, (size_t)fileinfo.st_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0)) == MAP_FAILED)
+    return (NULL);
+
+  if (memcmp(hdr->magic, _CUPS_RING_MAGIC, sizeof(hdr->magic)) ||
+      hdr->size != (size_t)fileinfo.st_size - _CUPS_RING_HEADER)
+  {
+    munmap(hdr, (size_t)fileinfo.st_size);
+    return (NULL);
+  }
+
+  if ((ring = calloc(1, sizeof(_cups_ring_t))) == NULL)
+  {
+    munmap(hdr, (size_t)fileinfo.st_size);
+    return (NULL);
+  }
+
+  ring->fd     = fd;
+  ring->mode   = mode;
+  ring->hdr    = hdr;
+  ring->data   = (char *)hdr + _CUPS_RING_HEADER;
+  ring->length = (size_t)fileinfo.st_size;
+
+  __atomic_store_n(mode == 'w' ? &hdr->writer : &hdr->reader, _CUPS_RING_OPEN,
+                   __ATOMIC_SEQ_CST);
+
+  ring_wake(&hdr->data_seq);
+  ring_wake(&hdr->space_seq);
+
+  DEBUG_printf(("1_cupsRingOpen: Opened %c side of %d byte ring on fd %d.",
+                mode, (int)hdr->size, fd));
+
+  return (ring);
+
+#else
+  (void)fd;
+  (void)mode;
+
+  return (NULL);
+#endif /* HAVE_CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingRead()' - Read data from a ring.
+ *
+ * Returns 0 once the writer has closed the ring (or exited) and all data has
+ * been read.  A @code NULL@ buffer closes the ring.
+ */
+
+ssize_t					/* O - Bytes read, 0 on EOF, -1 on error */
+_cupsRingRead(void   *ctx,		/* I - Ring */
+              char   *buffer,		/* I - Buffer */
+	      size_t bytes)		/* I - Size of buffer */
+{
+#ifdef HAVE_CUPS_RING
+  _cups_ring_t		*ring = (_cups_ring_t *)ctx;
+					/* Ring */
+  _cups_ring_hdr_t	*hdr = ring->hdr;
+					/* Shared header */
+  size_t		head,		/* Bytes written */
+			tail,		/* Bytes read */
+			count,		/* Bytes to copy */
+			offset;		/* Offset in data area */
+  int			writer;		/* Writer state */
+
+
+  if (!buffer)
+  {
+    ring_close(ring);
+    return (0);
+  }
+
+  tail = hdr->tail;
+
+  while ((head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE)) == tail)
+  {
+   /*
+    * No data; stop if the writer is gone, otherwise wait...
+    */
+
+    writer = __atomic_load_n(&hdr->writer, __ATOMIC_SEQ_CST);
+
+    if (writer == _CUPS_RING_CLOSED)
+    {
+      if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) == tail)
+        return (0);
+      else
+        continue;
+    }
+
+    if (!ring_wait(&hdr->data_seq, &hdr->reader_waiting, &hdr->head, tail) &&
+        !ring_alive(ring) &&
+        __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) == tail)
+      return (0);
+  }
+
+  if ((count = head - tail) > bytes)
+    count = bytes;
+
+  offset = tail % hdr->size;
+
+  if (offset + count > hdr->size)
+  {
+    memcpy(buffer, ring->data + offset, hdr->size - offset);
+    memcpy(buffer + hdr->size - offset, ring->data,
+           count - (hdr->size - offset));
+  }
+  else
+    memcpy(buffer, ring->data + offset, count);
+
+  __atomic_store_n(&hdr->tail, tail + count, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&hdr->space_seq, 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(&hdr->writer_waiting, __ATOMIC_SEQ_CST))
+    ring_wake(&hdr->space_seq);
+
+  return ((ssize_t)count);
+
+#else
+  (void)ctx;
+  (void)buffer;
+  (void)bytes;
+
+  errno = ENOSYS;
+  return (-1);
+#endif /* HAVE_CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingWrite()' - Write data to a ring.
+ *
+ * Waits for space as needed and fails with EPIPE once the reader has closed
+ * the ring (or exited).  A @code NULL@ buffer closes the ring.
+ */
+
+ssize_t					/* O - Bytes written or -1 on error */
+_cupsRingWrite(void   *ctx,		/* I - Ring */
+               char   *buffer,		/* I - Buffer */
+	       size_t bytes)		/* I - Number of bytes */
+{
+#ifdef HAVE_CUPS_RING
+  _cups_ring_t		*ring = (_cups_ring_t *)ctx;
+					/* Ring */
+  _cups_ring_hdr_t	*hdr = ring->hdr;
+					/* Shared header */
+  size_t		head,		/* Bytes written */
+			tail,		/* Bytes read */
+			count,		/* Bytes to copy */
+			offset;		/* Offset in data area */
+  int			reader;		/* Reader state */
+
+
+  if (!buffer)
+  {
+    ring_close(ring);
+    return (0);
+  }
+
+  head = hdr->head;
+
+  for (;;)
+  {
+    reader = __atomic_load_n(&hdr->reader, __ATOMIC_SEQ_CST);
+
+    if (reader == _CUPS_RING_CLOSED)
+    {
+      errno = EPIPE;
+      return (-1);
+    }
+
+    if ((tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE)) + hdr->size !=
+            head)
+      break;
+
+   /*
+    * Ring is full; wait for the reader...
+    */
+
+    if (!ring_wait(&hdr->space_seq, &hdr->writer_waiting, &hdr->tail, tail) &&
+        !ring_alive(ring) &&
+        __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE) == tail)
+    {
+      errno = EPIPE;
+      return (-1);
+    }
+  }
+
+  if ((count = hdr->size - (head - tail)) > bytes)
+    count = bytes;
+
+  offset = head % hdr->size;
+
+  if (offset + count > hdr->size)
+  {
+    memcpy(ring->data + offset, buffer, hdr->size - offset);
+    memcpy(ring->data, buffer + hdr->size - offset,
+           count - (hdr->size - offset));
+  }
+  else
+    memcpy(ring->data + offset, buffer, count);
+
+  __atomic_store_n(&hdr->head, head + count, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&hdr->data_seq, 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(&hdr->reader_waiting, __ATOMIC_SEQ_CST))
+    ring_wake(&hdr->data_seq);
+
+  return ((ssize_t)count);
+
+#else
+  (void)ctx;
+  (void)buffer;
+  (void)bytes;
+
+  errno = ENOSYS;
+  return (-1);
+#endif /* HAVE_CUPS_RING */
+}
+
+
+#ifdef HAVE_CUPS_RING
+/*
+ * 'ring_alive()' - See whether any process still has the other side open.
+ */
+
+static int				/* O - 1 if alive, 0 if gone */
+ring_alive(_cups_ring_t *ring)		/* I - Ring */
+{
+  struct flock	lock;			/* Other side's lock */
+
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start  = ring->mode == 'w' ? 1 : 0;
+  lock.l_len    = 1;
+
+  if (fcntl(ring->fd, F_OFD_GETLK, &lock))
+    return (1);
+
+  return (lock.l_type != F_UNLCK);
+}
+
+
+/*
+ * 'ring_close()' - Close our side of a ring.
+ */
+
+static void
+ring_close(_cups_ring_t *ring)		/* I - Ring */
+{
+  _cups_ring_hdr_t	*hdr = ring->hdr;
+					/* Shared header */
+
+
+  __atomic_store_n(ring->mode == 'w' ? &hdr->writer : &hdr->reader,
+                   _CUPS_RING_CLOSED, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&hdr->data_seq, 1, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&hdr->space_seq, 1, __ATOMIC_SEQ_CST);
+
+  ring_wake(&hdr->data_seq);
+  ring_wake(&hdr->space_seq);
+
+  munmap(hdr, ring->length);
+  free(ring);
+}
+
+
+/*
+ * 'ring_lock()' - Lock one side's byte of a ring.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+ring_lock(int fd,			/* I - Ring file descriptor */
+          int mode)			/* I - 'r' or 'w' */
+{
+  struct flock	lock;			/* Side lock */
+
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start  = mode == 'w' ? 0 : 1;
+  lock.l_len    = 1;
+
+  return (fcntl(fd, F_OFD_SETLK, &lock));
+}
+
+
+/*
+ * 'ring_wait()' - Wait for the other side of a ring.
+ *
+ * Returns 0 if the wait timed out so the caller can check whether the other
+ * side is still alive.
+ */
+
+static int				/* O - 1 if woken, 0 on timeout */
+ring_wait(int    *seq,			/* I - Futex to wait on */
+          int    *waiting,		/* I - Waiting flag */
+	  size_t *value,		/* I - Counter being waited on */
+	  size_t current)		/* I - Current value of counter */
+{
+  int			curseq;		/* Current sequence number */
+  struct timespec	timeout;	/* Timeout */
+  long			status = 0;	/* Status of wait */
+
+
+  curseq = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+
+  __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(value, __ATOMIC_SEQ_CST) == current)
+  {
+    timeout.tv_sec  = 0;
+    timeout.tv_nsec = _CUPS_RING_WAIT * 1000000L;
+
+    status = syscall(SYS_futex, seq, FUTEX_WAIT, curseq, &timeout, NULL, 0);
+  }
+
+  __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+
+  return (status == 0 || errno != ETIMEDOUT);
+}
+
+
+/*
+ * 'ring_wake()' - Wake any process waiting on a ring futex.
+ */
+
+static void
+ring_wake(int *seq)			/* I - Futex */
+{
+  syscall(SYS_futex, seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+#endif /* HAVE_CUPS_RING */
+
+
+/*
+ * End of "$Id$".
+ */
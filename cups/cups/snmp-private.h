@@ -36,6 +36,7 @@
 #define CUPS_SNMP_MAX_PACKET	1472	/* Maximum size of SNMP packet */
 #define CUPS_SNMP_MAX_STRING	1024	/* Maximum size of string */
 #define CUPS_SNMP_VERSION_1	0	/* SNMPv1 */
+#define CUPS_SNMP_VERSION_2C	1	/* SNMPv2c */
 
 
 /*
@@ -56,9 +57,13 @@ enum cups_asn1_e			/**** ASN1 request/object types ****/
   CUPS_ASN1_COUNTER = 0x41,		/* 32-bit unsigned aka Counter32 */
   CUPS_ASN1_GAUGE = 0x42,		/* 32-bit unsigned aka Gauge32 */
   CUPS_ASN1_TIMETICKS = 0x43,		/* 32-bit unsigned aka Timeticks32 */
+  CUPS_ASN1_NO_SUCH_OBJECT = 0x80,	/* noSuchObject exception (SNMPv2c) */
+  CUPS_ASN1_NO_SUCH_INSTANCE = 0x81,	/* noSuchInstance exception (SNMPv2c) */
+  CUPS_ASN1_END_OF_MIB_VIEW = 0x82,	/* endOfMibView exception (SNMPv2c) */
   CUPS_ASN1_GET_REQUEST = 0xa0,		/* GetRequest-PDU */
   CUPS_ASN1_GET_NEXT_REQUEST = 0xa1,	/* GetNextRequest-PDU */
-  CUPS_ASN1_GET_RESPONSE = 0xa2		/* GetResponse-PDU */
+  CUPS_ASN1_GET_RESPONSE = 0xa2,	/* GetResponse-PDU */
+  CUPS_ASN1_GET_BULK_REQUEST = 0xa5	/* GetBulkRequest-PDU (SNMPv2c) */
 };
 typedef enum cups_asn1_e cups_asn1_t;	/**** ASN1 request/object types ****/
 
@@ -108,10 +113,21 @@ typedef void (*cups_snmp_cb_t)(cups_snmp_t *packet, void *data);
 extern "C" {
 #  endif /* __cplusplus */
 
+extern int		_cupsSNMPBulkWalk(int fd, http_addr_t *address,
+			                  const char *community,
+					  const int *prefix,
+					  int max_repetitions, double timeout,
+					  cups_snmp_cb_t cb, void *data)
+					  _CUPS_API_2_1;
 extern void		_cupsSNMPClose(int fd) _CUPS_API_1_4;
 extern int		*_cupsSNMPCopyOID(int *dst, const int *src, int dstsize)
 			    _CUPS_API_1_4;
 extern const char	*_cupsSNMPDefaultCommunity(void) _CUPS_API_1_4;
+extern int		_cupsSNMPGet(int fd, http_addr_t *address, int version,
+			             const char *community, int num_oids,
+				     const int * const *oids, double timeout,
+				     cups_snmp_cb_t cb, void *data)
+				     _CUPS_API_2_1;
 extern int		_cupsSNMPIsOID(cups_snmp_t *packet, const int *oid)
 			    _CUPS_API_1_4;
 extern int		_cupsSNMPIsOIDPrefixed(cups_snmp_t *packet,
@@ -121,6 +137,9 @@ extern char		*_cupsSNMPOIDToString(const int *src, char *dst,
 extern int		_cupsSNMPOpen(int family) _CUPS_API_1_4;
 extern cups_snmp_t	*_cupsSNMPRead(int fd, cups_snmp_t *packet,
 			               double timeout) _CUPS_API_1_4;
+extern cups_snmp_t	*_cupsSNMPReadOIDs(int fd, cups_snmp_t *packet,
+			                   double timeout, cups_snmp_cb_t cb,
+					   void *data) _CUPS_API_2_1;
 extern void		_cupsSNMPSetDebug(int level) _CUPS_API_1_4;
 extern int		*_cupsSNMPStringToOID(const char *src,
 			                      int *dst, int dstsize)
@@ -134,6 +153,14 @@ extern int		_cupsSNMPWrite(int fd, http_addr_t *address, int version,
 				       cups_asn1_t request_type,
 				       const unsigned request_id,
 				       const int *oid) _CUPS_API_1_4;
+extern int		_cupsSNMPWriteOIDs(int fd, http_addr_t *address,
+			                   int version, const char *community,
+					   cups_asn1_t request_type,
+					   const unsigned request_id,
+					   int non_repeaters,
+					   int max_repetitions, int num_oids,
+					   const int * const *oids)
+					   _CUPS_API_2_1;
 
 #  ifdef __cplusplus
 }
@@ -26,6 +26,23 @@
 #endif /* HAVE_POLL */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_snmp_walk_s	/**** Walk/get state ****/
+{
+  const int		*prefix;	/* OID prefix or NULL for get */
+  int			lastoid[CUPS_SNMP_MAX_OID];
+					/* Last OID we got */
+  int			count,		/* Number of OIDs found */
+			found,		/* Number of OIDs in this response */
+			done;		/* Non-zero when the walk is done */
+  cups_snmp_cb_t	cb;		/* Function to call for each OID */
+  void			*data;		/* User data pointer */
+} _cups_snmp_walk_t;
+
+
 /*
  * Local functions...
  */
@@ -33,9 +50,14 @@
 static void		asn1_debug(const char *prefix, unsigned char *buffer,
 			           size_t len, int indent);
 static int		asn1_decode_snmp(unsigned char *buffer, size_t len,
-			                 cups_snmp_t *packet);
+			                 cups_snmp_t *packet,
+					 cups_snmp_cb_t cb, void *data);
+static int		asn1_decode_varbind(unsigned char **buffer,
+			                    unsigned char *bufend,
+					    cups_snmp_t *packet);
 static int		asn1_encode_snmp(unsigned char *buffer, size_t len,
-			                 cups_snmp_t *packet);
+			                 cups_snmp_t *packet, int num_oids,
+					 const int * const *oids);
 static int		asn1_get_integer(unsigned char **buffer,
 			                 unsigned char *bufend,
 			                 unsigned length);
@@ -64,8 +86,117 @@ static unsigned		asn1_size_integer(int integer);
 static unsigned		asn1_size_length(unsigned length);
 static unsigned		asn1_size_oid(const int *oid);
 static unsigned		asn1_size_packed(int integer);
+static void		snmp_get_cb(cups_snmp_t *packet, void *data);
 static void		snmp_set_error(cups_snmp_t *packet,
 			               const char *message);
+static void		snmp_walk_cb(cups_snmp_t *packet, void *data);
+
+
+/*
+ * '_cupsSNMPBulkWalk()' - Enumerate a group of OIDs using GetBulkRequest.
+ *
+ * This function works like @code _cupsSNMPWalk@ but uses SNMPv2c
+ * GetBulkRequest-PDUs so that up to "max_repetitions" OIDs are returned in
+ * each response.  Devices that only support SNMPv1 do not respond, so
+ * callers should fall back to @code _cupsSNMPWalk@ when -1 is returned.
+ *
+ * The array pointed to by "prefix" is terminated by the value -1.
+ *
+ * If "timeout" is negative, @code _cupsSNMPBulkWalk@ will wait for a response
+ * indefinitely.
+ */
+
+int					/* O - Number of OIDs found or -1 on error */
+_cupsSNMPBulkWalk(
+    int            fd,			/* I - SNMP socket */
+    http_addr_t    *address,		/* I - Address to query */
+    const char     *community,		/* I - Community name */
+    const int      *prefix,		/* I - OID prefix */
+    int            max_repetitions,	/* I - Maximum OIDs in each response */
+    double         timeout,		/* I - Timeout for each response in seconds */
+    cups_snmp_cb_t cb,			/* I - Function to call for each response */
+    void           *data)		/* I - User data pointer that is passed to the callback function */
+{
+  unsigned		request_id = 0;	/* Current request ID */
+  cups_snmp_t		packet;		/* Current response packet */
+  _cups_snmp_walk_t	walk;		/* Walk state */
+  const int		*oid;		/* OID to continue from */
+
+
+ /*
+  * Range check input...
+  */
+
+  DEBUG_printf(("4_cupsSNMPBulkWalk(fd=%d, address=%p, community=\"%s\", "
+                "prefix=%p, max_repetitions=%d, timeout=%.1f, cb=%p, "
+		"data=%p)", fd, address, community, prefix, max_repetitions,
+		timeout, cb, data));
+
+  if (fd < 0 || !address || !community || !prefix || max_repetitions < 1 ||
+      !cb)
+  {
+    DEBUG_puts("5_cupsSNMPBulkWalk: Returning -1");
+
+    return (-1);
+  }
+
+ /*
+  * Loop until we have no more OIDs...
+  */
+
+  memset(&walk, 0, sizeof(walk));
+  walk.prefix     = prefix;
+  walk.lastoid[0] = -1;
+  walk.cb         = cb;
+  walk.data       = data;
+
+  for (oid = prefix; !walk.done;)
+  {
+    request_id ++;
+
+    if (!_cupsSNMPWriteOIDs(fd, address, CUPS_SNMP_VERSION_2C, community,
+                            CUPS_ASN1_GET_BULK_REQUEST, request_id, 0,
+			    max_repetitions, 1, &oid))
+    {
+      DEBUG_puts("5_cupsSNMPBulkWalk: Returning -1");
+
+      return (-1);
+    }
+
+    walk.found = 0;
+
+    if (!_cupsSNMPReadOIDs(fd, &packet, timeout, snmp_walk_cb, &walk))
+    {
+      DEBUG_puts("5_cupsSNMPBulkWalk: Returning -1");
+
+      return (-1);
+    }
+
+   /*
+    * A response that was truncated still gives us a place to continue
+    * from...
+    */
+
+    if (!walk.found)
+    {
+      if (packet.error || packet.error_status)
+      {
+	DEBUG_printf(("5_cupsSNMPBulkWalk: Returning %d",
+	              walk.count > 0 ? walk.count : -1));
+
+	return (walk.count > 0 ? walk.count : -1);
+      }
+
+      break;
+    }
+
+    oid = walk.lastoid;
+  }
+
+  DEBUG_printf(("5_cupsSNMPBulkWalk: Returning %d", walk.count));
+
+  return (walk.count);
+}
 
 
 /*
@@ -152,6 +283,81 @@ _cupsSNMPDefaultCommunity(void)
 }
 
 
+/*
+ * '_cupsSNMPGet()' - Get the values of several OIDs with a single request.
+ *
+ * The "cb" function is called for each value that is returned.  SNMPv1
+ * devices do not return any values when one of the OIDs is not supported,
+ * while SNMPv2c devices just skip the unsupported OIDs.
+ *
+ * Each array pointed to by "oids" is terminated by the value -1.
+ *
+ * If "timeout" is negative, @code _cupsSNMPGet@ will wait for a response
+ * indefinitely.
+ */
+
+int					/* O - Number of values or -1 on error */
+_cupsSNMPGet(int            fd,		/* I - SNMP socket */
+             http_addr_t    *address,	/* I - Address to query */
+	     int            version,	/* I - SNMP version */
+	     const char     *community,	/* I - Community name */
+	     int            num_oids,	/* I - Number of OIDs */
+	     const int      * const *oids,
+					/* I - OIDs to get */
+	     double         timeout,	/* I - Timeout in seconds */
+	     cups_snmp_cb_t cb,		/* I - Function to call for each value */
+	     void           *data)	/* I - User data pointer that is passed to the callback function */
+{
+  cups_snmp_t		packet;		/* Response packet */
+  _cups_snmp_walk_t	get;		/* Get state */
+
+
+ /*
+  * Range check input...
+  */
+
+  DEBUG_printf(("4_cupsSNMPGet(fd=%d, address=%p, version=%d, "
+                "community=\"%s\", num_oids=%d, oids=%p, timeout=%.1f, "
+		"cb=%p, data=%p)", fd, address, version, community, num_oids,
+		oids, timeout, cb, data));
+
+  if (!cb)
+  {
+    DEBUG_puts("5_cupsSNMPGet: Returning -1");
+
+    return (-1);
+  }
+
+ /*
+  * Send the request and wait for the response...
+  */
+
+  if (!_cupsSNMPWriteOIDs(fd, address, version, community,
+                          CUPS_ASN1_GET_REQUEST, 1, 0, 0, num_oids, oids))
+  {
+    DEBUG_puts("5_cupsSNMPGet: Returning -1");
+
+    return (-1);
+  }
+
+  memset(&get, 0, sizeof(get));
+  get.cb   = cb;
+  get.data = data;
+
+  if (!_cupsSNMPReadOIDs(fd, &packet, timeout, snmp_get_cb, &get) ||
+      (!get.count && (packet.error || packet.error_status)))
+  {
+    DEBUG_puts("5_cupsSNMPGet: Returning -1");
+
+    return (-1);
+  }
+
+  DEBUG_printf(("5_cupsSNMPGet: Returning %d", get.count));
+
+  return (get.count);
+}
+
+
 /*
  * '_cupsSNMPIsOID()' - Test whether a SNMP response contains the specified OID.
  *
@@ -345,6 +551,32 @@ cups_snmp_t *				/* O - SNMP packet or @code NULL@ if none */
 _cupsSNMPRead(int         fd,		/* I - SNMP socket file descriptor */
               cups_snmp_t *packet,	/* I - SNMP packet buffer */
 	      double      timeout)	/* I - Timeout in seconds */
+{
+  DEBUG_printf(("4_cupsSNMPRead(fd=%d, packet=%p, timeout=%.1f)", fd, packet,
+                timeout));
+
+  return (_cupsSNMPReadOIDs(fd, packet, timeout, NULL, NULL));
+}
+
+
+/*
+ * '_cupsSNMPReadOIDs()' - Read and parse a SNMP response with several values.
+ *
+ * The "cb" function is called for each value in the response, with "packet"
+ * holding the response header and the current value.  If "cb" is
+ * @code NULL@, only the first value is decoded.
+ *
+ * If "timeout" is negative, @code _cupsSNMPReadOIDs@ will wait for a
+ * response indefinitely.
+ */
+
+cups_snmp_t *				/* O - SNMP packet or @code NULL@ if none */
+_cupsSNMPReadOIDs(
+    int            fd,			/* I - SNMP socket file descriptor */
+    cups_snmp_t    *packet,		/* I - SNMP packet buffer */
+    double         timeout,		/* I - Timeout in seconds */
+    cups_snmp_cb_t cb,			/* I - Function to call for each value or @code NULL@ */
+    void           *data)		/* I - User data pointer that is passed to the callback function */
 {
   unsigned char	buffer[CUPS_SNMP_MAX_PACKET];
 					/* Data packet */
@@ -357,12 +589,12 @@ _cupsSNMPRead(int         fd,		/* I - SNMP socket file descriptor */
   * Range check input...
   */
 
-  DEBUG_printf(("4_cupsSNMPRead(fd=%d, packet=%p, timeout=%.1f)", fd, packet,
-                timeout));
+  DEBUG_printf(("4_cupsSNMPReadOIDs(fd=%d, packet=%p, timeout=%.1f, cb=%p, "
+                "data=%p)", fd, packet, timeout, cb, data));
 
   if (fd < 0 || !packet)
   {
-    DEBUG_puts("5_cupsSNMPRead: Returning NULL");
+    DEBUG_puts("5_cupsSNMPReadOIDs: Returning NULL");
 
     return (NULL);
   }
@@ -410,7 +642,7 @@ _cupsSNMPRead(int         fd,		/* I - SNMP socket file descriptor */
 
     if (ready <= 0)
     {
-      DEBUG_puts("5_cupsSNMPRead: Returning NULL (timeout)");
+      DEBUG_puts("5_cupsSNMPReadOIDs: Returning NULL (timeout)");
 
       return (NULL);
     }
@@ -425,7 +657,8 @@ _cupsSNMPRead(int         fd,		/* I - SNMP socket file descriptor */
   if ((bytes = recvfrom(fd, buffer, sizeof(buffer), 0, (void *)&address,
                         &addrlen)) < 0)
   {
-    DEBUG_printf(("5_cupsSNMPRead: Returning NULL (%s)", strerror(errno)));
+    DEBUG_printf(("5_cupsSNMPReadOIDs: Returning NULL (%s)",
+                  strerror(errno)));
 
     return (NULL);
   }
@@ -436,15 +669,16 @@ _cupsSNMPRead(int         fd,		/* I - SNMP socket file descriptor */
 
   asn1_debug("DEBUG: IN ", buffer, (size_t)bytes, 0);
 
-  asn1_decode_snmp(buffer, (size_t)bytes, packet);
-
+  memset(packet, 0, sizeof(cups_snmp_t));
   memcpy(&(packet->address), &address, sizeof(packet->address));
 
+  asn1_decode_snmp(buffer, (size_t)bytes, packet, cb, data);
+
  /*
   * Return decoded data packet...
   */
 
-  DEBUG_puts("5_cupsSNMPRead: Returning packet");
+  DEBUG_puts("5_cupsSNMPReadOIDs: Returning packet");
 
   return (packet);
 }
@@ -571,8 +805,9 @@ _cupsSNMPWalk(int            fd,	/* I - SNMP socket */
                 "community=\"%s\", prefix=%p, timeout=%.1f, cb=%p, data=%p)",
 		fd, address, version, community, prefix, timeout, cb, data));
 
-  if (fd < 0 || !address || version != CUPS_SNMP_VERSION_1 || !community ||
-      !prefix || !cb)
+  if (fd < 0 || !address ||
+      (version != CUPS_SNMP_VERSION_1 && version != CUPS_SNMP_VERSION_2C) ||
+      !community || !prefix || !cb)
   {
     DEBUG_puts("5_cupsSNMPWalk: Returning -1");
 
@@ -646,7 +881,46 @@ _cupsSNMPWrite(
     const unsigned request_id,		/* I - Request ID */
     const int      *oid)		/* I - OID */
 {
-  int		i;			/* Looping var */
+  DEBUG_printf(("4_cupsSNMPWrite(fd=%d, address=%p, version=%d, "
+                "community=\"%s\", request_type=%d, request_id=%u, oid=%p)",
+		fd, address, version, community, request_type, request_id, oid));
+
+  if (request_type != CUPS_ASN1_GET_REQUEST &&
+      request_type != CUPS_ASN1_GET_NEXT_REQUEST)
+  {
+    DEBUG_puts("5_cupsSNMPWrite: Returning 0 (bad arguments)");
+
+    return (0);
+  }
+
+  return (_cupsSNMPWriteOIDs(fd, address, version, community, request_type,
+                             request_id, 0, 0, 1, &oid));
+}
+
+
+/*
+ * '_cupsSNMPWriteOIDs()' - Send an SNMP query packet for several OIDs.
+ *
+ * The "non_repeaters" and "max_repetitions" arguments are only used for
+ * SNMPv2c GetBulkRequest-PDUs and are otherwise ignored.
+ *
+ * Each array pointed to by "oids" is terminated by the value -1.
+ */
+
+int					/* O - 1 on success, 0 on error */
+_cupsSNMPWriteOIDs(
+    int            fd,			/* I - SNMP socket */
+    http_addr_t    *address,		/* I - Address to send to */
+    int            version,		/* I - SNMP version */
+    const char     *community,		/* I - Community name */
+    cups_asn1_t    request_type,	/* I - Request type */
+    const unsigned request_id,		/* I - Request ID */
+    int            non_repeaters,	/* I - Number of OIDs that are not repeated */
+    int            max_repetitions,	/* I - Maximum repetitions of the other OIDs */
+    int            num_oids,		/* I - Number of OIDs */
+    const int      * const *oids)	/* I - OIDs */
+{
+  int		i, j;			/* Looping vars */
   cups_snmp_t	packet;			/* SNMP message packet */
   unsigned char	buffer[CUPS_SNMP_MAX_PACKET];
 					/* SNMP message buffer */
@@ -658,19 +932,47 @@ _cupsSNMPWrite(
   * Range check input...
   */
 
-  DEBUG_printf(("4_cupsSNMPWrite(fd=%d, address=%p, version=%d, "
-                "community=\"%s\", request_type=%d, request_id=%u, oid=%p)",
-		fd, address, version, community, request_type, request_id, oid));
+  DEBUG_printf(("4_cupsSNMPWriteOIDs(fd=%d, address=%p, version=%d, "
+                "community=\"%s\", request_type=%d, request_id=%u, "
+		"non_repeaters=%d, max_repetitions=%d, num_oids=%d, oids=%p)",
+		fd, address, version, community, request_type, request_id,
+		non_repeaters, max_repetitions, num_oids, oids));
 
-  if (fd < 0 || !address || version != CUPS_SNMP_VERSION_1 || !community ||
+  if (fd < 0 || !address ||
+      (version != CUPS_SNMP_VERSION_1 && version != CUPS_SNMP_VERSION_2C) ||
+      !community ||
       (request_type != CUPS_ASN1_GET_REQUEST &&
-       request_type != CUPS_ASN1_GET_NEXT_REQUEST) || request_id < 1 || !oid)
+       request_type != CUPS_ASN1_GET_NEXT_REQUEST &&
+       (request_type != CUPS_ASN1_GET_BULK_REQUEST ||
+        version != CUPS_SNMP_VERSION_2C || non_repeaters < 0 ||
+	non_repeaters > num_oids || max_repetitions < 0)) ||
+      request_id < 1 || num_oids < 1 || !oids)
   {
-    DEBUG_puts("5_cupsSNMPWrite: Returning 0 (bad arguments)");
+    DEBUG_puts("5_cupsSNMPWriteOIDs: Returning 0 (bad arguments)");
 
     return (0);
   }
 
+  for (i = 0; i < num_oids; i ++)
+  {
+    if (!oids[i])
+    {
+      DEBUG_puts("5_cupsSNMPWriteOIDs: Returning 0 (bad arguments)");
+
+      return (0);
+    }
+
+    for (j = 0; oids[i][j] >= 0 && j < (CUPS_SNMP_MAX_OID - 1); j ++);
+
+    if (oids[i][j] >= 0)
+    {
+      DEBUG_puts("5_cupsSNMPWriteOIDs: Returning 0 (OID too big)");
+
+      errno = E2BIG;
+      return (0);
+    }
+  }
+
  /*
   * Create the SNMP message...
   */
@@ -680,27 +982,20 @@ _cupsSNMPWrite(
   packet.version      = version;
   packet.request_type = request_type;
   packet.request_id   = request_id;
-  packet.object_type  = CUPS_ASN1_NULL_VALUE;
 
-  strlcpy(packet.community, community, sizeof(packet.community));
-
-  for (i = 0; oid[i] >= 0 && i < (CUPS_SNMP_MAX_OID - 1); i ++)
-    packet.object_name[i] = oid[i];
-  packet.object_name[i] = -1;
-
-  if (oid[i] >= 0)
+  if (request_type == CUPS_ASN1_GET_BULK_REQUEST)
   {
-    DEBUG_puts("5_cupsSNMPWrite: Returning 0 (OID too big)");
-
-    errno = E2BIG;
-    return (0);
+    packet.error_status = non_repeaters;
+    packet.error_index  = max_repetitions;
   }
 
-  bytes = asn1_encode_snmp(buffer, sizeof(buffer), &packet);
+  strlcpy(packet.community, community, sizeof(packet.community));
+
+  bytes = asn1_encode_snmp(buffer, sizeof(buffer), &packet, num_oids, oids);
 
   if (bytes < 0)
   {
-    DEBUG_puts("5_cupsSNMPWrite: Returning 0 (request too big)");
+    DEBUG_puts("5_cupsSNMPWriteOIDs: Returning 0 (request too big)");
 
     errno = E2BIG;
     return (0);
@@ -898,6 +1193,26 @@ asn1_debug(const char    *prefix,	/* I - Prefix string */
 	  buffer += value_length;
           break;
 
+      case CUPS_ASN1_GET_BULK_REQUEST :
+          fprintf(stderr, "%s%*sGet-Bulk-Request-PDU %d bytes\n", prefix,
+	          indent, "", value_length);
+          asn1_debug(prefix, buffer, value_length, indent + 4);
+
+	  buffer += value_length;
+          break;
+
+      case CUPS_ASN1_NO_SUCH_OBJECT :
+      case CUPS_ASN1_NO_SUCH_INSTANCE :
+      case CUPS_ASN1_END_OF_MIB_VIEW :
+          fprintf(stderr, "%s%*s%s %d bytes\n", prefix, indent, "",
+	          value_type == CUPS_ASN1_NO_SUCH_OBJECT ? "noSuchObject" :
+		  value_type == CUPS_ASN1_NO_SUCH_INSTANCE ? "noSuchInstance" :
+		                                             "endOfMibView",
+	          value_length);
+
+	  buffer += value_length;
+          break;
+
       case CUPS_ASN1_GET_RESPONSE :
           fprintf(stderr, "%s%*sGet-Response-PDU %d bytes\n", prefix, indent,
 	          "", value_length);
@@ -919,23 +1234,28 @@ asn1_debug(const char    *prefix,	/* I - Prefix string */
 
 /*
  * 'asn1_decode_snmp()' - Decode a SNMP packet.
+ *
+ * If "cb" is not @code NULL@, it is called for each value in the packet.
+ * Otherwise only the first value is decoded.
  */
 
-static int				/* O - 0 on success, -1 on error */
-asn1_decode_snmp(unsigned char *buffer,	/* I - Buffer */
-                 size_t        len,	/* I - Size of buffer */
-                 cups_snmp_t   *packet)	/* I - SNMP packet */
+static int				/* O - Number of values or -1 on error */
+asn1_decode_snmp(unsigned char  *buffer,/* I - Buffer */
+                 size_t         len,	/* I - Size of buffer */
+                 cups_snmp_t    *packet,/* I - SNMP packet */
+		 cups_snmp_cb_t cb,	/* I - Function to call for each value */
+		 void           *data)	/* I - User data pointer */
 {
   unsigned char	*bufptr,		/* Pointer into the data */
 		*bufend;		/* End of data */
   unsigned	length;			/* Length of value */
+  int		count = 0;		/* Number of values */
 
 
  /*
   * Initialize the decoding...
   */
 
-  memset(packet, 0, sizeof(cups_snmp_t));
   packet->object_name[0] = -1;
 
   bufptr = buffer;
@@ -950,7 +1270,8 @@ asn1_decode_snmp(unsigned char *buffer,	/* I - Buffer */
   else if ((length = asn1_get_length(&bufptr, bufend)) == 0)
     snmp_set_error(packet, _("Version uses indefinite length"));
   else if ((packet->version = asn1_get_integer(&bufptr, bufend, length))
-               != CUPS_SNMP_VERSION_1)
+               != CUPS_SNMP_VERSION_1 &&
+	   packet->version != CUPS_SNMP_VERSION_2C)
     snmp_set_error(packet, _("Bad SNMP version number"));
   else if (asn1_get_type(&bufptr, bufend) != CUPS_ASN1_OCTET_STRING)
     snmp_set_error(packet, _("No community name"));
@@ -995,95 +1316,156 @@ asn1_decode_snmp(unsigned char *buffer,	/* I - Buffer */
 	  else if (asn1_get_length(&bufptr, bufend) == 0)
 	    snmp_set_error(packet,
 	                   _("variable-bindings uses indefinite length"));
-	  else if (asn1_get_type(&bufptr, bufend) != CUPS_ASN1_SEQUENCE)
-	    snmp_set_error(packet, _("No VarBind SEQUENCE"));
-	  else if (asn1_get_length(&bufptr, bufend) == 0)
-	    snmp_set_error(packet, _("VarBind uses indefinite length"));
-	  else if (asn1_get_type(&bufptr, bufend) != CUPS_ASN1_OID)
-	    snmp_set_error(packet, _("No name OID"));
-	  else if ((length = asn1_get_length(&bufptr, bufend)) == 0)
-	    snmp_set_error(packet, _("Name OID uses indefinite length"));
-          else
+	  else
 	  {
-	    asn1_get_oid(&bufptr, bufend, length, packet->object_name,
-	                 CUPS_SNMP_MAX_OID);
-
-            packet->object_type = (cups_asn1_t)asn1_get_type(&bufptr, bufend);
+	   /*
+	    * Decode the variable bindings...
+	    */
 
-	    if ((length = asn1_get_length(&bufptr, bufend)) == 0 &&
-	        packet->object_type != CUPS_ASN1_NULL_VALUE &&
-	        packet->object_type != CUPS_ASN1_OCTET_STRING)
-	      snmp_set_error(packet, _("Value uses indefinite length"));
-	    else
+	    do
 	    {
-	      switch (packet->object_type)
-	      {
-	        case CUPS_ASN1_BOOLEAN :
-		    packet->object_value.boolean =
-		        asn1_get_integer(&bufptr, bufend, length);
-	            break;
-
-	        case CUPS_ASN1_INTEGER :
-		    packet->object_value.integer =
-		        asn1_get_integer(&bufptr, bufend, length);
-	            break;
-
-		case CUPS_ASN1_NULL_VALUE :
-		    break;
-
-	        case CUPS_ASN1_OCTET_STRING :
-	        case CUPS_ASN1_BIT_STRING :
-	        case CUPS_ASN1_HEX_STRING :
-		    packet->object_value.string.num_bytes = length;
-		    asn1_get_string(&bufptr, bufend, length,
-		                    (char *)packet->object_value.string.bytes,
-				    sizeof(packet->object_value.string.bytes));
-	            break;
-
-	        case CUPS_ASN1_OID :
-		    asn1_get_oid(&bufptr, bufend, length,
-		                 packet->object_value.oid, CUPS_SNMP_MAX_OID);
-	            break;
-
-	        case CUPS_ASN1_COUNTER :
-		    packet->object_value.counter =
-		        asn1_get_integer(&bufptr, bufend, length);
-	            break;
-
-	        case CUPS_ASN1_GAUGE :
-		    packet->object_value.gauge =
-		        (unsigned)asn1_get_integer(&bufptr, bufend, length);
-	            break;
-
-	        case CUPS_ASN1_TIMETICKS :
-		    packet->object_value.timeticks =
-		        (unsigned)asn1_get_integer(&bufptr, bufend, length);
-	            break;
-
-                default :
-		    snmp_set_error(packet, _("Unsupported value type"));
-		    break;
-	      }
+	      if (asn1_decode_varbind(&bufptr, bufend, packet))
+	        break;
+
+	      count ++;
+
+	      if (!cb)
+	        break;
+
+	      (*cb)(packet, data);
 	    }
-          }
+	    while (bufptr < bufend);
+	  }
 	}
       }
     }
   }
 
+  return (packet->error ? -1 : count);
+}
+
+
+/*
+ * 'asn1_decode_varbind()' - Decode a SNMP variable binding.
+ */
+
+static int				/* O  - 0 on success, -1 on error */
+asn1_decode_varbind(
+    unsigned char **buffer,		/* IO - Pointer in buffer */
+    unsigned char *bufend,		/* I  - End of buffer */
+    cups_snmp_t   *packet)		/* I  - SNMP packet */
+{
+  unsigned char	*bufptr = *buffer;	/* Pointer into the data */
+  unsigned	length;			/* Length of value */
+
+
+  packet->object_name[0] = -1;
+  packet->object_type    = CUPS_ASN1_END_OF_CONTENTS;
+
+  memset(&(packet->object_value), 0, sizeof(packet->object_value));
+
+  if (asn1_get_type(&bufptr, bufend) != CUPS_ASN1_SEQUENCE)
+    snmp_set_error(packet, _("No VarBind SEQUENCE"));
+  else if (asn1_get_length(&bufptr, bufend) == 0)
+    snmp_set_error(packet, _("VarBind uses indefinite length"));
+  else if (asn1_get_type(&bufptr, bufend) != CUPS_ASN1_OID)
+    snmp_set_error(packet, _("No name OID"));
+  else if ((length = asn1_get_length(&bufptr, bufend)) == 0)
+    snmp_set_error(packet, _("Name OID uses indefinite length"));
+  else
+  {
+    asn1_get_oid(&bufptr, bufend, length, packet->object_name,
+		 CUPS_SNMP_MAX_OID);
+
+    packet->object_type = (cups_asn1_t)asn1_get_type(&bufptr, bufend);
+
+    if ((length = asn1_get_length(&bufptr, bufend)) == 0 &&
+	packet->object_type != CUPS_ASN1_NULL_VALUE &&
+	packet->object_type != CUPS_ASN1_OCTET_STRING &&
+	packet->object_type != CUPS_ASN1_NO_SUCH_OBJECT &&
+	packet->object_type != CUPS_ASN1_NO_SUCH_INSTANCE &&
+	packet->object_type != CUPS_ASN1_END_OF_MIB_VIEW)
+      snmp_set_error(packet, _("Value uses indefinite length"));
+    else
+    {
+      switch (packet->object_type)
+      {
+	case CUPS_ASN1_BOOLEAN :
+	    packet->object_value.boolean =
+		asn1_get_integer(&bufptr, bufend, length);
+	    break;
+
+	case CUPS_ASN1_INTEGER :
+	    packet->object_value.integer =
+		asn1_get_integer(&bufptr, bufend, length);
+	    break;
+
+	case CUPS_ASN1_NULL_VALUE :
+	case CUPS_ASN1_NO_SUCH_OBJECT :
+	case CUPS_ASN1_NO_SUCH_INSTANCE :
+	case CUPS_ASN1_END_OF_MIB_VIEW :
+	    bufptr += length;
+	    break;
+
+	case CUPS_ASN1_OCTET_STRING :
+	case CUPS_ASN1_BIT_STRING :
+	case CUPS_ASN1_HEX_STRING :
+	    packet->object_value.string.num_bytes = length;
+	    asn1_get_string(&bufptr, bufend, length,
+			    (char *)packet->object_value.string.bytes,
+			    sizeof(packet->object_value.string.bytes));
+	    break;
+
+	case CUPS_ASN1_OID :
+	    asn1_get_oid(&bufptr, bufend, length,
+			 packet->object_value.oid, CUPS_SNMP_MAX_OID);
+	    break;
+
+	case CUPS_ASN1_COUNTER :
+	    packet->object_value.counter =
+		asn1_get_integer(&bufptr, bufend, length);
+	    break;
+
+	case CUPS_ASN1_GAUGE :
+	    packet->object_value.gauge =
+		(unsigned)asn1_get_integer(&bufptr, bufend, length);
+	    break;
+
+	case CUPS_ASN1_TIMETICKS :
+	    packet->object_value.timeticks =
+		(unsigned)asn1_get_integer(&bufptr, bufend, length);
+	    break;
+
+	default :
+	    snmp_set_error(packet, _("Unsupported value type"));
+	    break;
+      }
+    }
+  }
+
+  *buffer = bufptr > bufend ? bufend : bufptr;
+
   return (packet->error ? -1 : 0);
 }
 
 
 /*
  * 'asn1_encode_snmp()' - Encode a SNMP packet.
+ *
+ * If "oids" is @code NULL@, the object name and value in the packet are
+ * encoded.  Otherwise the OIDs are encoded with NULL values.
  */
 
 static int				/* O - Length on success, -1 on error */
-asn1_encode_snmp(unsigned char *buffer,	/* I - Buffer */
-                 size_t        bufsize,	/* I - Size of buffer */
-                 cups_snmp_t   *packet)	/* I - SNMP packet */
+asn1_encode_snmp(unsigned char   *buffer,/* I - Buffer */
+                 size_t          bufsize,/* I - Size of buffer */
+                 cups_snmp_t     *packet,/* I - SNMP packet */
+		 int             num_oids,
+					/* I - Number of OIDs */
+		 const int       * const *oids)
+					/* I - OIDs or NULL */
 {
+  int		i;			/* Looping var */
   unsigned char	*bufptr;		/* Pointer into buffer */
   unsigned	total,			/* Total length */
 		msglen,			/* Length of entire message */
@@ -1093,45 +1475,56 @@ asn1_encode_snmp(unsigned char *buffer,	/* I - Buffer */
 		varlen,			/* Length of variable */
 		namelen,		/* Length of object name OID */
 		valuelen;		/* Length of object value */
+  const int	*name;			/* Object name OID */
 
 
  /*
-  * Get the lengths of the community string, OID, and message...
+  * Get the lengths of the community string, OIDs, and message...
   */
 
+  if (!oids)
+  {
+    num_oids = 1;
 
-  namelen = asn1_size_oid(packet->object_name);
+    switch (packet->object_type)
+    {
+      case CUPS_ASN1_NULL_VALUE :
+	  valuelen = 0;
+	  break;
 
-  switch (packet->object_type)
-  {
-    case CUPS_ASN1_NULL_VALUE :
-        valuelen = 0;
-	break;
+      case CUPS_ASN1_BOOLEAN :
+	  valuelen = asn1_size_integer(packet->object_value.boolean);
+	  break;
 
-    case CUPS_ASN1_BOOLEAN :
-        valuelen = asn1_size_integer(packet->object_value.boolean);
-	break;
+      case CUPS_ASN1_INTEGER :
+	  valuelen = asn1_size_integer(packet->object_value.integer);
+	  break;
 
-    case CUPS_ASN1_INTEGER :
-        valuelen = asn1_size_integer(packet->object_value.integer);
-	break;
+      case CUPS_ASN1_OCTET_STRING :
+	  valuelen = packet->object_value.string.num_bytes;
+	  break;
 
-    case CUPS_ASN1_OCTET_STRING :
-        valuelen = packet->object_value.string.num_bytes;
-	break;
+      case CUPS_ASN1_OID :
+	  valuelen = asn1_size_oid(packet->object_value.oid);
+	  break;
 
-    case CUPS_ASN1_OID :
-        valuelen = asn1_size_oid(packet->object_value.oid);
-	break;
+      default :
+	  packet->error = "Unknown object type";
+	  return (-1);
+    }
+  }
+  else
+    valuelen = 0;
 
-    default :
-        packet->error = "Unknown object type";
-        return (-1);
+  for (i = 0, listlen = 0; i < num_oids; i ++)
+  {
+    name    = oids ? oids[i] : packet->object_name;
+    namelen = asn1_size_oid(name);
+    varlen  = 1 + asn1_size_length(namelen) + namelen +
+              1 + asn1_size_length(valuelen) + valuelen;
+    listlen += 1 + asn1_size_length(varlen) + varlen;
   }
 
-  varlen  = 1 + asn1_size_length(namelen) + namelen +
-            1 + asn1_size_length(valuelen) + valuelen;
-  listlen = 1 + asn1_size_length(varlen) + varlen;
   reqlen  = 2 + asn1_size_integer((int)packet->request_id) +
             2 + asn1_size_integer(packet->error_status) +
             2 + asn1_size_integer(packet->error_index) +
@@ -1171,47 +1564,56 @@ asn1_encode_snmp(unsigned char *buffer,	/* I - Buffer */
   asn1_set_integer(&bufptr, (int)packet->request_id);
 
   asn1_set_integer(&bufptr, packet->error_status);
+					/* error-status or non-repeaters */
 
   asn1_set_integer(&bufptr, packet->error_index);
+					/* error-index or max-repetitions */
 
   *bufptr++ = CUPS_ASN1_SEQUENCE;	/* variable-bindings */
   asn1_set_length(&bufptr, listlen);
 
-  *bufptr++ = CUPS_ASN1_SEQUENCE;	/* variable */
-  asn1_set_length(&bufptr, varlen);
+  for (i = 0; i < num_oids; i ++)
+  {
+    name    = oids ? oids[i] : packet->object_name;
+    namelen = asn1_size_oid(name);
+    varlen  = 1 + asn1_size_length(namelen) + namelen +
+              1 + asn1_size_length(valuelen) + valuelen;
 
-  asn1_set_oid(&bufptr, packet->object_name);
-					/* ObjectName */
+    *bufptr++ = CUPS_ASN1_SEQUENCE;	/* variable */
+    asn1_set_length(&bufptr, varlen);
 
-  switch (packet->object_type)
-  {
-    case CUPS_ASN1_NULL_VALUE :
-	*bufptr++ = CUPS_ASN1_NULL_VALUE;
+    asn1_set_oid(&bufptr, name);	/* ObjectName */
+
+    switch (oids ? CUPS_ASN1_NULL_VALUE : packet->object_type)
+    {
+      case CUPS_ASN1_NULL_VALUE :
+	  *bufptr++ = CUPS_ASN1_NULL_VALUE;
 					/* ObjectValue */
-	*bufptr++ = 0;			/* Length */
-        break;
-
-    case CUPS_ASN1_BOOLEAN :
-        asn1_set_integer(&bufptr, packet->object_value.boolean);
-	break;
-
-    case CUPS_ASN1_INTEGER :
-        asn1_set_integer(&bufptr, packet->object_value.integer);
-	break;
-
-    case CUPS_ASN1_OCTET_STRING :
-        *bufptr++ = CUPS_ASN1_OCTET_STRING;
-	asn1_set_length(&bufptr, valuelen);
-	memcpy(bufptr, packet->object_value.string.bytes, valuelen);
-	bufptr += valuelen;
-	break;
-
-    case CUPS_ASN1_OID :
-        asn1_set_oid(&bufptr, packet->object_value.oid);
-	break;
-
-    default :
-        break;
+	  *bufptr++ = 0;		/* Length */
+	  break;
+
+      case CUPS_ASN1_BOOLEAN :
+	  asn1_set_integer(&bufptr, packet->object_value.boolean);
+	  break;
+
+      case CUPS_ASN1_INTEGER :
+	  asn1_set_integer(&bufptr, packet->object_value.integer);
+	  break;
+
+      case CUPS_ASN1_OCTET_STRING :
+	  *bufptr++ = CUPS_ASN1_OCTET_STRING;
+	  asn1_set_length(&bufptr, valuelen);
+	  memcpy(bufptr, packet->object_value.string.bytes, valuelen);
+	  bufptr += valuelen;
+	  break;
+
+      case CUPS_ASN1_OID :
+	  asn1_set_oid(&bufptr, packet->object_value.oid);
+	  break;
+
+      default :
+	  break;
+    }
   }
 
   return ((int)(bufptr - buffer));
@@ -1658,6 +2060,30 @@ asn1_size_packed(int integer)		/* I - Integer value */
 }
 
 
+/*
+ * 'snmp_get_cb()' - Pass the values from a get request to the caller.
+ */
+
+static void
+snmp_get_cb(cups_snmp_t *packet,	/* I - SNMP packet */
+            void        *data)		/* I - Get state */
+{
+  _cups_snmp_walk_t	*get = (_cups_snmp_walk_t *)data;
+					/* Get state */
+
+
+  if (packet->error_status ||
+      packet->object_type == CUPS_ASN1_NO_SUCH_OBJECT ||
+      packet->object_type == CUPS_ASN1_NO_SUCH_INSTANCE ||
+      packet->object_type == CUPS_ASN1_END_OF_MIB_VIEW)
+    return;
+
+  get->count ++;
+
+  (*get->cb)(packet, get->data);
+}
+
+
 /*
  * 'snmp_set_error()' - Set the localized error for a packet.
  */
@@ -1676,6 +2102,39 @@ snmp_set_error(cups_snmp_t *packet,	/* I - Packet */
 }
 
 
+/*
+ * 'snmp_walk_cb()' - Pass the values from a bulk walk to the caller.
+ */
+
+static void
+snmp_walk_cb(cups_snmp_t *packet,	/* I - SNMP packet */
+             void        *data)		/* I - Walk state */
+{
+  _cups_snmp_walk_t	*walk = (_cups_snmp_walk_t *)data;
+					/* Walk state */
+
+
+  if (walk->done)
+    return;
+
+  if (packet->error_status ||
+      packet->object_type == CUPS_ASN1_END_OF_MIB_VIEW ||
+      !_cupsSNMPIsOIDPrefixed(packet, walk->prefix) ||
+      _cupsSNMPIsOID(packet, walk->lastoid))
+  {
+    walk->done = 1;
+    return;
+  }
+
+  _cupsSNMPCopyOID(walk->lastoid, packet->object_name, CUPS_SNMP_MAX_OID);
+
+  walk->count ++;
+  walk->found ++;
+
+  (*walk->cb)(packet, walk->data);
+}
+
+
 /*
  * End of "$Id: snmp.c 11645 2014-02-27 16:35:53Z msweet $".
  */
@@ -0,0 +1,462 @@
+/*
+ * "$Id$"
+ *
+ * Asynchronous IPP request test program for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define SLOW_DELAY	2		/* Seconds the slow server waits */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct result_s			/**** Request result ****/
+{
+  const char	*resource;		/* Resource for request */
+  int		done;			/* Completion order (1-based) */
+  double	elapsed;		/* Seconds until completion */
+  ipp_status_t	status;			/* IPP status */
+  char		message[256];		/* Status message */
+} result_t;
+
+
+/*
+ * Local globals...
+ */
+
+static int	num_done = 0;		/* Number of completed requests */
+static double	start_time;		/* Time requests were queued */
+
+
+/*
+ * Local functions...
+ */
+
+static double	get_time(void);
+static void	request_cb(result_t *result, http_t *http, ipp_status_t status,
+		           const char *message, ipp_t *response);
+static void	run_server(int fd);
+static void	serve_client(int fd);
+static ssize_t	write_cb(ipp_uchar_t **ptr, ipp_uchar_t *data, size_t bytes);
+
+
+/*
+ * 'main()' - Send several concurrent requests to fast and slow servers.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			i,		/* Looping var */
+			listenfd,	/* Listen socket */
+			port,		/* Server port */
+			pending,	/* Pending requests */
+			status = 0;	/* Exit status */
+  pid_t			server;		/* Server process */
+  http_addr_t		addr;		/* Server address */
+  socklen_t		addrlen;	/* Length of address */
+  http_t		*slow,		/* Connection to slow server */
+			*fast[2],	/* Connections to fast server */
+			*unreachable;	/* Connection to broadcast address */
+  cups_loop_t		*loop;		/* Request loop */
+  ipp_t			*request;	/* IPP request */
+  result_t		results[5];	/* Request results */
+  static const char * const resources[5] =
+  {					/* Resources for requests */
+    "/slow",
+    "/fast",
+    "/chunked",
+    "/fast",
+    "/unreachable"
+  };
+
+
+  signal(SIGPIPE, SIG_IGN);
+
+ /*
+  * Start a local test server that answers "/slow" after SLOW_DELAY seconds
+  * and everything else immediately...
+  */
+
+  fputs("Starting test server: ", stdout);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.ipv4.sin_family      = AF_INET;
+  addr.ipv4.sin_addr.s_addr = htonl(0x7f000001);
+  addrlen                   = sizeof(addr.ipv4);
+
+  if ((listenfd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+      bind(listenfd, (struct sockaddr *)&addr, addrlen) ||
+      listen(listenfd, 16) ||
+      getsockname(listenfd, (struct sockaddr *)&addr, &addrlen))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  port = httpAddrPort(&addr);
+
+  fflush(stdout);
+
+  if ((server = fork()) == 0)
+  {
+    run_server(listenfd);
+    exit(0);
+  }
+  else if (server < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  close(listenfd);
+
+  printf("PASS (port %d)\n", port);
+
+ /*
+  * Queue one request to the slow server and three to the fast server, two of
+  * them on the same kept-alive connection, and one to the broadcast address,
+  * which usually fails right away but must still be reported by
+  * cupsLoopRun...
+  */
+
+  fputs("cupsDoRequestAsync: ", stdout);
+
+  loop    = cupsLoopNew();
+  slow    = httpConnect2("127.0.0.1", port, NULL, AF_INET,
+                         HTTP_ENCRYPTION_IF_REQUESTED, 1, 0, NULL);
+  fast[0] = httpConnect2("127.0.0.1", port, NULL, AF_INET,
+                         HTTP_ENCRYPTION_IF_REQUESTED, 1, 0, NULL);
+  fast[1] = httpConnect2("127.0.0.1", port, NULL, AF_INET,
+                         HTTP_ENCRYPTION_IF_REQUESTED, 1, 0, NULL);
+  unreachable = httpConnect2("255.255.255.255", port, NULL, AF_INET,
+                             HTTP_ENCRYPTION_IF_REQUESTED, 1, 0, NULL);
+
+  if (!loop || !slow || !fast[0] || !fast[1] || !unreachable)
+  {
+    puts("FAIL (unable to create loop or connections)");
+    kill(server, SIGTERM);
+    return (1);
+  }
+
+  start_time = get_time();
+
+  for (i = 0; i < 5; i ++)
+  {
+    memset(results + i, 0, sizeof(result_t));
+    results[i].resource = resources[i];
+
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL,
+                 "ipp://localhost/printers/test");
+
+    if (!cupsDoRequestAsync(loop, i == 0 ? slow : i == 4 ? unreachable :
+                                                   fast[i == 3],
+                            request, resources[i], 10000,
+			    (cups_request_cb_t)request_cb, results + i))
+    {
+      printf("FAIL (%s)\n", cupsLastErrorString());
+      kill(server, SIGTERM);
+      return (1);
+    }
+  }
+
+  if (num_done)
+  {
+    printf("FAIL (%d callbacks called before cupsLoopRun)\n", num_done);
+    kill(server, SIGTERM);
+    return (1);
+  }
+
+  puts("PASS");
+
+ /*
+  * Run the loop and make sure the fast requests complete while the slow one is
+  * still waiting...
+  */
+
+  fputs("cupsLoopRun: ", stdout);
+
+  pending = cupsLoopRun(loop, 10000);
+
+  if (pending)
+  {
+    printf("FAIL (%d requests still pending)\n", pending);
+    status = 1;
+  }
+  else
+  {
+    for (i = 0; i < 4; i ++)
+    {
+      if (!results[i].done)
+      {
+        printf("FAIL (%s not completed)\n", results[i].resource);
+	status = 1;
+	break;
+      }
+      else if (results[i].status != IPP_STATUS_OK)
+      {
+        printf("FAIL (%s returned %s: %s)\n", results[i].resource,
+	       ippErrorString(results[i].status), results[i].message);
+	status = 1;
+	break;
+      }
+      else if (i > 0 && (results[i].done > 4 || results[i].elapsed >= 1.0))
+      {
+        printf("FAIL (%s completed after %.3f seconds, blocked by slow "
+	       "server)\n", results[i].resource, results[i].elapsed);
+	status = 1;
+	break;
+      }
+    }
+
+    if (!status && (!results[4].done || results[4].status == IPP_STATUS_OK))
+    {
+      puts("FAIL (request to broadcast address not reported as an error)");
+      status = 1;
+    }
+
+    if (!status)
+      printf("PASS (fast requests in %.3f/%.3f/%.3f seconds, slow request in "
+             "%.3f seconds)\n", results[1].elapsed, results[2].elapsed,
+	     results[3].elapsed, results[0].elapsed);
+  }
+
+  cupsLoopDelete(loop);
+  httpClose(slow);
+  httpClose(fast[0]);
+  httpClose(fast[1]);
+  httpClose(unreachable);
+
+  kill(server, SIGTERM);
+  while (wait(NULL) > 0);
+
+  return (status);
+}
+
+
+/*
+ * 'get_time()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_time(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'request_cb()' - Record the completion of a request.
+ */
+
+static void
+request_cb(result_t     *result,	/* I - Request result */
+           http_t       *http,		/* I - Connection */
+	   ipp_status_t status,		/* I - IPP status */
+	   const char   *message,	/* I - Status message */
+	   ipp_t        *response)	/* I - IPP response */
+{
+  (void)http;
+
+  result->done    = ++ num_done;
+  result->elapsed = get_time() - start_time;
+  result->status  = status;
+
+  strlcpy(result->message, message ? message : "", sizeof(result->message));
+
+  ippDelete(response);
+}
+
+
+/*
+ * 'run_server()' - Accept connections, serving each from its own process.
+ */
+
+static void
+run_server(int fd)			/* I - Listen socket */
+{
+  int	client;				/* Client socket */
+
+
+  signal(SIGCHLD, SIG_IGN);
+
+  while ((client = accept(fd, NULL, NULL)) >= 0)
+  {
+    if (fork() == 0)
+    {
+      close(fd);
+      serve_client(client);
+      exit(0);
+    }
+
+    close(client);
+  }
+}
+
+
+/*
+ * 'serve_client()' - Answer requests on a connection until it is closed.
+ */
+
+static void
+serve_client(int fd)			/* I - Client socket */
+{
+  char		buffer[65536],		/* Request buffer */
+		*end,			/* End of header */
+		*ptr,			/* Pointer into header */
+		resource[256],		/* Requested resource */
+		header[1024];		/* Response header */
+  size_t	used = 0;		/* Bytes in buffer */
+  ssize_t	bytes;			/* Bytes read */
+  int		length;			/* Content-Length of request */
+  ipp_t		*response;		/* IPP response */
+  size_t	rlength;		/* Length of response */
+  ipp_uchar_t	*rbuffer;		/* Response buffer */
+  ipp_uchar_t	*rptr;			/* Pointer into response buffer */
+
+
+  buffer[0] = '\0';
+
+  for (;;)
+  {
+   /*
+    * Read the request header and body...
+    */
+
+    while ((end = strstr(buffer, "\r\n\r\n")) == NULL)
+    {
+      if ((bytes = read(fd, buffer + used, sizeof(buffer) - used - 1)) <= 0)
+        return;
+
+      used += (size_t)bytes;
+      buffer[used] = '\0';
+    }
+
+    end += 4;
+
+    if (sscanf(buffer, "POST %255s", resource) != 1)
+      return;
+
+    if ((ptr = strstr(buffer, "Content-Length:")) == NULL || ptr > end)
+      return;
+
+    length = atoi(ptr + 15);
+
+    while ((size_t)(end - buffer + length) > used)
+    {
+      if ((bytes = read(fd, buffer + used, sizeof(buffer) - used - 1)) <= 0)
+        return;
+
+      used += (size_t)bytes;
+    }
+
+    used -= (size_t)(end - buffer + length);
+    memmove(buffer, end + length, used);
+    buffer[used] = '\0';
+
+   /*
+    * Build the response...
+    */
+
+    if (!strcmp(resource, "/slow"))
+      sleep(SLOW_DELAY);
+
+    response = ippNew();
+    ippSetVersion(response, 2, 0);
+    ippSetStatusCode(response, IPP_STATUS_OK);
+    ippSetRequestId(response, 1);
+    ippAddString(response, IPP_TAG_OPERATION, IPP_TAG_CHARSET,
+                 "attributes-charset", NULL, "utf-8");
+    ippAddString(response, IPP_TAG_OPERATION, IPP_TAG_LANGUAGE,
+                 "attributes-natural-language", NULL, "en");
+    ippAddString(response, IPP_TAG_OPERATION, IPP_TAG_TEXT, "status-message",
+                 NULL, resource);
+
+    rlength = ippLength(response);
+    rbuffer = malloc(rlength);
+    rptr    = rbuffer;
+
+    ippWriteIO(&rptr, (ipp_iocb_t)write_cb, 1, NULL, response);
+    ippDelete(response);
+
+    if (!strcmp(resource, "/chunked"))
+    {
+     /*
+      * Send the response in two chunks...
+      */
+
+      snprintf(header, sizeof(header),
+               "HTTP/1.1 200 OK\r\nContent-Type: application/ipp\r\n"
+	       "Transfer-Encoding: chunked\r\n\r\n%x\r\n", (unsigned)rlength / 2);
+      write(fd, header, strlen(header));
+      write(fd, rbuffer, rlength / 2);
+      snprintf(header, sizeof(header), "\r\n%x\r\n",
+               (unsigned)(rlength - rlength / 2));
+      write(fd, header, strlen(header));
+      write(fd, rbuffer + rlength / 2, rlength - rlength / 2);
+      write(fd, "\r\n0\r\n\r\n", 7);
+    }
+    else
+    {
+      snprintf(header, sizeof(header),
+               "HTTP/1.1 200 OK\r\nContent-Type: application/ipp\r\n"
+	       "Content-Length: %d\r\n\r\n", (int)rlength);
+      write(fd, header, strlen(header));
+      write(fd, rbuffer, rlength);
+    }
+
+    free(rbuffer);
+  }
+}
+
+
+/*
+ * 'write_cb()' - Copy IPP data to a memory buffer.
+ */
+
+static ssize_t				/* O  - Bytes written */
+write_cb(ipp_uchar_t **ptr,		/* IO - Pointer into buffer */
+         ipp_uchar_t *data,		/* I  - Data */
+	 size_t      bytes)		/* I  - Number of bytes */
+{
+  memcpy(*ptr, data, bytes);
+  *ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -0,0 +1,216 @@
+/*
+ * "$Id$"
+ *
+ * HTTP connection pool test program for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include <signal.h>
+
+
+/*
+ * Local functions...
+ */
+
+static int	timeout_cb(http_t *http, void *data);
+
+
+/*
+ * 'main()' - Test reuse and reset of pooled connections.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			listenfd,	/* Listen socket */
+			clientfd,	/* Accepted connection */
+			port,		/* Server port */
+			status = 0;	/* Exit status */
+  http_addr_t		addr;		/* Server address */
+  socklen_t		addrlen;	/* Length of address */
+  http_t		*http,		/* Connection */
+			*pooled;	/* Connection from pool */
+  int			data = 0;	/* Timeout callback data */
+
+
+  signal(SIGPIPE, SIG_IGN);
+
+ /*
+  * Listen on a local port; connections are never answered so they stay idle
+  * until the test closes them...
+  */
+
+  fputs("httpConnect2: ", stdout);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.ipv4.sin_family      = AF_INET;
+  addr.ipv4.sin_addr.s_addr = htonl(0x7f000001);
+  addrlen                   = sizeof(addr.ipv4);
+
+  if ((listenfd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+      bind(listenfd, (struct sockaddr *)&addr, addrlen) ||
+      listen(listenfd, 16) ||
+      getsockname(listenfd, (struct sockaddr *)&addr, &addrlen))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  port = httpAddrPort(&addr);
+
+  if ((http = httpConnect2("127.0.0.1", port, NULL, AF_INET,
+                           HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000,
+			   NULL)) == NULL)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    return (1);
+  }
+
+  puts("PASS");
+
+ /*
+  * Change the per-owner state and put the connection in the pool...
+  */
+
+  fputs("_httpPoolPut: ", stdout);
+
+  httpSetTimeout(http, 5.0, timeout_cb, &data);
+  httpBlocking(http, 0);
+  httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+  httpSetAuthString(http, "Basic", "dXNlcjpwYXNzd29yZA==");
+  httpSetCookie(http, "session=1");
+
+  http->pool = 1;
+
+  httpClose(http);
+
+  puts("PASS");
+
+ /*
+  * The same host, port, and credentials get the same connection back with
+  * its state reset...
+  */
+
+  fputs("_httpPoolGet(other port): ", stdout);
+
+  if ((pooled = _httpPoolGet("127.0.0.1", port + 1,
+                             HTTP_ENCRYPTION_IF_REQUESTED, NULL)) != NULL)
+  {
+    puts("FAIL (got a connection to a different port)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("_httpPoolGet(other credentials): ", stdout);
+
+  if ((pooled = _httpPoolGet("127.0.0.1", port, HTTP_ENCRYPTION_IF_REQUESTED,
+                             (http_tls_credentials_t)&data)) != NULL)
+  {
+    puts("FAIL (got a connection made without client credentials)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("_httpPoolGet: ", stdout);
+
+  if ((pooled = _httpPoolGet("127.0.0.1", port, HTTP_ENCRYPTION_IF_REQUESTED,
+                             NULL)) != http)
+  {
+    printf("FAIL (got %p, expected %p)\n", pooled, http);
+    status = 1;
+  }
+  else if (http->timeout_cb || http->timeout_data || http->timeout_value > 0.0)
+  {
+    puts("FAIL (timeout callback not reset)");
+    status = 1;
+  }
+  else if (!http->blocking || http->wait_value != 60000)
+  {
+    puts("FAIL (blocking mode not reset)");
+    status = 1;
+  }
+  else if (httpGetField(http, HTTP_FIELD_CONTENT_TYPE)[0])
+  {
+    puts("FAIL (request fields not cleared)");
+    status = 1;
+  }
+  else if (httpGetAuthString(http) && httpGetAuthString(http)[0])
+  {
+    puts("FAIL (authorization not cleared)");
+    status = 1;
+  }
+  else if (httpGetCookie(http))
+  {
+    puts("FAIL (cookie not cleared)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * A connection the server has closed is not reused...
+  */
+
+  fputs("_httpPoolGet(closed by server): ", stdout);
+
+  if (pooled)
+  {
+    httpClose(pooled);
+
+    if ((clientfd = accept(listenfd, NULL, NULL)) >= 0)
+      close(clientfd);
+
+    usleep(100000);
+  }
+
+  if ((pooled = _httpPoolGet("127.0.0.1", port, HTTP_ENCRYPTION_IF_REQUESTED,
+                             NULL)) != NULL)
+  {
+    puts("FAIL (got a closed connection)");
+    pooled->pool = 0;
+    httpClose(pooled);
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  close(listenfd);
+
+  return (status);
+}
+
+
+/*
+ * 'timeout_cb()' - Timeout callback that should never be called.
+ */
+
+static int				/* O - 0 to cancel */
+timeout_cb(http_t *http,		/* I - Connection */
+           void   *data)		/* I - Callback data */
+{
+  (void)http;
+  (void)data;
+
+  return (0);
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -109,9 +109,24 @@ _cupsThreadCreate(
     _cups_thread_func_t func,		/* I - Entry point */
     void                *arg)		/* I - Entry point context */
 {
-  pthread_t thread;
+  pthread_t		thread;		/* Thread */
+  pthread_attr_t	attr;		/* Thread attributes */
+  int			status;		/* Result of pthread_create */
 
-  return (pthread_create(&thread, NULL, (void *(*)(void *))func, arg) == 0);
+
+ /*
+  * No thread handle is returned, so nothing can join the thread; create it
+  * detached so its resources are freed when it exits...
+  */
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  status = pthread_create(&thread, &attr, (void *(*)(void *))func, arg);
+
+  pthread_attr_destroy(&attr);
+
+  return (status == 0);
 }
 
 
@@ -219,8 +234,16 @@ _cupsThreadCreate(
     _cups_thread_func_t func,		/* I - Entry point */
     void                *arg)		/* I - Entry point context */
 {
-  return (_beginthreadex(NULL, 0, (LPTHREAD_START_ROUTINE) func, arg, 0, NULL)
-	      != 0);
+  uintptr_t	thread;			/* Thread handle */
+
+
+  if ((thread = _beginthreadex(NULL, 0, (LPTHREAD_START_ROUTINE) func, arg, 0,
+                               NULL)) == 0)
+    return (0);
+
+  CloseHandle((HANDLE)thread);
+
+  return (1);
 }
 
 
@@ -1169,6 +1169,22 @@ _httpTLSStart(http_t *http)		/* I - HTTP connection */
     error = SSLSetPeerDomainName(http->tls, hostname, strlen(hostname));
 
     DEBUG_printf(("4_httpTLSStart: SSLSetPeerDomainName, error=%d", (int)error));
+
+    if (!error)
+    {
+     /*
+      * Let Secure Transport resume previous sessions with this server...
+      */
+
+      char	peerid[300];		/* Peer ID for session cache */
+
+      snprintf(peerid, sizeof(peerid), "%s:%d", http->hostname,
+               httpAddrPort(http->hostaddr));
+
+      error = SSLSetPeerID(http->tls, peerid, strlen(peerid));
+
+      DEBUG_printf(("4_httpTLSStart: SSLSetPeerID, error=%d", (int)error));
+    }
   }
 
   if (!error)
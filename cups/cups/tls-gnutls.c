@@ -23,6 +23,28 @@
 #include <sys/stat.h>
 
 
+/*
+ * Local constants...
+ */
+
+#define _HTTP_TLS_MAX_CLIENT	64	/* Maximum cached client sessions */
+#define _HTTP_TLS_MAX_SERVER	1024	/* Maximum cached server sessions */
+#define _HTTP_TLS_SESSION_LIFE	3600	/* Lifetime of cached sessions in seconds */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _http_tls_session_s	/**** Cached TLS session ****/
+{
+  unsigned char		key[256];	/* "hostname:port" or session ID */
+  size_t		keylen;		/* Length of key */
+  time_t		expires;	/* Expiration time */
+  gnutls_datum_t	data;		/* Session data */
+} _http_tls_session_t;
+
+
 /*
  * Local globals...
  */
@@ -35,6 +57,14 @@ static char		*tls_keypath = NULL;
 					/* Server cert keychain path */
 static _cups_mutex_t	tls_mutex = _CUPS_MUTEX_INITIALIZER;
 					/* Mutex for keychain/certs */
+static cups_array_t	*tls_client_sessions = NULL,
+					/* Client sessions by hostname:port */
+			*tls_server_sessions = NULL;
+					/* Server sessions by session ID */
+static _cups_mutex_t	tls_session_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for session caches */
+static gnutls_datum_t	tls_ticket_key = { NULL, 0 };
+					/* Server session ticket key */
 
 
 /*
@@ -45,6 +75,14 @@ static gnutls_x509_crt_t http_gnutls_create_credential(http_credential_t *creden
 static const char	*http_gnutls_default_path(char *buffer, size_t bufsize);
 static const char	*http_gnutls_make_path(char *buffer, size_t bufsize, const char *dirname, const char *filename, const char *ext);
 static ssize_t		http_gnutls_read(gnutls_transport_ptr_t ptr, void *data, size_t length);
+static int		http_gnutls_session_compare(_http_tls_session_t *a, _http_tls_session_t *b);
+static _http_tls_session_t *http_gnutls_session_find(cups_array_t *sessions, const void *key, size_t keylen);
+static void		http_gnutls_session_name(http_t *http, char *buffer, size_t bufsize);
+static int		http_gnutls_session_remove(void *ptr, gnutls_datum_t key);
+static gnutls_datum_t	http_gnutls_session_retrieve(void *ptr, gnutls_datum_t key);
+static int		http_gnutls_session_store(void *ptr, gnutls_datum_t key, gnutls_datum_t data);
+static int		http_gnutls_session_save(cups_array_t **sessions, int max_sessions, const void *key, size_t keylen, gnutls_datum_t *data);
+static int		http_gnutls_start(http_t *http);
 static ssize_t		http_gnutls_write(gnutls_transport_ptr_t ptr, const void *data, size_t length);
 
 
@@ -898,123 +936,250 @@ http_gnutls_read(
 
 
 /*
- * 'http_gnutls_write()' - Write function for the GNU TLS library.
+ * 'http_gnutls_session_compare()' - Compare two cached sessions.
  */
 
-static ssize_t				/* O - Number of bytes written or -1 on error */
-http_gnutls_write(
-    gnutls_transport_ptr_t ptr,		/* I - Connection to server */
-    const void             *data,	/* I - Data buffer */
-    size_t                 length)	/* I - Number of bytes to write */
+static int				/* O - Result of comparison */
+http_gnutls_session_compare(
+    _http_tls_session_t *a,		/* I - First session */
+    _http_tls_session_t *b)		/* I - Second session */
 {
-  ssize_t bytes;			/* Bytes written */
+  if (a->keylen != b->keylen)
+    return ((int)a->keylen - (int)b->keylen);
+  else
+    return (memcmp(a->key, b->key, a->keylen));
+}
 
 
-  DEBUG_printf(("6http_gnutls_write(ptr=%p, data=%p, length=%d)", ptr, data,
-                (int)length));
-  bytes = send(((http_t *)ptr)->fd, data, length, 0);
-  DEBUG_printf(("http_gnutls_write: bytes=%d", (int)bytes));
+/*
+ * 'http_gnutls_session_find()' - Find an unexpired cached session.
+ *
+ * The session mutex must be held by the caller.
+ */
 
-  return (bytes);
+static _http_tls_session_t *		/* O - Session or NULL */
+http_gnutls_session_find(
+    cups_array_t *sessions,		/* I - Session cache */
+    const void   *key,			/* I - Key */
+    size_t       keylen)		/* I - Length of key */
+{
+  _http_tls_session_t	key_s,		/* Search key */
+			*match;		/* Matching session */
+
+
+  if (!sessions || keylen > sizeof(key_s.key))
+    return (NULL);
+
+  memcpy(key_s.key, key, keylen);
+  key_s.keylen = keylen;
+
+  if ((match = (_http_tls_session_t *)cupsArrayFind(sessions, &key_s)) != NULL &&
+      match->expires < time(NULL))
+  {
+    cupsArrayRemove(sessions, match);
+    free(match->data.data);
+    free(match);
+    match = NULL;
+  }
+
+  return (match);
 }
 
 
 /*
- * '_httpTLSInitialize()' - Initialize the TLS stack.
+ * 'http_gnutls_session_name()' - Get the client session cache key for a
+ *                                connection.
  */
 
-void
-_httpTLSInitialize(void)
+static void
+http_gnutls_session_name(
+    http_t *http,			/* I - Connection to server */
+    char   *buffer,			/* I - Key buffer */
+    size_t bufsize)			/* I - Size of key buffer */
 {
- /*
-  * Initialize GNU TLS...
-  */
+  snprintf(buffer, bufsize, "%s:%d", http->hostname,
+           httpAddrPort(http->hostaddr));
+}
 
-  gnutls_global_init();
+
+/*
+ * 'http_gnutls_session_remove()' - Remove a server session from the cache.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_gnutls_session_remove(
+    void           *ptr,		/* I - User data (unused) */
+    gnutls_datum_t key)			/* I - Session ID */
+{
+  _http_tls_session_t	*session;	/* Cached session */
+
+
+  (void)ptr;
+
+  _cupsMutexLock(&tls_session_mutex);
+
+  if ((session = http_gnutls_session_find(tls_server_sessions, key.data,
+                                          key.size)) != NULL)
+  {
+    cupsArrayRemove(tls_server_sessions, session);
+    free(session->data.data);
+    free(session);
+  }
+
+  _cupsMutexUnlock(&tls_session_mutex);
+
+  return (session ? 0 : -1);
 }
 
 
 /*
- * '_httpTLSPending()' - Return the number of pending TLS-encrypted bytes.
+ * 'http_gnutls_session_retrieve()' - Retrieve a server session from the cache.
  */
 
-size_t					/* O - Bytes available */
-_httpTLSPending(http_t *http)		/* I - HTTP connection */
+static gnutls_datum_t			/* O - Session data */
+http_gnutls_session_retrieve(
+    void           *ptr,		/* I - User data (unused) */
+    gnutls_datum_t key)			/* I - Session ID */
 {
-  return (gnutls_record_check_pending(http->tls));
+  _http_tls_session_t	*session;	/* Cached session */
+  gnutls_datum_t	data = { NULL, 0 };
+					/* Session data */
+
+
+  (void)ptr;
+
+  _cupsMutexLock(&tls_session_mutex);
+
+  if ((session = http_gnutls_session_find(tls_server_sessions, key.data,
+                                          key.size)) != NULL &&
+      (data.data = gnutls_malloc(session->data.size)) != NULL)
+  {
+    memcpy(data.data, session->data.data, session->data.size);
+    data.size = session->data.size;
+  }
+
+  _cupsMutexUnlock(&tls_session_mutex);
+
+  return (data);
 }
 
 
 /*
- * '_httpTLSRead()' - Read from a SSL/TLS connection.
+ * 'http_gnutls_session_save()' - Save a session in a cache.
+ *
+ * The session mutex must be held by the caller.
  */
 
-int					/* O - Bytes read */
-_httpTLSRead(http_t *http,		/* I - Connection to server */
-	     char   *buf,		/* I - Buffer to store data */
-	     int    len)		/* I - Length of buffer */
+static int				/* O - 0 on success, -1 on error */
+http_gnutls_session_save(
+    cups_array_t   **sessions,		/* IO - Session cache */
+    int            max_sessions,	/* I  - Maximum number of sessions */
+    const void     *key,		/* I  - Key */
+    size_t         keylen,		/* I  - Length of key */
+    gnutls_datum_t *data)		/* I  - Session data */
 {
-  ssize_t	result;			/* Return value */
+  _http_tls_session_t	*session,	/* Cached session */
+			*oldest;	/* Oldest session */
 
 
-  result = gnutls_record_recv(http->tls, buf, (size_t)len);
+  if (keylen > sizeof(session->key) || !data->data || !data->size)
+    return (-1);
 
-  if (result < 0 && !errno)
+  if (!*sessions &&
+      (*sessions = cupsArrayNew((cups_array_func_t)http_gnutls_session_compare,
+                                NULL)) == NULL)
+    return (-1);
+
+  if ((session = http_gnutls_session_find(*sessions, key, keylen)) != NULL)
   {
    /*
-    * Convert GNU TLS error to errno value...
+    * Replace the existing session data...
     */
 
-    switch (result)
+    cupsArrayRemove(*sessions, session);
+    free(session->data.data);
+  }
+  else
+  {
+    if (cupsArrayCount(*sessions) >= max_sessions)
     {
-      case GNUTLS_E_INTERRUPTED :
-	  errno = EINTR;
-	  break;
+     /*
+      * Make room by removing the session that expires first...
+      */
 
-      case GNUTLS_E_AGAIN :
-          errno = EAGAIN;
-          break;
+      for (oldest = session = (_http_tls_session_t *)cupsArrayFirst(*sessions);
+	   session;
+	   session = (_http_tls_session_t *)cupsArrayNext(*sessions))
+	if (session->expires < oldest->expires)
+	  oldest = session;
 
-      default :
-          errno = EPIPE;
-          break;
+      cupsArrayRemove(*sessions, oldest);
+      free(oldest->data.data);
+      free(oldest);
     }
 
-    result = -1;
+    if ((session = calloc(1, sizeof(_http_tls_session_t))) == NULL)
+      return (-1);
+
+    memcpy(session->key, key, keylen);
+    session->keylen = keylen;
   }
 
-  return ((int)result);
+  if ((session->data.data = malloc(data->size)) == NULL)
+  {
+    free(session);
+    return (-1);
+  }
+
+  memcpy(session->data.data, data->data, data->size);
+  session->data.size = data->size;
+  session->expires   = time(NULL) + _HTTP_TLS_SESSION_LIFE;
+
+  cupsArrayAdd(*sessions, session);
+
+  return (0);
 }
 
 
 /*
- * '_httpTLSSetCredentials()' - Set the TLS credentials.
+ * 'http_gnutls_session_store()' - Store a server session in the cache.
  */
 
-int					/* O - Status of connection */
-_httpTLSSetCredentials(http_t *http)	/* I - Connection to server */
+static int				/* O - 0 on success, -1 on error */
+http_gnutls_session_store(
+    void           *ptr,		/* I - User data (unused) */
+    gnutls_datum_t key,			/* I - Session ID */
+    gnutls_datum_t data)		/* I - Session data */
 {
-  (void)http;
+  int	status;				/* Status of save */
 
-  return (0);
+
+  (void)ptr;
+
+  _cupsMutexLock(&tls_session_mutex);
+  status = http_gnutls_session_save(&tls_server_sessions, _HTTP_TLS_MAX_SERVER,
+                                    key.data, key.size, &data);
+  _cupsMutexUnlock(&tls_session_mutex);
+
+  return (status);
 }
 
 
 /*
- * '_httpTLSStart()' - Set up SSL/TLS support on a connection.
+ * 'http_gnutls_start()' - Create the TLS session for a connection.
  */
 
-int					/* O - 0 on success, -1 on failure */
-_httpTLSStart(http_t *http)		/* I - Connection to server */
+static int				/* O - 0 on success, -1 on failure */
+http_gnutls_start(http_t *http)		/* I - Connection to server */
 {
   char			hostname[256],	/* Hostname */
 			*hostptr;	/* Pointer into hostname */
-  int			status;		/* Status of handshake */
+  int			status;		/* Status of setup */
   gnutls_certificate_credentials_t *credentials;
 					/* TLS credentials */
 
 
-  DEBUG_printf(("7_httpTLSStart(http=%p)", http));
+  DEBUG_printf(("7http_gnutls_start(http=%p)", http));
 
   if (http->mode == _HTTP_MODE_SERVER && !tls_keypath)
   {
@@ -1168,6 +1333,52 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   if (!status)
     status = gnutls_credentials_set(http->tls, GNUTLS_CRD_CERTIFICATE, *credentials);
 
+  if (!status)
+  {
+    if (http->mode == _HTTP_MODE_CLIENT)
+    {
+     /*
+      * Client: resume a previous session with this server, if any...
+      */
+
+      char		name[300];	/* Session cache key */
+      _http_tls_session_t *session;	/* Cached session */
+
+      http_gnutls_session_name(http, name, sizeof(name));
+
+      _cupsMutexLock(&tls_session_mutex);
+
+      if ((session = http_gnutls_session_find(tls_client_sessions, name,
+                                              strlen(name))) != NULL)
+      {
+        DEBUG_printf(("4_httpTLSStart: Resuming session for \"%s\".", name));
+	gnutls_session_set_data(http->tls, session->data.data,
+	                        session->data.size);
+      }
+
+      _cupsMutexUnlock(&tls_session_mutex);
+    }
+    else
+    {
+     /*
+      * Server: support resumption using session tickets and session IDs...
+      */
+
+      _cupsMutexLock(&tls_session_mutex);
+      if (!tls_ticket_key.data)
+        gnutls_session_ticket_key_generate(&tls_ticket_key);
+      _cupsMutexUnlock(&tls_session_mutex);
+
+      if (tls_ticket_key.data)
+        gnutls_session_ticket_enable_server(http->tls, &tls_ticket_key);
+
+      gnutls_db_set_retrieve_function(http->tls, http_gnutls_session_retrieve);
+      gnutls_db_set_store_function(http->tls, http_gnutls_session_store);
+      gnutls_db_set_remove_function(http->tls, http_gnutls_session_remove);
+      gnutls_db_set_cache_expiration(http->tls, _HTTP_TLS_SESSION_LIFE);
+    }
+  }
+
   if (status)
   {
     http->error  = EIO;
@@ -1191,33 +1402,183 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 #endif /* HAVE_GNUTLS_TRANSPORT_SET_PULL_TIMEOUT_FUNCTION */
   gnutls_transport_set_push_function(http->tls, http_gnutls_write);
 
-  while ((status = gnutls_handshake(http->tls)) != GNUTLS_E_SUCCESS)
+  http->tls_credentials = credentials;
+
+  return (0);
+}
+
+
+/*
+ * 'http_gnutls_write()' - Write function for the GNU TLS library.
+ */
+
+static ssize_t				/* O - Number of bytes written or -1 on error */
+http_gnutls_write(
+    gnutls_transport_ptr_t ptr,		/* I - Connection to server */
+    const void             *data,	/* I - Data buffer */
+    size_t                 length)	/* I - Number of bytes to write */
+{
+  ssize_t bytes;			/* Bytes written */
+
+
+  DEBUG_printf(("6http_gnutls_write(ptr=%p, data=%p, length=%d)", ptr, data,
+                (int)length));
+  bytes = send(((http_t *)ptr)->fd, data, length, 0);
+  DEBUG_printf(("http_gnutls_write: bytes=%d", (int)bytes));
+
+  return (bytes);
+}
+
+
+/*
+ * '_httpTLSHandshake()' - Perform one step of the SSL/TLS handshake.
+ *
+ * The TLS session is created on the first call.  When the socket is
+ * non-blocking, 0 is returned until the handshake completes and "wantwrite"
+ * is set to 1 when the socket must be writable (rather than readable) for the
+ * next step.
+ */
+
+int					/* O - 1 when done, 0 to try again, -1 on error */
+_httpTLSHandshake(http_t *http,		/* I - Connection to server */
+                  int    *wantwrite)	/* O - 1 to wait for writing, 0 for reading */
+{
+  int	status;				/* Status of handshake */
+
+
+  DEBUG_printf(("7_httpTLSHandshake(http=%p, wantwrite=%p)", http, wantwrite));
+
+  if (!http->tls && http_gnutls_start(http))
+    return (-1);
+
+  if ((status = gnutls_handshake(http->tls)) == GNUTLS_E_SUCCESS)
+    return (1);
+
+  DEBUG_printf(("8_httpTLSHandshake: gnutls_handshake returned %d (%s)",
+                status, gnutls_strerror(status)));
+
+  if (gnutls_error_is_fatal(status))
   {
-    DEBUG_printf(("5_httpStartTLS: gnutls_handshake returned %d (%s)",
-                  status, gnutls_strerror(status)));
+    http->error  = EIO;
+    http->status = HTTP_STATUS_ERROR;
 
-    if (gnutls_error_is_fatal(status))
-    {
-      http->error  = EIO;
-      http->status = HTTP_STATUS_ERROR;
+    _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
-      _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
+    gnutls_deinit(http->tls);
+    gnutls_certificate_free_credentials(*(http->tls_credentials));
+    free(http->tls_credentials);
+    http->tls             = NULL;
+    http->tls_credentials = NULL;
+
+    return (-1);
+  }
 
-      gnutls_deinit(http->tls);
-      gnutls_certificate_free_credentials(*credentials);
-      free(credentials);
-      http->tls = NULL;
+  if (wantwrite)
+    *wantwrite = gnutls_record_get_direction(http->tls);
 
-      return (-1);
+  return (0);
+}
+
+
+/*
+ * '_httpTLSInitialize()' - Initialize the TLS stack.
+ */
+
+void
+_httpTLSInitialize(void)
+{
+ /*
+  * Initialize GNU TLS...
+  */
+
+  gnutls_global_init();
+}
+
+
+/*
+ * '_httpTLSPending()' - Return the number of pending TLS-encrypted bytes.
+ */
+
+size_t					/* O - Bytes available */
+_httpTLSPending(http_t *http)		/* I - HTTP connection */
+{
+  return (gnutls_record_check_pending(http->tls));
+}
+
+
+/*
+ * '_httpTLSRead()' - Read from a SSL/TLS connection.
+ */
+
+int					/* O - Bytes read */
+_httpTLSRead(http_t *http,		/* I - Connection to server */
+	     char   *buf,		/* I - Buffer to store data */
+	     int    len)		/* I - Length of buffer */
+{
+  ssize_t	result;			/* Return value */
+
+
+  result = gnutls_record_recv(http->tls, buf, (size_t)len);
+
+  if (result < 0 && !errno)
+  {
+   /*
+    * Convert GNU TLS error to errno value...
+    */
+
+    switch (result)
+    {
+      case GNUTLS_E_INTERRUPTED :
+	  errno = EINTR;
+	  break;
+
+      case GNUTLS_E_AGAIN :
+          errno = EAGAIN;
+          break;
+
+      default :
+          errno = EPIPE;
+          break;
     }
+
+    result = -1;
   }
 
-  http->tls_credentials = credentials;
+  return ((int)result);
+}
+
+
+/*
+ * '_httpTLSSetCredentials()' - Set the TLS credentials.
+ */
+
+int					/* O - Status of connection */
+_httpTLSSetCredentials(http_t *http)	/* I - Connection to server */
+{
+  (void)http;
 
   return (0);
 }
 
 
+/*
+ * '_httpTLSStart()' - Set up SSL/TLS support on a connection.
+ */
+
+int					/* O - 0 on success, -1 on failure */
+_httpTLSStart(http_t *http)		/* I - Connection to server */
+{
+  int	status;				/* Status of handshake */
+
+
+  DEBUG_printf(("7_httpTLSStart(http=%p)", http));
+
+  while ((status = _httpTLSHandshake(http, NULL)) == 0);
+
+  return (status > 0 ? 0 : -1);
+}
+
+
 /*
  * '_httpTLSStop()' - Shut down SSL/TLS on a connection.
  */
@@ -1228,6 +1589,30 @@ _httpTLSStop(http_t *http)		/* I - Connection to server */
   int	error;				/* Error code */
 
 
+  if (http->mode == _HTTP_MODE_CLIENT)
+  {
+   /*
+    * Save the session so the next connection to this server can resume it;
+    * doing this at shutdown picks up any TLS 1.3 tickets sent after the
+    * handshake...
+    */
+
+    char		name[300];	/* Session cache key */
+    gnutls_datum_t	data;		/* Session data */
+
+    if (!gnutls_session_get_data2(http->tls, &data))
+    {
+      http_gnutls_session_name(http, name, sizeof(name));
+
+      _cupsMutexLock(&tls_session_mutex);
+      http_gnutls_session_save(&tls_client_sessions, _HTTP_TLS_MAX_CLIENT,
+                               name, strlen(name), &data);
+      _cupsMutexUnlock(&tls_session_mutex);
+
+      gnutls_free(data.data);
+    }
+  }
+
   error = gnutls_bye(http->tls, http->mode == _HTTP_MODE_CLIENT ? GNUTLS_SHUT_RDWR : GNUTLS_SHUT_WR);
   if (error != GNUTLS_E_SUCCESS)
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, gnutls_strerror(errno), 0);
@@ -212,6 +212,7 @@ cupsSetCredentials(
     return (-1);
 
 #ifdef HAVE_SSL
+  _httpPoolClose(cg->tls_credentials);
   _httpFreeCredentials(cg->tls_credentials);
   cg->tls_credentials = _httpCreateCredentials(credentials);
 #endif /* HAVE_SSL */
@@ -21,8 +21,8 @@
  * This header defines several constants - _CUPS_DEPRECATED,
  * _CUPS_DEPRECATED_MSG, _CUPS_INTERNAL_MSG, _CUPS_API_1_1, _CUPS_API_1_1_19,
  * _CUPS_API_1_1_20, _CUPS_API_1_1_21, _CUPS_API_1_2, _CUPS_API_1_3,
- * _CUPS_API_1_4, _CUPS_API_1_5, _CUPS_API_1_6, _CUPS_API_1_7, and
- * _CUPS_API_2_0 - which add compiler-specific attributes that flag functions
+ * _CUPS_API_1_4, _CUPS_API_1_5, _CUPS_API_1_6, _CUPS_API_1_7, _CUPS_API_2_0,
+ * and _CUPS_API_2_1 - which add compiler-specific attributes that flag functions
  * that are deprecated, added in particular releases, or internal to CUPS.
  *
  * On OS X, the _CUPS_API_* constants are defined based on the values of
@@ -63,6 +63,7 @@
 #    define _CUPS_API_1_6 AVAILABLE_MAC_OS_X_VERSION_10_8_AND_LATER
 #    define _CUPS_API_1_7 AVAILABLE_MAC_OS_X_VERSION_10_9_AND_LATER
 #    define _CUPS_API_2_0
+#    define _CUPS_API_2_1
 #  else
 #    define _CUPS_API_1_1_19
 #    define _CUPS_API_1_1_20
@@ -74,6 +75,7 @@
 #    define _CUPS_API_1_6
 #    define _CUPS_API_1_7
 #    define _CUPS_API_2_0
+#    define _CUPS_API_2_1
 #  endif /* __APPLE__ && !_CUPS_SOURCE */
 
 /*
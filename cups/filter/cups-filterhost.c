@@ -0,0 +1,393 @@
+/*
+ * "$Id$"
+ *
+ * Filter host for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ *
+ * Usage:
+ *
+ *   CUPS_FILTER_CHAIN="filter filter ..." cups-filterhost job-id user title
+ *       copies options [filename]
+ *
+ * Runs a chain of built-in filter plugins as threads in a single process.
+ * The first filter reads the print file (or stdin), the last filter writes
+ * to stdout, and each filter hands its output directly to the next one's
+ * read buffer instead of going through a pipe.  Stdin and stdout may also be
+ * shared memory rings to the neighboring filters.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "filter-plugin.h"
+#include <cups/file-private.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define MAX_STAGES	10		/* Maximum number of filters in a chain */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct host_channel_s		/**** Channel between two filters ****/
+{
+  pthread_mutex_t	mutex;		/* Channel lock */
+  pthread_cond_t	cond;		/* Channel condition */
+  const char		*data;		/* Data offered by the writer */
+  size_t		length;		/* Bytes of data remaining */
+  int			writer_done,	/* Writer closed its end? */
+			reader_done;	/* Reader closed its end? */
+} host_channel_t;
+
+typedef struct host_stage_s		/**** Filter in the chain ****/
+{
+  const cups_filter_plugin_t	*plugin;/* Filter plugin */
+  cups_filter_args_t		args;	/* Arguments for filter */
+  pthread_t			thread;	/* Thread running the filter */
+  int				started,/* Thread started? */
+				status;	/* Exit status of filter */
+} host_stage_t;
+
+
+/*
+ * Local globals...
+ */
+
+static const cups_filter_plugin_t * const plugins[] =
+{					/* Built-in filter plugins */
+  &gziptoany_plugin,
+  &rastertopwg_plugin
+};
+
+
+/*
+ * Local functions...
+ */
+
+static ssize_t	channel_read(void *ctx, char *buffer, size_t bytes);
+static ssize_t	channel_write(void *ctx, char *buffer, size_t bytes);
+static void	*run_stage(host_stage_t *stage);
+
+
+/*
+ * 'main()' - Run a chain of filter plugins.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line args */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int			i,		/* Looping var */
+			num_stages;	/* Number of filters */
+  host_stage_t		stages[MAX_STAGES];
+					/* Filters */
+  host_channel_t	channels[MAX_STAGES - 1];
+					/* Channels between filters */
+  const char		*chain;		/* CUPS_FILTER_CHAIN env variable */
+  char			name[256],	/* Filter name */
+			*nameptr;	/* Pointer into name */
+  int			num_options;	/* Number of options */
+  cups_option_t		*options = NULL;/* Options */
+  int			status = 0;	/* Exit status */
+
+
+ /*
+  * Check command-line...
+  */
+
+  if (argc < 6 || argc > 7)
+  {
+    _cupsLangPrintf(stderr,
+                    _("Usage: %s job-id user title copies options [file]"),
+                    argv[0]);
+    return (1);
+  }
+
+  if ((chain = getenv("CUPS_FILTER_CHAIN")) == NULL)
+  {
+    fputs("ERROR: CUPS_FILTER_CHAIN is not set.\n", stderr);
+    return (1);
+  }
+
+ /*
+  * Look up the filters in the chain...
+  */
+
+  memset(stages, 0, sizeof(stages));
+
+  for (num_stages = 0; *chain;)
+  {
+    while (isspace(*chain & 255))
+      chain ++;
+
+    if (!*chain)
+      break;
+
+    for (nameptr = name; *chain && !isspace(*chain & 255); chain ++)
+      if (nameptr < (name + sizeof(name) - 1))
+        *nameptr++ = *chain;
+
+    *nameptr = '\0';
+
+    if (num_stages >= MAX_STAGES)
+    {
+      fprintf(stderr, "ERROR: Too many filters in chain (%d max).\n",
+              MAX_STAGES);
+      return (1);
+    }
+
+    for (i = 0; i < (int)(sizeof(plugins) / sizeof(plugins[0])); i ++)
+      if (!strcmp(name, plugins[i]->name) &&
+          plugins[i]->version == CUPS_FILTER_PLUGIN_VERSION)
+        break;
+
+    if (i >= (int)(sizeof(plugins) / sizeof(plugins[0])))
+    {
+      fprintf(stderr, "ERROR: Unknown filter plugin \"%s\".\n", name);
+      return (1);
+    }
+
+    stages[num_stages ++].plugin = plugins[i];
+  }
+
+  if (num_stages == 0)
+  {
+    fputs("ERROR: No filters in CUPS_FILTER_CHAIN.\n", stderr);
+    return (1);
+  }
+
+ /*
+  * Open the input and output files and the channels between filters...
+  */
+
+  num_options = cupsParseOptions(argv[5], 0, &options);
+
+  for (i = 0; i < num_stages; i ++)
+  {
+    stages[i].args.job_id      = atoi(argv[1]);
+    stages[i].args.user        = argv[2];
+    stages[i].args.title       = argv[3];
+    stages[i].args.copies      = atoi(argv[4]);
+    stages[i].args.num_options = num_options;
+    stages[i].args.options     = options;
+  }
+
+  if (argc == 7)
+    stages[0].args.in = cupsFileOpen(argv[6], "r");
+  else
+    stages[0].args.in = cupsFileStdin();
+
+  if (!stages[0].args.in)
+  {
+    _cupsLangPrintError("ERROR", _("Unable to open print file"));
+    return (1);
+  }
+
+  if ((stages[num_stages - 1].args.out = cupsFileStdout()) == NULL)
+  {
+    perror("ERROR: Unable to open output");
+    return (1);
+  }
+
+  for (i = 0; i < (num_stages - 1); i ++)
+  {
+    memset(channels + i, 0, sizeof(host_channel_t));
+    pthread_mutex_init(&channels[i].mutex, NULL);
+    pthread_cond_init(&channels[i].cond, NULL);
+
+    stages[i].args.out    = _cupsFileOpenIO(channel_write, channels + i, "w");
+    stages[i + 1].args.in = _cupsFileOpenIO(channel_read, channels + i, "r");
+
+    if (!stages[i].args.out || !stages[i + 1].args.in)
+    {
+      perror("ERROR: Unable to create filter channel");
+      return (1);
+    }
+  }
+
+ /*
+  * Start a thread for each filter and wait for them to finish, returning the
+  * first non-zero exit status...
+  */
+
+  for (i = 0; i < num_stages; i ++)
+  {
+    fprintf(stderr, "DEBUG: Starting filter plugin %s.\n",
+            stages[i].plugin->name);
+
+    if (pthread_create(&stages[i].thread, NULL,
+                       (void *(*)(void *))run_stage, stages + i) == 0)
+      stages[i].started = 1;
+    else
+    {
+      perror("ERROR: Unable to start filter thread");
+
+     /*
+      * Close this filter's end of the chain so the others can finish...
+      */
+
+      cupsFileClose(stages[i].args.in);
+      cupsFileClose(stages[i].args.out);
+
+      stages[i].status = 1;
+    }
+  }
+
+  for (i = 0; i < num_stages; i ++)
+  {
+    if (stages[i].started)
+      pthread_join(stages[i].thread, NULL);
+
+    if (stages[i].status && !status)
+    {
+      fprintf(stderr, "DEBUG: Filter plugin %s exited with status %d.\n",
+              stages[i].plugin->name, stages[i].status);
+      status = stages[i].status;
+    }
+  }
+
+  cupsFreeOptions(num_options, options);
+
+  return (status);
+}
+
+
+/*
+ * 'channel_read()' - Read data offered by the previous filter.
+ *
+ * Data is copied straight from the writer's buffer; a NULL buffer closes the
+ * reading end of the channel.
+ */
+
+static ssize_t				/* O - Bytes read, 0 on EOF */
+channel_read(void   *ctx,		/* I - Channel */
+             char   *buffer,		/* I - Buffer */
+	     size_t bytes)		/* I - Size of buffer */
+{
+  host_channel_t	*channel = (host_channel_t *)ctx;
+					/* Channel */
+  size_t		count;		/* Bytes copied */
+
+
+  pthread_mutex_lock(&channel->mutex);
+
+  if (!buffer)
+  {
+    channel->reader_done = 1;
+    pthread_cond_broadcast(&channel->cond);
+    pthread_mutex_unlock(&channel->mutex);
+
+    return (0);
+  }
+
+  while (!channel->length && !channel->writer_done)
+    pthread_cond_wait(&channel->cond, &channel->mutex);
+
+  if ((count = channel->length) > bytes)
+    count = bytes;
+
+  if (count > 0)
+  {
+    memcpy(buffer, channel->data, count);
+
+    channel->data   += count;
+    channel->length -= count;
+
+    if (!channel->length)
+      pthread_cond_broadcast(&channel->cond);
+  }
+
+  pthread_mutex_unlock(&channel->mutex);
+
+  return ((ssize_t)count);
+}
+
+
+/*
+ * 'channel_write()' - Offer data to the next filter.
+ *
+ * Waits until the reader has copied all of the data or closed its end; a
+ * NULL buffer marks the end of the data.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+channel_write(void   *ctx,		/* I - Channel */
+              char   *buffer,		/* I - Buffer */
+	      size_t bytes)		/* I - Number of bytes */
+{
+  host_channel_t	*channel = (host_channel_t *)ctx;
+					/* Channel */
+  ssize_t		count;		/* Bytes written */
+
+
+  pthread_mutex_lock(&channel->mutex);
+
+  if (!buffer)
+  {
+    channel->writer_done = 1;
+    pthread_cond_broadcast(&channel->cond);
+    pthread_mutex_unlock(&channel->mutex);
+
+    return (0);
+  }
+
+  channel->data   = buffer;
+  channel->length = bytes;
+
+  pthread_cond_broadcast(&channel->cond);
+
+  while (channel->length && !channel->reader_done)
+    pthread_cond_wait(&channel->cond, &channel->mutex);
+
+  count           = (ssize_t)(bytes - channel->length);
+  channel->data   = NULL;
+  channel->length = 0;
+
+  pthread_mutex_unlock(&channel->mutex);
+
+  if (count == 0)
+  {
+    errno = EPIPE;
+    return (-1);
+  }
+
+  return (count);
+}
+
+
+/*
+ * 'run_stage()' - Run a filter plugin and close its input and output.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+run_stage(host_stage_t *stage)		/* I - Filter */
+{
+  stage->status = (stage->plugin->func)(&stage->args);
+
+  cupsFileClose(stage->args.in);
+
+  if (cupsFileClose(stage->args.out) && !stage->status)
+    stage->status = 1;
+
+  return (NULL);
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -0,0 +1,425 @@
+/*
+ * "$Id$"
+ *
+ * Raster merge program for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ *
+ * Usage:
+ *
+ *   cups-rastermerge {cups|pwg} pages-per-block num-blocks fd [... fd]
+ *
+ * Merges the raster streams from parallel filter chains into a single
+ * stream on stdout.  The scheduler gives chain N the pages in blocks N,
+ * N + num-fds, N + 2 * num-fds, and so forth, with the last chain also
+ * getting every page after "num-blocks" blocks, so the blocks are copied
+ * round-robin from each file descriptor until one of them runs out of pages.
+ *
+ * All of the chains are read as soon as they produce data, with anything
+ * that is not needed yet queued in a spool file for that chain, so that no
+ * chain waits on the blocks of the chains before it.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/cups-private.h>
+#include <cups/raster.h>
+#include <poll.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define MAX_CHAINS	16		/* Maximum number of filter chains */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct chain_s			/**** Filter chain ****/
+{
+  int		number,			/* Chain number */
+		fd,			/* Pipe from chain or -1 at EOF */
+		spoolfd;		/* Spool file for queued data */
+  off_t		rpos,			/* Read position in spool file */
+		wpos,			/* Write position in spool file */
+		received;		/* Total bytes received from chain */
+  cups_raster_t	*ras;			/* Raster stream */
+} chain_t;
+
+
+/*
+ * Local globals...
+ */
+
+static chain_t	chains[MAX_CHAINS];	/* Filter chains */
+static int	num_chains = 0;		/* Number of filter chains */
+
+
+/*
+ * Local functions...
+ */
+
+static int	copy_pages(cups_raster_t *in, cups_raster_t *out, int count,
+		           unsigned char **buffer, size_t *bufsize);
+static int	queue_chains(int timeout);
+static ssize_t	read_chain(chain_t *chain, unsigned char *buffer,
+		           size_t bytes);
+static void	usage(void) __attribute__((noreturn));
+
+
+/*
+ * 'main()' - Merge raster streams.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line args */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int			i;		/* Looping var */
+  chain_t		*chain;		/* Current chain */
+  char			filename[1024];	/* Spool filename */
+  cups_raster_t		*out;		/* Raster stream to stdout */
+  cups_mode_t		mode;		/* Output mode */
+  int			block,		/* Current block */
+			pages_per_block,/* Number of pages in each block */
+			num_blocks,	/* Number of round-robin blocks */
+			count,		/* Number of pages to copy */
+			copied,		/* Number of pages copied */
+			total = 0;	/* Total number of pages */
+  unsigned char		*buffer = NULL;	/* Line buffer */
+  size_t		bufsize = 0;	/* Size of line buffer */
+
+
+ /*
+  * Check command-line...
+  */
+
+  if (argc < 5 || (argc - 4) > MAX_CHAINS)
+    usage();
+
+  if (!strcmp(argv[1], "pwg"))
+    mode = CUPS_RASTER_WRITE_PWG;
+  else if (!strcmp(argv[1], "cups"))
+    mode = CUPS_RASTER_WRITE_COMPRESSED;
+  else
+    usage();
+
+  if ((pages_per_block = atoi(argv[2])) < 1 ||
+      (num_blocks = atoi(argv[3])) < 1)
+    usage();
+
+  for (i = 4, chain = chains; i < argc; i ++, chain ++, num_chains ++)
+  {
+    chain->number = num_chains + 1;
+    chain->fd     = atoi(argv[i]);
+
+    if ((chain->spoolfd = cupsTempFd(filename, sizeof(filename))) < 0)
+    {
+      fprintf(stderr, "DEBUG: Unable to create spool file: %s\n",
+              strerror(errno));
+      return (1);
+    }
+
+    unlink(filename);
+  }
+
+  for (i = 0, chain = chains; i < num_chains; i ++, chain ++)
+  {
+    if ((chain->ras = cupsRasterOpenIO((cups_raster_iocb_t)read_chain, chain,
+                                       CUPS_RASTER_READ)) == NULL)
+    {
+     /*
+      * A chain whose blocks all lie past the end of the document closes its
+      * pipe without writing anything...
+      */
+
+      if (chain->fd < 0 && chain->received == 0)
+      {
+        fprintf(stderr, "DEBUG: Chain %d produced no pages.\n",
+	        chain->number);
+	continue;
+      }
+
+      fprintf(stderr, "DEBUG: Unable to open raster stream %s.\n",
+              argv[i + 4]);
+      return (1);
+    }
+  }
+
+  if ((out = cupsRasterOpen(1, mode)) == NULL)
+  {
+    fputs("DEBUG: Unable to open output raster stream.\n", stderr);
+    return (1);
+  }
+
+ /*
+  * Copy the blocks of pages in order...
+  */
+
+  for (block = 0;; block ++)
+  {
+    if (block < num_blocks)
+    {
+      chain = chains + block % num_chains;
+      count = pages_per_block;
+    }
+    else
+    {
+      chain = chains + num_chains - 1;
+      count = INT_MAX;
+    }
+
+    if (!chain->ras)
+      copied = 0;
+    else if ((copied = copy_pages(chain->ras, out, count, &buffer,
+                                  &bufsize)) < 0)
+    {
+      fputs("DEBUG: Unable to write raster data.\n", stderr);
+      return (1);
+    }
+
+    total += copied;
+
+    fprintf(stderr, "DEBUG: Copied %d pages from chain %d.\n", copied,
+            chain->number);
+
+    if (copied < count)
+      break;
+  }
+
+  fprintf(stderr, "DEBUG: Merged %d pages from %d filter chains.\n", total,
+          num_chains);
+
+ /*
+  * Close everything and return...
+  */
+
+  for (i = 0, chain = chains; i < num_chains; i ++, chain ++)
+  {
+    if (chain->ras)
+      cupsRasterClose(chain->ras);
+
+    if (chain->fd >= 0)
+      close(chain->fd);
+
+    close(chain->spoolfd);
+  }
+
+  cupsRasterClose(out);
+
+  free(buffer);
+
+  return (0);
+}
+
+
+/*
+ * 'copy_pages()' - Copy pages from one raster stream to another.
+ */
+
+static int				/* O  - Number of pages or -1 on error */
+copy_pages(cups_raster_t *in,		/* I  - Input stream */
+           cups_raster_t *out,		/* I  - Output stream */
+	   int           count,		/* I  - Maximum number of pages */
+	   unsigned char **buffer,	/* IO - Line buffer */
+	   size_t        *bufsize)	/* IO - Size of line buffer */
+{
+  int			pages;		/* Number of pages copied */
+  unsigned		y;		/* Current line */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		*temp;		/* New line buffer */
+
+
+  for (pages = 0; pages < count && cupsRasterReadHeader2(in, &header);
+       pages ++)
+  {
+    if (!cupsRasterWriteHeader2(out, &header))
+      return (-1);
+
+    if (header.cupsBytesPerLine > *bufsize)
+    {
+      if ((temp = realloc(*buffer, header.cupsBytesPerLine)) == NULL)
+        return (-1);
+
+      *buffer  = temp;
+      *bufsize = header.cupsBytesPerLine;
+    }
+
+    for (y = 0; y < header.cupsHeight; y ++)
+    {
+      if (!cupsRasterReadPixels(in, *buffer, header.cupsBytesPerLine))
+        break;
+
+      if (!cupsRasterWritePixels(out, *buffer, header.cupsBytesPerLine))
+        return (-1);
+    }
+
+    if (y < header.cupsHeight)
+    {
+     /*
+      * Short page, pad it out so that the output stream stays in sync...
+      */
+
+      memset(*buffer, 0, header.cupsBytesPerLine);
+
+      for (; y < header.cupsHeight; y ++)
+        if (!cupsRasterWritePixels(out, *buffer, header.cupsBytesPerLine))
+	  return (-1);
+
+      return (pages + 1);
+    }
+  }
+
+  return (pages);
+}
+
+
+/*
+ * 'queue_chains()' - Queue the data that is available from the filter chains.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+queue_chains(int timeout)		/* I - Timeout in milliseconds */
+{
+  int		i,			/* Looping var */
+		nfds;			/* Number of file descriptors */
+  chain_t	*chain,			/* Current chain */
+		*pchains[MAX_CHAINS];	/* Chains being polled */
+  struct pollfd	pfds[MAX_CHAINS];	/* Chain file descriptors */
+  ssize_t	bytes;			/* Bytes read */
+  char		buffer[65536];		/* Copy buffer */
+
+
+  for (i = 0, nfds = 0, chain = chains; i < num_chains; i ++, chain ++)
+  {
+    if (chain->fd < 0)
+      continue;
+
+    pchains[nfds]      = chain;
+    pfds[nfds].fd      = chain->fd;
+    pfds[nfds].events  = POLLIN;
+    pfds[nfds].revents = 0;
+    nfds ++;
+  }
+
+  if (nfds == 0)
+    return (0);
+
+  while (poll(pfds, (nfds_t)nfds, timeout) < 0)
+    if (errno != EINTR && errno != EAGAIN)
+      return (-1);
+
+  for (i = 0; i < nfds; i ++)
+  {
+    if (!pfds[i].revents)
+      continue;
+
+    chain = pchains[i];
+
+    while ((bytes = read(chain->fd, buffer, sizeof(buffer))) < 0)
+      if (errno != EINTR && errno != EAGAIN)
+        return (-1);
+
+    if (bytes == 0)
+    {
+      close(chain->fd);
+      chain->fd = -1;
+      continue;
+    }
+
+    if (pwrite(chain->spoolfd, buffer, (size_t)bytes, chain->wpos) != bytes)
+    {
+      fprintf(stderr, "DEBUG: Unable to queue data from chain %d: %s\n",
+              chain->number, strerror(errno));
+      return (-1);
+    }
+
+    chain->wpos     += bytes;
+    chain->received += bytes;
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'read_chain()' - Read queued raster data from a filter chain.
+ */
+
+static ssize_t				/* O - Bytes read, 0 on EOF, -1 on error */
+read_chain(chain_t       *chain,	/* I - Filter chain */
+           unsigned char *buffer,	/* I - Buffer */
+	   size_t        bytes)		/* I - Maximum number of bytes */
+{
+  ssize_t	rbytes;			/* Bytes read */
+
+
+ /*
+  * Pick up whatever the other chains have written so far, then wait for
+  * this chain...
+  */
+
+  if (queue_chains(0))
+    return (-1);
+
+  while (chain->rpos == chain->wpos && chain->fd >= 0)
+    if (queue_chains(-1))
+      return (-1);
+
+  if (chain->rpos == chain->wpos)
+    return (0);
+
+  if ((off_t)bytes > (chain->wpos - chain->rpos))
+    bytes = (size_t)(chain->wpos - chain->rpos);
+
+  if ((rbytes = pread(chain->spoolfd, buffer, bytes, chain->rpos)) <= 0)
+    return (-1);
+
+  chain->rpos += rbytes;
+
+  if (chain->rpos == chain->wpos)
+  {
+   /*
+    * Everything queued has been read, start over at the beginning of the
+    * spool file...
+    */
+
+    chain->rpos = chain->wpos = 0;
+
+    if (ftruncate(chain->spoolfd, 0))
+      return (-1);
+  }
+
+  return (rbytes);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  fputs("Usage: cups-rastermerge {cups|pwg} pages-per-block num-blocks fd "
+        "[... fd]\n", stderr);
+  exit(1);
+}
+
+
+/*
+ * End of "$Id$".
+ */
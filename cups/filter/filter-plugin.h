@@ -0,0 +1,96 @@
+/*
+ * "$Id$"
+ *
+ * Filter plugin definitions for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+#ifndef _CUPS_FILTER_PLUGIN_H_
+#  define _CUPS_FILTER_PLUGIN_H_
+
+/*
+ * Include necessary headers...
+ */
+
+#  include <cups/cups-private.h>
+
+
+/*
+ * C++ magic...
+ */
+
+#  ifdef __cplusplus
+extern "C" {
+#  endif /* __cplusplus */
+
+
+/*
+ * A filter plugin is a filter that can run as a thread inside the
+ * "cups-filterhost" program.  Instead of reading stdin and writing stdout it
+ * is given its input and output as CUPS files; between stages of the same
+ * host these are backed by in-memory buffers rather than pipes.  Plugins
+ * still use the environment and stderr like any other filter, and must
+ * return rather than call exit().  The input and output files are closed by
+ * the host after the filter function returns.
+ */
+
+/*
+ * Constants...
+ */
+
+#  define CUPS_FILTER_PLUGIN_VERSION 1	/* Current plugin ABI version */
+
+
+/*
+ * Types and structures...
+ */
+
+typedef struct cups_filter_args_s	/**** Filter plugin arguments ****/
+{
+  int		job_id;			/* Job ID */
+  const char	*user,			/* Username */
+		*title;			/* Job title */
+  int		copies;			/* Number of copies */
+  int		num_options;		/* Number of options */
+  cups_option_t	*options;		/* Options */
+  cups_file_t	*in,			/* Input file */
+		*out;			/* Output file */
+} cups_filter_args_t;
+
+typedef int (*cups_filter_func_t)(cups_filter_args_t *args);
+					/**** Filter plugin entry point ****/
+
+typedef struct cups_filter_plugin_s	/**** Filter plugin ****/
+{
+  int			version;	/* CUPS_FILTER_PLUGIN_VERSION */
+  const char		*name;		/* Filter name */
+  cups_filter_func_t	func;		/* Entry point */
+} cups_filter_plugin_t;
+
+
+/*
+ * Built-in plugins...
+ */
+
+extern const cups_filter_plugin_t	gziptoany_plugin,
+					rastertopwg_plugin;
+
+
+#  ifdef __cplusplus
+}
+#  endif /* __cplusplus */
+
+#endif /* !_CUPS_FILTER_PLUGIN_H_ */
+
+/*
+ * End of "$Id$".
+ */
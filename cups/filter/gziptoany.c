@@ -19,9 +19,29 @@
  * Include necessary headers...
  */
 
-#include <cups/cups-private.h>
+#include "filter-plugin.h"
 
 
+/*
+ * Local functions...
+ */
+
+static int	gziptoany(cups_filter_args_t *args);
+
+
+/*
+ * Filter plugin...
+ */
+
+const cups_filter_plugin_t gziptoany_plugin =
+{
+  CUPS_FILTER_PLUGIN_VERSION,
+  "gziptoany",
+  gziptoany
+};
+
+
+#ifndef CUPS_FILTER_PLUGIN
 /*
  * 'main()' - Copy (and uncompress) files to stdout.
  */
@@ -30,10 +50,8 @@ int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
-  cups_file_t	*fp;			/* File */
-  char		buffer[8192];		/* Data buffer */
-  ssize_t	bytes;			/* Number of bytes read/written */
-  int		copies;			/* Number of copies */
+  cups_filter_args_t	args;		/* Filter arguments */
+  int			status;		/* Exit status */
 
 
  /*
@@ -48,58 +66,136 @@ main(int  argc,				/* I - Number of command-line arguments */
     return (1);
   }
 
+ /*
+  * Open the file...
+  */
+
+  memset(&args, 0, sizeof(args));
+
+  args.job_id = atoi(argv[1]);
+  args.user   = argv[2];
+  args.title  = argv[3];
+  args.copies = atoi(argv[4]);
+  args.out    = cupsFileStdout();
+
+  if ((args.in = cupsFileOpen(argv[6], "r")) == NULL)
+  {
+    _cupsLangPrintError("ERROR", _("Unable to open print file"));
+    return (1);
+  }
+
+ /*
+  * Copy the file to stdout...
+  */
+
+  status = gziptoany(&args);
+
+ /*
+  * Close the file and return...
+  */
+
+  cupsFileClose(args.in);
+
+  if (cupsFileFlush(args.out) && !status)
+    status = 1;
+
+  return (status);
+}
+#endif /* !CUPS_FILTER_PLUGIN */
+
+
+/*
+ * 'gziptoany()' - Copy (and uncompress) the input file to the output file.
+ */
+
+static int				/* O - Exit status */
+gziptoany(cups_filter_args_t *args)	/* I - Filter arguments */
+{
+  cups_file_t	*in = args->in,		/* Input file for this copy */
+		*temp = NULL;		/* Temporary file for copies */
+  char		tempfile[1024] = "",	/* Temporary filename */
+		buffer[8192];		/* Data buffer */
+  ssize_t	bytes;			/* Number of bytes read/written */
+  int		copies;			/* Number of copies */
+  int		status = 0;		/* Exit status */
+
+
  /*
   * Get the copy count; if we have no final content type, this is a
   * raw queue or raw print file, so we need to make copies...
   */
 
   if (!getenv("FINAL_CONTENT_TYPE"))
-    copies = atoi(argv[4]);
+    copies = args->copies;
   else
     copies = 1;
 
  /*
-  * Open the file...
+  * Stdin, pipes, and the channels of a filter host can't be rewound, so save
+  * the first copy in a temporary file for the others...
   */
 
-  if ((fp = cupsFileOpen(argv[6], "r")) == NULL)
+  if (copies > 1 && lseek(cupsFileNumber(args->in), 0, SEEK_CUR) < 0)
   {
-    _cupsLangPrintError("ERROR", _("Unable to open print file"));
-    return (1);
+    if ((temp = cupsTempFile2(tempfile, sizeof(tempfile))) == NULL)
+    {
+      perror("DEBUG: Unable to create temporary file");
+      return (1);
+    }
   }
 
- /*
-  * Copy the file to stdout...
-  */
-
-  while (copies > 0)
+  while (copies > 0 && !status)
   {
     if (!getenv("FINAL_CONTENT_TYPE"))
       fputs("PAGE: 1 1\n", stderr);
 
-    cupsFileRewind(fp);
+    cupsFileRewind(in);
 
-    while ((bytes = cupsFileRead(fp, buffer, sizeof(buffer))) > 0)
-      if (write(1, buffer, (size_t)bytes) < bytes)
+    while ((bytes = cupsFileRead(in, buffer, sizeof(buffer))) > 0)
+    {
+      if (cupsFileWrite(args->out, buffer, (size_t)bytes) < 0)
       {
 	_cupsLangPrintFilter(stderr, "ERROR",
 			     _("Unable to write uncompressed print data: %s"),
 			     strerror(errno));
-	cupsFileClose(fp);
+	status = 1;
+	break;
+      }
 
-	return (1);
+      if (temp && cupsFileWrite(temp, buffer, (size_t)bytes) < 0)
+      {
+        perror("DEBUG: Unable to write temporary file");
+	status = 1;
+	break;
       }
+    }
 
     copies --;
+
+    if (temp)
+    {
+     /*
+      * Read the remaining copies from the temporary file...
+      */
+
+      cupsFileClose(temp);
+      temp = NULL;
+
+      if (!status && (in = cupsFileOpen(tempfile, "r")) == NULL)
+      {
+        perror("DEBUG: Unable to open temporary file");
+	status = 1;
+      }
+    }
   }
 
- /*
-  * Close the file and return...
-  */
+  if (in != args->in)
+    cupsFileClose(in);
 
-  cupsFileClose(fp);
+  if (tempfile[0])
+    unlink(tempfile);
 
-  return (0);
+  return (status);
 }
 
 
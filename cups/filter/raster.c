@@ -22,6 +22,7 @@
  */
 
 #include <cups/raster-private.h>
+#include <cups/ring-private.h>
 #ifdef HAVE_STDINT_H
 #  include <stdint.h>
 #endif /* HAVE_STDINT_H */
@@ -50,6 +51,7 @@ struct _cups_raster_s			/**** Raster stream data ****/
 			*bufptr,	/* Current (read) position in buffer */
 			*bufend;	/* End of current (read) buffer */
   size_t		bufsize;	/* Buffer size */
+  _cups_ring_t		*ring;		/* Shared memory ring, if any */
 };
 
 
@@ -65,8 +67,10 @@ static void	cups_raster_update(cups_raster_t *r);
 static ssize_t	cups_raster_write(cups_raster_t *r,
 		                  const unsigned char *pixels);
 static ssize_t	cups_read_fd(void *ctx, unsigned char *buf, size_t bytes);
+static ssize_t	cups_read_ring(void *ctx, unsigned char *buf, size_t bytes);
 static void	cups_swap(unsigned char *buf, size_t bytes);
 static ssize_t	cups_write_fd(void *ctx, unsigned char *buf, size_t bytes);
+static ssize_t	cups_write_ring(void *ctx, unsigned char *buf, size_t bytes);
 
 
 /*
@@ -81,6 +85,14 @@ cupsRasterClose(cups_raster_t *r)	/* I - Stream to close */
 {
   if (r != NULL)
   {
+    if (r->ring)
+    {
+      if (r->mode == CUPS_RASTER_READ)
+        _cupsRingRead(r->ring, NULL, 0);
+      else
+        _cupsRingWrite(r->ring, NULL, 0);
+    }
+
     if (r->buffer)
       free(r->buffer);
 
@@ -98,7 +110,8 @@ cupsRasterClose(cups_raster_t *r)	/* I - Stream to close */
  * This function associates a raster stream with the given file descriptor.
  * For most printer driver filters, "fd" will be 0 (stdin).  For most raster
  * image processor (RIP) filters that generate raster data, "fd" will be 1
- * (stdout).
+ * (stdout).  If the scheduler connected the filter to its neighbor with a
+ * shared memory ring, the ring is used in place of the file descriptor.
  *
  * When writing raster data, the @code CUPS_RASTER_WRITE@,
  * @code CUPS_RASTER_WRITE_COMPRESS@, or @code CUPS_RASTER_WRITE_PWG@ mode can
@@ -113,7 +126,27 @@ cupsRasterOpen(int         fd,		/* I - File descriptor */
 					       @code CUPS_RASTER_WRITE_COMPRESSED@,
 					       or @code CUPS_RASTER_WRITE_PWG@ */
 {
-  if (mode == CUPS_RASTER_READ)
+  _cups_ring_t	*ring;			/* Shared memory ring */
+  cups_raster_t	*r;			/* New stream */
+
+
+  if ((ring = _cupsRingOpen(fd, mode == CUPS_RASTER_READ ? 'r' : 'w')) != NULL)
+  {
+    if (mode == CUPS_RASTER_READ)
+      r = cupsRasterOpenIO(cups_read_ring, ring, mode);
+    else
+      r = cupsRasterOpenIO(cups_write_ring, ring, mode);
+
+    if (r)
+      r->ring = ring;
+    else if (mode == CUPS_RASTER_READ)
+      _cupsRingRead(ring, NULL, 0);
+    else
+      _cupsRingWrite(ring, NULL, 0);
+
+    return (r);
+  }
+  else if (mode == CUPS_RASTER_READ)
     return (cupsRasterOpenIO(cups_read_fd, (void *)((intptr_t)fd), mode));
   else
     return (cupsRasterOpenIO(cups_write_fd, (void *)((intptr_t)fd), mode));
@@ -1395,6 +1428,19 @@ cups_read_fd(void          *ctx,	/* I - File descriptor as pointer */
 }
 
 
+/*
+ * 'cups_read_ring()' - Read bytes from a shared memory ring.
+ */
+
+static ssize_t				/* O - Bytes read or -1 */
+cups_read_ring(void          *ctx,	/* I - Ring */
+               unsigned char *buf,	/* I - Buffer for read */
+	       size_t        bytes)	/* I - Maximum number of bytes to read */
+{
+  return (_cupsRingRead(ctx, (char *)buf, bytes));
+}
+
+
 /*
  * 'cups_swap()' - Swap bytes in raster data...
  */
@@ -1447,6 +1493,19 @@ cups_write_fd(void          *ctx,	/* I - File descriptor pointer */
 }
 
 
+/*
+ * 'cups_write_ring()' - Write bytes to a shared memory ring.
+ */
+
+static ssize_t				/* O - Bytes written or -1 */
+cups_write_ring(void          *ctx,	/* I - Ring */
+                unsigned char *buf,	/* I - Bytes to write */
+	        size_t        bytes)	/* I - Number of bytes to write */
+{
+  return (_cupsRingWrite(ctx, (char *)buf, bytes));
+}
+
+
 /*
  * End of "$Id: raster.c 12131 2014-08-28 23:38:16Z msweet $".
  */
@@ -18,12 +18,32 @@
  * Include necessary headers...
  */
 
-#include <cups/cups-private.h>
+#include "filter-plugin.h"
 #include <cups/raster.h>
-#include <unistd.h>
-#include <fcntl.h>
 
 
+/*
+ * Local functions...
+ */
+
+static ssize_t	raster_read(void *ctx, unsigned char *buffer, size_t length);
+static ssize_t	raster_write(void *ctx, unsigned char *buffer, size_t length);
+static int	rastertopwg(cups_filter_args_t *args);
+
+
+/*
+ * Filter plugin...
+ */
+
+const cups_filter_plugin_t rastertopwg_plugin =
+{
+  CUPS_FILTER_PLUGIN_VERSION,
+  "rastertopwg",
+  rastertopwg
+};
+
+
+#ifndef CUPS_FILTER_PLUGIN
 /*
  * 'main()' - Main entry for filter.
  */
@@ -32,13 +52,87 @@ int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line args */
      char *argv[])			/* I - Command-line arguments */
 {
-  int			fd;		/* Raster file */
+  cups_filter_args_t	args;		/* Filter arguments */
+  int			status;		/* Exit status */
+
+
+  if (argc < 6 || argc > 7)
+  {
+    puts("Usage: rastertopwg job user title copies options [filename]");
+    return (1);
+  }
+  else if (argc == 7)
+  {
+    if ((args.in = cupsFileOpen(argv[6], "r")) == NULL)
+    {
+      perror("ERROR: Unable to open print file");
+      return (1);
+    }
+  }
+  else
+    args.in = cupsFileStdin();
+
+  args.job_id      = atoi(argv[1]);
+  args.user        = argv[2];
+  args.title       = argv[3];
+  args.copies      = atoi(argv[4]);
+  args.num_options = cupsParseOptions(argv[5], 0, &args.options);
+  args.out         = cupsFileStdout();
+
+  status = rastertopwg(&args);
+
+  if (argc == 7)
+    cupsFileClose(args.in);
+
+  if (cupsFileFlush(args.out) && !status)
+    status = 1;
+
+  cupsFreeOptions(args.num_options, args.options);
+
+  return (status);
+}
+#endif /* !CUPS_FILTER_PLUGIN */
+
+
+/*
+ * 'raster_read()' - Read raster data from a CUPS file.
+ */
+
+static ssize_t				/* O - Bytes read or -1 on error */
+raster_read(void          *ctx,		/* I - CUPS file */
+            unsigned char *buffer,	/* I - Buffer */
+	    size_t        length)	/* I - Number of bytes to read */
+{
+  return (cupsFileRead((cups_file_t *)ctx, (char *)buffer, length));
+}
+
+
+/*
+ * 'raster_write()' - Write raster data to a CUPS file.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+raster_write(void          *ctx,	/* I - CUPS file */
+             unsigned char *buffer,	/* I - Buffer */
+	     size_t        length)	/* I - Number of bytes to write */
+{
+  return (cupsFileWrite((cups_file_t *)ctx, (char *)buffer, length));
+}
+
+
+/*
+ * 'rastertopwg()' - Convert CUPS raster data to PWG raster data.
+ */
+
+static int				/* O - Exit status */
+rastertopwg(cups_filter_args_t *args)	/* I - Filter arguments */
+{
   cups_raster_t		*inras,		/* Input raster stream */
 			*outras;	/* Output raster stream */
   cups_page_header2_t	inheader,	/* Input raster page header */
 			outheader;	/* Output raster page header */
   unsigned		y;		/* Current line */
-  unsigned char		*line;		/* Line buffer */
+  unsigned char		*line = NULL;	/* Line buffer */
   unsigned		page = 0,	/* Current page */
 			page_width,	/* Actual page width */
 			page_height,	/* Actual page height */
@@ -54,33 +148,19 @@ main(int  argc,				/* I - Number of command-line args */
   _pwg_size_t		*pwg_size;	/* PWG media size */
   _pwg_media_t		*pwg_media;	/* PWG media name */
   int	 		num_options;	/* Number of options */
-  cups_option_t		*options = NULL;/* Options */
+  cups_option_t		*options;	/* Options */
   const char		*val;		/* Option value */
+  int			status = 0;	/* Exit status */
 
 
-  if (argc < 6 || argc > 7)
-  {
-    puts("Usage: rastertopwg job user title copies options [filename]");
-    return (1);
-  }
-  else if (argc == 7)
-  {
-    if ((fd = open(argv[6], O_RDONLY)) < 0)
-    {
-      perror("ERROR: Unable to open print file");
-      return (1);
-    }
-  }
-  else
-    fd = 0;
-
-  inras  = cupsRasterOpen(fd, CUPS_RASTER_READ);
-  outras = cupsRasterOpen(1, CUPS_RASTER_WRITE_PWG);
+  inras  = cupsRasterOpenIO(raster_read, args->in, CUPS_RASTER_READ);
+  outras = cupsRasterOpenIO(raster_write, args->out, CUPS_RASTER_WRITE_PWG);
 
   ppd   = ppdOpenFile(getenv("PPD"));
   back  = ppdFindAttr(ppd, "cupsBackSide", NULL);
 
-  num_options = cupsParseOptions(argv[5], 0, &options);
+  num_options = args->num_options;
+  options     = args->options;
 
   ppdMarkDefaults(ppd);
   cupsMarkOptions(ppd, num_options, options);
@@ -139,7 +219,8 @@ main(int  argc,				/* I - Number of command-line args */
 	  _cupsLangPrintFilter(stderr, "ERROR", _("Unsupported raster data."));
 	  fprintf(stderr, "DEBUG: Unsupported cupsColorSpace %d on page %d.\n",
 	          inheader.cupsColorSpace, page);
-	  return (1);
+	  status = 1;
+	  goto done;
     }
 
     if (inheader.cupsColorOrder != CUPS_ORDER_CHUNKED)
@@ -147,7 +228,8 @@ main(int  argc,				/* I - Number of command-line args */
       _cupsLangPrintFilter(stderr, "ERROR", _("Unsupported raster data."));
       fprintf(stderr, "DEBUG: Unsupported cupsColorOrder %d on page %d.\n",
               inheader.cupsColorOrder, page);
-      return (1);
+      status = 1;
+      goto done;
     }
 
     if (inheader.cupsBitsPerPixel != 1 &&
@@ -156,7 +238,8 @@ main(int  argc,				/* I - Number of command-line args */
       _cupsLangPrintFilter(stderr, "ERROR", _("Unsupported raster data."));
       fprintf(stderr, "DEBUG: Unsupported cupsBitsPerColor %d on page %d.\n",
               inheader.cupsBitsPerColor, page);
-      return (1);
+      status = 1;
+      goto done;
     }
 
     memcpy(&outheader, &inheader, sizeof(outheader));
@@ -394,14 +477,22 @@ main(int  argc,				/* I - Number of command-line args */
     {
       _cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
       fprintf(stderr, "DEBUG: Unable to write header for page %d.\n", page);
-      return (1);
+      status = 1;
+      goto done;
     }
 
    /*
     * Copy raster data...
     */
 
-    line = malloc(linesize);
+    if ((line = malloc(linesize)) == NULL)
+    {
+      _cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
+      fprintf(stderr, "DEBUG: Unable to allocate line buffer for page %d.\n",
+              page);
+      status = 1;
+      goto done;
+    }
 
     memset(line, white, linesize);
     for (y = page_top; y > 0; y --)
@@ -410,7 +501,8 @@ main(int  argc,				/* I - Number of command-line args */
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
 	fprintf(stderr, "DEBUG: Unable to write line %d for page %d.\n",
 	        page_top - y + 1, page);
-	return (1);
+	status = 1;
+	goto done;
       }
 
     for (y = inheader.cupsHeight; y > 0; y --)
@@ -421,7 +513,8 @@ main(int  argc,				/* I - Number of command-line args */
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
 	fprintf(stderr, "DEBUG: Unable to write line %d for page %d.\n",
 	        inheader.cupsHeight - y + page_top + 1, page);
-	return (1);
+	status = 1;
+	goto done;
       }
     }
 
@@ -432,19 +525,28 @@ main(int  argc,				/* I - Number of command-line args */
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
 	fprintf(stderr, "DEBUG: Unable to write line %d for page %d.\n",
 	        page_bottom - y + page_top + inheader.cupsHeight + 1, page);
-	return (1);
+	status = 1;
+	goto done;
       }
 
     free(line);
+    line = NULL;
   }
 
-  cupsRasterClose(inras);
-  if (fd)
-    close(fd);
+ /*
+  * Free memory and return...
+  */
 
+  done:
+
+  free(line);
+
+  cupsRasterClose(inras);
   cupsRasterClose(outras);
 
-  return (0);
+  ppdClose(ppd);
+
+  return (status);
 }
 
 
@@ -0,0 +1,408 @@
+/*
+ * "$Id$"
+ *
+ * Raster merge test program for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/cups-private.h>
+#include <cups/raster.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define NUM_PAGES	4		/* Number of pages */
+#define PAGE_SIZE	512		/* Width and height of pages */
+#define WAIT_TIME	5		/* Seconds to wait for the second chain */
+
+
+/*
+ * Local functions...
+ */
+
+static int	test_empty_chain(void);
+static int	write_chain(int fd, int first, int last, int waitfd);
+
+
+/*
+ * 'main()' - Run cups-rastermerge with two chains and check that they run at
+ *            the same time.
+ *
+ * The first chain produces page 1 but only after the second chain has
+ * finished writing pages 2 to 4, which are much larger than a pipe buffer.
+ * If the merge program only read the chains in page order the second chain
+ * would block and the first chain would time out.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			i,		/* Looping var */
+			status = 0,	/* Exit status */
+			chainfds[2][2],	/* Pipes from chains */
+			syncfds[2],	/* Pipe from second to first chain */
+			outfds[2],	/* Pipe from merge program */
+			pstatus;	/* Process status */
+  pid_t			pids[3];	/* Process IDs */
+  char			fds[2][16],	/* Chain file descriptors */
+			*argv[7];	/* Merge arguments */
+  cups_raster_t		*ras;		/* Merged raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		line[PAGE_SIZE];/* Line of page */
+  int			page;		/* Current page */
+  unsigned		y;		/* Current line */
+
+
+  signal(SIGPIPE, SIG_IGN);
+
+  fputs("cups-rastermerge: ", stdout);
+  fflush(stdout);
+
+  if (pipe(chainfds[0]) || pipe(chainfds[1]) || pipe(syncfds) || pipe(outfds))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+ /*
+  * Start the chains; the second one closes the sync pipe when it is done...
+  */
+
+  if ((pids[0] = fork()) == 0)
+  {
+    close(chainfds[0][0]);
+    close(chainfds[1][0]);
+    close(chainfds[1][1]);
+    close(syncfds[1]);
+    close(outfds[0]);
+    close(outfds[1]);
+
+    exit(write_chain(chainfds[0][1], 1, 1, syncfds[0]));
+  }
+
+  if ((pids[1] = fork()) == 0)
+  {
+    close(chainfds[0][0]);
+    close(chainfds[0][1]);
+    close(chainfds[1][0]);
+    close(syncfds[0]);
+    close(outfds[0]);
+    close(outfds[1]);
+
+    if (write_chain(chainfds[1][1], 2, NUM_PAGES, -1))
+      exit(1);
+
+    close(syncfds[1]);
+    exit(0);
+  }
+
+  close(chainfds[0][1]);
+  close(chainfds[1][1]);
+  close(syncfds[0]);
+  close(syncfds[1]);
+
+ /*
+  * Start the merge program with one page per block and two blocks...
+  */
+
+  if ((pids[2] = fork()) == 0)
+  {
+    dup2(outfds[1], 1);
+    close(outfds[0]);
+    close(outfds[1]);
+
+    close(2);
+    open("/dev/null", O_WRONLY);
+
+    snprintf(fds[0], sizeof(fds[0]), "%d", chainfds[0][0]);
+    snprintf(fds[1], sizeof(fds[1]), "%d", chainfds[1][0]);
+
+    argv[0] = (char *)"cups-rastermerge";
+    argv[1] = (char *)"cups";
+    argv[2] = (char *)"1";
+    argv[3] = (char *)"2";
+    argv[4] = fds[0];
+    argv[5] = fds[1];
+    argv[6] = NULL;
+
+    execv("./cups-rastermerge", argv);
+    exit(errno + 100);
+  }
+
+  close(chainfds[0][0]);
+  close(chainfds[1][0]);
+  close(outfds[1]);
+
+ /*
+  * Read the merged pages back and make sure they are in order...
+  */
+
+  ras = cupsRasterOpen(outfds[0], CUPS_RASTER_READ);
+
+  for (page = 1; cupsRasterReadHeader2(ras, &header); page ++)
+  {
+    for (y = 0; y < header.cupsHeight; y ++)
+    {
+      if (!cupsRasterReadPixels(ras, line, sizeof(line)))
+        break;
+
+      if (line[0] != page || line[PAGE_SIZE - 1] != page)
+        break;
+    }
+
+    if (y < header.cupsHeight)
+    {
+      printf("FAIL (bad data on page %d)\n", page);
+      status = 1;
+      break;
+    }
+  }
+
+  cupsRasterClose(ras);
+  close(outfds[0]);
+
+  if (!status && page != (NUM_PAGES + 1))
+  {
+    printf("FAIL (got %d pages, expected %d)\n", page - 1, NUM_PAGES);
+    status = 1;
+  }
+
+ /*
+  * Check the exit status of the chains and merge program...
+  */
+
+  for (i = 0; i < 3; i ++)
+  {
+    while (waitpid(pids[i], &pstatus, 0) < 0 && errno == EINTR);
+
+    if (!status && (!WIFEXITED(pstatus) || WEXITSTATUS(pstatus)))
+    {
+      if (i == 0)
+        puts("FAIL (first chain timed out waiting for second chain)");
+      else if (i == 1)
+        puts("FAIL (second chain failed)");
+      else
+        printf("FAIL (merge program exited with status %d)\n", pstatus);
+
+      status = 1;
+    }
+  }
+
+  if (!status)
+    printf("PASS (%d pages from 2 overlapping chains)\n", NUM_PAGES);
+
+  if (test_empty_chain())
+    status = 1;
+
+  return (status);
+}
+
+
+/*
+ * 'test_empty_chain()' - Run cups-rastermerge with a chain that has no pages.
+ *
+ * A one page document split into two chains leaves the second chain with
+ * nothing to rasterize, so it closes its pipe without writing a raster
+ * stream.  The merge program must treat that as zero pages.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+test_empty_chain(void)
+{
+  int			i,		/* Looping var */
+			status = 0,	/* Exit status */
+			chainfds[2][2],	/* Pipes from chains */
+			outfds[2],	/* Pipe from merge program */
+			pstatus;	/* Process status */
+  pid_t			pids[2];	/* Process IDs */
+  char			fds[2][16],	/* Chain file descriptors */
+			*argv[7];	/* Merge arguments */
+  cups_raster_t		*ras;		/* Merged raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		line[PAGE_SIZE];/* Line of page */
+  int			pages = 0;	/* Number of pages */
+
+
+  fputs("cups-rastermerge (empty chain): ", stdout);
+  fflush(stdout);
+
+  if (pipe(chainfds[0]) || pipe(chainfds[1]) || pipe(outfds))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+ /*
+  * The second chain exits without writing anything...
+  */
+
+  close(chainfds[1][1]);
+
+  if ((pids[0] = fork()) == 0)
+  {
+    close(chainfds[0][0]);
+    close(chainfds[1][0]);
+    close(outfds[0]);
+    close(outfds[1]);
+
+    exit(write_chain(chainfds[0][1], 1, 1, -1));
+  }
+
+  close(chainfds[0][1]);
+
+  if ((pids[1] = fork()) == 0)
+  {
+    dup2(outfds[1], 1);
+    close(outfds[0]);
+    close(outfds[1]);
+
+    close(2);
+    open("/dev/null", O_WRONLY);
+
+    snprintf(fds[0], sizeof(fds[0]), "%d", chainfds[0][0]);
+    snprintf(fds[1], sizeof(fds[1]), "%d", chainfds[1][0]);
+
+    argv[0] = (char *)"cups-rastermerge";
+    argv[1] = (char *)"cups";
+    argv[2] = (char *)"1";
+    argv[3] = (char *)"2";
+    argv[4] = fds[0];
+    argv[5] = fds[1];
+    argv[6] = NULL;
+
+    execv("./cups-rastermerge", argv);
+    exit(errno + 100);
+  }
+
+  close(chainfds[0][0]);
+  close(chainfds[1][0]);
+  close(outfds[1]);
+
+  ras = cupsRasterOpen(outfds[0], CUPS_RASTER_READ);
+
+  while (cupsRasterReadHeader2(ras, &header))
+  {
+    pages ++;
+
+    while (header.cupsHeight > 0 &&
+           cupsRasterReadPixels(ras, line, sizeof(line)))
+      header.cupsHeight --;
+  }
+
+  cupsRasterClose(ras);
+  close(outfds[0]);
+
+  if (pages != 1)
+  {
+    printf("FAIL (got %d pages, expected 1)\n", pages);
+    status = 1;
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    while (waitpid(pids[i], &pstatus, 0) < 0 && errno == EINTR);
+
+    if (!status && (!WIFEXITED(pstatus) || WEXITSTATUS(pstatus)))
+    {
+      if (i == 0)
+        puts("FAIL (first chain failed)");
+      else
+        printf("FAIL (merge program exited with status %d)\n", pstatus);
+
+      status = 1;
+    }
+  }
+
+  if (!status)
+    puts("PASS");
+
+  return (status);
+}
+
+
+/*
+ * 'write_chain()' - Write pages to a chain pipe.
+ */
+
+static int				/* O - 0 on success, 1 on error */
+write_chain(int fd,			/* I - Pipe to merge program */
+            int first,			/* I - First page */
+	    int last,			/* I - Last page */
+	    int waitfd)			/* I - Pipe to wait on or -1 */
+{
+  int			page;		/* Current page */
+  unsigned		y;		/* Current line */
+  cups_raster_t		*ras;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		line[PAGE_SIZE];/* Line of page */
+  struct pollfd		pfd;		/* Sync pipe */
+  char			ch;		/* Sync character */
+
+
+  if (waitfd >= 0)
+  {
+   /*
+    * Wait for the other chain to finish...
+    */
+
+    pfd.fd     = waitfd;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, WAIT_TIME * 1000) <= 0 || read(waitfd, &ch, 1) != 0)
+      return (1);
+  }
+
+  if ((ras = cupsRasterOpen(fd, CUPS_RASTER_WRITE)) == NULL)
+    return (1);
+
+  memset(&header, 0, sizeof(header));
+  header.cupsWidth        = PAGE_SIZE;
+  header.cupsHeight       = PAGE_SIZE;
+  header.cupsBytesPerLine = PAGE_SIZE;
+  header.cupsBitsPerColor = 8;
+  header.cupsBitsPerPixel = 8;
+  header.cupsColorSpace   = CUPS_CSPACE_K;
+  header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+  header.HWResolution[0]  = 100;
+  header.HWResolution[1]  = 100;
+
+  for (page = first; page <= last; page ++)
+  {
+    if (!cupsRasterWriteHeader2(ras, &header))
+      return (1);
+
+    memset(line, page, sizeof(line));
+
+    for (y = 0; y < PAGE_SIZE; y ++)
+      if (!cupsRasterWritePixels(ras, line, sizeof(line)))
+        return (1);
+  }
+
+  cupsRasterClose(ras);
+  close(fd);
+
+  return (0);
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -63,20 +63,97 @@ typedef struct sockpeercred cupsd_ucred_t;
 #endif /* HAVE_SYS_UCRED_H */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_AUTH_CACHE_MAX	1024	/* Maximum entries in each cache */
+
+
+/*
+ * Local structures...
+ */
+
+#if HAVE_LIBPAM
+typedef struct cupsd_authdata_s		/**** Authentication data ****/
+{
+  char	username[HTTP_MAX_VALUE],	/* Username string */
+	password[HTTP_MAX_VALUE];	/* Password string */
+} cupsd_authdata_t;
+#endif /* HAVE_LIBPAM */
+
+struct cupsd_ipnode_s			/**** IP mask trie node ****/
+{
+  cupsd_ipnode_t	*child[2];	/* Nodes for next bit 0 and 1 */
+  int			match;		/* Does a mask end here? */
+};
+
+typedef struct cupsd_accesscache_s	/**** Cached access decision ****/
+{
+  cupsd_location_t	*loc;		/* Location */
+  unsigned		ip[4];		/* Client address */
+  char			name[HTTP_MAX_HOST];
+					/* Client hostname */
+  int			allow;		/* 1 if allowed, 0 otherwise */
+  time_t		expires;	/* Time when decision expires */
+} cupsd_accesscache_t;
+
+typedef struct cupsd_groupcache_s	/**** Cached group membership ****/
+{
+  char			username[HTTP_MAX_VALUE],
+					/* User name */
+			groupname[HTTP_MAX_VALUE];
+					/* Group name */
+  int			has_user,	/* Was passwd info supplied? */
+			is_member;	/* 1 if user is a member, 0 otherwise */
+  time_t		expires;	/* Time when membership expires */
+} cupsd_groupcache_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*AccessCache = NULL;
+					/* Cached access decisions */
+static cups_array_t	*GroupCache = NULL;
+					/* Cached group memberships */
+
+
 /*
  * Local functions...
  */
 
+static int		add_ipnode(cupsd_ipnode_t **trie,
+			           const cupsd_ipmask_t *mask);
+static int		check_access(unsigned ip[4], const char *name,
+			             size_t namelen, cupsd_location_t *loc);
 #ifdef HAVE_AUTHORIZATION_H
 static int		check_authref(cupsd_client_t *con, const char *right);
 #endif /* HAVE_AUTHORIZATION_H */
+static int		check_group(const char *username, struct passwd *user,
+			            const char *groupname);
+static int		check_masks(unsigned ip[4], const char *name,
+			            size_t namelen, cupsd_ipnode_t *trie,
+				    cups_array_t *others);
+static int		compare_access_cache(cupsd_accesscache_t *a,
+			                     cupsd_accesscache_t *b);
+static int		compare_group_cache(cupsd_groupcache_t *a,
+			                    cupsd_groupcache_t *b);
 static int		compare_locations(cupsd_location_t *a,
 			                  cupsd_location_t *b);
+static void		compile_location(cupsd_location_t *loc);
+static void		compile_masks(cups_array_t *masks,
+			              cupsd_ipnode_t **trie,
+				      cups_array_t **others);
 static cupsd_authmask_t	*copy_authmask(cupsd_authmask_t *am, void *data);
 #if !HAVE_LIBPAM
 static char		*cups_crypt(const char *pw, const char *salt);
 #endif /* !HAVE_LIBPAM */
+static void		flush_cache(cups_array_t *cache);
 static void		free_authmask(cupsd_authmask_t *am, void *data);
+static void		free_ipnode(cupsd_ipnode_t *node);
+static int		match_ipnode(cupsd_ipnode_t *trie, unsigned ip[4]);
 #if HAVE_LIBPAM
 static int		pam_func(int, const struct pam_message **,
 			         struct pam_response **, void *);
@@ -85,19 +162,6 @@ static void		to64(char *s, unsigned long v, int n);
 #endif /* HAVE_LIBPAM */
 
 
-/*
- * Local structures...
- */
-
-#if HAVE_LIBPAM
-typedef struct cupsd_authdata_s		/**** Authentication data ****/
-{
-  char	username[HTTP_MAX_VALUE],	/* Username string */
-	password[HTTP_MAX_VALUE];	/* Password string */
-} cupsd_authdata_t;
-#endif /* HAVE_LIBPAM */
-
-
 /*
  * 'cupsdAddIPMask()' - Add an IP address authorization mask.
  */
@@ -1012,52 +1076,54 @@ cupsdCheckAccess(
     size_t           namelen,		/* I - Length of hostname */
     cupsd_location_t *loc)		/* I - Location to check */
 {
-  int	allow;				/* 1 if allowed, 0 otherwise */
+  cupsd_accesscache_t	key,		/* Search key */
+			*ac;		/* Cached decision */
 
 
-  if (!_cups_strcasecmp(name, "localhost"))
-  {
-   /*
-    * Access from localhost (127.0.0.1 or ::1) is always allowed...
-    */
+  if (AuthCacheTimeout <= 0 || namelen >= sizeof(key.name))
+    return (check_access(ip, name, namelen, loc));
 
-    return (1);
-  }
-  else
-  {
-   /*
-    * Do authorization checks on the domain/address...
-    */
+ /*
+  * See if we have a recent decision for this client and location...
+  */
 
-    switch (loc->order_type)
-    {
-      default :
-	  allow = 0;	/* anti-compiler-warning-code */
-	  break;
+  key.loc = loc;
+  memcpy(key.ip, ip, sizeof(key.ip));
+  strlcpy(key.name, name, sizeof(key.name));
 
-      case CUPSD_AUTH_ALLOW : /* Order Deny,Allow */
-          allow = 1;
+  if ((ac = (cupsd_accesscache_t *)cupsArrayFind(AccessCache, &key)) != NULL)
+  {
+    if (ac->expires > time(NULL))
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                      "cupsdCheckAccess: Using cached decision %d for \"%s\".",
+                      ac->allow, name);
+      return (ac->allow);
+    }
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->deny))
-	    allow = 0;
+    cupsArrayRemove(AccessCache, ac);
+    free(ac);
+  }
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->allow))
-	    allow = 1;
-	  break;
+ /*
+  * No, check the masks and cache the result...
+  */
 
-      case CUPSD_AUTH_DENY : /* Order Allow,Deny */
-          allow = 0;
+  key.allow   = check_access(ip, name, namelen, loc);
+  key.expires = time(NULL) + AuthCacheTimeout;
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->allow))
-	    allow = 1;
+  if (!AccessCache)
+    AccessCache = cupsArrayNew((cups_array_func_t)compare_access_cache, NULL);
+  else if (cupsArrayCount(AccessCache) >= CUPSD_AUTH_CACHE_MAX)
+    flush_cache(AccessCache);
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->deny))
-	    allow = 0;
-	  break;
-    }
+  if ((ac = malloc(sizeof(cupsd_accesscache_t))) != NULL)
+  {
+    memcpy(ac, &key, sizeof(cupsd_accesscache_t));
+    cupsArrayAdd(AccessCache, ac);
   }
 
-  return (allow);
+  return (key.allow);
 }
 
 
@@ -1252,13 +1318,8 @@ cupsdCheckGroup(
     struct passwd *user,		/* I - System user info */
     const char    *groupname)		/* I - Group name */
 {
-  int		i;			/* Looping var */
-  struct group	*group;			/* System group info */
-#ifdef HAVE_MBR_UID_TO_UUID
-  uuid_t	useruuid,		/* UUID for username */
-		groupuuid;		/* UUID for groupname */
-  int		is_member;		/* True if user is a member of group */
-#endif /* HAVE_MBR_UID_TO_UUID */
+  cupsd_groupcache_t	key,		/* Search key */
+			*gc;		/* Cached membership */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -1272,78 +1333,47 @@ cupsdCheckGroup(
   if (!username || !groupname)
     return (0);
 
+  if (AuthCacheTimeout <= 0 ||
+      strlcpy(key.username, username, sizeof(key.username)) >= sizeof(key.username) ||
+      strlcpy(key.groupname, groupname, sizeof(key.groupname)) >= sizeof(key.groupname))
+    return (check_group(username, user, groupname));
+
  /*
-  * Check to see if the user is a member of the named group...
+  * The primary group check needs the passwd entry, so cache lookups with and
+  * without one separately...
   */
 
-  group = getgrnam(groupname);
-  endgrent();
+  key.has_user = user != NULL;
 
-  if (group != NULL)
+  if ((gc = (cupsd_groupcache_t *)cupsArrayFind(GroupCache, &key)) != NULL)
   {
-   /*
-    * Group exists, check it...
-    */
+    if (gc->expires > time(NULL))
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                      "cupsdCheckGroup: Using cached membership %d.",
+		      gc->is_member);
+      return (gc->is_member);
+    }
 
-    for (i = 0; group->gr_mem[i]; i ++)
-      if (!_cups_strcasecmp(username, group->gr_mem[i]))
-	return (1);
+    cupsArrayRemove(GroupCache, gc);
+    free(gc);
   }
 
- /*
-  * Group doesn't exist or user not in group list, check the group ID
-  * against the user's group ID...
-  */
-
-  if (user && group && group->gr_gid == user->pw_gid)
-    return (1);
+  key.is_member = check_group(username, user, groupname);
+  key.expires   = time(NULL) + AuthCacheTimeout;
 
-#ifdef HAVE_MBR_UID_TO_UUID
- /*
-  * Check group membership through MacOS X membership API...
-  */
+  if (!GroupCache)
+    GroupCache = cupsArrayNew((cups_array_func_t)compare_group_cache, NULL);
+  else if (cupsArrayCount(GroupCache) >= CUPSD_AUTH_CACHE_MAX)
+    flush_cache(GroupCache);
 
-  if (user && !mbr_uid_to_uuid(user->pw_uid, useruuid))
+  if ((gc = malloc(sizeof(cupsd_groupcache_t))) != NULL)
   {
-    if (group)
-    {
-     /*
-      * Map group name to UUID and check membership...
-      */
-
-      if (!mbr_gid_to_uuid(group->gr_gid, groupuuid))
-        if (!mbr_check_membership(useruuid, groupuuid, &is_member))
-	  if (is_member)
-	    return (1);
-    }
-    else if (groupname[0] == '#')
-    {
-     /*
-      * Use UUID directly and check for equality (user UUID) and
-      * membership (group UUID)...
-      */
-
-      if (!uuid_parse((char *)groupname + 1, groupuuid))
-      {
-        if (!uuid_compare(useruuid, groupuuid))
-	  return (1);
-	else if (!mbr_check_membership(useruuid, groupuuid, &is_member))
-	  if (is_member)
-	    return (1);
-      }
-
-      return (0);
-    }
+    memcpy(gc, &key, sizeof(cupsd_groupcache_t));
+    cupsArrayAdd(GroupCache, gc);
   }
-  else if (groupname[0] == '#')
-    return (0);
-#endif /* HAVE_MBR_UID_TO_UUID */
-
- /*
-  * If we get this far, then the user isn't part of the named group...
-  */
 
-  return (0);
+  return (key.is_member);
 }
 
 
@@ -1578,6 +1608,18 @@ cupsdFindLocation(const char *location)	/* I - Connection */
 }
 
 
+/*
+ * 'cupsdFlushAuthCache()' - Discard all cached access and group decisions.
+ */
+
+void
+cupsdFlushAuthCache(void)
+{
+  flush_cache(AccessCache);
+  flush_cache(GroupCache);
+}
+
+
 /*
  * 'cupsdFreeLocation()' - Free all memory used by a location.
  */
@@ -1588,6 +1630,10 @@ cupsdFreeLocation(cupsd_location_t *loc)/* I - Location to free */
   cupsArrayDelete(loc->names);
   cupsArrayDelete(loc->allow);
   cupsArrayDelete(loc->deny);
+  cupsArrayDelete(loc->allow_other);
+  cupsArrayDelete(loc->deny_other);
+  free_ipnode(loc->allow_ips);
+  free_ipnode(loc->deny_ips);
 
   _cupsStrFree(loc->location);
   free(loc);
@@ -1978,6 +2024,134 @@ cupsdNewLocation(const char *location)	/* I - Location path */
 }
 
 
+/*
+ * 'add_ipnode()' - Add an IP mask to a trie.
+ *
+ * Only masks with contiguous netmasks can be added; 0 is returned for others.
+ */
+
+static int				/* O  - 1 if added, 0 otherwise */
+add_ipnode(cupsd_ipnode_t       **trie,	/* IO - Trie root */
+           const cupsd_ipmask_t *mask)	/* I  - IP mask */
+{
+  int			i,		/* Looping var */
+			bit,		/* Current bit */
+			bits;		/* Number of bits in netmask */
+  cupsd_ipnode_t	**node;		/* Current node */
+
+
+ /*
+  * Count the leading one bits of the netmask and make sure the rest of the
+  * netmask is zero...
+  */
+
+  for (bits = 0; bits < 128; bits ++)
+    if (!(mask->netmask[bits / 32] & (0x80000000U >> (bits & 31))))
+      break;
+
+  for (i = bits; i < 128; i ++)
+    if (mask->netmask[i / 32] & (0x80000000U >> (i & 31)))
+      return (0);
+
+ /*
+  * Walk down the trie, adding nodes as needed...
+  */
+
+  for (node = trie, i = 0; i <= bits; i ++)
+  {
+    if (!*node && (*node = calloc(1, sizeof(cupsd_ipnode_t))) == NULL)
+      return (0);
+
+    if ((*node)->match)
+      return (1);			/* Already covered by a shorter prefix */
+
+    if (i == bits)
+      break;
+
+    bit  = (mask->address[i / 32] >> (31 - (i & 31))) & 1;
+    node = (*node)->child + bit;
+  }
+
+ /*
+  * Mark the end of the prefix; anything longer is now redundant...
+  */
+
+  (*node)->match = 1;
+
+  free_ipnode((*node)->child[0]);
+  free_ipnode((*node)->child[1]);
+  (*node)->child[0] = (*node)->child[1] = NULL;
+
+  return (1);
+}
+
+
+/*
+ * 'check_access()' - Check the allow and deny masks of a location.
+ */
+
+static int				/* O - 1 if allowed, 0 otherwise */
+check_access(unsigned         ip[4],	/* I - Client address */
+             const char       *name,	/* I - Client hostname */
+             size_t           namelen,	/* I - Length of hostname */
+             cupsd_location_t *loc)	/* I - Location to check */
+{
+  int	allow;				/* 1 if allowed, 0 otherwise */
+
+
+  if (!_cups_strcasecmp(name, "localhost"))
+  {
+   /*
+    * Access from localhost (127.0.0.1 or ::1) is always allowed...
+    */
+
+    return (1);
+  }
+  else
+  {
+   /*
+    * Do authorization checks on the domain/address...
+    */
+
+    if (!loc->compiled)
+      compile_location(loc);
+
+    switch (loc->order_type)
+    {
+      default :
+	  allow = 0;	/* anti-compiler-warning-code */
+	  break;
+
+      case CUPSD_AUTH_ALLOW : /* Order Deny,Allow */
+          allow = 1;
+
+          if (check_masks(ip, name, namelen, loc->deny_ips,
+	                  loc->deny_other))
+	    allow = 0;
+
+          if (check_masks(ip, name, namelen, loc->allow_ips,
+	                  loc->allow_other))
+	    allow = 1;
+	  break;
+
+      case CUPSD_AUTH_DENY : /* Order Allow,Deny */
+          allow = 0;
+
+          if (check_masks(ip, name, namelen, loc->allow_ips,
+	                  loc->allow_other))
+	    allow = 1;
+
+          if (check_masks(ip, name, namelen, loc->deny_ips,
+	                  loc->deny_other))
+	    allow = 0;
+	  break;
+    }
+  }
+
+  return (allow);
+}
+
+
 #ifdef HAVE_AUTHORIZATION_H
 /*
  * 'check_authref()' - Check if an authorization services reference has the
@@ -2031,6 +2205,159 @@ check_authref(cupsd_client_t *con,	/* I - Connection */
 #endif /* HAVE_AUTHORIZATION_H */
 
 
+/*
+ * 'check_group()' - Look up a user's group membership.
+ */
+
+static int				/* O - 1 if user is a member, 0 otherwise */
+check_group(const char    *username,	/* I - User name */
+            struct passwd *user,	/* I - System user info */
+            const char    *groupname)	/* I - Group name */
+{
+  int		i;			/* Looping var */
+  struct group	*group;			/* System group info */
+#ifdef HAVE_MBR_UID_TO_UUID
+  uuid_t	useruuid,		/* UUID for username */
+		groupuuid;		/* UUID for groupname */
+  int		is_member;		/* True if user is a member of group */
+#endif /* HAVE_MBR_UID_TO_UUID */
+
+
+ /*
+  * Check to see if the user is a member of the named group...
+  */
+
+  group = getgrnam(groupname);
+  endgrent();
+
+  if (group != NULL)
+  {
+   /*
+    * Group exists, check it...
+    */
+
+    for (i = 0; group->gr_mem[i]; i ++)
+      if (!_cups_strcasecmp(username, group->gr_mem[i]))
+	return (1);
+  }
+
+ /*
+  * Group doesn't exist or user not in group list, check the group ID
+  * against the user's group ID...
+  */
+
+  if (user && group && group->gr_gid == user->pw_gid)
+    return (1);
+
+#ifdef HAVE_MBR_UID_TO_UUID
+ /*
+  * Check group membership through MacOS X membership API...
+  */
+
+  if (user && !mbr_uid_to_uuid(user->pw_uid, useruuid))
+  {
+    if (group)
+    {
+     /*
+      * Map group name to UUID and check membership...
+      */
+
+      if (!mbr_gid_to_uuid(group->gr_gid, groupuuid))
+        if (!mbr_check_membership(useruuid, groupuuid, &is_member))
+	  if (is_member)
+	    return (1);
+    }
+    else if (groupname[0] == '#')
+    {
+     /*
+      * Use UUID directly and check for equality (user UUID) and
+      * membership (group UUID)...
+      */
+
+      if (!uuid_parse((char *)groupname + 1, groupuuid))
+      {
+        if (!uuid_compare(useruuid, groupuuid))
+	  return (1);
+	else if (!mbr_check_membership(useruuid, groupuuid, &is_member))
+	  if (is_member)
+	    return (1);
+      }
+
+      return (0);
+    }
+  }
+  else if (groupname[0] == '#')
+    return (0);
+#endif /* HAVE_MBR_UID_TO_UUID */
+
+ /*
+  * If we get this far, then the user isn't part of the named group...
+  */
+
+  return (0);
+}
+
+
+/*
+ * 'check_masks()' - Check compiled and remaining authorization masks.
+ */
+
+static int				/* O - 1 if mask matches, 0 otherwise */
+check_masks(unsigned       ip[4],	/* I - Client address */
+            const char     *name,	/* I - Client hostname */
+	    size_t         namelen,	/* I - Length of hostname */
+	    cupsd_ipnode_t *trie,	/* I - IP prefixes */
+	    cups_array_t   *others)	/* I - Other masks */
+{
+  if (trie && match_ipnode(trie, ip))
+    return (1);
+
+  return (cupsdCheckAuth(ip, name, namelen, others));
+}
+
+
+/*
+ * 'compare_access_cache()' - Compare two cached access decisions.
+ */
+
+static int				/* O - Result of comparison */
+compare_access_cache(
+    cupsd_accesscache_t *a,		/* I - First decision */
+    cupsd_accesscache_t *b)		/* I - Second decision */
+{
+  int	result;				/* Result of comparison */
+
+
+  if (a->loc != b->loc)
+    return (a->loc < b->loc ? -1 : 1);
+  else if ((result = memcmp(a->ip, b->ip, sizeof(a->ip))) != 0)
+    return (result);
+  else
+    return (_cups_strcasecmp(a->name, b->name));
+}
+
+
+/*
+ * 'compare_group_cache()' - Compare two cached group memberships.
+ */
+
+static int				/* O - Result of comparison */
+compare_group_cache(
+    cupsd_groupcache_t *a,		/* I - First membership */
+    cupsd_groupcache_t *b)		/* I - Second membership */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->username, b->username)) != 0)
+    return (result);
+  else if ((result = strcmp(a->groupname, b->groupname)) != 0)
+    return (result);
+  else
+    return (a->has_user - b->has_user);
+}
+
+
 /*
  * 'compare_locations()' - Compare two locations.
  */
@@ -2043,6 +2370,72 @@ compare_locations(cupsd_location_t *a,	/* I - First location */
 }
 
 
+/*
+ * 'compile_location()' - Compile the allow and deny masks of a location.
+ */
+
+static void
+compile_location(cupsd_location_t *loc)	/* I - Location */
+{
+  compile_masks(loc->allow, &(loc->allow_ips), &(loc->allow_other));
+  compile_masks(loc->deny, &(loc->deny_ips), &(loc->deny_other));
+
+  loc->compiled = 1;
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "compile_location: \"%s\" has %d/%d allow and %d/%d deny "
+		  "masks that need a linear search.",
+		  loc->location ? loc->location : "(null)",
+		  cupsArrayCount(loc->allow_other), cupsArrayCount(loc->allow),
+		  cupsArrayCount(loc->deny_other), cupsArrayCount(loc->deny));
+}
+
+
+/*
+ * 'compile_masks()' - Compile IP prefix masks into a trie.
+ *
+ * Masks that cannot be represented in the trie (names, interfaces, and
+ * non-contiguous netmasks) are added to the "others" array.
+ */
+
+static void
+compile_masks(cups_array_t   *masks,	/* I - Masks */
+              cupsd_ipnode_t **trie,	/* O - IP prefixes */
+	      cups_array_t   **others)	/* O - Other masks */
+{
+  int			i;		/* Looping var */
+  cupsd_authmask_t	*mask;		/* Current mask */
+
+
+  *trie   = NULL;
+  *others = NULL;
+
+  for (mask = (cupsd_authmask_t *)cupsArrayFirst(masks);
+       mask;
+       mask = (cupsd_authmask_t *)cupsArrayNext(masks))
+  {
+    if (mask->type == CUPSD_AUTH_IP)
+    {
+     /*
+      * Addresses with bits outside the netmask (e.g. "none") never match...
+      */
+
+      for (i = 0; i < 4; i ++)
+        if (mask->mask.ip.address[i] & ~mask->mask.ip.netmask[i])
+	  break;
+
+      if (i < 4 || add_ipnode(trie, &(mask->mask.ip)))
+        continue;
+    }
+
+    if (!*others)
+      *others = cupsArrayNew(NULL, NULL);
+
+    cupsArrayAdd(*others, mask);
+  }
+}
+
+
 /*
  * 'copy_authmask()' - Copy function for auth masks.
  */
@@ -2205,6 +2598,23 @@ cups_crypt(const char *pw,		/* I - Password string */
 #endif /* !HAVE_LIBPAM */
 
 
+/*
+ * 'flush_cache()' - Free all entries in a decision cache.
+ */
+
+static void
+flush_cache(cups_array_t *cache)	/* I - Cache to flush */
+{
+  void	*entry;				/* Current entry */
+
+
+  for (entry = cupsArrayFirst(cache); entry; entry = cupsArrayNext(cache))
+    free(entry);
+
+  cupsArrayClear(cache);
+}
+
+
 /*
  * 'free_authmask()' - Free function for auth masks.
  */
@@ -2222,6 +2632,46 @@ free_authmask(cupsd_authmask_t *mask,	/* I - Auth mask to free */
 }
 
 
+/*
+ * 'free_ipnode()' - Free an IP mask trie.
+ */
+
+static void
+free_ipnode(cupsd_ipnode_t *node)	/* I - Trie node */
+{
+  if (!node)
+    return;
+
+  free_ipnode(node->child[0]);
+  free_ipnode(node->child[1]);
+  free(node);
+}
+
+
+/*
+ * 'match_ipnode()' - Check an address against an IP mask trie.
+ */
+
+static int				/* O - 1 if a mask matches, 0 otherwise */
+match_ipnode(cupsd_ipnode_t *trie,	/* I - Trie root */
+             unsigned       ip[4])	/* I - Client address */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; trie && i <= 128; i ++)
+  {
+    if (trie->match)
+      return (1);
+
+    if (i < 128)
+      trie = trie->child[(ip[i / 32] >> (31 - (i & 31))) & 1];
+  }
+
+  return (0);
+}
+
+
 #if HAVE_LIBPAM
 /*
  * 'pam_func()' - PAM conversation function.
@@ -86,6 +86,9 @@ typedef struct
   }		mask;			/* Mask data */
 } cupsd_authmask_t;
 
+typedef struct cupsd_ipnode_s cupsd_ipnode_t;
+					/* Compiled IP mask trie node */
+
 typedef struct
 {
   char			*location;	/* Location of resource */
@@ -99,6 +102,11 @@ typedef struct
   cups_array_t		*names,		/* User or group names */
 			*allow,		/* Allow lines */
 			*deny;		/* Deny lines */
+  int			compiled;	/* Have the masks been compiled? */
+  cupsd_ipnode_t	*allow_ips,	/* Allow IP prefixes */
+			*deny_ips;	/* Deny IP prefixes */
+  cups_array_t		*allow_other,	/* Allow lines not in allow_ips */
+			*deny_other;	/* Deny lines not in deny_ips */
   http_encryption_t	encryption;	/* To encrypt or not to encrypt... */
 } cupsd_location_t;
 
@@ -111,6 +119,8 @@ typedef struct cupsd_client_s cupsd_client_t;
 
 VAR cups_array_t	*Locations	VALUE(NULL);
 					/* Authorization locations */
+VAR int			AuthCacheTimeout VALUE(60);
+					/* Lifetime of cached access decisions */
 #ifdef HAVE_SSL
 VAR http_encryption_t	DefaultEncryption VALUE(HTTP_ENCRYPT_REQUIRED);
 					/* Default encryption for authentication */
@@ -137,6 +147,7 @@ extern cupsd_location_t	*cupsdCopyLocation(cupsd_location_t *loc);
 extern void		cupsdDeleteAllLocations(void);
 extern cupsd_location_t	*cupsdFindBest(const char *path, http_state_t state);
 extern cupsd_location_t	*cupsdFindLocation(const char *location);
+extern void		cupsdFlushAuthCache(void);
 extern void		cupsdFreeLocation(cupsd_location_t *loc);
 extern http_status_t	cupsdIsAuthorized(cupsd_client_t *con, const char *owner);
 extern cupsd_location_t	*cupsdNewLocation(const char *location);
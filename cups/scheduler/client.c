@@ -432,6 +432,26 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
     con->file = -1;
   }
 
+  if (con->stream_job)
+  {
+   /*
+    * Abort any stream-through job whose file was not completely received...
+    */
+
+    cupsd_job_t	*job;			/* Stream-through job */
+
+
+    if ((job = cupsdFindJob(con->stream_job)) != NULL)
+    {
+      cupsdUpdateJobStream(job, 1);
+      cupsdSetJobState(job, IPP_JSTATE_ABORTED, CUPSD_JOB_DEFAULT,
+                       "Aborting job because the print file was not "
+		       "completely received.");
+    }
+
+    con->stream_job = 0;
+  }
+
  /*
   * Close the socket and clear the file from the input set for select()...
   */
@@ -554,6 +574,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
   struct stat		filestats;	/* File information */
   mime_type_t		*type;		/* MIME type of file */
   cupsd_printer_t	*p;		/* Printer */
+  cupsd_job_t		*job;		/* Stream-through job */
   static unsigned	request_id = 0;	/* Request ID for temp files */
 
 
@@ -1921,6 +1942,25 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
             fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+           /*
+	    * Start stream-through jobs before the file is received...
+	    */
+
+	    if (con->file >= 0 && con->request && cupsdStartIPPStream(con) &&
+	        !con->request)
+	    {
+	     /*
+	      * The request was answered with an HTTP error, which ends the
+	      * POST since the rest of the document can no longer be read...
+	      */
+
+	      unlink(con->filename);
+	      cupsdClearString(&con->filename);
+
+	      cupsdCloseClient(con);
+	      return;
+	    }
 	  }
 
 	  if (httpGetState(con->http) != HTTP_STATE_POST_SEND)
@@ -1946,14 +1986,48 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
               if (write(con->file, line, (size_t)bytes) < bytes)
 	      {
-        	cupsdLogClient(con, CUPSD_LOG_ERROR,
-	                       "Unable to write %d bytes to \"%s\": %s",
-                               bytes, con->filename, strerror(errno));
+	        if (con->stream_job)
+		{
+		 /*
+		  * The spool file belongs to the stream-through job, so abort
+		  * the job and drop the response that was held for it...
+		  */
 
-		close(con->file);
-		con->file = -1;
-		unlink(con->filename);
-		cupsdClearString(&con->filename);
+		  cupsdLogClient(con, CUPSD_LOG_ERROR,
+				 "Unable to write %d bytes to the print file for "
+				 "job %d: %s", bytes, con->stream_job,
+				 strerror(errno));
+
+		  close(con->file);
+		  con->file = -1;
+
+		  if ((job = cupsdFindJob(con->stream_job)) != NULL)
+		  {
+		    cupsdUpdateJobStream(job, 1);
+		    cupsdSetJobState(job, IPP_JSTATE_ABORTED, CUPSD_JOB_DEFAULT,
+				     "Aborting job because the print file "
+				     "could not be written.");
+		  }
+
+		  con->stream_job = 0;
+
+		  ippDelete(con->request);
+		  con->request = NULL;
+
+		  ippDelete(con->response);
+		  con->response = NULL;
+		}
+		else
+		{
+		  cupsdLogClient(con, CUPSD_LOG_ERROR,
+				 "Unable to write %d bytes to \"%s\": %s",
+				 bytes, con->filename, strerror(errno));
+
+		  close(con->file);
+		  con->file = -1;
+		  unlink(con->filename);
+		  cupsdClearString(&con->filename);
+		}
 
         	if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE,
 		                    CUPSD_AUTH_NONE))
@@ -1962,6 +2036,9 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 		  return;
 		}
 	      }
+	      else if (con->stream_job &&
+	               (job = cupsdFindJob(con->stream_job)) != NULL)
+	        cupsdUpdateJobStream(job, 0);
 	    }
 	    else if (httpGetState(con->http) == HTTP_STATE_POST_RECV)
               return;
@@ -1992,15 +2069,37 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    close(con->file);
 	    con->file = -1;
 
-            if (filestats.st_size > MaxRequestSize &&
-	        MaxRequestSize > 0)
+            if (con->stream_job)
 	    {
 	     /*
-	      * Request is too big; remove it and send an error...
+	      * Tell the stream-through job that the file is complete...
 	      */
 
-	      unlink(con->filename);
-	      cupsdClearString(&con->filename);
+	      if ((job = cupsdFindJob(con->stream_job)) != NULL)
+	      {
+	        cupsdUpdateJobStream(job, 1);
+
+		if (filestats.st_size > MaxRequestSize && MaxRequestSize > 0)
+		  cupsdSetJobState(job, IPP_JSTATE_ABORTED, CUPSD_JOB_DEFAULT,
+		                   "Aborting job because the print file is too "
+				   "large.");
+	      }
+
+	      con->stream_job = 0;
+	    }
+
+            if (filestats.st_size > MaxRequestSize && MaxRequestSize > 0)
+	    {
+	     /*
+	      * Request is too big; remove it and send an error instead of any
+	      * response held for a stream-through job...
+	      */
+
+	      if (con->filename)
+	      {
+		unlink(con->filename);
+		cupsdClearString(&con->filename);
+	      }
 
 	      if (con->request)
 	      {
@@ -2012,13 +2111,19 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 		con->request = NULL;
               }
 
+	      if (con->response)
+	      {
+	        ippDelete(con->response);
+		con->response = NULL;
+	      }
+
               if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE, CUPSD_AUTH_NONE))
 	      {
 		cupsdCloseClient(con);
 		return;
 	      }
 	    }
-	    else if (filestats.st_size == 0)
+	    else if (filestats.st_size == 0 && con->filename)
 	    {
 	     /*
 	      * Don't allow empty file...
@@ -2045,7 +2150,10 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
           if (con->request)
 	  {
-	    cupsdProcessIPPRequest(con);
+	    if (con->response)
+	      cupsdSendIPPResponse(con);
+	    else
+	      cupsdProcessIPPRequest(con);
 
 	    if (con->filename)
 	    {
@@ -2435,7 +2543,7 @@ cupsdUpdateCGI(void)
     if (loglevel == CUPSD_LOG_INFO)
       cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
 
-    if (!strchr(CGIStatusBuffer->buffer, '\n'))
+    if (!strchr(CGIStatusBuffer->bufptr, '\n'))
       break;
   }
 
@@ -44,6 +44,7 @@ struct cupsd_client_s
 			*options,	/* Options for command */
 			*query_string;	/* QUERY_STRING environment variable */
   int			file;		/* Input/output file */
+  int			stream_job;	/* Stream-through job receiving file */
   int			file_ready;	/* Input ready on file/pipe? */
   int			pipe_pid;	/* Pipe process ID (or 0 if not a pipe) */
   http_status_t		pipe_status;	/* HTTP status from pipe process */
@@ -135,7 +136,9 @@ extern int	cupsdSendError(cupsd_client_t *con, http_status_t code,
 		               int auth_type);
 extern int	cupsdSendHeader(cupsd_client_t *con, http_status_t code,
 		                char *type, int auth_type);
+extern int	cupsdSendIPPResponse(cupsd_client_t *con);
 extern void	cupsdShutdownClient(cupsd_client_t *con);
+extern int	cupsdStartIPPStream(cupsd_client_t *con);
 extern void	cupsdStartListening(void);
 extern void	cupsdStopListening(void);
 extern void	cupsdUpdateCGI(void);
@@ -44,6 +44,7 @@
 typedef enum
 {
   CUPSD_VARTYPE_INTEGER,		/* Integer option */
+  CUPSD_VARTYPE_SIZE,			/* 64-bit size option */
   CUPSD_VARTYPE_TIME,			/* Time interval option */
   CUPSD_VARTYPE_STRING,			/* String option */
   CUPSD_VARTYPE_BOOLEAN,		/* Boolean option */
@@ -65,6 +66,7 @@ typedef struct
 
 static const cupsd_var_t	cupsd_vars[] =
 {
+  { "AuthCacheTimeout",		&AuthCacheTimeout,	CUPSD_VARTYPE_TIME },
   { "AutoPurgeJobs", 		&JobAutoPurge,		CUPSD_VARTYPE_BOOLEAN },
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   { "BrowseDNSSDSubTypes",	&DNSSDSubTypes,		CUPSD_VARTYPE_STRING },
@@ -78,10 +80,16 @@ static const cupsd_var_t	cupsd_vars[] =
   { "DefaultPaperSize",		&DefaultPaperSize,	CUPSD_VARTYPE_STRING },
   { "DefaultPolicy",		&DefaultPolicy,		CUPSD_VARTYPE_STRING },
   { "DefaultShared",		&DefaultShared,		CUPSD_VARTYPE_BOOLEAN },
+  { "DeviceCacheTime",		&DeviceCacheTime,	CUPSD_VARTYPE_STRING },
   { "DirtyCleanInterval",	&DirtyCleanInterval,	CUPSD_VARTYPE_TIME },
   { "ErrorPolicy",		&ErrorPolicy,		CUPSD_VARTYPE_STRING },
+  { "FilterHost",		&FilterHost,		CUPSD_VARTYPE_BOOLEAN },
+  { "FilterLauncher",		&FilterLauncher,	CUPSD_VARTYPE_BOOLEAN },
   { "FilterLimit",		&FilterLimit,		CUPSD_VARTYPE_INTEGER },
+  { "FilterMemoryLimit",	&FilterMemoryLimit,	CUPSD_VARTYPE_SIZE },
   { "FilterNice",		&FilterNice,		CUPSD_VARTYPE_INTEGER },
+  { "FilterParallel",		&FilterParallel,	CUPSD_VARTYPE_INTEGER },
+  { "FilterRingSize",		&FilterRingSize,	CUPSD_VARTYPE_INTEGER },
 #ifdef HAVE_GSSAPI
   { "GSSServiceName",		&GSSServiceName,	CUPSD_VARTYPE_STRING },
 #endif /* HAVE_GSSAPI */
@@ -138,6 +146,7 @@ static const cupsd_var_t	cupsfiles_vars[] =
   { "DocumentRoot",		&DocumentRoot,		CUPSD_VARTYPE_STRING },
   { "ErrorLog",			&ErrorLog,		CUPSD_VARTYPE_STRING },
   { "FileDevice",		&FileDevice,		CUPSD_VARTYPE_BOOLEAN },
+  { "FilterCgroup",		&FilterCgroup,		CUPSD_VARTYPE_PATHNAME },
   { "FontPath",			&FontPath,		CUPSD_VARTYPE_STRING },
   { "LogFilePerm",		&LogFilePerm,		CUPSD_VARTYPE_PERM },
   { "LPDConfigFile",		&LPDConfigFile,		CUPSD_VARTYPE_STRING },
@@ -540,6 +549,7 @@ cupsdReadConfiguration(void)
   */
 
   cupsdDeleteAllLocations();
+  cupsdFlushAuthCache();
 
   cupsdDeleteAllListeners();
 
@@ -562,6 +572,7 @@ cupsdReadConfiguration(void)
   cupsdSetString(&DocumentRoot, CUPS_DOCROOT);
   cupsdSetString(&AccessLog, CUPS_LOGDIR "/access_log");
   cupsdClearString(&ErrorLog);
+  cupsdClearString(&FilterCgroup);
   cupsdSetString(&PageLog, CUPS_LOGDIR "/page_log");
   cupsdSetString(&PageLogFormat,
                  "%p %u %j %T %P %C %{job-billing} "
@@ -680,6 +691,7 @@ cupsdReadConfiguration(void)
   */
 
   AccessLogLevel           = CUPSD_ACCESSLOG_ACTIONS;
+  AuthCacheTimeout         = 60;
   ConfigFilePerm           = CUPS_DEFAULT_CONFIG_FILE_PERM;
   FatalErrors              = parse_fatal_errors(CUPS_DEFAULT_FATAL_ERRORS);
   default_auth_type        = CUPSD_AUTH_BASIC;
@@ -691,9 +703,14 @@ cupsdReadConfiguration(void)
   JobRetryLimit            = 5;
   JobRetryInterval         = 300;
   FileDevice               = FALSE;
+  FilterHost               = FALSE;
+  FilterLauncher           = FALSE;
   FilterLevel              = 0;
   FilterLimit              = 0;
+  FilterMemoryLimit        = 0;
   FilterNice               = 0;
+  FilterParallel           = 0;
+  FilterRingSize           = 0;
   HostNameLookups          = FALSE;
   KeepAlive                = TRUE;
   KeepAliveTimeout         = DEFAULT_KEEPALIVE;
@@ -729,6 +746,7 @@ cupsdReadConfiguration(void)
   cupsdSetString(&SMBConfigFile, CUPS_DEFAULT_SMB_CONFIG_FILE);
 
   cupsdSetString(&ErrorPolicy, "stop-printer");
+  cupsdSetString(&DeviceCacheTime, "300");
 
   JobHistory          = DEFAULT_HISTORY;
   JobFiles            = DEFAULT_FILES;
@@ -2617,6 +2635,7 @@ parse_variable(
   switch (var->type)
   {
     case CUPSD_VARTYPE_INTEGER :
+    case CUPSD_VARTYPE_SIZE :
 	if (!value)
 	{
 	  cupsdLogMessage(CUPSD_LOG_ERROR,
@@ -2633,21 +2652,25 @@ parse_variable(
 	}
 	else
 	{
-	  int	n;		/* Number */
-	  char	*units;		/* Units */
+	  long long	n,		/* Number */
+			scale = 1,	/* Units multiplier */
+			max;		/* Maximum value */
+	  char		*units;		/* Units */
 
-	  n = strtol(value, &units, 0);
+	  errno = 0;
+	  n     = strtoll(value, &units, 0);
+	  max   = var->type == CUPSD_VARTYPE_SIZE ? LLONG_MAX : INT_MAX;
 
 	  if (units && *units)
 	  {
 	    if (tolower(units[0] & 255) == 'g')
-	      n *= 1024 * 1024 * 1024;
+	      scale = 1024 * 1024 * 1024;
 	    else if (tolower(units[0] & 255) == 'm')
-	      n *= 1024 * 1024;
+	      scale = 1024 * 1024;
 	    else if (tolower(units[0] & 255) == 'k')
-	      n *= 1024;
+	      scale = 1024;
 	    else if (tolower(units[0] & 255) == 't')
-	      n *= 262144;
+	      scale = 262144;
 	    else
 	    {
 	      cupsdLogMessage(CUPSD_LOG_ERROR,
@@ -2664,9 +2687,20 @@ parse_variable(
 			    "%s.", line, linenum, filename);
 	    return (0);
 	  }
+	  else if (errno == ERANGE || n > max / scale)
+	  {
+	    cupsdLogMessage(CUPSD_LOG_ERROR,
+			    "Integer value too large for %s on line %d of %s.",
+			    line, linenum, filename);
+	    return (0);
+	  }
+	  else if (var->type == CUPSD_VARTYPE_SIZE)
+	  {
+	    *((off_t *)var->ptr) = (off_t)(n * scale);
+	  }
 	  else
 	  {
-	    *((int *)var->ptr) = n;
+	    *((int *)var->ptr) = (int)(n * scale);
 	  }
 	}
 	break;
@@ -2931,6 +2965,15 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
 		      "FaxRetryLimit is deprecated; use "
 		      "JobRetryLimit on line %d.", linenum);
     }
+    else if (!_cups_strcasecmp(line, "FilterLimit") && value &&
+             !_cups_strcasecmp(value, "auto"))
+    {
+     /*
+      * Size the filter limit using the number of CPUs...
+      */
+
+      FilterLimit = -1;
+    }
     else if ((!_cups_strcasecmp(line, "Port") || !_cups_strcasecmp(line, "Listen")
 #ifdef HAVE_SSL
              || !_cups_strcasecmp(line, "SSLPort") || !_cups_strcasecmp(line, "SSLListen")
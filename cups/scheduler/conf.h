@@ -132,6 +132,8 @@ VAR char		*AccessLog		VALUE(NULL),
 					/* Error log filename */
 			*PageLog		VALUE(NULL),
 					/* Page log filename */
+			*FilterCgroup		VALUE(NULL),
+					/* Control group for job processes */
 			*CacheDir		VALUE(NULL),
 					/* Cache file directory */
 			*DataDir		VALUE(NULL),
@@ -142,6 +144,8 @@ VAR char		*AccessLog		VALUE(NULL),
 					/* Default locale */
 			*DefaultPaperSize	VALUE(NULL),
 					/* Default paper size */
+			*DeviceCacheTime	VALUE(NULL),
+					/* Device cache times for backends */
 			*ErrorPolicy		VALUE(NULL),
 					/* Default printer-error-policy */
 			*RIPCache		VALUE(NULL),
@@ -212,6 +216,14 @@ VAR int			MaxClients		VALUE(100),
 					/* Current filter level */
 			FilterNice		VALUE(0),
 					/* Nice value for filters */
+			FilterParallel		VALUE(0),
+					/* Number of parallel raster chains */
+			FilterRingSize		VALUE(0),
+					/* Size of rings between filters */
+			FilterHost		VALUE(FALSE),
+					/* Run built-in filters in cups-filterhost? */
+			FilterLauncher		VALUE(FALSE),
+					/* Start filters using cups-launcher? */
 			ReloadTimeout		VALUE(DEFAULT_KEEPALIVE),
 					/* Timeout before reload from SIGHUP */
 			RootCertDuration	VALUE(300),
@@ -224,6 +236,8 @@ VAR int			MaxClients		VALUE(100),
 					/* multiple-operation-time-out value */
 			WebInterface		VALUE(CUPS_DEFAULT_WEBIF);
 					/* Enable the web interface? */
+VAR off_t		FilterMemoryLimit	VALUE(0);
+					/* Max memory for a job's processes */
 VAR cups_file_t		*AccessFile		VALUE(NULL),
 					/* Access log file */
 			*ErrorFile		VALUE(NULL),
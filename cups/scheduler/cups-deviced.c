@@ -30,6 +30,8 @@
  */
 
 #define MAX_BACKENDS	200		/* Maximum number of backends we'll run */
+#define REFRESH_TIMEOUT	120		/* Timeout for background cache refresh */
+#define SLOW_TIME	1.0		/* Run time for caching backends */
 
 
 /*
@@ -40,9 +42,12 @@ typedef struct
 {
   char		*name;			/* Name of backend */
   int		pid,			/* Process ID */
-		status;			/* Exit status */
+		status,			/* Exit status */
+		orphan;			/* Started by the parent process? */
   cups_file_t	*pipe;			/* Pipe from backend stdout */
   int		count;			/* Number of devices found */
+  double	start;			/* Time backend was started */
+  cups_array_t	*lines;			/* Lines to cache, if any */
 } cupsd_backend_t;
 
 
@@ -82,6 +87,11 @@ static int		send_class,	/* Send device-class attribute? */
 			send_location;	/* Send device-location attribute? */
 static int		dead_children = 0;
 					/* Dead children? */
+static int		cache_time = 0;	/* Default device cache time */
+static int		num_cache_times = 0;
+					/* Number of backend cache times */
+static cups_option_t	*cache_times = NULL;
+					/* Backend cache times */
 
 
 /*
@@ -94,13 +104,21 @@ static int		add_device(const char *device_class,
 				   const char *device_uri,
 				   const char *device_id,
 				   const char *device_location);
+static void		collect_devices(double end_time);
 static int		compare_devices(cupsd_device_t *p0,
 			                cupsd_device_t *p1);
+static int		get_cache_time(const char *name, int *fixed);
 static double		get_current_time(void);
 static int		get_device(cupsd_backend_t *backend);
+static int		parse_device(const char *name, char *line);
 static void		process_children(void);
+static int		read_cache(const char *name, int *refresh);
+static void		refresh_cache(char *names[], int roots[],
+			              int num_names);
 static void		sigchld_handler(int sig);
 static int		start_backend(const char *backend, int root);
+static void		stop_unfinished(void);
+static void		write_cache(cupsd_backend_t *backend);
 
 
 /*
@@ -122,8 +140,20 @@ main(int  argc,				/* I - Number of command-line args */
   char		filename[1024];		/* Backend directory filename */
   cups_dir_t	*dir;			/* Directory pointer */
   cups_dentry_t *dent;			/* Directory entry */
-  double	current_time,		/* Current time */
-		end_time;		/* Ending time */
+  int		num_names = 0,		/* Number of backends to report */
+		num_refresh = 0,	/* Number of backends to refresh */
+		num_unfinished = 0,	/* Number of backends to finish */
+		roots[MAX_BACKENDS],	/* Run backends as root? */
+		refresh_roots[MAX_BACKENDS],
+					/* Run refreshed backends as root? */
+		refresh;		/* Refresh cached devices? */
+  char		*names[MAX_BACKENDS],	/* Backends to report */
+		*refresh_names[MAX_BACKENDS];
+					/* Backends to refresh */
+  const char	*cache_value;		/* device-cache-time option */
+  char		cache_buffer[256],	/* Copy of device-cache-time */
+		*cache_ptr,		/* Pointer into device-cache-time */
+		*cache_name;		/* Backend name in device-cache-time */
   int		num_options;		/* Number of options */
   cups_option_t	*options;		/* Options */
   cups_array_t	*requested,		/* requested-attributes values */
@@ -202,6 +232,31 @@ main(int  argc,				/* I - Number of command-line args */
     send_location       = cupsArrayFind(requested, "device-location") != NULL;
   }
 
+ /*
+  * The device-cache-time option contains the default cache time followed by
+  * any backend=seconds values, separated by commas...
+  */
+
+  if ((cache_value = cupsGetOption("device-cache-time", num_options,
+                                   options)) != NULL)
+  {
+    strlcpy(cache_buffer, cache_value, sizeof(cache_buffer));
+
+    for (cache_ptr = strtok(cache_buffer, ",");
+         cache_ptr;
+	 cache_ptr = strtok(NULL, ","))
+    {
+      if ((cache_name = strchr(cache_ptr, '=')) != NULL)
+      {
+        *cache_name++ = '\0';
+	num_cache_times = cupsAddOption(cache_ptr, cache_name,
+	                                num_cache_times, &cache_times);
+      }
+      else
+        cache_time = atoi(cache_ptr);
+    }
+  }
+
  /*
   * Listen to child signals...
   */
@@ -270,7 +325,15 @@ main(int  argc,				/* I - Number of command-line args */
     * all others run as the unprivileged user...
     */
 
-    start_backend(dent->filename, !(dent->fileinfo.st_mode & (S_IWGRP | S_IRWXO)));
+    if (num_names >= MAX_BACKENDS)
+    {
+      fprintf(stderr, "ERROR: Too many backends (%d)!\n", num_names);
+      break;
+    }
+
+    names[num_names] = strdup(dent->filename);
+    roots[num_names] = !(dent->fileinfo.st_mode & (S_IWGRP | S_IRWXO));
+    num_names ++;
   }
 
   cupsDirClose(dir);
@@ -287,58 +350,54 @@ main(int  argc,				/* I - Number of command-line args */
   cupsdSendIPPString(IPP_TAG_CHARSET, "attributes-charset", "utf-8");
   cupsdSendIPPString(IPP_TAG_LANGUAGE, "attributes-natural-language", "en-US");
 
-  end_time = get_current_time() + timeout;
+ /*
+  * Report cached devices right away and run the other backends...
+  */
 
-  while (active_backends > 0 && (current_time = get_current_time()) < end_time)
+  for (i = 0; i < num_names; i ++)
   {
-   /*
-    * Collect the output from the backends...
-    */
-
-    timeout = (int)(1000 * (end_time - current_time));
-
-    if (poll(backend_fds, (nfds_t)num_backends, timeout) > 0)
+    if (read_cache(names[i], &refresh))
     {
-      for (i = 0; i < num_backends; i ++)
-        if (backend_fds[i].revents && backends[i].pipe)
-	{
-	  cups_file_t *bpipe = backends[i].pipe;
-					/* Copy of pipe for backend... */
-
-	  do
-	  {
-	    if (get_device(backends + i))
-	    {
-	      backend_fds[i].fd     = 0;
-	      backend_fds[i].events = 0;
-	      break;
-	    }
-	  }
-	  while (bpipe->ptr && memchr(bpipe->ptr, '\n', (size_t)(bpipe->end - bpipe->ptr)));
-        }
+      if (refresh)
+      {
+        refresh_names[num_refresh] = names[i];
+	refresh_roots[num_refresh] = roots[i];
+	num_refresh ++;
+      }
     }
-
-   /*
-    * Get exit status from children...
-    */
-
-    if (dead_children)
-      process_children();
+    else
+      start_backend(names[i], roots[i]);
   }
 
+  collect_devices(get_current_time() + timeout);
+
   cupsdSendIPPTrailer();
 
  /*
-  * Terminate any remaining backends and exit...
+  * Terminate any remaining backends that are not cached and exit; slow
+  * backends that are cached run to completion in the background so their
+  * devices are cached for the next request...
   */
 
   if (active_backends > 0)
   {
     for (i = 0; i < num_backends; i ++)
       if (backends[i].pid)
-	kill(backends[i].pid, SIGTERM);
+      {
+        if (backends[i].pipe && backends[i].lines)
+	  num_unfinished ++;
+	else
+	  kill(backends[i].pid, SIGTERM);
+      }
   }
 
+ /*
+  * Update old cached devices in the background...
+  */
+
+  if (num_refresh > 0 || num_unfinished > 0)
+    refresh_cache(refresh_names, refresh_roots, num_refresh);
+
   return (0);
 }
 
@@ -427,6 +486,75 @@ add_device(
 }
 
 
+/*
+ * 'collect_devices()' - Collect the devices reported by the backends.
+ */
+
+static void
+collect_devices(double end_time)	/* I - Time to stop collecting */
+{
+  int		i;			/* Looping var */
+  int		timeout;		/* Timeout in milliseconds */
+  double	current_time;		/* Current time */
+
+
+  while (active_backends > 0 && (current_time = get_current_time()) < end_time)
+  {
+   /*
+    * Collect the output from the backends...
+    */
+
+    timeout = (int)(1000 * (end_time - current_time));
+
+    if (poll(backend_fds, (nfds_t)num_backends, timeout) > 0)
+    {
+      for (i = 0; i < num_backends; i ++)
+        if (backend_fds[i].revents && backends[i].pipe)
+	{
+	  cups_file_t *bpipe = backends[i].pipe;
+					/* Copy of pipe for backend... */
+
+	  do
+	  {
+	    if (get_device(backends + i))
+	    {
+	      backend_fds[i].fd     = 0;
+	      backend_fds[i].events = 0;
+	      break;
+	    }
+	  }
+	  while (bpipe->ptr && memchr(bpipe->ptr, '\n', (size_t)(bpipe->end - bpipe->ptr)));
+        }
+    }
+
+   /*
+    * Get exit status from children...
+    */
+
+    if (dead_children)
+      process_children();
+  }
+
+ /*
+  * Read any devices that were reported just before the backends exited...
+  */
+
+  for (i = 0; i < num_backends; i ++)
+    if (backends[i].pipe && !backends[i].pid)
+    {
+      while (poll(backend_fds + i, 1, 0) > 0)
+      {
+	if (get_device(backends + i))
+	{
+	  backend_fds[i].fd     = 0;
+	  backend_fds[i].events = 0;
+	  break;
+	}
+      }
+    }
+}
+
+
 /*
  * 'compare_devices()' - Compare device names to eliminate duplicates.
  */
@@ -451,6 +579,28 @@ compare_devices(cupsd_device_t *d0,	/* I - First device */
 }
 
 
+/*
+ * 'get_cache_time()' - Get the device cache time for a backend.
+ */
+
+static int				/* O - Cache time in seconds */
+get_cache_time(const char *name,	/* I - Name of backend */
+               int        *fixed)	/* O - 1 if set for this backend */
+{
+  const char	*value;			/* Cache time for backend */
+
+
+  if ((value = cupsGetOption(name, num_cache_times, cache_times)) != NULL)
+  {
+    *fixed = 1;
+    return (atoi(value));
+  }
+
+  *fixed = 0;
+  return (cache_time);
+}
+
+
 /*
  * 'get_current_time()' - Get the current time as a double value in seconds.
  */
@@ -474,8 +624,63 @@ get_current_time(void)
 static int				/* O - 0 on success, -1 on error */
 get_device(cupsd_backend_t *backend)	/* I - Backend to read from */
 {
-  char	line[2048],			/* Line from backend */
-	temp[2048],			/* Copy of line */
+  char	line[2048];			/* Line from backend */
+
+
+  if (cupsFileGets(backend->pipe, line, sizeof(line)))
+  {
+    if (!parse_device(backend->name, line) && backend->lines)
+      cupsArrayAdd(backend->lines, strdup(line));
+
+    return (0);
+  }
+
+ /*
+  * End of file, update the cache as needed...
+  */
+
+  cupsFileClose(backend->pipe);
+  backend->pipe = NULL;
+
+  if (backend->orphan)
+  {
+   /*
+    * Backends started by the parent can't be waited for, so they are done
+    * once their output ends...
+    */
+
+    backend->pid = 0;
+    active_backends --;
+  }
+
+  if (backend->lines)
+  {
+    char	*cached;			/* Cached line */
+
+    write_cache(backend);
+
+    for (cached = (char *)cupsArrayFirst(backend->lines);
+         cached;
+	 cached = (char *)cupsArrayNext(backend->lines))
+      free(cached);
+
+    cupsArrayDelete(backend->lines);
+    backend->lines = NULL;
+  }
+
+  return (-1);
+}
+
+
+/*
+ * 'parse_device()' - Parse and add a device line from a backend.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+parse_device(const char *name,		/* I - Name of backend */
+	     char       *line)		/* I - Line from backend */
+{
+  char	temp[2048],			/* Copy of line */
 	*ptr,				/* Pointer into line */
 	*dclass,			/* Device class */
 	*uri,				/* Device URI */
@@ -485,72 +690,87 @@ get_device(cupsd_backend_t *backend)	/* I - Backend to read from */
 	*location;			/* Physical location */
 
 
-  if (cupsFileGets(backend->pipe, line, sizeof(line)))
-  {
-   /*
-    * Each line is of the form:
-    *
-    *   class URI "make model" "name" ["1284 device ID"] ["location"]
-    */
+ /*
+  * Each line is of the form:
+  *
+  *   class URI "make model" "name" ["1284 device ID"] ["location"]
+  */
 
-    strlcpy(temp, line, sizeof(temp));
+  strlcpy(temp, line, sizeof(temp));
 
-   /*
-    * device-class
-    */
+ /*
+  * device-class
+  */
 
-    dclass = temp;
+  dclass = temp;
 
-    for (ptr = temp; *ptr; ptr ++)
-      if (isspace(*ptr & 255))
-        break;
+  for (ptr = temp; *ptr; ptr ++)
+    if (isspace(*ptr & 255))
+      break;
 
-    while (isspace(*ptr & 255))
-      *ptr++ = '\0';
+  while (isspace(*ptr & 255))
+    *ptr++ = '\0';
 
-   /*
-    * device-uri
-    */
+ /*
+  * device-uri
+  */
 
-    if (!*ptr)
-      goto error;
+  if (!*ptr)
+    goto error;
 
-    for (uri = ptr; *ptr; ptr ++)
-      if (isspace(*ptr & 255))
-        break;
+  for (uri = ptr; *ptr; ptr ++)
+    if (isspace(*ptr & 255))
+      break;
 
-    while (isspace(*ptr & 255))
-      *ptr++ = '\0';
+  while (isspace(*ptr & 255))
+    *ptr++ = '\0';
 
-   /*
-    * device-make-and-model
-    */
+ /*
+  * device-make-and-model
+  */
 
-    if (*ptr != '\"')
-      goto error;
+  if (*ptr != '\"')
+    goto error;
 
-    for (ptr ++, make_model = ptr; *ptr && *ptr != '\"'; ptr ++)
-    {
-      if (*ptr == '\\' && ptr[1])
-        _cups_strcpy(ptr, ptr + 1);
-    }
+  for (ptr ++, make_model = ptr; *ptr && *ptr != '\"'; ptr ++)
+  {
+    if (*ptr == '\\' && ptr[1])
+      _cups_strcpy(ptr, ptr + 1);
+  }
 
-    if (*ptr != '\"')
-      goto error;
+  if (*ptr != '\"')
+    goto error;
 
-    for (*ptr++ = '\0'; isspace(*ptr & 255); *ptr++ = '\0');
+  for (*ptr++ = '\0'; isspace(*ptr & 255); *ptr++ = '\0');
 
-   /*
-    * device-info
-    */
+ /*
+  * device-info
+  */
 
-    if (*ptr != '\"')
-      goto error;
+  if (*ptr != '\"')
+    goto error;
+
+  for (ptr ++, info = ptr; *ptr && *ptr != '\"'; ptr ++)
+  {
+    if (*ptr == '\\' && ptr[1])
+      _cups_strcpy(ptr, ptr + 1);
+  }
+
+  if (*ptr != '\"')
+    goto error;
+
+  for (*ptr++ = '\0'; isspace(*ptr & 255); *ptr++ = '\0');
+
+ /*
+  * device-id
+  */
 
-    for (ptr ++, info = ptr; *ptr && *ptr != '\"'; ptr ++)
+  if (*ptr == '\"')
+  {
+    for (ptr ++, device_id = ptr; *ptr && *ptr != '\"'; ptr ++)
     {
       if (*ptr == '\\' && ptr[1])
-        _cups_strcpy(ptr, ptr + 1);
+	_cups_strcpy(ptr, ptr + 1);
     }
 
     if (*ptr != '\"')
@@ -559,12 +779,12 @@ get_device(cupsd_backend_t *backend)	/* I - Backend to read from */
     for (*ptr++ = '\0'; isspace(*ptr & 255); *ptr++ = '\0');
 
    /*
-    * device-id
+    * device-location
     */
 
     if (*ptr == '\"')
     {
-      for (ptr ++, device_id = ptr; *ptr && *ptr != '\"'; ptr ++)
+      for (ptr ++, location = ptr; *ptr && *ptr != '\"'; ptr ++)
       {
 	if (*ptr == '\\' && ptr[1])
 	  _cups_strcpy(ptr, ptr + 1);
@@ -573,52 +793,25 @@ get_device(cupsd_backend_t *backend)	/* I - Backend to read from */
       if (*ptr != '\"')
 	goto error;
 
-      for (*ptr++ = '\0'; isspace(*ptr & 255); *ptr++ = '\0');
-
-     /*
-      * device-location
-      */
-
-      if (*ptr == '\"')
-      {
-	for (ptr ++, location = ptr; *ptr && *ptr != '\"'; ptr ++)
-	{
-	  if (*ptr == '\\' && ptr[1])
-	    _cups_strcpy(ptr, ptr + 1);
-	}
-
-	if (*ptr != '\"')
-	  goto error;
-
-	*ptr = '\0';
-      }
-      else
-        location = NULL;
+      *ptr = '\0';
     }
     else
-    {
-      device_id = NULL;
-      location  = NULL;
-    }
-
-   /*
-    * Add the device to the array of available devices...
-    */
-
-    if (!add_device(dclass, make_model, info, uri, device_id, location))
-      fprintf(stderr, "DEBUG: [cups-deviced] Found device \"%s\"...\n", uri);
-
-    return (0);
+      location = NULL;
+  }
+  else
+  {
+    device_id = NULL;
+    location  = NULL;
   }
 
  /*
-  * End of file...
+  * Add the device to the array of available devices...
   */
 
-  cupsFileClose(backend->pipe);
-  backend->pipe = NULL;
+  if (!add_device(dclass, make_model, info, uri, device_id, location))
+    fprintf(stderr, "DEBUG: [cups-deviced] Found device \"%s\"...\n", uri);
 
-  return (-1);
+  return (0);
 
  /*
   * Bad format; strip trailing newline and write an error message.
@@ -630,8 +823,8 @@ get_device(cupsd_backend_t *backend)	/* I - Backend to read from */
     line[strlen(line) - 1] = '\0';
 
   fprintf(stderr, "ERROR: [cups-deviced] Bad line from \"%s\": %s\n",
-	  backend->name, line);
-  return (0);
+	  name, line);
+  return (-1);
 }
 
 
@@ -704,6 +897,185 @@ process_children(void)
 }
 
 
+/*
+ * 'read_cache()' - Report the cached devices for a backend.
+ */
+
+static int				/* O - 1 if devices were reported, 0 otherwise */
+read_cache(const char *name,		/* I - Name of backend */
+           int        *refresh)		/* O - 1 if cache should be refreshed */
+{
+  int		ttl,			/* Cache time for backend */
+		fixed;			/* Cache time set for backend? */
+  time_t	age;			/* Age of cache file */
+  double	run_time;		/* Run time of backend */
+  const char	*cache_dir;		/* CUPS_CACHEDIR environment variable */
+  char		filename[1024],		/* Cache filename */
+		line[2048];		/* Line from cache */
+  struct stat	fileinfo;		/* Cache file information */
+  cups_file_t	*fp;			/* Cache file */
+
+
+  *refresh = 0;
+
+  if ((ttl = get_cache_time(name, &fixed)) <= 0)
+    return (0);
+
+  if ((cache_dir = getenv("CUPS_CACHEDIR")) == NULL)
+    cache_dir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/%s.devices", cache_dir, name);
+
+  if (stat(filename, &fileinfo) ||
+      (age = time(NULL) - fileinfo.st_mtime) < 0 || age >= ttl ||
+      (fp = cupsFileOpen(filename, "r")) == NULL)
+    return (0);
+
+ /*
+  * The first line contains the run time of the backend; only backends that
+  * take a while to run are cached unless a cache time is set for them...
+  */
+
+  if (!cupsFileGets(fp, line, sizeof(line)) ||
+      sscanf(line, "#CUPS-DEVICES %lf", &run_time) != 1 ||
+      (!fixed && run_time < SLOW_TIME))
+  {
+    cupsFileClose(fp);
+    return (0);
+  }
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+    parse_device(name, line);
+
+  cupsFileClose(fp);
+
+  fprintf(stderr,
+          "DEBUG: [cups-deviced] Reported cached devices for %s (%d seconds "
+	  "old).\n", name, (int)age);
+
+  *refresh = age >= (ttl / 2);
+
+  return (1);
+}
+
+
+/*
+ * 'refresh_cache()' - Run backends in the background to update their caches.
+ *
+ * Backends that are still running and have a cache time are finished by the
+ * background process, which writes their cache when their output ends.
+ */
+
+static void
+refresh_cache(char *names[],		/* I - Names of backends */
+              int  roots[],		/* I - Run backends as root? */
+	      int  num_names)		/* I - Number of backends */
+{
+  int		i,			/* Looping var */
+		count;			/* Number of unfinished backends */
+  pid_t		pid;			/* Background process ID */
+  int		fd;			/* Lock/null file */
+  const char	*cache_dir;		/* CUPS_CACHEDIR environment variable */
+  char		filename[1024];		/* Lock filename */
+  struct flock	lock;			/* Lock information */
+
+
+ /*
+  * Fork a child that is not part of the scheduler's process group for
+  * cups-deviced and does not hold the response pipe open...
+  */
+
+  fflush(stdout);
+
+  if ((pid = fork()) != 0)
+  {
+    if (pid < 0)
+      stop_unfinished();
+
+    return;
+  }
+
+  setsid();
+
+  if ((fd = open("/dev/null", O_RDWR)) >= 0)
+  {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    close(fd);
+  }
+
+ /*
+  * Only refresh from one process at a time...
+  */
+
+  if ((cache_dir = getenv("CUPS_CACHEDIR")) == NULL)
+    cache_dir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/devices.lock", cache_dir);
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type   = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  if ((fd = open(filename, O_WRONLY | O_CREAT, 0600)) < 0 ||
+      fcntl(fd, F_SETLK, &lock))
+  {
+   /*
+    * Another process is refreshing, stop the unfinished backends...
+    */
+
+    stop_unfinished();
+
+    if (fd >= 0)
+      close(fd);
+
+    return;
+  }
+
+ /*
+  * Keep the unfinished backends started by the parent, forget the others, and
+  * run the old ones again...
+  */
+
+  for (i = 0, count = 0; i < num_backends; i ++)
+  {
+    if (backends[i].pid && backends[i].pipe && backends[i].lines)
+    {
+      fprintf(stderr, "DEBUG: [cups-deviced] Caching devices for %s.\n",
+              backends[i].name);
+
+      backends[count]        = backends[i];
+      backends[count].orphan = 1;
+      backend_fds[count]     = backend_fds[i];
+      count ++;
+    }
+    else if (backends[i].pipe)
+    {
+      cupsFileClose(backends[i].pipe);
+      backends[i].pipe = NULL;
+    }
+  }
+
+  num_backends    = count;
+  active_backends = count;
+
+  for (i = 0; i < num_names; i ++)
+  {
+    fprintf(stderr, "DEBUG: [cups-deviced] Refreshing cached devices for %s.\n",
+            names[i]);
+    start_backend(names[i], roots[i]);
+  }
+
+  collect_devices(get_current_time() + REFRESH_TIMEOUT);
+
+  for (i = 0; i < num_backends; i ++)
+    if (backends[i].pid)
+      kill(backends[i].pid, SIGTERM);
+
+  close(fd);
+}
+
+
 /*
  * 'sigchld_handler()' - Handle 'child' signals from old processes.
  */
@@ -741,6 +1113,7 @@ start_backend(const char *name,		/* I - Backend to run */
   char			program[1024];	/* Full path to backend */
   cupsd_backend_t	*backend;	/* Current backend */
   char			*argv[2];	/* Command-line arguments */
+  int			fixed;		/* Cache time set for backend? */
 
 
   if (num_backends >= MAX_BACKENDS)
@@ -783,7 +1156,13 @@ start_backend(const char *name,		/* I - Backend to run */
 
   backend->name   = strdup(name);
   backend->status = 0;
+  backend->orphan = 0;
   backend->count  = 0;
+  backend->start  = get_current_time();
+  backend->lines  = NULL;
+
+  if (get_cache_time(name, &fixed) > 0)
+    backend->lines = cupsArrayNew(NULL, NULL);
 
   active_backends ++;
   num_backends ++;
@@ -792,6 +1171,69 @@ start_backend(const char *name,		/* I - Backend to run */
 }
 
 
+/*
+ * 'stop_unfinished()' - Stop the backends left running for the background
+ *                       process.
+ */
+
+static void
+stop_unfinished(void)
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < num_backends; i ++)
+    if (backends[i].pid && backends[i].pipe && backends[i].lines)
+      kill(backends[i].pid, SIGTERM);
+}
+
+
+/*
+ * 'write_cache()' - Write the devices reported by a backend to its cache.
+ */
+
+static void
+write_cache(cupsd_backend_t *backend)	/* I - Backend */
+{
+  const char	*cache_dir;		/* CUPS_CACHEDIR environment variable */
+  char		filename[1024],		/* Cache filename */
+		tempfile[1024],		/* Temporary cache filename */
+		*line;			/* Current line */
+  cups_file_t	*fp;			/* Cache file */
+
+
+  if ((cache_dir = getenv("CUPS_CACHEDIR")) == NULL)
+    cache_dir = CUPS_CACHEDIR;
+
+  snprintf(filename, sizeof(filename), "%s/%s.devices", cache_dir,
+           backend->name);
+  snprintf(tempfile, sizeof(tempfile), "%s/%s.devices.%d", cache_dir,
+           backend->name, (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+  {
+    fprintf(stderr, "DEBUG: [cups-deviced] Unable to create \"%s\": %s\n",
+            tempfile, strerror(errno));
+    return;
+  }
+
+  cupsFilePrintf(fp, "#CUPS-DEVICES %.3f\n",
+                 get_current_time() - backend->start);
+
+  for (line = (char *)cupsArrayFirst(backend->lines);
+       line;
+       line = (char *)cupsArrayNext(backend->lines))
+    cupsFilePrintf(fp, "%s\n", line);
+
+  if (cupsFileClose(fp) || rename(tempfile, filename))
+  {
+    fprintf(stderr, "DEBUG: [cups-deviced] Unable to write \"%s\": %s\n",
+            filename, strerror(errno));
+    unlink(tempfile);
+  }
+}
+
+
 /*
  * End of "$Id: cups-deviced.c 11791 2014-04-02 16:56:54Z msweet $".
  */
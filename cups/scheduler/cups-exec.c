@@ -13,7 +13,7 @@
  *
  * Usage:
  *
- *     cups-exec /path/to/profile [-u UID] [-g GID] [-n NICE] /path/to/program argv0 argv1 ... argvN
+ *     cups-exec [-c /path/to/cgroup] [-u UID] [-g GID] [-n NICE] /path/to/profile /path/to/program argv0 argv1 ... argvN
  */
 
 /*
@@ -55,6 +55,9 @@ main(int  argc,				/* I - Number of command-line args */
   uid_t		uid = getuid();		/* UID */
   gid_t		gid = getgid();		/* GID */
   int		niceval = 0;		/* Nice value */
+  const char	*cgroup = NULL;		/* Control group directory */
+  char		procs[1024];		/* cgroup.procs file */
+  int		procsfd;		/* cgroup.procs file descriptor */
 #ifdef HAVE_SANDBOX_H
   char		*sandbox_error = NULL;	/* Sandbox error, if any */
 #endif /* HAVE_SANDBOX_H */
@@ -72,6 +75,14 @@ main(int  argc,				/* I - Number of command-line args */
       {
         switch (*opt)
         {
+          case 'c' : /* -c cgroup */
+              i ++;
+              if (i >= argc)
+                usage();
+
+              cgroup = argv[i];
+              break;
+
           case 'g' : /* -g gid */
               i ++;
               if (i >= argc)
@@ -123,6 +134,24 @@ main(int  argc,				/* I - Number of command-line args */
   fcntl(3, F_SETFL, O_NDELAY);
   fcntl(4, F_SETFL, O_NDELAY);
 
+ /*
+  * Move into the job's control group while we still have privileges...
+  */
+
+  if (cgroup)
+  {
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", cgroup);
+
+    if ((procsfd = open(procs, O_WRONLY)) < 0 || write(procsfd, "0", 1) < 0)
+    {
+      fprintf(stderr, "DEBUG: Unable to join control group %s: %s\n", cgroup,
+              strerror(errno));
+      exit(errno + 100);
+    }
+
+    close(procsfd);
+  }
+
  /*
   * Change UID, GID, and nice value...
   */
@@ -196,7 +225,7 @@ main(int  argc,				/* I - Number of command-line args */
 static void
 usage(void)
 {
-  fputs("Usage: cups-exec [-g gid] [-n nice-value] [-u uid] /path/to/profile /path/to/program argv0 argv1 ... argvN\n", stderr);
+  fputs("Usage: cups-exec [-c cgroup] [-g gid] [-n nice-value] [-u uid] /path/to/profile /path/to/program argv0 argv1 ... argvN\n", stderr);
   exit(1);
 }
 
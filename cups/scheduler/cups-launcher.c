@@ -0,0 +1,509 @@
+/*
+ * "$Id$"
+ *
+ * Process launcher helper for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * Usage:
+ *
+ *     cups-launcher
+ *
+ * The scheduler runs this program with a socket on the standard input and
+ * sends it requests to start filters and backends.  Since the helper has a
+ * tiny address space compared to cupsd, starting processes is much cheaper.
+ * See "launcher.h" for a description of the protocol.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/string-private.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#ifdef HAVE_POSIX_SPAWN
+#  include <spawn.h>
+extern char **environ;
+#endif /* HAVE_POSIX_SPAWN */
+#include "launcher.h"
+
+
+/*
+ * Local globals...
+ */
+
+static int	sigchld_fds[2] = { -1, -1 };
+					/* Pipe for SIGCHLD notifications */
+
+
+/*
+ * Local functions...
+ */
+
+static int	launch_process(int sock, cupsd_launch_msg_t *msg, int *fds,
+		               int num_fds, char *data);
+static int	read_request(int sock, cupsd_launch_msg_t *msg, int *fds,
+		             int *num_fds, char **data);
+static void	reap_children(int sock);
+static int	send_message(int sock, int op, int pid, int status,
+		             struct rusage *usage);
+static void	sigchld_handler(int sig);
+
+
+/*
+ * 'main()' - Start processes for the scheduler.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			sock;		/* Scheduler socket */
+  struct pollfd		pfds[2];	/* Poll data */
+  cupsd_launch_msg_t	msg;		/* Request */
+  int			fds[CUPSD_LAUNCH_MAX_FDS],
+					/* Descriptors from request */
+			num_fds,	/* Number of descriptors */
+			i;		/* Looping var */
+  char			*data;		/* Strings from request */
+  char			ch;		/* Notification byte */
+  struct sigaction	action;		/* Signal action */
+
+
+#ifndef HAVE_POSIX_SPAWN
+  fputs("cups-launcher: Not supported on this platform.\n", stderr);
+  return (1);
+#endif /* !HAVE_POSIX_SPAWN */
+
+ /*
+  * Move the scheduler socket out of the way of the standard descriptors...
+  */
+
+  if ((sock = fcntl(0, F_DUPFD, 10)) < 0)
+  {
+    perror("cups-launcher: Unable to copy socket");
+    return (1);
+  }
+
+  fcntl(sock, F_SETFD, FD_CLOEXEC);
+  close(0);
+  open("/dev/null", O_RDONLY);
+
+ /*
+  * Catch SIGCHLD using a pipe so we can poll() for it...
+  */
+
+  if (pipe(sigchld_fds))
+  {
+    perror("cups-launcher: Unable to create pipe");
+    return (1);
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    fcntl(sigchld_fds[i], F_SETFD, FD_CLOEXEC);
+    fcntl(sigchld_fds[i], F_SETFL, O_NONBLOCK);
+  }
+
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &action, NULL);
+
+  action.sa_handler = sigchld_handler;
+  action.sa_flags   = SA_RESTART | SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &action, NULL);
+
+ /*
+  * Loop until the scheduler closes the socket...
+  */
+
+  pfds[0].fd     = sock;
+  pfds[0].events = POLLIN;
+  pfds[1].fd     = sigchld_fds[0];
+  pfds[1].events = POLLIN;
+
+  for (;;)
+  {
+    if (poll(pfds, 2, -1) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      perror("cups-launcher: poll failed");
+      break;
+    }
+
+    if (pfds[1].revents)
+    {
+      while (read(sigchld_fds[0], &ch, 1) > 0);
+
+      reap_children(sock);
+    }
+
+    if (pfds[0].revents)
+    {
+      if (!read_request(sock, &msg, fds, &num_fds, &data))
+        break;
+
+      launch_process(sock, &msg, fds, num_fds, data);
+
+      for (i = 0; i < num_fds; i ++)
+        close(fds[i]);
+
+      free(data);
+    }
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'launch_process()' - Start a process and tell the scheduler about it.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+launch_process(int                sock,	/* I - Scheduler socket */
+               cupsd_launch_msg_t *msg,	/* I - Request */
+               int                *fds,	/* I - Descriptors */
+	       int                num_fds,/* I - Number of descriptors */
+	       char               *data)	/* I - Strings */
+{
+#ifdef HAVE_POSIX_SPAWN
+  int		i,			/* Looping var */
+		fd,			/* Current descriptor */
+		child[CUPSD_LAUNCH_MAX_FDS];
+					/* Descriptors for the child */
+  pid_t		pid;			/* Process ID */
+  int		error;			/* Spawn error */
+  char		*path,			/* Program to run */
+		**argv,			/* Arguments */
+		**envp = NULL,		/* Environment */
+		*ptr;			/* Pointer into strings */
+  posix_spawn_file_actions_t actions;	/* Spawn file actions */
+  posix_spawnattr_t attrs;		/* Spawn attributes */
+
+
+ /*
+  * Split the strings into the program, arguments, and environment...
+  */
+
+  if ((argv = calloc((size_t)msg->num_argv + 1, sizeof(char *))) == NULL ||
+      (msg->num_envp >= 0 &&
+       (envp = calloc((size_t)msg->num_envp + 1, sizeof(char *))) == NULL))
+  {
+    free(argv);
+    return (send_message(sock, CUPSD_LAUNCH_STARTED, 0, ENOMEM, NULL));
+  }
+
+  path = data;
+  ptr  = path + strlen(path) + 1;
+
+  for (i = 0; i < msg->num_argv; ptr += strlen(ptr) + 1)
+    argv[i ++] = ptr;
+
+  for (i = 0; i < msg->num_envp; ptr += strlen(ptr) + 1)
+    envp[i ++] = ptr;
+
+ /*
+  * Map the descriptors we got to the child's standard descriptors...
+  */
+
+  for (i = 0, fd = 0; i < CUPSD_LAUNCH_MAX_FDS; i ++)
+    child[i] = (msg->fds & (1 << i)) ? fds[fd ++] : -1;
+
+  posix_spawnattr_init(&attrs);
+  posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+
+  posix_spawn_file_actions_init(&actions);
+
+  if (child[0] < 0)
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  else
+    posix_spawn_file_actions_adddup2(&actions, child[0], 0);
+
+  for (i = 1; i < 3; i ++)
+    if (child[i] < 0)
+      posix_spawn_file_actions_addopen(&actions, i, "/dev/null", O_WRONLY, 0);
+    else
+      posix_spawn_file_actions_adddup2(&actions, child[i], i);
+
+  for (i = 3; i < CUPSD_LAUNCH_MAX_FDS; i ++)
+    if (child[i] >= 0)
+      posix_spawn_file_actions_adddup2(&actions, child[i], i);
+
+  if ((error = posix_spawn(&pid, path, &actions, &attrs, argv,
+                           envp ? envp : environ)) != 0)
+    pid = 0;
+
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attrs);
+
+  free(argv);
+  free(envp);
+
+  return (send_message(sock, CUPSD_LAUNCH_STARTED, (int)pid, error, NULL));
+
+#else
+  (void)msg;
+  (void)fds;
+  (void)num_fds;
+  (void)data;
+
+  return (send_message(sock, CUPSD_LAUNCH_STARTED, 0, ENOSYS, NULL));
+#endif /* HAVE_POSIX_SPAWN */
+}
+
+
+/*
+ * 'read_request()' - Read a request from the scheduler.
+ */
+
+static int				/* O - 1 on success, 0 on EOF/error */
+read_request(int                sock,	/* I - Scheduler socket */
+             cupsd_launch_msg_t *msg,	/* O - Request */
+	     int                *fds,	/* O - Descriptors */
+	     int                *num_fds,/* O - Number of descriptors */
+	     char               **data)	/* O - Strings */
+{
+  int			i,		/* Looping var */
+			fd,		/* Current descriptor */
+			strings;	/* Number of strings */
+  ssize_t		bytes;		/* Bytes read */
+  size_t		total;		/* Total bytes read */
+  struct msghdr		hdr;		/* Message header */
+  struct iovec		iov;		/* I/O vector */
+  struct cmsghdr	*cmsg;		/* Control message */
+  char			control[CMSG_SPACE(CUPSD_LAUNCH_MAX_FDS * sizeof(int))];
+					/* Control buffer */
+
+
+  *num_fds = 0;
+  *data    = NULL;
+
+ /*
+  * Read the header and any descriptors that come with it...
+  */
+
+  memset(&hdr, 0, sizeof(hdr));
+  iov.iov_base       = msg;
+  iov.iov_len        = sizeof(cupsd_launch_msg_t);
+  hdr.msg_iov        = &iov;
+  hdr.msg_iovlen     = 1;
+  hdr.msg_control    = control;
+  hdr.msg_controllen = sizeof(control);
+
+  while ((bytes = recvmsg(sock, &hdr, 0)) < 0)
+    if (errno != EINTR && errno != EAGAIN)
+      return (0);
+
+  if (bytes == 0)
+    return (0);
+
+  for (cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+  {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    for (i = 0;
+         i < (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int)) &&
+             *num_fds < CUPSD_LAUNCH_MAX_FDS;
+	 i ++)
+    {
+     /*
+      * Keep the descriptors above the child's standard descriptors so that
+      * the dup2 actions cannot clobber each other...
+      */
+
+      memcpy(&fd, CMSG_DATA(cmsg) + (size_t)i * sizeof(int), sizeof(int));
+
+      if (fd < 10)
+      {
+        int newfd = fcntl(fd, F_DUPFD, 10);
+
+        close(fd);
+	fd = newfd;
+      }
+
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fds[(*num_fds) ++] = fd;
+    }
+  }
+
+  for (total = (size_t)bytes; total < sizeof(cupsd_launch_msg_t); total += (size_t)bytes)
+  {
+    if ((bytes = read(sock, (char *)msg + total, sizeof(cupsd_launch_msg_t) - total)) <= 0)
+    {
+      if (bytes < 0 && (errno == EINTR || errno == EAGAIN))
+      {
+        bytes = 0;
+        continue;
+      }
+
+      return (0);
+    }
+  }
+
+ /*
+  * Validate the request and read the strings...
+  */
+
+  for (i = 0, fd = 0; i < CUPSD_LAUNCH_MAX_FDS; i ++)
+    if (msg->fds & (1 << i))
+      fd ++;
+
+  if (msg->op != CUPSD_LAUNCH_START || fd != *num_fds || msg->num_argv < 1 ||
+      msg->num_envp < -1 || msg->length < 1 ||
+      msg->length > CUPSD_LAUNCH_MAX_DATA)
+  {
+    fputs("cups-launcher: Bad request.\n", stderr);
+    return (0);
+  }
+
+  if ((*data = malloc(msg->length)) == NULL)
+    return (0);
+
+  for (total = 0; total < msg->length; total += (size_t)bytes)
+  {
+    if ((bytes = read(sock, *data + total, msg->length - total)) <= 0)
+    {
+      if (bytes < 0 && (errno == EINTR || errno == EAGAIN))
+      {
+        bytes = 0;
+        continue;
+      }
+
+      return (0);
+    }
+  }
+
+  for (total = 0, strings = 0; total < msg->length; total ++)
+    if (!(*data)[total])
+      strings ++;
+
+  if ((*data)[msg->length - 1] ||
+      strings != 1 + msg->num_argv + (msg->num_envp > 0 ? msg->num_envp : 0))
+  {
+    fputs("cups-launcher: Bad request strings.\n", stderr);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'reap_children()' - Collect exited children and tell the scheduler.
+ */
+
+static void
+reap_children(int sock)			/* I - Scheduler socket */
+{
+  pid_t		pid;			/* Process ID */
+  int		status,			/* Exit status */
+		count = 0;		/* Number of children */
+  struct rusage	usage;			/* Resource usage */
+
+
+#ifdef HAVE_WAIT4
+  while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0)
+#else
+  memset(&usage, 0, sizeof(usage));
+
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+#endif /* HAVE_WAIT4 */
+  {
+    send_message(sock, CUPSD_LAUNCH_EXITED, (int)pid, status, &usage);
+    count ++;
+  }
+
+ /*
+  * Wake up the scheduler so it processes the exit status...
+  */
+
+  if (count)
+    kill(getppid(), SIGCHLD);
+}
+
+
+/*
+ * 'send_message()' - Send a message to the scheduler.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+send_message(int           sock,	/* I - Scheduler socket */
+             int           op,		/* I - Message type */
+             int           pid,		/* I - Process ID */
+	     int           status,	/* I - Exit status or errno value */
+	     struct rusage *usage)	/* I - Resource usage or NULL */
+{
+  cupsd_launch_msg_t	msg;		/* Message */
+  ssize_t		bytes;		/* Bytes written */
+  size_t		total;		/* Total bytes written */
+
+
+  memset(&msg, 0, sizeof(msg));
+  msg.op     = op;
+  msg.pid    = pid;
+  msg.status = status;
+
+  if (usage)
+    msg.usage = *usage;
+
+  for (total = 0; total < sizeof(msg); total += (size_t)bytes)
+  {
+    if ((bytes = write(sock, (char *)&msg + total, sizeof(msg) - total)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+      {
+        bytes = 0;
+        continue;
+      }
+
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'sigchld_handler()' - Note that a child has exited.
+ */
+
+static void
+sigchld_handler(int sig)		/* I - Signal number */
+{
+  int	saved_errno = errno;		/* Saved errno value */
+  ssize_t bytes;			/* Bytes written */
+
+
+  (void)sig;
+
+ /*
+  * If the pipe is full we already have a notification pending...
+  */
+
+  bytes = write(sigchld_fds[1], "C", 1);
+  (void)bytes;
+
+  errno = saved_errno;
+}
+
+
+/*
+ * End of "$Id$".
+ */
@@ -30,6 +30,7 @@
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 
 #ifdef WIN32
 #  include <direct.h>
@@ -157,6 +158,8 @@ VAR int			NeedReload	VALUE(RELOAD_ALL),
 					/* Shutting down the scheduler? */
 VAR void		*DefaultProfile	VALUE(0);
 					/* Default security profile */
+VAR time_t		CgroupCleanTime	VALUE(0);
+					/* Time to retry removing control groups */
 
 #if defined(HAVE_LAUNCHD) || defined(HAVE_SYSTEMD)
 VAR int			OnDemand	VALUE(0);
@@ -201,7 +204,10 @@ extern void		cupsdSetStringf(char **s, const char *f, ...)
 			__attribute__ ((__format__ (__printf__, 2, 3)));
 
 /* process.c */
+extern void		cupsdCleanCgroups(void);
+extern char		*cupsdCreateCgroup(cupsd_job_t *job);
 extern void		*cupsdCreateProfile(int job_id, int allow_networking);
+extern void		cupsdDestroyCgroup(char *cgroup);
 extern void		cupsdDestroyProfile(void *profile);
 extern int		cupsdEndProcess(int pid, int force);
 extern const char	*cupsdFinishProcess(int pid, char *name, size_t namelen, int *job_id);
@@ -210,6 +216,7 @@ extern int		cupsdStartProcess(const char *command, char *argv[],
 					  int errfd, int backfd, int sidefd,
 					  int root, void *profile,
 					  cupsd_job_t *job, int *pid);
+extern int		cupsdWaitLauncher(int *status, struct rusage *usage);
 
 /* select.c */
 extern int		cupsdAddSelect(int fd, cupsd_selfunc_t read_cb,
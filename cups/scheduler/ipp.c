@@ -624,6 +624,37 @@ cupsdProcessIPPRequest(
     }
   }
 
+  if (con->response && httpGetState(con->http) == HTTP_STATE_POST_RECV)
+  {
+   /*
+    * The document for a stream-through job is still being received, so the
+    * response is sent once the request is complete...
+    */
+
+    return (1);
+  }
+
+  return (cupsdSendIPPResponse(con));
+}
+
+
+/*
+ * 'cupsdSendIPPResponse()' - Send the response to an IPP request.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsdSendIPPResponse(
+    cupsd_client_t *con)		/* I - Client connection */
+{
+  ipp_attribute_t	*uri;		/* Printer or job URI attribute */
+
+
+  if ((uri = ippFindAttribute(con->request, "printer-uri",
+                              IPP_TAG_URI)) == NULL &&
+      (uri = ippFindAttribute(con->request, "job-uri", IPP_TAG_URI)) == NULL &&
+      con->request->request.op.operation_id == CUPS_GET_PPD)
+    uri = ippFindAttribute(con->request, "ppd-name", IPP_TAG_NAME);
+
   if (con->response)
   {
    /*
@@ -714,6 +745,67 @@ cupsdProcessIPPRequest(
 }
 
 
+/*
+ * 'cupsdStartIPPStream()' - Start a Print-Job request before its document
+ *                           has been received.
+ *
+ * Printers with stream-through enabled start printing as soon as the request
+ * attributes and document format are known; the document is then fed to the
+ * job as it arrives and the response is sent once it has been received.
+ */
+
+int					/* O - 1 if started, 0 otherwise */
+cupsdStartIPPStream(
+    cupsd_client_t *con)		/* I - Client connection */
+{
+  ipp_attribute_t	*uri,		/* Printer URI attribute */
+			*format;	/* document-format attribute */
+  cups_ptype_t		dtype;		/* Destination type */
+  cupsd_printer_t	*printer;	/* Destination printer */
+
+
+ /*
+  * Only Print-Job requests for stream-through printers with an explicit
+  * document format can be started early; auto-typing needs the document...
+  */
+
+  if (con->request->request.op.operation_id != IPP_OP_PRINT_JOB)
+    return (0);
+
+  if ((uri = ippFindAttribute(con->request, "printer-uri",
+                              IPP_TAG_URI)) == NULL ||
+      !cupsdValidateDest(uri->values[0].string.text, &dtype, &printer) ||
+      (dtype & CUPS_PRINTER_CLASS) || printer->remote ||
+      !printer->stream_through)
+    return (0);
+
+  if ((format = ippFindAttribute(con->request, "document-format",
+                                 IPP_TAG_MIMETYPE)) == NULL ||
+      !_cups_strncasecmp(format->values[0].string.text,
+                         "application/octet-stream", 24))
+    return (0);
+
+  cupsdLogClient(con, CUPSD_LOG_DEBUG,
+                 "Starting stream-through job on \"%s\".", printer->name);
+
+  if (!cupsdProcessIPPRequest(con))
+    return (0);
+
+  if (!con->response)
+  {
+   /*
+    * The request was answered with an HTTP error, so don't process it again
+    * once the document has been received...
+    */
+
+    ippDelete(con->request);
+    con->request = NULL;
+  }
+
+  return (1);
+}
+
+
 /*
  * 'cupsdTimeoutJob()' - Timeout a job waiting on job files.
  */
@@ -2494,6 +2586,17 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
     printer->shared = attr->values[0].boolean;
   }
 
+  if ((attr = ippFindAttribute(con->request, "printer-stream-through",
+                               IPP_TAG_BOOLEAN)) != NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_INFO,
+                    "Setting %s printer-stream-through to %d (was %d.)",
+                    printer->name, attr->values[0].boolean,
+		    printer->stream_through);
+
+    printer->stream_through = attr->values[0].boolean;
+  }
+
   if ((attr = ippFindAttribute(con->request, "printer-state",
                                IPP_TAG_ENUM)) != NULL)
   {
@@ -4961,6 +5064,10 @@ copy_printer_attrs(
   if (!ra || cupsArrayFind(ra, "printer-state-reasons"))
     add_printer_state_reasons(con, printer);
 
+  if (!ra || cupsArrayFind(ra, "printer-stream-through"))
+    ippAddBoolean(con->response, IPP_TAG_PRINTER, "printer-stream-through",
+                  (char)printer->stream_through);
+
   if (!ra || cupsArrayFind(ra, "printer-type"))
   {
     cups_ptype_t type;			/* printer-type value */
@@ -5787,6 +5894,8 @@ get_devices(cupsd_client_t *con)	/* I - Client connection */
 			*include;	/* include-schemes attribute */
   char			command[1024],	/* cups-deviced command */
 			options[2048],	/* Options to pass to command */
+			cache_str[256],	/* String for device cache times */
+			*cache_ptr,	/* Pointer into cache times */
 			requested_str[256],
 					/* String for requested attributes */
 			exclude_str[512],
@@ -5833,16 +5942,29 @@ get_devices(cupsd_client_t *con)	/* I - Client connection */
   else
     include_str[0] = '\0';
 
+ /*
+  * DeviceCacheTime is "seconds [backend=seconds ...]", pass it as a single
+  * comma-delimited option...
+  */
+
+  snprintf(cache_str, sizeof(cache_str), "device-cache-time=%s",
+           DeviceCacheTime ? DeviceCacheTime : "0");
+
+  for (cache_ptr = cache_str; *cache_ptr; cache_ptr ++)
+    if (isspace(*cache_ptr & 255) || *cache_ptr == '+' || *cache_ptr == '%')
+      *cache_ptr = ',';
+
   snprintf(command, sizeof(command), "%s/daemon/cups-deviced", ServerBin);
   snprintf(options, sizeof(options),
-           "%d+%d+%d+%d+%s%s%s%s%s",
+           "%d+%d+%d+%d+%s%s%s%s%s%%20%s",
            con->request->request.op.request_id,
            limit ? limit->values[0].integer : 0,
 	   timeout ? timeout->values[0].integer : 15,
 	   (int)User,
 	   requested_str,
 	   exclude_str[0] ? "%20" : "", exclude_str,
-	   include_str[0] ? "%20" : "", include_str);
+	   include_str[0] ? "%20" : "", include_str,
+	   cache_str);
 
   if (cupsdSendCommand(con, command, options, 1))
   {
@@ -7125,6 +7247,7 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
   char		*first_printer_name;	/* first-printer-name attribute */
   cups_array_t	*ra;			/* Requested attributes array */
   int		local;			/* Local connection? */
+  int		change_count;		/* printer-list-change-count value */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_printers(%p[%d], %x)", con,
@@ -7150,6 +7273,26 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
     return;
   }
 
+ /*
+  * Report the current printer-list-change-count value, and don't send the
+  * printers again if the client already has the current list...
+  */
+
+  change_count = (int)(PrinterListChangeCount & INT_MAX);
+
+  ippAddInteger(con->response, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                "printer-list-change-count", change_count);
+
+  if ((attr = ippFindAttribute(con->request, "printer-list-change-count",
+                               IPP_TAG_INTEGER)) != NULL &&
+      attr->values[0].integer == change_count)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "get_printers: Printer list has not changed.");
+    con->response->request.status.status_code = IPP_OK;
+    return;
+  }
+
  /*
   * See if they want to limit the number of printers reported...
   */
@@ -8217,12 +8360,14 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
   }
 
  /*
-  * Read any embedded job ticket info from PS files...
+  * Read any embedded job ticket info from PS files, unless the file is still
+  * being received...
   */
 
   if (!_cups_strcasecmp(filetype->super, "application") &&
       (!_cups_strcasecmp(filetype->type, "postscript") ||
-       !_cups_strcasecmp(filetype->type, "pdf")))
+       !_cups_strcasecmp(filetype->type, "pdf")) &&
+      httpGetState(con->http) != HTTP_STATE_POST_RECV)
     read_job_ticket(con);
 
  /*
@@ -8233,20 +8378,25 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
     return;
 
  /*
-  * Update quota data...
+  * Update quota data, unless the file is still being received in which case
+  * cupsdUpdateJobStream counts the whole file once it is complete...
   */
 
-  if (stat(con->filename, &fileinfo))
-    kbytes = 0;
-  else
-    kbytes = (fileinfo.st_size + 1023) / 1024;
+  if (httpGetState(con->http) != HTTP_STATE_POST_RECV)
+  {
+    if (stat(con->filename, &fileinfo))
+      kbytes = 0;
+    else
+      kbytes = (fileinfo.st_size + 1023) / 1024;
 
-  cupsdUpdateQuota(printer, job->username, 0, kbytes);
+    cupsdUpdateQuota(printer, job->username, 0, kbytes);
 
-  job->koctets += kbytes;
+    job->koctets += kbytes;
 
-  if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
-    attr->values[0].integer += kbytes;
+    if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
+                                 IPP_TAG_INTEGER)) != NULL)
+      attr->values[0].integer += kbytes;
+  }
 
  /*
   * Add the job file...
@@ -8260,6 +8410,16 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
   rename(con->filename, filename);
   cupsdClearString(&con->filename);
 
+  if (httpGetState(con->http) == HTTP_STATE_POST_RECV)
+  {
+   /*
+    * The rest of the file is fed to the job as it is received...
+    */
+
+    job->streaming  = job->num_files;
+    con->stream_job = job->id;
+  }
+
  /*
   * See if we need to add the ending sheet...
   */
@@ -21,6 +21,7 @@
 #include <grp.h>
 #include <cups/backend.h>
 #include <cups/dir.h>
+#include <cups/ring-private.h>
 #ifdef __APPLE__
 #  include <IOKit/pwr_mgt/IOPMLib.h>
 #  ifdef HAVE_IOKIT_PWR_MGT_IOPMLIBPRIVATE_H
@@ -71,7 +72,8 @@
  *     Each file in a job is filtered by 0 or more programs.  After getting the
  *     list of filters needed and the total cost, the job is either passed or
  *     put back to the processing state until the current FilterLevel comes down
- *     enough to allow printing.
+ *     enough to allow printing.  Waiting jobs are admitted by cupsdCheckJobs,
+ *     shortest (estimated) job first with credit for the time spent waiting.
  *
  *     If we can print, we build a string for the print options and run each of
  *     the filters, piping the output from one into the next.
@@ -101,6 +103,34 @@
  */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_FILTER_HOSTED	1	/* Built into cups-filterhost */
+#define CUPSD_FILTER_RING_IN	2	/* Can read input from a ring */
+#define CUPSD_FILTER_RING_OUT	4	/* Can write output to a ring */
+
+#define CUPSD_FILTER_AGING	2	/* Pages of credit per second waiting */
+#define CUPSD_FILTER_KPAGE	64	/* Estimated kilobytes per page */
+
+#define CUPSD_PARALLEL_BLOCKS	128	/* Blocks of pages for each chain */
+#define CUPSD_PARALLEL_CHAINS	8	/* Maximum number of parallel chains */
+#define CUPSD_PARALLEL_PAGES	16	/* Pages in each block */
+#define CUPSD_PARALLEL_SIZE	1048576	/* Minimum document bytes per chain */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_filter_info_s	/**** Built-in filter information ****/
+{
+  const char	*name;			/* Filter program */
+  int		flags;			/* CUPSD_FILTER_ flags */
+} cupsd_filter_info_t;
+
+
 /*
  * Local globals...
  */
@@ -112,33 +142,72 @@ static mime_filter_t	gziptoany_filter =
 			  0,		/* Cost */
 			  "gziptoany"	/* Filter program to run */
 			};
+static const cupsd_filter_info_t filter_info[] =
+			{		/* Filters that use libcups for I/O */
+			  { "commandtops",	CUPSD_FILTER_RING_IN },
+			  { "gziptoany",	CUPSD_FILTER_HOSTED |
+						CUPSD_FILTER_RING_IN |
+						CUPSD_FILTER_RING_OUT },
+			  { "pstops",		CUPSD_FILTER_RING_IN },
+			  { "rastertodymo",	CUPSD_FILTER_RING_IN },
+			  { "rastertoepson",	CUPSD_FILTER_RING_IN },
+			  { "rastertohp",	CUPSD_FILTER_RING_IN },
+			  { "rastertolabel",	CUPSD_FILTER_RING_IN },
+			  { "rastertopwg",	CUPSD_FILTER_HOSTED |
+						CUPSD_FILTER_RING_IN |
+						CUPSD_FILTER_RING_OUT }
+			};
+static double		filter_load = 1.0;
+					/* Average CPUs used by a job */
+static int		filter_waiting = 0;
+					/* Number of jobs waiting on FilterLimit */
 
 
 /*
  * Local functions...
  */
 
+static void	admit_jobs(void);
+static void	close_stream(cupsd_job_t *job);
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
 static int	compare_jobs(void *first, void *second, void *data);
 static void	dump_job_history(cupsd_job_t *job);
+static int	filter_flags(mime_filter_t *filter, mime_filter_t *hosted,
+		             int num_hosted);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
 static void	free_job_history(cupsd_job_t *job);
+static int	get_filter_limit(void);
+static int	get_job_score(cupsd_job_t *job, time_t curtime);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
+static cups_array_t *host_filters(cups_array_t *filters,
+		             mime_filter_t *hosted, int *num_hosted);
 static size_t	ipp_length(ipp_t *ipp);
 static void	load_job_cache(const char *filename);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static void	release_filters(cupsd_job_t *job);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
 static void	set_time(cupsd_job_t *job, const char *name);
+static int	split_filters(cupsd_job_t *job, cups_array_t *filters,
+		              mime_filter_t **prefix, int *num_prefix,
+			      mime_filter_t *merge);
+static int	start_chains(cupsd_job_t *job, mime_filter_t **prefix,
+		             int num_prefix, int num_chains,
+			     mime_filter_t *merge, const char *command,
+			     char *argv[], char *envp[], int outfd,
+			     int *num_procs);
 static void	start_job(cupsd_job_t *job, cupsd_printer_t *printer);
 static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
+static void	stop_persistent_backends(void);
 static void	unload_job(cupsd_job_t *job);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
+static void	update_job_message(cupsd_job_t *job, const char *level);
+static void	update_stream(cupsd_job_t *job);
 
 
 /*
@@ -165,6 +234,8 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   job->side_pipes[1]   = -1;
   job->status_pipes[0] = -1;
   job->status_pipes[1] = -1;
+  job->stream_file     = -1;
+  job->stream_pipe     = -1;
 
   cupsdSetString(&job->dest, dest);
 
@@ -179,6 +250,65 @@ cupsdAddJob(int        priority,	/* I - Job priority */
 }
 
 
+/*
+ * 'cupsdAddJobUsage()' - Record the resource usage of a job's filter or
+ *                        backend.
+ *
+ * Each process that exits adds one value to the job-process-names,
+ * job-process-cpu-times (milliseconds), and job-process-max-rss (kilobytes)
+ * attributes.
+ */
+
+void
+cupsdAddJobUsage(cupsd_job_t *job,	/* I - Job */
+                 const char  *name,	/* I - Process name */
+		 int         cpu_time,	/* I - User + system CPU time in ms */
+		 int         max_rss)	/* I - Maximum resident set size in kB */
+{
+  const char		*program;	/* Program name */
+  ipp_attribute_t	*attr;		/* Usage attribute */
+
+
+  job->filter_cpu += cpu_time;
+
+  if (!job->attrs)
+    return;
+
+  if ((program = strrchr(name, '/')) != NULL)
+    program ++;
+  else
+    program = name;
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG,
+              "%s used %d.%03d seconds of CPU time and %dk of memory.",
+	      program, cpu_time / 1000, cpu_time % 1000, max_rss);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-process-names",
+                               IPP_TAG_NAME)) != NULL)
+    ippSetString(job->attrs, &attr, ippGetCount(attr), program);
+  else
+    ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME, "job-process-names",
+                 NULL, program);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-process-cpu-times",
+                               IPP_TAG_INTEGER)) != NULL)
+    ippSetInteger(job->attrs, &attr, ippGetCount(attr), cpu_time);
+  else
+    ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER,
+                  "job-process-cpu-times", cpu_time);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-process-max-rss",
+                               IPP_TAG_INTEGER)) != NULL)
+    ippSetInteger(job->attrs, &attr, ippGetCount(attr), max_rss);
+  else
+    ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER,
+                  "job-process-max-rss", max_rss);
+
+  job->dirty = 1;
+  cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+}
+
+
 /*
  * 'cupsdCancelJobs()' - Cancel all jobs for the given destination/user.
  */
@@ -237,6 +367,12 @@ cupsdCheckJobs(void)
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), Sleeping, ACPower, NeedReload, (long)curtime);
 
+ /*
+  * Continue jobs that are waiting on the FilterLimit...
+  */
+
+  admit_jobs();
+
   for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
        job;
        job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
@@ -316,14 +452,6 @@ cupsdCheckJobs(void)
                        "Job submission timed out.");
     }
 
-   /*
-    * Continue jobs that are waiting on the FilterLimit...
-    */
-
-    if (job->pending_cost > 0 &&
-	((FilterLevel + job->pending_cost) < FilterLimit || FilterLevel == 0))
-      cupsdContinueJob(job);
-
    /*
     * Start pending jobs if the destination is available...
     */
@@ -470,11 +598,22 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 {
   int			i;		/* Looping var */
   int			slot;		/* Pipe slot */
+  int			limit;		/* Filter limit */
   cups_array_t		*filters = NULL,/* Filters for job */
 			*prefilters;	/* Filters with prefilters */
   mime_filter_t		*filter,	/* Current filter */
 			*prefilter,	/* Prefilter */
-			port_monitor;	/* Port monitor filter */
+			*next,		/* Next filter */
+			port_monitor,	/* Port monitor filter */
+			hosted[MAX_FILTERS / 2],
+					/* Filter host chains */
+			merge,		/* Raster merge stage */
+			*prefix[MAX_FILTERS];
+					/* Filters run in parallel chains */
+  int			num_hosted = 0,	/* Number of filter host chains */
+			num_prefix = 0,	/* Number of filters in each chain */
+			num_chains = 0,	/* Number of parallel chains */
+			num_procs = 0;	/* Number of filter processes */
   char			scheme[255];	/* Device URI scheme */
   ipp_attribute_t	*attr;		/* Current attribute */
   const char		*ptr,		/* Pointer into value */
@@ -498,7 +637,7 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 					/* Job title string */
 			copies[255],	/* # copies string */
 			*options,	/* Options string */
-			*envp[MAX_ENV + 21],
+			*envp[MAX_ENV + 22],
 					/* Environment variables */
 			charset[255],	/* CHARSET env variable */
 			class_name[255],/* CLASS env variable */
@@ -524,6 +663,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 					/* PRINTER_LOCATION env variable */
 			printer_name[255],
 					/* PRINTER env variable */
+			filter_chain[MIME_MAX_FILTER + 18],
+					/* CUPS_FILTER_CHAIN env variable */
 			*printer_state_reasons = NULL,
 					/* PRINTER_STATE_REASONS env var */
 			rip_max_cache[255];
@@ -539,9 +680,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   * the source to the destination type...
   */
 
-  FilterLevel -= job->cost;
+  release_filters(job);
 
-  job->cost         = 0;
   job->pending_cost = 0;
 
   memset(job->filters, 0, sizeof(job->filters));
@@ -693,18 +833,23 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
  /*
   * Set a minimum cost of 100 for all jobs so that FilterLimit
-  * works with raw queues and other low-cost paths.
+  * works with raw queues and other low-cost paths.  When the limit is sized
+  * automatically, every job costs the same...
   */
 
-  if (job->cost < 100)
+  if (job->cost < 100 || FilterLimit < 0)
     job->cost = 100;
 
  /*
-  * See if the filter cost is too high...
+  * See if the filter cost is too high or if other jobs are already waiting
+  * their turn...
   */
 
-  if ((FilterLevel + job->cost) > FilterLimit && FilterLevel > 0 &&
-      FilterLimit > 0)
+  limit = get_filter_limit();
+
+  if (limit > 0 && FilterLevel > 0 &&
+      ((FilterLevel + job->cost) > limit ||
+       (!job->pending_time && filter_waiting > 0)))
   {
    /*
     * Don't print this job quite yet...
@@ -715,16 +860,30 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
     cupsdLogJob(job, CUPSD_LOG_INFO,
 		"Holding because filter limit has been reached.");
     cupsdLogJob(job, CUPSD_LOG_DEBUG2,
-		"cupsdContinueJob: file=%d, cost=%d, level=%d, limit=%d",
-		job->current_file, job->cost, FilterLevel,
-		FilterLimit);
+		"cupsdContinueJob: file=%d, cost=%d, level=%d, limit=%d, "
+		"waiting=%d", job->current_file, job->cost, FilterLevel,
+		limit, filter_waiting);
+
+    if (!job->pending_time)
+    {
+      job->pending_time = time(NULL);
+      filter_waiting ++;
+    }
 
     job->pending_cost = job->cost;
     job->cost         = 0;
     return;
   }
 
-  FilterLevel += job->cost;
+  if (job->pending_time)
+  {
+    job->pending_time = 0;
+    filter_waiting --;
+  }
+
+  FilterLevel      += job->cost;
+  job->filter_time = time(NULL);
+  job->filter_cpu  = 0;
 
  /*
   * Add decompression/raw filter as needed...
@@ -802,6 +961,22 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
     goto abort_job;
   }
 
+ /*
+  * Split the rasterization of large documents into parallel filter chains
+  * as needed...
+  */
+
+  if (FilterParallel > 1 && filters)
+    num_chains = split_filters(job, filters, prefix, &num_prefix, &merge);
+
+ /*
+  * Run consecutive built-in filters as threads in a filter host process as
+  * needed...
+  */
+
+  if (FilterHost && cupsArrayCount(filters) > 1)
+    filters = host_filters(filters, hosted, &num_hosted);
+
  /*
   * Determine if we are printing a banner page or not...
   */
@@ -902,6 +1077,44 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
     argv[6] = strdup(filename);
   }
 
+ /*
+  * Feed a file that is still being received to the first filter through a
+  * pipe as it arrives...
+  */
+
+  if (job->streaming == (job->current_file + 1) && !job->printer->remote)
+  {
+    if ((job->stream_file = open(filename, O_RDONLY)) < 0 ||
+        cupsdOpenPipe(filterfds[1]))
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to stream print file - %s",
+                  strerror(errno));
+
+      abort_message = "Stopping job because the scheduler could not stream "
+                      "the print file.";
+
+      goto abort_job;
+    }
+
+    fcntl(job->stream_file, F_SETFD,
+          fcntl(job->stream_file, F_GETFD) | FD_CLOEXEC);
+
+    job->stream_pipe = filterfds[1][1];
+    filterfds[1][1]  = -1;
+
+    fcntl(job->stream_pipe, F_SETFL,
+          fcntl(job->stream_pipe, F_GETFL) | O_NONBLOCK);
+
+    cupsdAddSelect(job->stream_pipe, NULL, (cupsd_selfunc_t)update_stream,
+                   job);
+
+    free(argv[6]);
+    argv[6] = NULL;
+
+    cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                "Streaming print file to filters as it is received.");
+  }
+
   for (i = 0; argv[i]; i ++)
     cupsdLogJob(job, CUPSD_LOG_DEBUG, "argv[%d]=\"%s\"", i, argv[i]);
 
@@ -1107,7 +1320,20 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
        filter;
        i ++, filter = (mime_filter_t *)cupsArrayNext(filters))
   {
-    if (filter->filter[0] != '/')
+    if (filter >= hosted && filter < (hosted + num_hosted))
+    {
+      snprintf(command, sizeof(command), "%s/daemon/cups-filterhost",
+               ServerBin);
+      snprintf(filter_chain, sizeof(filter_chain), "CUPS_FILTER_CHAIN=%s",
+               filter->filter);
+
+      envp[envc]     = filter_chain;
+      envp[envc + 1] = NULL;
+    }
+    else if (filter == &merge)
+      snprintf(command, sizeof(command), "%s/daemon/cups-rastermerge",
+               ServerBin);
+    else if (filter->filter[0] != '/')
       snprintf(command, sizeof(command), "%s/filter/%s", ServerBin,
                filter->filter);
     else
@@ -1115,7 +1341,23 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
     if (i < (cupsArrayCount(filters) - 1))
     {
-      if (cupsdOpenPipe(filterfds[slot]))
+     /*
+      * Connect filters that both use libcups for I/O with a shared memory
+      * ring when enabled, otherwise with a pipe...
+      */
+
+      cupsArraySave(filters);
+      next = (mime_filter_t *)cupsArrayNext(filters);
+      cupsArrayRestore(filters);
+
+      if (FilterRingSize > 0 &&
+          (filter_flags(filter, hosted, num_hosted) & CUPSD_FILTER_RING_OUT) &&
+          (filter_flags(next, hosted, num_hosted) & CUPSD_FILTER_RING_IN) &&
+          !_cupsRingCreate((size_t)FilterRingSize, filterfds[slot]))
+        cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                    "Using %d byte ring between filters %s and %s.",
+                    FilterRingSize, filter->filter, next->filter);
+      else if (cupsdOpenPipe(filterfds[slot]))
       {
         abort_message = "Stopping job because the scheduler could not create "
 	                "the filter pipes.";
@@ -1177,10 +1419,16 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
       filterfds[slot][1] = job->print_pipes[1];
     }
 
-    pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
-                            filterfds[slot][1], job->status_pipes[1],
-		            job->back_pipes[0], job->side_pipes[0], 0,
-			    job->profile, job, job->filters + i);
+    if (filter == &merge)
+      pid = start_chains(job, prefix, num_prefix, num_chains, &merge, command,
+                         argv, envp, filterfds[slot][1], &num_procs);
+    else
+      pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
+			      filterfds[slot][1], job->status_pipes[1],
+			      job->back_pipes[0], job->side_pipes[0], 0,
+			      job->profile, job, job->filters + num_procs ++);
+
+    envp[envc] = NULL;
 
     cupsdClosePipe(filterfds[!slot]);
 
@@ -1195,8 +1443,12 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
       goto abort_job;
     }
 
-    cupsdLogJob(job, CUPSD_LOG_INFO, "Started filter %s (PID %d)", command,
-                pid);
+    if (filter >= hosted && filter < (hosted + num_hosted))
+      cupsdLogJob(job, CUPSD_LOG_INFO, "Started filter %s for \"%s\" (PID %d)",
+                  command, filter->filter, pid);
+    else
+      cupsdLogJob(job, CUPSD_LOG_INFO, "Started filter %s (PID %d)", command,
+                  pid);
 
     if (argv[6])
     {
@@ -1313,8 +1565,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
   abort_job:
 
-  FilterLevel -= job->cost;
-  job->cost = 0;
+  release_filters(job);
+  close_stream(job);
 
   for (slot = 0; slot < 2; slot ++)
     cupsdClosePipe(filterfds[slot]);
@@ -2726,6 +2978,8 @@ cupsdStopAllJobs(
       cupsdSetJobState(job, IPP_JOB_PENDING, action, NULL);
     }
   }
+
+  stop_persistent_backends();
 }
 
 
@@ -2756,6 +3010,62 @@ cupsdUnloadCompletedJobs(void)
 }
 
 
+/*
+ * 'cupsdUpdateJobStream()' - Note new data for a file being received.
+ *
+ * The scheduler calls this function whenever more of a stream-through job's
+ * file has been written to the spool directory, and with "done" set once the
+ * whole file has been received.
+ */
+
+void
+cupsdUpdateJobStream(cupsd_job_t *job,	/* I - Job */
+                     int         done)	/* I - 1 if file is complete */
+{
+  char			filename[1024];	/* Job filename */
+  struct stat		fileinfo;	/* File information */
+  int			kbytes;		/* Size of file */
+  ipp_attribute_t	*attr;		/* job-k-octets attribute */
+
+
+  if (done && job->streaming)
+  {
+   /*
+    * Update the job size and quota now that we know it...
+    */
+
+    snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
+             job->id, job->streaming);
+
+    if (!stat(filename, &fileinfo))
+    {
+      kbytes = (int)((fileinfo.st_size + 1023) / 1024);
+
+      cupsdUpdateQuota(cupsdFindDest(job->dest), job->username, 0, kbytes);
+
+      job->koctets += kbytes;
+
+      if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
+                                   IPP_TAG_INTEGER)) != NULL)
+	attr->values[0].integer += kbytes;
+
+      job->dirty = 1;
+      cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+    }
+
+    job->streaming = 0;
+  }
+
+ /*
+  * Resume feeding the first filter...
+  */
+
+  if (job->stream_pipe >= 0)
+    cupsdAddSelect(job->stream_pipe, NULL, (cupsd_selfunc_t)update_stream,
+                   job);
+}
+
+
 /*
  * 'cupsdUpdateJobs()' - Update the history/file files for all jobs.
  */
@@ -2812,6 +3122,111 @@ cupsdUpdateJobs(void)
 }
 
 
+/*
+ * 'admit_jobs()' - Continue jobs that are waiting on the FilterLimit.
+ *
+ * Jobs with the fewest (estimated) pages go first, but every second a job
+ * waits counts against its page count so that large jobs are not starved by
+ * a steady stream of small ones.
+ */
+
+static void
+admit_jobs(void)
+{
+  cupsd_job_t	*job,			/* Current job */
+		*best;			/* Job to admit next */
+  int		score,			/* Score of current job */
+		best_score,		/* Score of best job */
+		limit,			/* Current filter limit */
+		admitted = 0;		/* Number of jobs admitted */
+  time_t	curtime = time(NULL);	/* Current time */
+
+
+  if (filter_waiting <= 0)
+    return;
+
+  limit = get_filter_limit();
+
+  for (;;)
+  {
+   /*
+    * Find the waiting job with the lowest score...
+    */
+
+    for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), best = NULL,
+             best_score = 0;
+         job;
+	 job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+    {
+      if (job->pending_cost <= 0)
+        continue;
+
+      score = get_job_score(job, curtime);
+
+      if (!best || score < best_score)
+      {
+        best       = job;
+	best_score = score;
+      }
+    }
+
+    if (!best)
+    {
+     /*
+      * No jobs are waiting after all...
+      */
+
+      filter_waiting = 0;
+      break;
+    }
+
+    if (limit > 0 && FilterLevel > 0 &&
+        (FilterLevel + best->pending_cost) > limit)
+      break;
+
+    cupsdLogJob(best, CUPSD_LOG_DEBUG,
+                "Continuing after waiting %d seconds (score %d).",
+		(int)(curtime - best->pending_time), best_score);
+
+    cupsdContinueJob(best);
+
+    if (best->pending_cost > 0)
+      break;
+
+    admitted ++;
+  }
+
+  if (admitted)
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Filter queue: %d admitted, %d waiting, level %d of %d, "
+		    "average job load %.2f CPUs.", admitted, filter_waiting,
+		    FilterLevel, limit, filter_load);
+}
+
+
+/*
+ * 'close_stream()' - Stop feeding a file to the first filter.
+ */
+
+static void
+close_stream(cupsd_job_t *job)		/* I - Job */
+{
+  if (job->stream_pipe >= 0)
+  {
+    cupsdRemoveSelect(job->stream_pipe);
+
+    close(job->stream_pipe);
+    job->stream_pipe = -1;
+  }
+
+  if (job->stream_file >= 0)
+  {
+    close(job->stream_file);
+    job->stream_file = -1;
+  }
+}
+
+
 /*
  * 'compare_active_jobs()' - Compare the job IDs and priorities of two jobs.
  */
@@ -3005,6 +3420,40 @@ free_job_history(cupsd_job_t *job)	/* I - Job */
 }
 
 
+/*
+ * 'filter_flags()' - Get the CUPSD_FILTER_ flags for a filter.
+ */
+
+static int				/* O - Filter flags */
+filter_flags(mime_filter_t *filter,	/* I - Filter */
+             mime_filter_t *hosted,	/* I - Filter host chains */
+	     int           num_hosted)	/* I - Number of filter host chains */
+{
+  int	i;				/* Looping var */
+
+
+ /*
+  * cups-filterhost uses cupsFileStdin and cupsFileStdout...
+  */
+
+  if (filter >= hosted && filter < (hosted + num_hosted))
+    return (CUPSD_FILTER_RING_IN | CUPSD_FILTER_RING_OUT);
+
+ /*
+  * Only the filters we install know about rings...
+  */
+
+  if (filter->filter[0] == '/')
+    return (0);
+
+  for (i = 0; i < (int)(sizeof(filter_info) / sizeof(filter_info[0])); i ++)
+    if (!strcmp(filter->filter, filter_info[i].name))
+      return (filter_info[i].flags);
+
+  return (0);
+}
+
+
 /*
  * 'finalize_job()' - Cleanup after job filter processes and support data.
  */
@@ -3047,13 +3496,30 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
     cupsdSetPrinterReasons(job->printer, "-offline-report");
 
  /*
-  * Free the security profile...
+  * Stop feeding any file that is still being received...
+  */
+
+  close_stream(job);
+
+ /*
+  * Free the security profiles and control group...
   */
 
   cupsdDestroyProfile(job->profile);
   job->profile = NULL;
   cupsdDestroyProfile(job->bprofile);
   job->bprofile = NULL;
+  cupsdDestroyCgroup(job->cgroup);
+  job->cgroup = NULL;
+
+ /*
+  * Log the resource usage of the filters and backend if the page log format
+  * asks for it...
+  */
+
+  if (PageLogFormat && strstr(PageLogFormat, "%{job-process-") &&
+      ippFindAttribute(job->attrs, "job-process-names", IPP_TAG_NAME))
+    cupsdLogPage(job, "usage");
 
  /*
   * Clear the unresponsive job watchdog timers...
@@ -3501,6 +3967,81 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
 }
 
 
+/*
+ * 'get_filter_limit()' - Get the current filter limit.
+ *
+ * "FilterLimit auto" allows one job per CPU, scaled by the number of CPUs
+ * the filters and backend of recent jobs have actually used.
+ */
+
+static int				/* O - Filter limit or 0 for none */
+get_filter_limit(void)
+{
+  long		cpus;			/* Number of online CPUs */
+  double	load;			/* Average CPUs used by a job */
+  int		slots;			/* Number of concurrent jobs */
+
+
+  if (FilterLimit >= 0)
+    return (FilterLimit);
+
+  if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    cpus = 1;
+
+  if ((load = filter_load) < 0.25)
+    load = 0.25;
+
+  slots = (int)(cpus / load + 0.5);
+
+  if (slots < 1)
+    slots = 1;
+  else if (slots > 4 * cpus)
+    slots = 4 * (int)cpus;
+
+  return (100 * slots);
+}
+
+
+/*
+ * 'get_job_score()' - Get the admission score of a waiting job.
+ */
+
+static int				/* O - Score, lower is better */
+get_job_score(cupsd_job_t *job,		/* I - Job */
+              time_t      curtime)	/* I - Current time */
+{
+  int			pages;		/* Estimated number of pages */
+  ipp_attribute_t	*attr;		/* Job attribute */
+
+
+ /*
+  * Use the job-impressions value from the client or estimate the number of
+  * pages from the size of the job...
+  */
+
+  if (job->attrs &&
+      (attr = ippFindAttribute(job->attrs, "job-impressions",
+                               IPP_TAG_INTEGER)) != NULL)
+    pages = ippGetInteger(attr, 0);
+  else
+    pages = 1 + job->koctets / CUPSD_FILTER_KPAGE;
+
+  if (job->attrs &&
+      (attr = ippFindAttribute(job->attrs, "copies", IPP_TAG_INTEGER)) != NULL)
+    pages *= ippGetInteger(attr, 0);
+
+ /*
+  * Higher priority jobs look smaller, and waiting jobs get credit for the time
+  * they have already waited...
+  */
+
+  if (job->priority > 0)
+    pages = pages * 50 / job->priority;
+
+  return (pages - (int)(curtime - job->pending_time) * CUPSD_FILTER_AGING);
+}
+
+
 /*
  * 'get_options()' - Get a string containing the job options.
  */
@@ -3892,16 +4433,91 @@ get_options(cupsd_job_t *job,		/* I - Job */
 
 
 /*
- * 'ipp_length()' - Compute the size of the buffer needed to hold
- *		    the textual IPP attributes.
+ * 'host_filters()' - Replace runs of built-in filters with filter host chains.
  */
 
-static size_t				/* O - Size of attribute buffer */
-ipp_length(ipp_t *ipp)			/* I - IPP request */
+static cups_array_t *			/* O - New filter list */
+host_filters(cups_array_t  *filters,	/* I - Filters for job */
+             mime_filter_t *hosted,	/* I - Filter host chains */
+	     int           *num_hosted)	/* O - Number of filter host chains */
 {
-  size_t		bytes; 		/* Number of bytes */
-  int			i;		/* Looping var */
-  ipp_attribute_t	*attr;		/* Current attribute */
+  int			i, j, k,	/* Looping vars */
+			count;		/* Number of filters */
+  mime_filter_t		*filter,	/* Current filter */
+			*host;		/* Current filter host chain */
+  cups_array_t		*temp;		/* New filter list */
+
+
+  if ((temp = cupsArrayNew(NULL, NULL)) == NULL)
+    return (filters);
+
+  for (i = 0, count = cupsArrayCount(filters); i < count; i = j)
+  {
+   /*
+    * Find the run of built-in filters starting at this one...
+    */
+
+    for (j = i; j < count; j ++)
+    {
+      filter = (mime_filter_t *)cupsArrayIndex(filters, j);
+
+      if (!(filter_flags(filter, NULL, 0) & CUPSD_FILTER_HOSTED))
+        break;
+    }
+
+    if (j - i < 2)
+    {
+     /*
+      * Run a single filter normally...
+      */
+
+      if (j == i)
+        j ++;
+
+      cupsArrayAdd(temp, cupsArrayIndex(filters, i));
+      continue;
+    }
+
+   /*
+    * Run two or more built-in filters in one filter host...
+    */
+
+    host = hosted + *num_hosted;
+    (*num_hosted) ++;
+
+    memset(host, 0, sizeof(mime_filter_t));
+
+    for (k = i; k < j; k ++)
+    {
+      filter = (mime_filter_t *)cupsArrayIndex(filters, k);
+
+      if (k > i)
+        strlcat(host->filter, " ", sizeof(host->filter));
+      strlcat(host->filter, filter->filter, sizeof(host->filter));
+
+      host->cost += filter->cost;
+    }
+
+    cupsArrayAdd(temp, host);
+  }
+
+  cupsArrayDelete(filters);
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_length()' - Compute the size of the buffer needed to hold
+ *		    the textual IPP attributes.
+ */
+
+static size_t				/* O - Size of attribute buffer */
+ipp_length(ipp_t *ipp)			/* I - IPP request */
+{
+  size_t		bytes; 		/* Number of bytes */
+  int			i;		/* Looping var */
+  ipp_attribute_t	*attr;		/* Current attribute */
 
 
  /*
@@ -4108,6 +4724,8 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
       job->side_pipes[1]   = -1;
       job->status_pipes[0] = -1;
       job->status_pipes[1] = -1;
+      job->stream_file     = -1;
+      job->stream_pipe     = -1;
 
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from cache...");
     }
@@ -4396,6 +5014,8 @@ load_request_root(void)
       job->side_pipes[1]   = -1;
       job->status_pipes[0] = -1;
       job->status_pipes[1] = -1;
+      job->stream_file     = -1;
+      job->stream_pipe     = -1;
 
       if (job->id >= NextJobId)
         NextJobId = job->id + 1;
@@ -4425,6 +5045,36 @@ load_request_root(void)
 }
 
 
+/*
+ * 'release_filters()' - Release the filter cost of a job.
+ */
+
+static void
+release_filters(cupsd_job_t *job)	/* I - Job */
+{
+  int	elapsed;			/* Seconds the filters ran */
+
+
+  if (job->cost > 0 && job->filter_time)
+  {
+   /*
+    * Update the average number of CPUs used by a job's processes, which
+    * sizes "FilterLimit auto"...
+    */
+
+    if ((elapsed = (int)(time(NULL) - job->filter_time)) < 1)
+      elapsed = 1;
+
+    filter_load = 0.8 * filter_load +
+                  0.2 * job->filter_cpu / (1000.0 * elapsed);
+  }
+
+  FilterLevel      -= job->cost;
+  job->cost        = 0;
+  job->filter_time = 0;
+}
+
+
 /*
  * 'remove_job_files()' - Remove the document files for a job.
  */
@@ -4528,6 +5178,409 @@ set_time(cupsd_job_t *job,		/* I - Job to update */
 }
 
 
+/*
+ * 'split_filters()' - Split the rasterizing filters into parallel chains.
+ *
+ * Documents whose first filter understands page-ranges are split into
+ * blocks of pages that are rasterized by "FilterParallel" copies of the
+ * filters up to the last one producing raster data.  Those filters are moved
+ * from the filter list into the prefix array and replaced by the merge stage,
+ * which copies the blocks back into a single raster stream in order.
+ * Documents smaller than CUPSD_PARALLEL_SIZE bytes or one block of pages per
+ * chain, and documents printed in reverse order, are not split.
+ */
+
+static int				/* O - Number of chains or 0 for none */
+split_filters(cupsd_job_t   *job,	/* I - Job */
+              cups_array_t  *filters,	/* I - Filters for job */
+	      mime_filter_t **prefix,	/* O - Filters in each chain */
+	      int           *num_prefix,/* O - Number of filters in each chain */
+	      mime_filter_t *merge)	/* O - Merge stage */
+{
+  int			i,		/* Looping var */
+			count,		/* Number of filters */
+			chains;		/* Number of chains */
+  long			cpus;		/* Number of online CPUs */
+  mime_type_t		*src;		/* Source document type */
+  mime_filter_t		*filter;	/* Current filter */
+  ipp_attribute_t	*attr;		/* Job or printer attribute */
+  const char		*value;		/* Attribute value */
+  char			filename[1024];	/* Document or PPD filename */
+  struct stat		fileinfo;	/* Document file information */
+  ppd_file_t		*ppd;		/* PPD file */
+  ppd_choice_t		*choice;	/* Default output bin */
+  ppd_attr_t		*ppd_attr;	/* PageStackOrder/DefaultOutputOrder */
+  int			reverse;	/* Reverse output order? */
+  int			max_chains;	/* Chains the document can fill */
+
+
+ /*
+  * cups-launcher can only pass the standard file descriptors, remote queues
+  * do no filtering, and files that are still being received can only be read
+  * once...
+  */
+
+  if (FilterLauncher || job->printer->remote || job->streaming)
+    return (0);
+
+ /*
+  * Only PDF and PostScript filters support page-ranges...
+  */
+
+  src = job->filetypes[job->current_file];
+
+  if (strcmp(src->super, "application") ||
+      (strcmp(src->type, "pdf") && strcmp(src->type, "postscript")))
+    return (0);
+
+ /*
+  * Options that change the number or order of pages can't be split...
+  */
+
+  if (ippFindAttribute(job->attrs, "page-ranges", IPP_TAG_ZERO) ||
+      ippFindAttribute(job->attrs, "page-set", IPP_TAG_ZERO) ||
+      ippFindAttribute(job->attrs, "output-bin", IPP_TAG_ZERO))
+    return (0);
+
+  if ((attr = ippFindAttribute(job->attrs, "copies",
+                               IPP_TAG_INTEGER)) != NULL &&
+      ippGetInteger(attr, 0) > 1)
+    return (0);
+
+  if ((attr = ippFindAttribute(job->attrs, "number-up",
+                               IPP_TAG_INTEGER)) != NULL &&
+      ippGetInteger(attr, 0) > 1)
+    return (0);
+
+  if (job->job_sheets)
+  {
+    for (i = 0; i < ippGetCount(job->job_sheets); i ++)
+      if (strcmp(ippGetString(job->job_sheets, i, NULL), "none"))
+        return (0);
+  }
+
+ /*
+  * Small documents finish faster in a single chain than it takes to start
+  * several...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot, job->id,
+           job->current_file + 1);
+  if (stat(filename, &fileinfo))
+    return (0);
+
+  max_chains = (int)(fileinfo.st_size / CUPSD_PARALLEL_SIZE);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-impressions",
+                               IPP_TAG_INTEGER)) != NULL &&
+      ippGetInteger(attr, 0) > 0)
+  {
+   /*
+    * Each chain needs at least one block of pages to do any work...
+    */
+
+    i = (ippGetInteger(attr, 0) + CUPSD_PARALLEL_PAGES - 1) /
+        CUPSD_PARALLEL_PAGES;
+
+    if (i < max_chains)
+      max_chains = i;
+  }
+
+  if (max_chains < 2)
+    return (0);
+
+ /*
+  * Reversed output is collected by the last filter, which needs every page
+  * in order.  Use the same defaults as pstops: the OutputOrder option, then
+  * the PageStackOrder of the default output bin, then DefaultOutputOrder...
+  */
+
+  reverse = 0;
+
+  if ((attr = ippFindAttribute(job->attrs, "OutputOrder",
+                               IPP_TAG_ZERO)) != NULL)
+  {
+    if ((value = ippGetString(attr, 0, NULL)) != NULL &&
+        !_cups_strcasecmp(value, "Reverse"))
+      reverse = 1;
+  }
+  else
+  {
+    snprintf(filename, sizeof(filename), "%s/ppd/%s.ppd", ServerRoot,
+             job->printer->name);
+
+    if ((ppd = _ppdOpenFile(filename, _PPD_LOCALIZATION_NONE)) != NULL)
+    {
+      if ((choice = ppdFindMarkedChoice(ppd, "OutputOrder")) != NULL)
+        reverse = !_cups_strcasecmp(choice->choice, "Reverse");
+      else if ((choice = ppdFindMarkedChoice(ppd, "OutputBin")) != NULL &&
+	       (ppd_attr = ppdFindAttr(ppd, "PageStackOrder",
+				       choice->choice)) != NULL &&
+	       ppd_attr->value)
+	reverse = !_cups_strcasecmp(ppd_attr->value, "Reverse");
+      else if ((ppd_attr = ppdFindAttr(ppd, "DefaultOutputOrder",
+                                       NULL)) != NULL && ppd_attr->value)
+	reverse = !_cups_strcasecmp(ppd_attr->value, "Reverse");
+
+      ppdClose(ppd);
+    }
+  }
+
+  if (reverse)
+    return (0);
+
+ /*
+  * Find the last filter that produces raster data...
+  */
+
+  count = cupsArrayCount(filters);
+
+  for (i = count - 1; i >= 0; i --)
+  {
+    filter = (mime_filter_t *)cupsArrayIndex(filters, i);
+
+    if (filter->dst &&
+        ((!strcmp(filter->dst->super, "application") &&
+	  !strcmp(filter->dst->type, "vnd.cups-raster")) ||
+	 (!strcmp(filter->dst->super, "image") &&
+	  !strcmp(filter->dst->type, "pwg-raster"))))
+      break;
+  }
+
+  if (i < 0)
+    return (0);
+
+  *num_prefix = i + 1;
+
+ /*
+  * Use as many chains as we can without going over MAX_FILTERS or the number
+  * of CPUs, since more chains than that just compete with each other...
+  */
+
+  chains = (MAX_FILTERS - 1 - (count - *num_prefix)) / *num_prefix;
+
+  if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    cpus = 1;
+
+  if (chains > FilterParallel)
+    chains = FilterParallel;
+  if (chains > cpus)
+    chains = (int)cpus;
+  if (chains > CUPSD_PARALLEL_CHAINS)
+    chains = CUPSD_PARALLEL_CHAINS;
+  if (chains > max_chains)
+    chains = max_chains;
+
+  if (chains < 2)
+    return (0);
+
+ /*
+  * Move the prefix filters out of the list and add the merge stage...
+  */
+
+  for (i = 0; i < *num_prefix; i ++)
+  {
+    prefix[i] = (mime_filter_t *)cupsArrayIndex(filters, 0);
+    cupsArrayRemove(filters, prefix[i]);
+  }
+
+  memset(merge, 0, sizeof(mime_filter_t));
+  merge->src  = src;
+  merge->dst  = prefix[*num_prefix - 1]->dst;
+  merge->cost = prefix[*num_prefix - 1]->cost;
+  strlcpy(merge->filter, "cups-rastermerge", sizeof(merge->filter));
+
+  if (!cupsArrayInsert(filters, merge))
+  {
+    for (i = *num_prefix - 1; i >= 0; i --)
+      cupsArrayInsert(filters, prefix[i]);
+
+    return (0);
+  }
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG,
+              "Rasterizing in %d parallel chains of %d filters.", chains,
+	      *num_prefix);
+
+  return (chains);
+}
+
+
+/*
+ * 'start_chains()' - Start parallel filter chains and the merge stage.
+ */
+
+static int				/* O - Process ID of merge stage or 0 */
+start_chains(cupsd_job_t   *job,	/* I - Job */
+             mime_filter_t **prefix,	/* I - Filters in each chain */
+	     int           num_prefix,	/* I - Number of filters in each chain */
+	     int           num_chains,	/* I - Number of chains */
+	     mime_filter_t *merge,	/* I - Merge stage */
+	     const char    *command,	/* I - Merge command */
+	     char          *argv[],	/* I - Filter arguments */
+	     char          *envp[],	/* I - Environment variables */
+	     int           outfd,	/* I - Output file descriptor */
+	     int           *num_procs)	/* IO - Number of processes */
+{
+  int		i,			/* Looping var */
+		chain,			/* Current chain */
+		block,			/* Current block */
+		pid = 0,		/* Process ID */
+		infd,			/* Input for current filter */
+		filterfds[2],		/* Pipe to next filter */
+		chainfds[CUPSD_PARALLEL_CHAINS][2];
+					/* Pipes from chains to merge stage */
+  char		*chain_argv[8],		/* Arguments for chain */
+		*merge_argv[CUPSD_PARALLEL_CHAINS + 5],
+					/* Arguments for merge stage */
+		*options,		/* Options for chain */
+		*optptr,		/* Pointer into options */
+		filter_command[1024],	/* Filter command */
+		pages[16],		/* Pages per block */
+		blocks[16],		/* Number of blocks */
+		fds[CUPSD_PARALLEL_CHAINS][16];
+					/* Chain file descriptors */
+  size_t	optsize;		/* Size of options */
+
+
+  for (chain = 0; chain < num_chains; chain ++)
+    chainfds[chain][0] = chainfds[chain][1] = -1;
+
+  memcpy(chain_argv, argv, 7 * sizeof(char *));
+  chain_argv[7] = NULL;
+
+  optsize = strlen(argv[5]) + 14 + 24 * CUPSD_PARALLEL_BLOCKS;
+  if ((options = malloc(optsize)) == NULL)
+    return (0);
+
+  chain_argv[5] = options;
+
+  for (chain = 0; chain < num_chains; chain ++)
+  {
+   /*
+    * Build the page-ranges for this chain; the last chain also gets all of the
+    * pages after the last block...
+    */
+
+    snprintf(options, optsize, "%s%spage-ranges=", argv[5],
+             argv[5][0] ? " " : "");
+    optptr = options + strlen(options);
+
+    for (block = chain; block < num_chains * CUPSD_PARALLEL_BLOCKS;
+         block += num_chains)
+    {
+      snprintf(optptr, optsize - (size_t)(optptr - options), "%s%d-%d",
+               block == chain ? "" : ",", block * CUPSD_PARALLEL_PAGES + 1,
+	       (block + 1) * CUPSD_PARALLEL_PAGES);
+      optptr += strlen(optptr);
+    }
+
+    if (chain == (num_chains - 1))
+      snprintf(optptr, optsize - (size_t)(optptr - options), ",%d-",
+               block * CUPSD_PARALLEL_PAGES + 1);
+
+   /*
+    * Start the filters in the chain...
+    */
+
+    for (i = 0, infd = -1; i < num_prefix; i ++)
+    {
+      if (cupsdOpenPipe(i < (num_prefix - 1) ? filterfds : chainfds[chain]))
+      {
+        if (infd >= 0)
+	  close(infd);
+
+	goto error;
+      }
+
+      if (i == (num_prefix - 1))
+      {
+        filterfds[0] = chainfds[chain][0];
+        filterfds[1] = chainfds[chain][1];
+      }
+
+      if (prefix[i]->filter[0] != '/')
+	snprintf(filter_command, sizeof(filter_command), "%s/filter/%s",
+	         ServerBin, prefix[i]->filter);
+      else
+	strlcpy(filter_command, prefix[i]->filter, sizeof(filter_command));
+
+      pid = cupsdStartProcess(filter_command, chain_argv, envp, infd,
+                              filterfds[1], job->status_pipes[1],
+			      job->back_pipes[0], job->side_pipes[0], 0,
+			      job->profile, job, job->filters + *num_procs);
+
+      if (infd >= 0)
+        close(infd);
+
+      close(filterfds[1]);
+      if (i == (num_prefix - 1))
+        chainfds[chain][1] = -1;
+
+      infd = filterfds[0];
+
+      if (!pid)
+      {
+	cupsdLogJob(job, CUPSD_LOG_ERROR,
+		    "Unable to start filter \"%s\" - %s.", prefix[i]->filter,
+		    strerror(errno));
+
+        if (i < (num_prefix - 1))
+	  close(infd);
+
+	goto error;
+      }
+
+      cupsdLogJob(job, CUPSD_LOG_INFO, "Started filter %s (PID %d) for chain %d",
+                  filter_command, pid, chain + 1);
+
+      (*num_procs) ++;
+    }
+  }
+
+ /*
+  * Start the merge stage, which inherits the read end of the chain pipes...
+  */
+
+  snprintf(pages, sizeof(pages), "%d", CUPSD_PARALLEL_PAGES);
+  snprintf(blocks, sizeof(blocks), "%d", num_chains * CUPSD_PARALLEL_BLOCKS);
+
+  merge_argv[0] = (char *)"cups-rastermerge";
+  merge_argv[1] = !strcmp(merge->dst->type, "pwg-raster") ? (char *)"pwg" :
+                                                            (char *)"cups";
+  merge_argv[2] = pages;
+  merge_argv[3] = blocks;
+
+  for (chain = 0; chain < num_chains; chain ++)
+  {
+    snprintf(fds[chain], sizeof(fds[chain]), "%d", chainfds[chain][0]);
+    merge_argv[chain + 4] = fds[chain];
+
+    fcntl(chainfds[chain][0], F_SETFD,
+          fcntl(chainfds[chain][0], F_GETFD) & ~FD_CLOEXEC);
+  }
+
+  merge_argv[chain + 4] = NULL;
+
+  pid = cupsdStartProcess(command, merge_argv, envp, -1, outfd,
+                          job->status_pipes[1], job->back_pipes[0],
+			  job->side_pipes[0], 0, job->profile, job,
+			  job->filters + *num_procs);
+
+  if (pid)
+    (*num_procs) ++;
+
+  error:
+
+  for (chain = 0; chain < num_chains; chain ++)
+    cupsdClosePipe(chainfds[chain]);
+
+  free(options);
+
+  return (pid);
+}
+
+
 /*
  * 'start_job()' - Start a print job.
  */
@@ -4591,6 +5644,20 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
   job->printer      = printer;
   printer->job      = job;
 
+ /*
+  * Forget the resource usage from any previous attempt...
+  */
+
+  ippDeleteAttribute(job->attrs,
+                     ippFindAttribute(job->attrs, "job-process-names",
+		                      IPP_TAG_NAME));
+  ippDeleteAttribute(job->attrs,
+                     ippFindAttribute(job->attrs, "job-process-cpu-times",
+		                      IPP_TAG_INTEGER));
+  ippDeleteAttribute(job->attrs,
+                     ippFindAttribute(job->attrs, "job-process-max-rss",
+		                      IPP_TAG_INTEGER));
+
   if (cancel_after)
     job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
   else if (MaxJobTime > 0)
@@ -4618,12 +5685,13 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
   }
 
  /*
-  * Setup the last exit status and security profiles...
+  * Setup the last exit status, security profiles, and control group...
   */
 
   job->status   = 0;
   job->profile  = cupsdCreateProfile(job->id, 0);
   job->bprofile = cupsdCreateProfile(job->id, 1);
+  job->cgroup   = cupsdCreateCgroup(job);
 
  /*
   * Create the status pipes and buffer...
@@ -4642,6 +5710,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
     job->profile = NULL;
     cupsdDestroyProfile(job->bprofile);
     job->bprofile = NULL;
+    cupsdDestroyCgroup(job->cgroup);
+    job->cgroup = NULL;
     return;
   }
 
@@ -4669,6 +5739,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
     job->profile = NULL;
     cupsdDestroyProfile(job->bprofile);
     job->bprofile = NULL;
+    cupsdDestroyCgroup(job->cgroup);
+    job->cgroup = NULL;
     return;
   }
 
@@ -4700,6 +5772,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
     job->profile = NULL;
     cupsdDestroyProfile(job->bprofile);
     job->bprofile = NULL;
+    cupsdDestroyCgroup(job->cgroup);
+    job->cgroup = NULL;
     return;
   }
 
@@ -4735,8 +5809,15 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "stop_job(job=%p(%d), action=%d)", job,
                   job->id, action);
 
-  FilterLevel -= job->cost;
-  job->cost   = 0;
+  release_filters(job);
+
+  if (job->pending_time)
+  {
+    job->pending_time = 0;
+    filter_waiting --;
+  }
+
+  job->pending_cost = 0;
 
   if (action == CUPSD_JOB_DEFAULT && !job->kill_time)
     job->kill_time = time(NULL) + JobKillDelay;
@@ -4771,6 +5852,94 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
 }
 
 
+/*
+ * 'stop_persistent_backends()' - Stop backend processes that keep printer
+ *                                connections between jobs.
+ *
+ * Each of these processes holds a lock on a "pid" file in the private
+ * "cups-backend-UID" directory under TempDir.  Removing its socket keeps new
+ * jobs away and tells it to exit after the current job, and SIGTERM stops it
+ * right away when it is idle.
+ */
+
+static void
+stop_persistent_backends(void)
+{
+  cups_dir_t	*dir,			/* Temporary directory */
+		*subdir;		/* Backend directory */
+  cups_dentry_t	*dent,			/* Directory entry */
+		*subdent;		/* Backend directory entry */
+  char		dirname[1024],		/* Backend directory name */
+		filename[1024],		/* PID or socket filename */
+		*ext;			/* Filename extension */
+  int		fd;			/* PID file */
+  struct stat	dirinfo,		/* Backend directory information */
+		fileinfo;		/* PID file information */
+  struct flock	lock;			/* Lock on PID file */
+
+
+  if ((dir = cupsDirOpen(TempDir)) == NULL)
+    return;
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+   /*
+    * Only look in private directories owned by the user named in them...
+    */
+
+    if (strncmp(dent->filename, "cups-backend-", 13))
+      continue;
+
+    if (snprintf(dirname, sizeof(dirname), "%s/%s", TempDir,
+                 dent->filename) >= (int)sizeof(dirname))
+      continue;
+
+    if (lstat(dirname, &dirinfo) || !S_ISDIR(dirinfo.st_mode) ||
+        (dirinfo.st_mode & 077) ||
+	(dirinfo.st_uid != User && dirinfo.st_uid != 0) ||
+        atoi(dent->filename + 13) != (int)dirinfo.st_uid ||
+	(subdir = cupsDirOpen(dirname)) == NULL)
+      continue;
+
+    while ((subdent = cupsDirRead(subdir)) != NULL)
+    {
+      if ((ext = strrchr(subdent->filename, '.')) == NULL || strcmp(ext, ".pid"))
+        continue;
+
+      if (snprintf(filename, sizeof(filename), "%s/%s", dirname,
+                   subdent->filename) >= (int)sizeof(filename) ||
+          (fd = open(filename, O_RDONLY | O_NOFOLLOW)) < 0)
+        continue;
+
+      memset(&lock, 0, sizeof(lock));
+      lock.l_type   = F_WRLCK;
+      lock.l_whence = SEEK_SET;
+
+      if (!fstat(fd, &fileinfo) && fileinfo.st_uid == dirinfo.st_uid &&
+          !fcntl(fd, F_GETLK, &lock) && lock.l_type != F_UNLCK &&
+	  lock.l_pid > 0)
+      {
+        if (snprintf(filename, sizeof(filename), "%s/%.*s.sock", dirname,
+	             (int)(ext - subdent->filename),
+		     subdent->filename) < (int)sizeof(filename))
+	  unlink(filename);
+
+	cupsdLogMessage(CUPSD_LOG_DEBUG,
+	                "Stopping persistent backend (PID %d).",
+			(int)lock.l_pid);
+	kill(lock.l_pid, SIGTERM);
+      }
+
+      close(fd);
+    }
+
+    cupsDirClose(subdir);
+  }
+
+  cupsDirClose(dir);
+}
+
+
 /*
  * 'unload_job()' - Unload a job from memory.
  */
@@ -4797,6 +5966,10 @@ unload_job(cupsd_job_t *job)		/* I - Job */
 
 /*
  * 'update_job()' - Read a status update from a job's filters.
+ *
+ * All of the complete lines from one read of the status pipe are handled as
+ * a batch: job and printer attributes are updated once with the last value
+ * of each, and at most one job event and one printer event are sent.
  */
 
 void
@@ -4809,6 +5982,14 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 		*ptr;			/* Pointer update... */
   int		loglevel,		/* Log level for message */
 		event = 0;		/* Events? */
+  int		num_attrs = 0;		/* Number of ATTR: attributes */
+  cups_option_t	*attrs = NULL;		/* ATTR: attributes */
+  const char	*attr;			/* Attribute */
+  int		pages = 0,		/* Pages printed? */
+		progress = 0,		/* Media progress updated? */
+		do_state = 0,		/* Update job-printer-state-reasons? */
+		do_message = 0,		/* Update job-printer-state-message? */
+		paused = 0;		/* Pause printer? */
   static const char * const levels[] =	/* Log levels */
 		{
 		  "NONE",
@@ -4868,9 +6049,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 
       cupsdLogPage(job, message);
 
-      if (job->sheets)
-	cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
-		      "Printed %d page(s).", job->sheets->values[0].integer);
+      pages = 1;
     }
     else if (loglevel == CUPSD_LOG_JOBSTATE)
     {
@@ -4892,8 +6071,13 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 
       if (!strcmp(message, "paused"))
       {
-        cupsdStopPrinter(job->printer, 1);
-	return;
+       /*
+        * Finish this batch first, leaving any later messages in the buffer
+	* for when the printer resumes...
+	*/
+
+        paused = 1;
+	break;
       }
       else if (message[0] && cupsdSetPrinterReasons(job->printer, message))
       {
@@ -4924,129 +6108,17 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         }
       }
 
-      update_job_attrs(job, 0);
+      do_state = 1;
     }
     else if (loglevel == CUPSD_LOG_ATTR)
     {
      /*
-      * Set attribute(s)...
+      * Collect attribute(s), keeping the last value of each...
       */
 
-      int		num_attrs;	/* Number of attributes */
-      cups_option_t	*attrs;		/* Attributes */
-      const char	*attr;		/* Attribute */
-
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "ATTR: %s", message);
 
-      num_attrs = cupsParseOptions(message, 0, &attrs);
-
-      if ((attr = cupsGetOption("auth-info-default", num_attrs,
-                                attrs)) != NULL)
-      {
-        job->printer->num_options = cupsAddOption("auth-info", attr,
-						  job->printer->num_options,
-						  &(job->printer->options));
-	cupsdSetPrinterAttrs(job->printer);
-
-	cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("auth-info-required", num_attrs,
-                                attrs)) != NULL)
-      {
-        cupsdSetAuthInfoRequired(job->printer, attr, NULL);
-	cupsdSetPrinterAttrs(job->printer);
-
-	cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("job-media-progress", num_attrs,
-                                attrs)) != NULL)
-      {
-        int progress = atoi(attr);
-
-
-        if (progress >= 0 && progress <= 100)
-	{
-	  job->progress = progress;
-
-	  if (job->sheets)
-	    cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
-			  "Printing page %d, %d%%",
-			  job->sheets->values[0].integer, job->progress);
-        }
-      }
-
-      if ((attr = cupsGetOption("printer-alert", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetString(&job->printer->alert, attr);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-      }
-
-      if ((attr = cupsGetOption("printer-alert-description", num_attrs,
-                                attrs)) != NULL)
-      {
-        cupsdSetString(&job->printer->alert_description, attr);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-      }
-
-      if ((attr = cupsGetOption("marker-colors", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-colors", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-low-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-low-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-high-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-high-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-message", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-message", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-names", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-names", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-types", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-types", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      cupsFreeOptions(num_attrs, attrs);
+      num_attrs = cupsParseOptions(message, num_attrs, &attrs);
     }
     else if (loglevel == CUPSD_LOG_PPD)
     {
@@ -5086,6 +6158,18 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
       if (loglevel < CUPSD_LOG_DEBUG &&
           strcmp(job->printer->state_message, ptr))
       {
+       /*
+        * Copy any pending job-printer-state-message before it is replaced by
+	* a message that doesn't belong there...
+	*/
+
+	if (do_message &&
+	    (loglevel > job->status_level || job->status_level <= CUPSD_LOG_ERROR))
+	{
+	  update_job_message(job, levels[job->status_level]);
+	  do_message = 0;
+	}
+
 	strlcpy(job->printer->state_message, ptr,
 		sizeof(job->printer->state_message));
 
@@ -5100,24 +6184,141 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 	  if (loglevel != CUPSD_LOG_NOTICE)
 	    job->status_level = loglevel;
 
-	  update_job_attrs(job, 1);
-
-	  cupsdLogJob(job, CUPSD_LOG_DEBUG,
-	              "Set job-printer-state-message to \"%s\", "
-	              "current level=%s",
-	              job->printer_message->values[0].string.text,
-	              levels[job->status_level]);
+	  do_message = 1;
 	}
       }
     }
 
-    if (!strchr(job->status_buffer->buffer, '\n'))
+    if (!strchr(job->status_buffer->bufptr, '\n'))
       break;
   }
 
+  if (num_attrs > 0)
+  {
+   /*
+    * Set attribute(s)...
+    */
+
+    if ((attr = cupsGetOption("auth-info-default", num_attrs, attrs)) != NULL)
+    {
+      job->printer->num_options = cupsAddOption("auth-info", attr,
+						job->printer->num_options,
+						&(job->printer->options));
+      cupsdSetPrinterAttrs(job->printer);
+
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("auth-info-required", num_attrs,
+                              attrs)) != NULL)
+    {
+      cupsdSetAuthInfoRequired(job->printer, attr, NULL);
+      cupsdSetPrinterAttrs(job->printer);
+
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("job-media-progress", num_attrs,
+                              attrs)) != NULL)
+    {
+      int value = atoi(attr);		/* Progress percentage */
+
+
+      if (value >= 0 && value <= 100)
+      {
+	job->progress = value;
+	progress      = 1;
+      }
+    }
+
+    if ((attr = cupsGetOption("printer-alert", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetString(&job->printer->alert, attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+    }
+
+    if ((attr = cupsGetOption("printer-alert-description", num_attrs,
+                              attrs)) != NULL)
+    {
+      cupsdSetString(&job->printer->alert_description, attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+    }
+
+    if ((attr = cupsGetOption("marker-colors", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-colors", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-levels", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-levels", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-low-levels", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-low-levels", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-high-levels", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-high-levels", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-message", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-message", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-names", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-names", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-types", num_attrs, attrs)) != NULL)
+    {
+      job->printer->marker_time = time(NULL);
+      cupsdSetPrinterAttr(job->printer, "marker-types", (char *)attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    cupsFreeOptions(num_attrs, attrs);
+  }
+
+  if (do_message)
+    update_job_message(job, levels[job->status_level]);
+  else if (do_state)
+    update_job_attrs(job, 0);
+
   if (event & CUPSD_EVENT_JOB_PROGRESS)
     cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
                   "%s", job->printer->state_message);
+  else if (progress && job->sheets)
+    cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
+		  "Printing page %d, %d%%",
+		  job->sheets->values[0].integer, job->progress);
+  else if (pages && job->sheets)
+    cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
+		  "Printed %d page(s).", job->sheets->values[0].integer);
+
   if (event & CUPSD_EVENT_PRINTER_STATE)
     cupsdAddEvent(CUPSD_EVENT_PRINTER_STATE, job->printer, NULL,
 		  (job->printer->type & CUPS_PRINTER_CLASS) ?
@@ -5125,6 +6326,11 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 		      "Printer \"%s\" state changed.",
 		  job->printer->name);
 
+  if (paused)
+  {
+    cupsdStopPrinter(job->printer, 1);
+    return;
+  }
 
   if (ptr == NULL && !job->status_buffer->bufused)
   {
@@ -5285,6 +6491,83 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
 }
 
 
+/*
+ * 'update_job_message()' - Copy the printer-state-message to the job.
+ */
+
+static void
+update_job_message(cupsd_job_t *job,	/* I - Job to update */
+                   const char  *level)	/* I - Current status level name */
+{
+  update_job_attrs(job, 1);
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG,
+              "Set job-printer-state-message to \"%s\", current level=%s",
+	      job->printer_message->values[0].string.text, level);
+}
+
+
+/*
+ * 'update_stream()' - Feed more of a file that is being received to the
+ *                     first filter.
+ */
+
+static void
+update_stream(cupsd_job_t *job)		/* I - Job */
+{
+  char		buffer[32768];		/* Copy buffer */
+  ssize_t	bytes,			/* Bytes read */
+		written;		/* Bytes written */
+
+
+  if ((bytes = read(job->stream_file, buffer, sizeof(buffer))) > 0)
+  {
+    if ((written = write(job->stream_pipe, buffer, (size_t)bytes)) < 0)
+    {
+      if (errno != EAGAIN && errno != EINTR)
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG,
+	            "Unable to stream print file to filters - %s",
+		    strerror(errno));
+	close_stream(job);
+	return;
+      }
+
+      written = 0;
+    }
+
+   /*
+    * Back up over anything the pipe would not take so it is sent next time...
+    */
+
+    if (written < bytes)
+      lseek(job->stream_file, (off_t)(written - bytes), SEEK_CUR);
+  }
+  else if (bytes == 0 && job->streaming)
+  {
+   /*
+    * Caught up with the client, wait for more data...
+    */
+
+    cupsdRemoveSelect(job->stream_pipe);
+  }
+  else
+  {
+   /*
+    * End of file (or error), let the filter see EOF...
+    */
+
+    if (bytes < 0)
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to read print file - %s",
+                  strerror(errno));
+    else
+      cupsdLogJob(job, CUPSD_LOG_DEBUG, "Finished streaming print file.");
+
+    close_stream(job);
+  }
+}
+
+
 /*
  * End of "$Id: job.c 12142 2014-08-30 02:35:43Z msweet $".
  */
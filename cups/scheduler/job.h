@@ -71,8 +71,14 @@ struct cupsd_job_s			/**** Job request ****/
   cupsd_statbuf_t	*status_buffer;	/* Status buffer for this job */
   int			status_level;	/* Highest log level in a status
 					 * message */
+  int			streaming;	/* File still being received, if any */
+  int			stream_file,	/* File being streamed to filters */
+			stream_pipe;	/* Pipe to first filter for stream */
   int			cost;		/* Filtering cost */
   int			pending_cost;	/* Waiting for FilterLimit */
+  time_t		pending_time;	/* When job started waiting */
+  time_t		filter_time;	/* When filters were started */
+  int			filter_cpu;	/* CPU time used by filters in ms */
   int			filters[MAX_FILTERS + 1];
 					/* Filter process IDs, 0 terminated */
   int			backend;	/* Backend process ID */
@@ -85,6 +91,7 @@ struct cupsd_job_s			/**** Job request ****/
 			*auth_uid;	/* AUTH_UID environment variable */
   void			*profile,	/* Security profile for filters */
 			*bprofile;	/* Security profile for backend */
+  char			*cgroup;	/* Control group for filters and backend */
   cups_array_t		*history;	/* Debug log history */
   int			progress;	/* Printing progress */
   int			num_keywords;	/* Number of PPD keywords */
@@ -143,6 +150,8 @@ VAR int			JobKillDelay	VALUE(DEFAULT_TIMEOUT),
  */
 
 extern cupsd_job_t	*cupsdAddJob(int priority, const char *dest);
+extern void		cupsdAddJobUsage(cupsd_job_t *job, const char *name,
+			                 int cpu_time, int max_rss);
 extern void		cupsdCancelJobs(const char *dest, const char *username,
 			                int purge);
 extern void		cupsdCheckJobs(void);
@@ -175,6 +184,7 @@ extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobStream(cupsd_job_t *job, int done);
 extern void		cupsdUpdateJobs(void);
 
 
@@ -0,0 +1,58 @@
+/*
+ * "$Id$"
+ *
+ * Process launcher definitions for the CUPS scheduler.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ */
+
+/*
+ * The scheduler talks to the "cups-launcher" helper over a UNIX domain stream
+ * socket.  Each message starts with a cupsd_launch_msg_t header.  START
+ * requests are followed by "length" bytes containing the nul-terminated
+ * program path, arguments, and environment strings, and carry the child's
+ * standard file descriptors as SCM_RIGHTS ancillary data in the order given
+ * by the "fds" bitmask.  The helper answers each START with a STARTED
+ * message and sends an EXITED message with the exit status and resource
+ * usage (followed by a SIGCHLD to the scheduler) whenever one of its
+ * children exits.
+ */
+
+/*
+ * Constants...
+ */
+
+#define CUPSD_LAUNCH_START	0	/* Start a process */
+#define CUPSD_LAUNCH_STARTED	1	/* Process started (or not) */
+#define CUPSD_LAUNCH_EXITED	2	/* Process exited */
+
+#define CUPSD_LAUNCH_MAX_FDS	5	/* stdin, stdout, stderr, back, side */
+#define CUPSD_LAUNCH_MAX_DATA	262144	/* Maximum size of START strings */
+
+
+/*
+ * Types and structures...
+ */
+
+typedef struct				/**** Launcher message ****/
+{
+  int		op,			/* Message type */
+		pid,			/* Process ID */
+		status,			/* Exit status or errno value */
+		fds,			/* Bitmask of descriptors sent (START) */
+		num_argv,		/* Number of arguments (START) */
+		num_envp;		/* Number of environment strings or -1 */
+  size_t	length;			/* Length of strings that follow */
+  struct rusage	usage;			/* Resource usage of process (EXITED) */
+} cupsd_launch_msg_t;
+
+
+/*
+ * End of "$Id$".
+ */
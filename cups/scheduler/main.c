@@ -518,6 +518,14 @@ main(int  argc,				/* I - Number of command-line args */
 
   cupsdStartSelect();
 
+ /*
+  * Start the printer-list-change-count value at the current time so that
+  * clients don't mistake the printers of a restarted scheduler for the ones
+  * they saw before...
+  */
+
+  PrinterListChangeCount = (unsigned)time(NULL);
+
  /*
   * Read configuration...
   */
@@ -841,6 +849,13 @@ main(int  argc,				/* I - Number of command-line args */
     if (DirtyCleanTime && current_time >= DirtyCleanTime)
       cupsdCleanDirty();
 
+   /*
+    * Remove control groups that were still in use when their job finished...
+    */
+
+    if (CgroupCleanTime && current_time >= CgroupCleanTime)
+      cupsdCleanCgroups();
+
 #ifdef __APPLE__
    /*
     * If we are going to sleep and still have pending jobs, stop them after
@@ -1311,6 +1326,7 @@ process_children(void)
   int		i;			/* Looping var */
   char		name[1024];		/* Process name */
   const char	*type;			/* Type of program */
+  struct rusage	usage;			/* Resource usage of child */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "process_children()");
@@ -1322,16 +1338,25 @@ process_children(void)
   dead_children = 0;
 
  /*
-  * Collect the exit status of some children...
+  * Collect the exit status of some children, including the ones started by
+  * cups-launcher...
   */
 
-#ifdef HAVE_WAITPID
-  while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+  memset(&usage, 0, sizeof(usage));
+
+#ifdef HAVE_WAIT4
+  while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0 ||
+         (pid = cupsdWaitLauncher(&status, &usage)) > 0)
+#elif defined(HAVE_WAITPID)
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0 ||
+         (pid = cupsdWaitLauncher(&status, &usage)) > 0)
 #elif defined(HAVE_WAIT3)
-  while ((pid = wait3(&status, WNOHANG, NULL)) > 0)
+  while ((pid = wait3(&status, WNOHANG, &usage)) > 0 ||
+         (pid = cupsdWaitLauncher(&status, &usage)) > 0)
 #else
-  if ((pid = wait(&status)) > 0)
-#endif /* HAVE_WAITPID */
+  if ((pid = wait(&status)) > 0 ||
+      (pid = cupsdWaitLauncher(&status, &usage)) > 0)
+#endif /* HAVE_WAIT4 */
   {
    /*
     * Collect the name of the process that finished...
@@ -1378,6 +1403,20 @@ process_children(void)
 	  type         = "Backend";
 	}
 
+       /*
+	* Record the CPU time and memory used...
+	*/
+
+	cupsdAddJobUsage(job, name,
+	                 (int)((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+			       1000 + (usage.ru_utime.tv_usec +
+			               usage.ru_stime.tv_usec) / 1000),
+#ifdef __APPLE__
+			 (int)(usage.ru_maxrss / 1024));
+#else
+			 (int)usage.ru_maxrss);
+#endif /* __APPLE__ */
+
 	if (status && status != SIGTERM && status != SIGKILL &&
 	    status != SIGPIPE)
 	{
@@ -1521,6 +1560,13 @@ process_children(void)
     else
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "PID %d (%s) exited with no errors.",
 		  pid, name);
+
+   /*
+    * waitpid() and wait() don't report resource usage, so don't let a value
+    * from cups-launcher carry over to the next process...
+    */
+
+    memset(&usage, 0, sizeof(usage));
   }
 
  /*
@@ -1629,6 +1675,16 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
     why     = "write dirty config/state files";
   }
 
+ /*
+  * Retry removing busy control groups...
+  */
+
+  if (CgroupCleanTime && timeout > CgroupCleanTime)
+  {
+    timeout = CgroupCleanTime;
+    why     = "remove stale control groups";
+  }
+
  /*
   * Check for any job activity...
   */
@@ -106,10 +106,11 @@ cupsdNetIFUpdate(void)
   NetIFUpdate = 0;
 
  /*
-  * Free the old interfaces...
+  * Free the old interfaces and any access decisions based on them...
   */
 
   cupsdNetIFFree();
+  cupsdFlushAuthCache();
 
  /*
   * Make sure we have an array...
@@ -49,6 +49,8 @@ static void	add_printer_formats(cupsd_printer_t *p);
 static int	compare_printers(void *first, void *second, void *data);
 static void	delete_printer_filters(cupsd_printer_t *p);
 static void	dirty_printer(cupsd_printer_t *p);
+static unsigned	hash_attrs(unsigned hash, ipp_t *ipp);
+static unsigned	hash_string(unsigned hash, const char *s);
 static void	load_ppd(cupsd_printer_t *p);
 static ipp_t	*new_media_col(_pwg_size_t *size, const char *source,
 		               const char *type);
@@ -120,6 +122,8 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
                   "cupsdAddPrinter: Adding %s to Printers", p->name);
   cupsArrayAdd(Printers, p);
 
+  PrinterListChangeCount ++;
+
  /*
   * Return the new printer...
   */
@@ -708,6 +712,8 @@ cupsdDeletePrinter(
                   "cupsdDeletePrinter: Removing %s from Printers", p->name);
   cupsArrayRemove(Printers, p);
 
+  PrinterListChangeCount ++;
+
  /*
   * If p is the default printer, assign a different one...
   */
@@ -1113,6 +1119,26 @@ cupsdLoadAllPrinters(void)
 	cupsdLogMessage(CUPSD_LOG_ERROR,
 	                "Syntax error on line %d of printers.conf.", linenum);
     }
+    else if (!_cups_strcasecmp(line, "StreamThrough"))
+    {
+     /*
+      * Set whether jobs are started before their documents are received...
+      */
+
+      if (value &&
+          (!_cups_strcasecmp(value, "yes") ||
+           !_cups_strcasecmp(value, "on") ||
+           !_cups_strcasecmp(value, "true")))
+        p->stream_through = 1;
+      else if (value &&
+               (!_cups_strcasecmp(value, "no") ||
+        	!_cups_strcasecmp(value, "off") ||
+        	!_cups_strcasecmp(value, "false")))
+        p->stream_through = 0;
+      else
+	cupsdLogMessage(CUPSD_LOG_ERROR,
+	                "Syntax error on line %d of printers.conf.", linenum);
+    }
     else if (!_cups_strcasecmp(line, "JobSheets"))
     {
      /*
@@ -1308,6 +1334,8 @@ cupsdRenamePrinter(
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
                   "cupsdRenamePrinter: Adding %s to Printers", p->name);
   cupsArrayAdd(Printers, p);
+
+  PrinterListChangeCount ++;
 }
 
 
@@ -1452,6 +1480,9 @@ cupsdSaveAllPrinters(void)
     else
       cupsFilePuts(fp, "Shared No\n");
 
+    if (printer->stream_through)
+      cupsFilePuts(fp, "StreamThrough Yes\n");
+
     snprintf(value, sizeof(value), "%s %s", printer->job_sheets[0],
              printer->job_sheets[1]);
     cupsFilePutConf(fp, "JobSheets", value);
@@ -1998,6 +2029,8 @@ cupsdSetPrinterAttr(
   }
 
   free(temp);
+
+  cupsdUpdatePrinterListChangeCount(p);
 }
 
 
@@ -2369,6 +2402,12 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
 
   add_printer_defaults(p);
 
+ /*
+  * Let clients know if the printer list changed...
+  */
+
+  cupsdUpdatePrinterListChangeCount(p);
+
  /*
   * Let the browse protocols reflect the change
   */
@@ -2422,7 +2461,10 @@ cupsdSetPrinterReasons(
   }
 
   if (!strcmp(s, "none"))
+  {
+    cupsdUpdatePrinterListChangeCount(p);
     return (changed);
+  }
 
  /*
   * Loop through all of the reasons...
@@ -2495,7 +2537,7 @@ cupsdSetPrinterReasons(
 	  cupsdLogMessage(CUPSD_LOG_ALERT,
 	                  "Too many printer-state-reasons values for %s (%d)",
 			  p->name, i + 1);
-          return (changed);
+          break;
         }
 
         p->reasons[i] = _cupsStrAlloc(reason);
@@ -2514,6 +2556,9 @@ cupsdSetPrinterReasons(
     }
   }
 
+  if (changed)
+    cupsdUpdatePrinterListChangeCount(p);
+
   return (changed);
 }
 
@@ -2547,17 +2592,17 @@ cupsdSetPrinterState(
 
   if (old_state != s)
   {
-    cupsdAddEvent(s == IPP_PRINTER_STOPPED ? CUPSD_EVENT_PRINTER_STOPPED :
-                      CUPSD_EVENT_PRINTER_STATE, p, NULL,
-		  "%s \"%s\" state changed to %s.",
-		  (p->type & CUPS_PRINTER_CLASS) ? "Class" : "Printer",
-		  p->name, printer_states[p->state - IPP_PRINTER_IDLE]);
-
    /*
     * Let the browse code know this needs to be updated...
     */
 
     p->state_time = time(NULL);
+
+    cupsdAddEvent(s == IPP_PRINTER_STOPPED ? CUPSD_EVENT_PRINTER_STOPPED :
+                      CUPSD_EVENT_PRINTER_STATE, p, NULL,
+		  "%s \"%s\" state changed to %s.",
+		  (p->type & CUPS_PRINTER_CLASS) ? "Class" : "Printer",
+		  p->name, printer_states[p->state - IPP_PRINTER_IDLE]);
   }
 
  /*
@@ -2629,6 +2674,53 @@ cupsdStopPrinter(cupsd_printer_t *p,	/* I - Printer to stop */
 }
 
 
+/*
+ * 'cupsdUpdatePrinterListChangeCount()' - Bump printer-list-change-count if the
+ *                                         printer's list entry changed.
+ *
+ * Every value that cupsGetDests requests and caches for a printer is checked;
+ * adding, deleting, and renaming printers bump the count directly.
+ */
+
+void
+cupsdUpdatePrinterListChangeCount(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  unsigned	hash = 5381;		/* Hash of list attributes */
+  const char	*values[4];		/* String values */
+  int		i;			/* Looping var */
+
+
+  values[0] = p->info;
+  values[1] = p->location;
+  values[2] = p->make_model;
+  values[3] = p->sanitized_device_uri;
+
+  for (i = 0; i < 4; i ++)
+    hash = hash_string(hash, values[i]);
+
+  for (i = 0; i < p->num_reasons; i ++)
+    hash = hash_string(hash, p->reasons[i]);
+
+  hash = hash * 33 + (unsigned)p->state;
+  hash = hash * 33 + (unsigned)p->state_time;
+  hash = hash * 33 + (unsigned)p->marker_time;
+  hash = hash * 33 + (unsigned)p->type;
+  hash = hash * 33 + (unsigned)(p->accepting ? 1 : 0);
+  hash = hash * 33 + (unsigned)(p->shared ? 1 : 0);
+  hash = hash * 33 + (unsigned)(p == DefaultPrinter);
+
+  hash = hash_attrs(hash, p->attrs);
+  hash = hash_attrs(hash, p->ppd_attrs);
+
+  if (hash != p->list_hash)
+  {
+    p->list_hash = hash;
+    PrinterListChangeCount ++;
+  }
+}
+
+
 /*
  * 'cupsdUpdatePrinterPPD()' - Update keywords in a printer's PPD file.
  */
@@ -3615,6 +3707,64 @@ dirty_printer(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'hash_attrs()' - Add the attributes cupsGetDests caches to a hash.
+ *
+ * These are the auth-info-required, marker-*,
+ * printer-mandatory-job-attributes, and *-default attributes.
+ */
+
+static unsigned				/* O - New hash */
+hash_attrs(unsigned hash,		/* I - Current hash */
+           ipp_t    *ipp)		/* I - Attributes */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  const char		*name;		/* Attribute name */
+  size_t		namelen;	/* Length of name */
+  char			value[2048];	/* Attribute value */
+
+
+  if (!ipp)
+    return (hash);
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+  {
+    if ((name = attr->name) == NULL)
+      continue;
+
+    namelen = strlen(name);
+
+    if (strcmp(name, "auth-info-required") && strncmp(name, "marker-", 7) &&
+        strcmp(name, "printer-mandatory-job-attributes") &&
+	(namelen < 8 || strcmp(name + namelen - 8, "-default")))
+      continue;
+
+    ippAttributeString(attr, value, sizeof(value));
+
+    hash = hash_string(hash, name);
+    hash = hash_string(hash, value);
+  }
+
+  return (hash);
+}
+
+
+/*
+ * 'hash_string()' - Add a string to a hash.
+ */
+
+static unsigned				/* O - New hash */
+hash_string(unsigned   hash,		/* I - Current hash */
+            const char *s)		/* I - String or NULL */
+{
+  if (s)
+    while (*s)
+      hash = hash * 33 + (unsigned char)*s++;
+
+  return (hash * 33);
+}
+
+
 /*
  * 'load_ppd()' - Load a cached PPD file, updating the cache as needed.
  */
@@ -85,6 +85,7 @@ struct cupsd_printer_s
   char		*port_monitor;		/* Port monitor */
   int		raw;			/* Raw queue? */
   int		remote;			/* Remote queue? */
+  int		stream_through;		/* Start jobs before documents are received? */
   mime_type_t	*filetype,		/* Pseudo-filetype for printer */
 		*prefiltertype;		/* Pseudo-filetype for pre-filters */
   cups_array_t	*filetypes,		/* Supported file types */
@@ -109,6 +110,7 @@ struct cupsd_printer_s
   char		*alert,			/* PSX printer-alert value */
 		*alert_description;	/* PSX printer-alert-description value */
   time_t	marker_time;		/* Last time marker attributes were updated */
+  unsigned	list_hash;		/* Hash of printer list attributes */
   _ppd_cache_t	*pc;			/* PPD cache and mapping data */
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
@@ -142,6 +144,9 @@ VAR char		*DefaultPolicy	VALUE(NULL);
 VAR cupsd_policy_t	*DefaultPolicyPtr
 					VALUE(NULL);
 					/* Pointer to default policy */
+VAR unsigned		PrinterListChangeCount
+					VALUE(0);
+					/* printer-list-change-count value */
 
 
 /*
@@ -179,6 +184,7 @@ extern void		cupsdStopPrinter(cupsd_printer_t *p, int update);
 extern int		cupsdUpdatePrinterPPD(cupsd_printer_t *p,
 			                      int num_keywords,
 					      cups_option_t *keywords);
+extern void		cupsdUpdatePrinterListChangeCount(cupsd_printer_t *p);
 extern void		cupsdUpdatePrinters(void);
 extern cupsd_quota_t	*cupsdUpdateQuota(cupsd_printer_t *p,
 			                  const char *username, int pages,
@@ -26,6 +26,8 @@
 #  include <spawn.h>
 extern char **environ;
 #endif /* HAVE_POSIX_SPAWN */
+#include <poll.h>
+#include "launcher.h"
 
 
 /*
@@ -35,16 +37,32 @@ extern char **environ;
 typedef struct
 {
   int	pid,				/* Process ID */
-	job_id;				/* Job associated with process */
+	job_id,				/* Job associated with process */
+	launched;			/* Started by cups-launcher? */
   char	name[1];			/* Name of process */
 } cupsd_proc_t;
 
+typedef struct
+{
+  int		pid,			/* Process ID */
+		status;			/* Exit status */
+  struct rusage	usage;			/* Resource usage */
+} cupsd_exit_t;
+
 
 /*
  * Local globals...
  */
 
 static cups_array_t	*process_array = NULL;
+static int		launcher_fd = -1;
+					/* Socket for cups-launcher */
+static int		launcher_pid = 0;
+					/* Process ID of cups-launcher */
+static cups_array_t	*launcher_exits = NULL;
+					/* Exit status from cups-launcher */
+static cups_array_t	*stale_cgroups = NULL;
+					/* Control groups still in use */
 
 
 /*
@@ -52,11 +70,141 @@ static cups_array_t	*process_array = NULL;
  */
 
 static int	compare_procs(cupsd_proc_t *a, cupsd_proc_t *b);
+static void	cgroup_release(const char *cgroup);
+static int	cgroup_write(const char *cgroup, const char *name,
+		             const char *value);
+static void	launcher_queue(int pid, int status, struct rusage *usage);
+#ifdef HAVE_POSIX_SPAWN
+static int	launcher_recv(cupsd_launch_msg_t *msg, int msec);
+static int	launcher_spawn(const char *command, char *argv[], char *envp[],
+		               int infd, int outfd, int errfd, int backfd,
+			       int sidefd);
+static int	launcher_start(void);
+#endif /* HAVE_POSIX_SPAWN */
+static void	launcher_stop(void);
 #ifdef HAVE_SANDBOX_H
 static char	*cupsd_requote(char *dst, const char *src, size_t dstsize);
 #endif /* HAVE_SANDBOX_H */
 
 
+/*
+ * 'cupsdCleanCgroups()' - Retry removing control groups that were busy.
+ */
+
+void
+cupsdCleanCgroups(void)
+{
+  char	*cgroup;			/* Current control group */
+  int	status;				/* Result of rmdir() */
+
+
+  for (cgroup = (char *)cupsArrayFirst(stale_cgroups);
+       cgroup;
+       cgroup = (char *)cupsArrayNext(stale_cgroups))
+  {
+    if ((status = rmdir(cgroup)) && errno == EBUSY)
+    {
+      cgroup_release(cgroup);
+      status = rmdir(cgroup);
+    }
+
+    if (!status || errno == ENOENT)
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Removed control group %s.", cgroup);
+
+      cupsArrayRemove(stale_cgroups, cgroup);
+      free(cgroup);
+    }
+    else if (errno != EBUSY)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove control group %s: %s",
+                      cgroup, strerror(errno));
+
+      cupsArrayRemove(stale_cgroups, cgroup);
+      free(cgroup);
+    }
+  }
+
+  if (cupsArrayCount(stale_cgroups) > 0)
+    CgroupCleanTime = time(NULL) + 10;
+  else
+    CgroupCleanTime = 0;
+}
+
+
+/*
+ * 'cupsdCreateCgroup()' - Create a control group for the processes of a job.
+ */
+
+char *					/* O - Control group directory or NULL */
+cupsdCreateCgroup(cupsd_job_t *job)	/* I - Job */
+{
+  char		cgroup[1024],		/* Control group directory */
+		value[256];		/* Value to write */
+  int		weight;			/* CPU and I/O weight */
+
+
+  if (!FilterCgroup || !*FilterCgroup || RunUser)
+    return (NULL);
+
+ /*
+  * Make sure the cpu, io, and memory controllers are available to the job
+  * control groups...
+  */
+
+  cgroup_write(FilterCgroup, "cgroup.subtree_control", "+cpu +io +memory");
+
+ /*
+  * Create the job's control group...
+  */
+
+  snprintf(cgroup, sizeof(cgroup), "%s/job-%d", FilterCgroup, job->id);
+
+  if (mkdir(cgroup, 0755) && errno != EEXIST)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to create control group %s: %s",
+                cgroup, strerror(errno));
+    return (NULL);
+  }
+
+ /*
+  * Scale the CPU and I/O weights by the job priority, so the default priority
+  * of 50 gets the kernel's default weight of 100.  Every job gets its own
+  * share regardless of how many filters it runs...
+  */
+
+  weight = 2 * job->priority;
+  if (weight < 1)
+    weight = 1;
+
+  snprintf(value, sizeof(value), "%d", weight);
+  cgroup_write(cgroup, "cpu.weight", value);
+
+  snprintf(value, sizeof(value), "default %d", weight);
+  cgroup_write(cgroup, "io.weight", value);
+
+ /*
+  * Limit the memory used by the filters and backend and kill all of them
+  * when the limit is exceeded...
+  */
+
+  if (FilterMemoryLimit > 0)
+  {
+    snprintf(value, sizeof(value), CUPS_LLFMT, CUPS_LLCAST FilterMemoryLimit);
+    cgroup_write(cgroup, "memory.max", value);
+  }
+  else
+    cgroup_write(cgroup, "memory.max", "max");
+
+  cgroup_write(cgroup, "memory.oom.group", "1");
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG, "Using control group %s with weight %d.",
+              cgroup, weight);
+
+  return (strdup(cgroup));
+}
+
+
 /*
  * 'cupsdCreateProfile()' - Create an execution profile for a subprocess.
  */
@@ -347,6 +495,62 @@ cupsdCreateProfile(int job_id,		/* I - Job ID or 0 for none */
 }
 
 
+/*
+ * 'cupsdDestroyCgroup()' - Remove a job control group.
+ */
+
+void
+cupsdDestroyCgroup(char *cgroup)	/* I - Control group directory */
+{
+  int	status;				/* Result of rmdir() */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdDestroyCgroup(cgroup=\"%s\")",
+		  cgroup ? cgroup : "(null)");
+
+  if (cgroup)
+  {
+   /*
+    * The directory can only be removed once every process in the group has
+    * exited, which is normally the case once the job is finalized.  A
+    * process that outlives the job (such as a persistent backend helper) is
+    * moved to a shared group so that it is no longer limited and accounted
+    * as part of this job.  If the group is still busy, try again later...
+    */
+
+    if ((status = rmdir(cgroup)) && errno == EBUSY)
+    {
+      cgroup_release(cgroup);
+      status = rmdir(cgroup);
+    }
+
+    if (!status || errno == ENOENT)
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Removed control group %s.", cgroup);
+    else if (errno == EBUSY)
+    {
+      cupsdLogMessage(CUPSD_LOG_INFO,
+                      "Control group %s is still in use, will retry removal.",
+		      cgroup);
+
+      if (!stale_cgroups)
+        stale_cgroups = cupsArrayNew(NULL, NULL);
+
+      if (cupsArrayAdd(stale_cgroups, cgroup))
+      {
+        if (!CgroupCleanTime)
+	  CgroupCleanTime = time(NULL) + 10;
+	return;
+      }
+    }
+    else
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove control group %s: %s",
+                      cgroup, strerror(errno));
+
+    free(cgroup);
+  }
+}
+
+
 /*
  * 'cupsdDestroyProfile()' - Delete an execution profile.
  */
@@ -414,6 +618,16 @@ cupsdFinishProcess(int    pid,		/* I - Process ID */
 
   key.pid = pid;
 
+  if (launcher_pid > 0 && pid == launcher_pid)
+  {
+   /*
+    * The launcher went away; stop using it...
+    */
+
+    launcher_pid = 0;
+    launcher_stop();
+  }
+
   if ((proc = (cupsd_proc_t *)cupsArrayFind(process_array, &key)) != NULL)
   {
     if (job_id)
@@ -458,16 +672,18 @@ cupsdStartProcess(
 {
   int		i;			/* Looping var */
   const char	*exec_path = command;	/* Command to be exec'd */
-  char		*real_argv[110],	/* Real command-line arguments */
+  char		*real_argv[112],	/* Real command-line arguments */
 		cups_exec[1024];	/* Path to "cups-exec" program */
+  int		real_argc;		/* Number of real arguments */
   uid_t		user;			/* Command UID */
   cupsd_proc_t	*proc;			/* New process record */
-#ifdef HAVE_POSIX_SPAWN
-  posix_spawn_file_actions_t actions;	/* Spawn file actions */
-  posix_spawnattr_t attrs;		/* Spawn attributes */
+  int		launched = 0;		/* Started by cups-launcher? */
   char		user_str[16],		/* User string */
 		group_str[16],		/* Group string */
 		nice_str[16];		/* FilterNice string */
+#ifdef HAVE_POSIX_SPAWN
+  posix_spawn_file_actions_t actions;	/* Spawn file actions */
+  posix_spawnattr_t attrs;		/* Spawn attributes */
 #elif defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
   struct sigaction action;		/* POSIX signal handler */
 #endif /* HAVE_POSIX_SPAWN */
@@ -531,11 +747,12 @@ cupsdStartProcess(
 #endif	/* __APPLE__ */
 
  /*
-  * Use helper program when we have a sandbox profile...
+  * Use helper program when we have a sandbox profile or control group; it is
+  * the one place where a process joins the job's control group...
   */
 
 #ifndef HAVE_POSIX_SPAWN
-  if (profile)
+  if (profile || (job && job->cgroup))
 #endif /* !HAVE_POSIX_SPAWN */
   {
     snprintf(cups_exec, sizeof(cups_exec), "%s/daemon/cups-exec", ServerBin);
@@ -543,22 +760,31 @@ cupsdStartProcess(
     snprintf(group_str, sizeof(group_str), "%d", Group);
     snprintf(nice_str, sizeof(nice_str), "%d", FilterNice);
 
-    real_argv[0] = cups_exec;
-    real_argv[1] = (char *)"-g";
-    real_argv[2] = group_str;
-    real_argv[3] = (char *)"-n";
-    real_argv[4] = nice_str;
-    real_argv[5] = (char *)"-u";
-    real_argv[6] = user_str;
-    real_argv[7] = profile ? profile : "none";
-    real_argv[8] = (char *)command;
+    real_argc = 0;
+    real_argv[real_argc ++] = cups_exec;
+
+    if (job && job->cgroup)
+    {
+      real_argv[real_argc ++] = (char *)"-c";
+      real_argv[real_argc ++] = job->cgroup;
+    }
+
+    real_argv[real_argc ++] = (char *)"-g";
+    real_argv[real_argc ++] = group_str;
+    real_argv[real_argc ++] = (char *)"-n";
+    real_argv[real_argc ++] = nice_str;
+    real_argv[real_argc ++] = (char *)"-u";
+    real_argv[real_argc ++] = user_str;
+    real_argv[real_argc ++] = profile ? profile : "none";
+    real_argv[real_argc ++] = (char *)command;
 
     for (i = 0;
-         i < (int)(sizeof(real_argv) / sizeof(real_argv[0]) - 10) && argv[i];
+         real_argc < (int)(sizeof(real_argv) / sizeof(real_argv[0]) - 1) &&
+	     argv[i];
 	 i ++)
-      real_argv[i + 9] = argv[i];
+      real_argv[real_argc ++] = argv[i];
 
-    real_argv[i + 9] = NULL;
+    real_argv[real_argc] = NULL;
 
     argv      = real_argv;
     exec_path = cups_exec;
@@ -573,59 +799,74 @@ cupsdStartProcess(
   }
 
 #ifdef HAVE_POSIX_SPAWN
- /*
-  * Setup attributes and file actions for the spawn...
-  */
+  if (job && FilterLauncher &&
+      (*pid = launcher_spawn(exec_path, argv, envp, infd, outfd, errfd,
+                             backfd, sidefd)) > 0)
+  {
+   /*
+    * Started by cups-launcher...
+    */
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Setting spawn attributes.");
-  posix_spawnattr_init(&attrs);
-  posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: pid=%d (launched)", (int)*pid);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Setting file actions.");
-  posix_spawn_file_actions_init(&actions);
-  if (infd != 0)
-  {
-    if (infd < 0)
-      posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_WRONLY, 0);
-    else
-      posix_spawn_file_actions_adddup2(&actions, infd, 0);
+    launched = 1;
   }
-
-  if (outfd != 1)
+  else
   {
-    if (outfd < 0)
-      posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
-    else
-      posix_spawn_file_actions_adddup2(&actions, outfd, 1);
-  }
+   /*
+    * Setup attributes and file actions for the spawn...
+    */
 
-  if (errfd != 2)
-  {
-    if (errfd < 0)
-      posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
-    else
-      posix_spawn_file_actions_adddup2(&actions, errfd, 2);
-  }
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Setting spawn attributes.");
+    posix_spawnattr_init(&attrs);
+    posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Setting file actions.");
+    posix_spawn_file_actions_init(&actions);
+    if (infd != 0)
+    {
+      if (infd < 0)
+        posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_WRONLY, 0);
+      else
+        posix_spawn_file_actions_adddup2(&actions, infd, 0);
+    }
 
-  if (backfd != 3 && backfd >= 0)
-    posix_spawn_file_actions_adddup2(&actions, backfd, 3);
+    if (outfd != 1)
+    {
+      if (outfd < 0)
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+      else
+        posix_spawn_file_actions_adddup2(&actions, outfd, 1);
+    }
 
-  if (sidefd != 4 && sidefd >= 0)
-    posix_spawn_file_actions_adddup2(&actions, sidefd, 4);
+    if (errfd != 2)
+    {
+      if (errfd < 0)
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+      else
+        posix_spawn_file_actions_adddup2(&actions, errfd, 2);
+    }
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Calling posix_spawn.");
+    if (backfd != 3 && backfd >= 0)
+      posix_spawn_file_actions_adddup2(&actions, backfd, 3);
 
-  if (posix_spawn(pid, exec_path, &actions, &attrs, argv, envp ? envp : environ))
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to fork %s - %s.", command, strerror(errno));
+    if (sidefd != 4 && sidefd >= 0)
+      posix_spawn_file_actions_adddup2(&actions, sidefd, 4);
 
-    *pid = 0;
-  }
-  else
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: pid=%d", (int)*pid);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Calling posix_spawn.");
 
-  posix_spawn_file_actions_destroy(&actions);
-  posix_spawnattr_destroy(&attrs);
+    if (posix_spawn(pid, exec_path, &actions, &attrs, argv, envp ? envp : environ))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to fork %s - %s.", command, strerror(errno));
+
+      *pid = 0;
+    }
+    else
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: pid=%d", (int)*pid);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attrs);
+  }
 
 #else
  /*
@@ -708,29 +949,37 @@ cupsdStartProcess(
     }
 
    /*
-    * Change the priority of the process based on the FilterNice setting.
-    * (this is not done for root processes...)
+    * When running through cups-exec it joins the control group and drops
+    * privileges itself...
     */
 
-    if (!root)
-      nice(FilterNice);
+    if (exec_path == command)
+    {
+     /*
+      * Change the priority of the process based on the FilterNice setting.
+      * (this is not done for root processes...)
+      */
 
-   /*
-    * Reset group membership to just the main one we belong to.
-    */
+      if (!root)
+	nice(FilterNice);
 
-    if (!RunUser && setgid(Group))
-      exit(errno + 100);
+     /*
+      * Reset group membership to just the main one we belong to.
+      */
 
-    if (!RunUser && setgroups(1, &Group))
-      exit(errno + 100);
+      if (!RunUser && setgid(Group))
+	exit(errno + 100);
 
-   /*
-    * Change user to something "safe"...
-    */
+      if (!RunUser && setgroups(1, &Group))
+	exit(errno + 100);
 
-    if (!RunUser && user && setuid(user))
-      exit(errno + 100);
+     /*
+      * Change user to something "safe"...
+      */
+
+      if (!RunUser && user && setuid(user))
+	exit(errno + 100);
+    }
 
    /*
     * Change umask to restrict permissions on created files...
@@ -799,8 +1048,9 @@ cupsdStartProcess(
     {
       if ((proc = calloc(1, sizeof(cupsd_proc_t) + strlen(command))) != NULL)
       {
-        proc->pid    = *pid;
-	proc->job_id = job ? job->id : 0;
+        proc->pid      = *pid;
+	proc->job_id   = job ? job->id : 0;
+	proc->launched = launched;
 	_cups_strcpy(proc->name, command);
 
 	cupsArrayAdd(process_array, proc);
@@ -819,6 +1069,136 @@ cupsdStartProcess(
 }
 
 
+/*
+ * 'cupsdWaitLauncher()' - Get the exit status of a process started by
+ *                         cups-launcher.
+ */
+
+int					/* O - Process ID or -1 if none */
+cupsdWaitLauncher(int           *status,/* O - Exit status */
+                  struct rusage *usage)	/* O - Resource usage */
+{
+  int			pid;		/* Process ID */
+  cupsd_exit_t		*ex;		/* Exit status */
+#ifdef HAVE_POSIX_SPAWN
+  cupsd_launch_msg_t	msg;		/* Launcher message */
+
+
+ /*
+  * Collect any pending exit notifications...
+  */
+
+  while (launcher_fd >= 0 && launcher_recv(&msg, 0) > 0)
+  {
+    if (msg.op == CUPSD_LAUNCH_EXITED && msg.pid > 0)
+      launcher_queue(msg.pid, msg.status, &msg.usage);
+  }
+#endif /* HAVE_POSIX_SPAWN */
+
+  if ((ex = (cupsd_exit_t *)cupsArrayFirst(launcher_exits)) == NULL)
+    return (-1);
+
+  cupsArrayRemove(launcher_exits, ex);
+
+  pid     = ex->pid;
+  *status = ex->status;
+  *usage  = ex->usage;
+
+  free(ex);
+
+  return (pid);
+}
+
+
+/*
+ * 'cgroup_release()' - Move the processes left in a job control group to the
+ *                      shared group for processes that outlive their jobs.
+ */
+
+static void
+cgroup_release(const char *cgroup)	/* I - Control group directory */
+{
+  cups_file_t	*fp;			/* cgroup.procs file */
+  char		filename[1024],		/* cgroup.procs filename */
+		shared[1024],		/* Shared control group directory */
+		*ptr,			/* Pointer into directory name */
+		pid[256];		/* Process ID */
+
+
+ /*
+  * The shared group is a sibling of the job groups...
+  */
+
+  strlcpy(shared, cgroup, sizeof(shared));
+
+  if ((ptr = strrchr(shared, '/')) == NULL)
+    return;
+
+  strlcpy(ptr, "/persistent", sizeof(shared) - (size_t)(ptr - shared));
+
+  if (mkdir(shared, 0755) && errno != EEXIST)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create control group %s: %s",
+                    shared, strerror(errno));
+    return;
+  }
+
+ /*
+  * Move each process, one per write as the kernel requires...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/cgroup.procs", cgroup);
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return;
+
+  while (cupsFileGets(fp, pid, sizeof(pid)))
+    if (!cgroup_write(shared, "cgroup.procs", pid))
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Moved process %s from control group %s to %s.", pid,
+		      cgroup, shared);
+
+  cupsFileClose(fp);
+}
+
+
+/*
+ * 'cgroup_write()' - Write a value to a control group interface file.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+cgroup_write(const char *cgroup,	/* I - Control group directory */
+             const char *name,		/* I - Interface file name */
+	     const char *value)		/* I - Value to write */
+{
+  int		fd;			/* File descriptor */
+  char		filename[1024];		/* Interface file */
+  size_t	length = strlen(value);	/* Length of value */
+
+
+  snprintf(filename, sizeof(filename), "%s/%s", cgroup, name);
+
+  if ((fd = open(filename, O_WRONLY)) < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Unable to open %s: %s", filename,
+                    strerror(errno));
+    return (-1);
+  }
+
+  if (write(fd, value, length) != (ssize_t)length)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Unable to write \"%s\" to %s: %s",
+                    value, filename, strerror(errno));
+    close(fd);
+    return (-1);
+  }
+
+  close(fd);
+
+  return (0);
+}
+
+
 /*
  * 'compare_procs()' - Compare two processes.
  */
@@ -869,6 +1249,357 @@ cupsd_requote(char       *dst,		/* I - Destination buffer */
 #endif /* HAVE_SANDBOX_H */
 
 
+/*
+ * 'launcher_queue()' - Save the exit status of a launched process.
+ */
+
+static void
+launcher_queue(int           pid,	/* I - Process ID */
+               int           status,	/* I - Exit status */
+	       struct rusage *usage)	/* I - Resource usage or NULL */
+{
+  cupsd_exit_t	*ex;			/* Exit status */
+
+
+  if ((ex = malloc(sizeof(cupsd_exit_t))) == NULL)
+    return;
+
+  ex->pid    = pid;
+  ex->status = status;
+
+  if (usage)
+    ex->usage = *usage;
+  else
+    memset(&ex->usage, 0, sizeof(ex->usage));
+
+  if (!launcher_exits)
+    launcher_exits = cupsArrayNew(NULL, NULL);
+
+  cupsArrayAdd(launcher_exits, ex);
+}
+
+
+#ifdef HAVE_POSIX_SPAWN
+/*
+ * 'launcher_recv()' - Read a message from cups-launcher.
+ */
+
+static int				/* O - 1 on success, 0 on timeout, -1 on error */
+launcher_recv(cupsd_launch_msg_t *msg,	/* O - Message */
+              int                msec)	/* I - Milliseconds to wait */
+{
+  struct pollfd	pfd;			/* Poll data */
+  ssize_t	bytes;			/* Bytes read */
+  size_t	total = 0;		/* Total bytes read */
+
+
+  pfd.fd     = launcher_fd;
+  pfd.events = POLLIN;
+
+  while (total < sizeof(cupsd_launch_msg_t))
+  {
+   /*
+    * Only the first byte is subject to the timeout; once a message has
+    * started the rest follows immediately...
+    */
+
+    if (poll(&pfd, 1, total ? 1000 : msec) <= 0)
+    {
+      if (errno == EINTR && !total)
+        continue;
+      else if (!total)
+        return (0);
+
+      break;
+    }
+
+    if ((bytes = read(launcher_fd, (char *)msg + total,
+                      sizeof(cupsd_launch_msg_t) - total)) <= 0)
+    {
+      if (bytes < 0 && (errno == EINTR || errno == EAGAIN))
+        continue;
+
+      break;
+    }
+
+    total += (size_t)bytes;
+  }
+
+  if (total < sizeof(cupsd_launch_msg_t))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Lost connection to cups-launcher.");
+    launcher_stop();
+    return (-1);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'launcher_spawn()' - Start a process using cups-launcher.
+ */
+
+static int				/* O - Process ID or 0 on error */
+launcher_spawn(const char *command,	/* I - Full path to command */
+               char       *argv[],	/* I - Command-line arguments */
+	       char       *envp[],	/* I - Environment or NULL */
+	       int        infd,		/* I - Standard input */
+	       int        outfd,	/* I - Standard output */
+	       int        errfd,	/* I - Standard error */
+	       int        backfd,	/* I - Backchannel */
+	       int        sidefd)	/* I - Sidechannel */
+{
+  int			i,		/* Looping var */
+			fds[CUPSD_LAUNCH_MAX_FDS],
+					/* Descriptors to send */
+			num_fds = 0;	/* Number of descriptors */
+  cupsd_launch_msg_t	msg;		/* Request/response */
+  char			*data,		/* Strings */
+			*ptr;		/* Pointer into strings */
+  size_t		length;		/* Length of strings */
+  ssize_t		bytes;		/* Bytes written */
+  struct msghdr		hdr;		/* Message header */
+  struct iovec		iov;		/* I/O vector */
+  struct cmsghdr	*cmsg;		/* Control message */
+  char			control[CMSG_SPACE(CUPSD_LAUNCH_MAX_FDS * sizeof(int))];
+					/* Control buffer */
+
+
+  if (launcher_fd < 0 && !launcher_start())
+    return (0);
+
+ /*
+  * Build the request...
+  */
+
+  memset(&msg, 0, sizeof(msg));
+
+  msg.op       = CUPSD_LAUNCH_START;
+  msg.num_envp = -1;
+  length       = strlen(command) + 1;
+
+  for (msg.num_argv = 0; argv[msg.num_argv]; msg.num_argv ++)
+    length += strlen(argv[msg.num_argv]) + 1;
+
+  if (envp)
+    for (msg.num_envp = 0; envp[msg.num_envp]; msg.num_envp ++)
+      length += strlen(envp[msg.num_envp]) + 1;
+
+  if (length > CUPSD_LAUNCH_MAX_DATA || (data = malloc(length)) == NULL)
+    return (0);
+
+  msg.length = length;
+
+  strlcpy(data, command, length);
+  ptr = data + strlen(data) + 1;
+
+  for (i = 0; i < msg.num_argv; i ++)
+  {
+    strlcpy(ptr, argv[i], length - (size_t)(ptr - data));
+    ptr += strlen(ptr) + 1;
+  }
+
+  for (i = 0; i < msg.num_envp; i ++)
+  {
+    strlcpy(ptr, envp[i], length - (size_t)(ptr - data));
+    ptr += strlen(ptr) + 1;
+  }
+
+  if (infd >= 0)
+  {
+    msg.fds |= 1;
+    fds[num_fds ++] = infd;
+  }
+
+  if (outfd >= 0)
+  {
+    msg.fds |= 2;
+    fds[num_fds ++] = outfd;
+  }
+
+  if (errfd >= 0)
+  {
+    msg.fds |= 4;
+    fds[num_fds ++] = errfd;
+  }
+
+  if (backfd >= 0)
+  {
+    msg.fds |= 8;
+    fds[num_fds ++] = backfd;
+  }
+
+  if (sidefd >= 0)
+  {
+    msg.fds |= 16;
+    fds[num_fds ++] = sidefd;
+  }
+
+ /*
+  * Send the header with the descriptors, then the strings...
+  */
+
+  memset(&hdr, 0, sizeof(hdr));
+  iov.iov_base   = &msg;
+  iov.iov_len    = sizeof(msg);
+  hdr.msg_iov    = &iov;
+  hdr.msg_iovlen = 1;
+
+  if (num_fds > 0)
+  {
+    memset(control, 0, sizeof(control));
+    hdr.msg_control    = control;
+    hdr.msg_controllen = CMSG_SPACE((size_t)num_fds * sizeof(int));
+
+    cmsg             = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN((size_t)num_fds * sizeof(int));
+
+    memcpy(CMSG_DATA(cmsg), fds, (size_t)num_fds * sizeof(int));
+  }
+
+  while ((bytes = sendmsg(launcher_fd, &hdr, 0)) < 0 && errno == EINTR);
+
+  if (bytes == (ssize_t)sizeof(msg))
+  {
+    for (ptr = data, length = msg.length; length > 0; length -= (size_t)bytes, ptr += bytes)
+    {
+      if ((bytes = write(launcher_fd, ptr, length)) < 0)
+      {
+        if (errno != EINTR)
+	  break;
+
+	bytes = 0;
+      }
+    }
+  }
+  else if (bytes >= 0)
+    bytes = -1;
+
+  free(data);
+
+  if (bytes < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to send request to cups-launcher: %s", strerror(errno));
+    launcher_stop();
+    return (0);
+  }
+
+ /*
+  * Wait for the process ID, saving any exit status that arrives first...
+  */
+
+  for (;;)
+  {
+    if ((i = launcher_recv(&msg, 10000)) == 0)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Timed out waiting for cups-launcher.");
+      launcher_stop();
+      return (0);
+    }
+    else if (i < 0)
+      return (0);
+
+    if (msg.op == CUPSD_LAUNCH_STARTED)
+      break;
+    else if (msg.op == CUPSD_LAUNCH_EXITED && msg.pid > 0)
+      launcher_queue(msg.pid, msg.status, &msg.usage);
+  }
+
+  if (msg.pid <= 0)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to launch %s - %s.", command,
+                    strerror(msg.status));
+
+  return (msg.pid > 0 ? msg.pid : 0);
+}
+
+
+/*
+ * 'launcher_start()' - Start the cups-launcher helper.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+launcher_start(void)
+{
+  int	fds[2];				/* Socket pair */
+  char	command[1024],			/* Path to cups-launcher */
+	*argv[2];			/* Command-line arguments */
+
+
+  if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create cups-launcher socket: %s", strerror(errno));
+    return (0);
+  }
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+  snprintf(command, sizeof(command), "%s/daemon/cups-launcher", ServerBin);
+  argv[0] = (char *)"cups-launcher";
+  argv[1] = NULL;
+
+  if (!cupsdStartProcess(command, argv, NULL, fds[1], -1, -1, -1, -1, 1, NULL,
+                         NULL, &launcher_pid))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to start cups-launcher - %s.", strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+    return (0);
+  }
+
+  close(fds[1]);
+
+  launcher_fd = fds[0];
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Started cups-launcher (PID %d).", launcher_pid);
+
+  return (1);
+}
+#endif /* HAVE_POSIX_SPAWN */
+
+
+/*
+ * 'launcher_stop()' - Stop using cups-launcher.
+ *
+ * Processes started by the launcher can no longer be waited for, so they
+ * are killed and reported as terminated.
+ */
+
+static void
+launcher_stop(void)
+{
+  cupsd_proc_t	*proc;			/* Current process */
+
+
+  if (launcher_fd >= 0)
+  {
+    close(launcher_fd);
+    launcher_fd = -1;
+  }
+
+  if (launcher_pid > 0)
+  {
+    kill(launcher_pid, SIGTERM);
+    launcher_pid = 0;
+  }
+
+  for (proc = (cupsd_proc_t *)cupsArrayFirst(process_array);
+       proc;
+       proc = (cupsd_proc_t *)cupsArrayNext(process_array))
+  {
+    if (!proc->launched)
+      continue;
+
+    proc->launched = 0;
+
+    cupsdEndProcess(proc->pid, 1);
+    launcher_queue(proc->pid, SIGKILL, NULL);
+  }
+}
+
+
 /*
  * End of "$Id: process.c 12104 2014-08-20 15:23:40Z msweet $".
  */
@@ -75,7 +75,8 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
     * Assign the file descriptor...
     */
 
-    sb->fd = fd;
+    sb->fd     = fd;
+    sb->bufptr = sb->buffer;
 
    /*
     * Format the prefix string, if any.  This is usually "[Job 123]"
@@ -108,6 +109,10 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
 
 /*
  * 'cupsdStatBufUpdate()' - Update the status buffer.
+ *
+ * Lines are consumed by advancing "bufptr", so a read that returns many lines
+ * only moves the remaining data to the front of the buffer once, before the
+ * next read.
  */
 
 char *					/* O - Line from buffer, "", or NULL */
@@ -126,12 +131,19 @@ cupsdStatBufUpdate(
   * Check if the buffer already contains a full line...
   */
 
-  if ((lineptr = strchr(sb->buffer, '\n')) == NULL)
+  if ((lineptr = strchr(sb->bufptr, '\n')) == NULL)
   {
    /*
-    * No, read more data...
+    * No, move any partial line to the front of the buffer and read more
+    * data...
     */
 
+    if (sb->bufptr > sb->buffer)
+    {
+      memmove(sb->buffer, sb->bufptr, (size_t)sb->bufused + 1);
+      sb->bufptr = sb->buffer;
+    }
+
     if ((bytes = read(sb->fd, sb->buffer + sb->bufused, (size_t)(CUPSD_SB_BUFFER_SIZE - sb->bufused - 1))) > 0)
     {
       sb->bufused += bytes;
@@ -196,80 +208,80 @@ cupsdStatBufUpdate(
   * Figure out the logging level...
   */
 
-  if (!strncmp(sb->buffer, "EMERG:", 6))
+  if (!strncmp(sb->bufptr, "EMERG:", 6))
   {
     *loglevel = CUPSD_LOG_EMERG;
-    message   = sb->buffer + 6;
+    message   = sb->bufptr + 6;
   }
-  else if (!strncmp(sb->buffer, "ALERT:", 6))
+  else if (!strncmp(sb->bufptr, "ALERT:", 6))
   {
     *loglevel = CUPSD_LOG_ALERT;
-    message   = sb->buffer + 6;
+    message   = sb->bufptr + 6;
   }
-  else if (!strncmp(sb->buffer, "CRIT:", 5))
+  else if (!strncmp(sb->bufptr, "CRIT:", 5))
   {
     *loglevel = CUPSD_LOG_CRIT;
-    message   = sb->buffer + 5;
+    message   = sb->bufptr + 5;
   }
-  else if (!strncmp(sb->buffer, "ERROR:", 6))
+  else if (!strncmp(sb->bufptr, "ERROR:", 6))
   {
     *loglevel = CUPSD_LOG_ERROR;
-    message   = sb->buffer + 6;
+    message   = sb->bufptr + 6;
   }
-  else if (!strncmp(sb->buffer, "WARNING:", 8))
+  else if (!strncmp(sb->bufptr, "WARNING:", 8))
   {
     *loglevel = CUPSD_LOG_WARN;
-    message   = sb->buffer + 8;
+    message   = sb->bufptr + 8;
   }
-  else if (!strncmp(sb->buffer, "NOTICE:", 7))
+  else if (!strncmp(sb->bufptr, "NOTICE:", 7))
   {
     *loglevel = CUPSD_LOG_NOTICE;
-    message   = sb->buffer + 7;
+    message   = sb->bufptr + 7;
   }
-  else if (!strncmp(sb->buffer, "INFO:", 5))
+  else if (!strncmp(sb->bufptr, "INFO:", 5))
   {
     *loglevel = CUPSD_LOG_INFO;
-    message   = sb->buffer + 5;
+    message   = sb->bufptr + 5;
   }
-  else if (!strncmp(sb->buffer, "DEBUG:", 6))
+  else if (!strncmp(sb->bufptr, "DEBUG:", 6))
   {
     *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer + 6;
+    message   = sb->bufptr + 6;
   }
-  else if (!strncmp(sb->buffer, "DEBUG2:", 7))
+  else if (!strncmp(sb->bufptr, "DEBUG2:", 7))
   {
     *loglevel = CUPSD_LOG_DEBUG2;
-    message   = sb->buffer + 7;
+    message   = sb->bufptr + 7;
   }
-  else if (!strncmp(sb->buffer, "PAGE:", 5))
+  else if (!strncmp(sb->bufptr, "PAGE:", 5))
   {
     *loglevel = CUPSD_LOG_PAGE;
-    message   = sb->buffer + 5;
+    message   = sb->bufptr + 5;
   }
-  else if (!strncmp(sb->buffer, "STATE:", 6))
+  else if (!strncmp(sb->bufptr, "STATE:", 6))
   {
     *loglevel = CUPSD_LOG_STATE;
-    message   = sb->buffer + 6;
+    message   = sb->bufptr + 6;
   }
-  else if (!strncmp(sb->buffer, "JOBSTATE:", 9))
+  else if (!strncmp(sb->bufptr, "JOBSTATE:", 9))
   {
     *loglevel = CUPSD_LOG_JOBSTATE;
-    message   = sb->buffer + 9;
+    message   = sb->bufptr + 9;
   }
-  else if (!strncmp(sb->buffer, "ATTR:", 5))
+  else if (!strncmp(sb->bufptr, "ATTR:", 5))
   {
     *loglevel = CUPSD_LOG_ATTR;
-    message   = sb->buffer + 5;
+    message   = sb->bufptr + 5;
   }
-  else if (!strncmp(sb->buffer, "PPD:", 4))
+  else if (!strncmp(sb->bufptr, "PPD:", 4))
   {
     *loglevel = CUPSD_LOG_PPD;
-    message   = sb->buffer + 4;
+    message   = sb->bufptr + 4;
   }
   else
   {
     *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer;
+    message   = sb->bufptr;
   }
 
  /*
@@ -298,7 +310,7 @@ cupsdStatBufUpdate(
 	cupsdLogMessage(*loglevel, "%s %s", sb->prefix, message);
     }
     else if (*loglevel < CUPSD_LOG_NONE && LogLevel >= CUPSD_LOG_DEBUG)
-      cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, sb->buffer);
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, sb->bufptr);
   }
 
  /*
@@ -308,16 +320,19 @@ cupsdStatBufUpdate(
   strlcpy(line, message, (size_t)linelen);
 
  /*
-  * Copy over the buffer data we've used up...
+  * Skip over the buffer data we've used up...
   */
 
-  if (lineptr < sb->buffer + sb->bufused)
-    _cups_strcpy(sb->buffer, lineptr);
+  sb->bufused -= lineptr - sb->bufptr;
 
-  sb->bufused -= lineptr - sb->buffer;
-
-  if (sb->bufused < 0)
-    sb->bufused = 0;
+  if (sb->bufused > 0)
+    sb->bufptr = lineptr;
+  else
+  {
+    sb->bufused   = 0;
+    sb->bufptr    = sb->buffer;
+    sb->buffer[0] = '\0';
+  }
 
   return (line);
 }
@@ -30,6 +30,7 @@ typedef struct				/**** Status buffer */
   int	fd;				/* File descriptor to read from */
   char	prefix[64];			/* Prefix for log messages */
   int	bufused;			/* How much is used in buffer */
+  char	*bufptr;			/* Start of unread data in buffer */
   char	buffer[CUPSD_SB_BUFFER_SIZE];	/* Buffer */
 } cupsd_statbuf_t;
 
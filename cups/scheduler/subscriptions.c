@@ -76,6 +76,9 @@ cupsdAddEvent(
 
   LastEvent |= event;
 
+  if ((event & CUPSD_EVENT_PRINTER_CHANGED) && dest)
+    cupsdUpdatePrinterListChangeCount(dest);
+
 #ifdef HAVE_DBUS
   cupsd_send_dbus(event, dest, job);
 #endif /* HAVE_DBUS */
@@ -1610,7 +1613,7 @@ cupsd_update_notifier(void)
     if (loglevel == CUPSD_LOG_INFO)
       cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
 
-    if (!strchr(NotifierStatusBuffer->buffer, '\n'))
+    if (!strchr(NotifierStatusBuffer->bufptr, '\n'))
       break;
   }
 }
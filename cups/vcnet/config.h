@@ -339,6 +339,7 @@ typedef unsigned long useconds_t;
 
 /* #undef HAVE_WAITPID */
 /* #undef HAVE_WAIT3 */
+/* #undef HAVE_WAIT4 */
 
 
 /*
@@ -650,6 +651,7 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_POLL */
 /* #undef HAVE_EPOLL */
 /* #undef HAVE_KQUEUE */
+/* #undef HAVE_SPLICE */
 
 
 /*
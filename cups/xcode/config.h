@@ -267,6 +267,7 @@
 
 #define HAVE_WAITPID 1
 #define HAVE_WAIT3 1
+#define HAVE_WAIT4 1
 
 
 /*
@@ -564,6 +565,7 @@
 #define HAVE_POLL 1
 /* #undef HAVE_EPOLL */
 #define HAVE_KQUEUE 1
+/* #undef HAVE_SPLICE */
 
 
 /*